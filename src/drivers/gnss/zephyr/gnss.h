@@ -60,7 +60,7 @@ typedef struct {
 	/** Height above ellipsoid [dm].*/
 	int16_t height;
 
-	/** 2-D speed [cm/s]*/
+	/** 2-D speed [mm/s]*/
 	uint16_t speed;
 
 	/** Movement direction (-18000 to 18000 Hundred-deg).*/
@@ -90,12 +90,19 @@ typedef struct {
 	/** Milliseconds system time when data was updated from GNSS.*/
 	uint32_t updated_at;
 
+	/** k_cycle_get_32() when the UBX-NAV-PVT message arrived, used to
+	 *  measure the latency of the following processing.
+	 */
+	uint32_t pvt_cycles;
+
 	/** UBX-NAV-STATUS milliseconds since receiver start or reset.*/
 	uint32_t msss;
 
 	/** UBX-NAV-STATUS milliseconds since First Fix.*/
 	uint32_t ttff;
 
+	/** UBX-NAV-SAT C/N0 [dBHz] of SV 27, then minimum, maximum and average
+	 *  over the satellites above 0 dBHz.*/
 	uint8_t cno[4];
 
 	/** Proprietary mode, to verify that any corrections are done when GNSS is in MAX performance */
@@ -121,6 +128,7 @@ typedef struct {
 	uint32_t msss;
 	gnss_mode_t mode;
 	uint32_t updated_at;
+	uint32_t pvt_cycles;
 	gnss_pl_t pl;
 } gnss_last_fix_struct_t;
 
@@ -191,6 +199,65 @@ typedef int (*gnss_version_get_t)(const struct device *dev,
  */
 typedef int (*gnss_upload_assist_data_t)(const struct device *dev, uint8_t *data, uint32_t size);
 
+/** @brief Result of a bulk upload of assistance data. */
+struct gnss_assist_stats {
+	/** Messages accepted by the receiver. */
+	uint16_t accepted;
+	/** Messages rejected by the receiver, or never acknowledged, after all
+	 *  retransmissions. */
+	uint16_t rejected;
+	/** Retransmissions of rejected messages. */
+	uint16_t retransmitted;
+	/** Duration of the upload in milliseconds. */
+	uint32_t duration_ms;
+};
+
+/**
+ * @typedef gnss_upload_assist_data_bulk_t
+ * @brief Callback API for sending many assistance data messages to GNSS receiver
+ *
+ * See gnss_upload_assist_data_bulk() for argument description
+ */
+typedef int (*gnss_upload_assist_data_bulk_t)(const struct device *dev, const uint8_t *data,
+					      uint32_t stride, uint16_t count,
+					      struct gnss_assist_stats *stats);
+
+/** @brief Last known position and current time, given to the receiver before
+ *         its navigation database is restored. */
+struct gnss_nav_hint {
+	/** Set if the position is known. */
+	bool has_pos;
+	int32_t lat;
+	int32_t lon;
+	/** Height above ellipsoid [dm]. */
+	int16_t height;
+	/** Position accuracy [m]. */
+	uint32_t pos_acc_m;
+	/** UTC time in seconds since the epoch, 0 if unknown. */
+	int64_t unix_time;
+	/** Time accuracy [s]. */
+	uint16_t time_acc_s;
+};
+
+/**
+ * @typedef gnss_get_nav_db_t
+ * @brief Callback API for reading the navigation database of GNSS receiver
+ *
+ * See gnss_get_nav_db() for argument description
+ */
+typedef int (*gnss_get_nav_db_t)(const struct device *dev, uint8_t *buf, uint32_t max_size,
+				 uint32_t *size);
+
+/**
+ * @typedef gnss_restore_nav_db_t
+ * @brief Callback API for restoring the navigation database of GNSS receiver
+ *
+ * See gnss_restore_nav_db() for argument description
+ */
+typedef int (*gnss_restore_nav_db_t)(const struct device *dev, const struct gnss_nav_hint *hint,
+				     const uint8_t *buf, uint32_t size,
+				     struct gnss_assist_stats *stats);
+
 /**
  * @typedef gnss_set_rate_t
  * @brief Callback API for setting rate of GNSS receiver
@@ -247,6 +314,15 @@ typedef int (*gnss_wakeup_t)(const struct device *dev);
  */
 typedef int (*gnss_set_power_mode_t)(const struct device *dev, gnss_mode_t mode);
 
+/**
+ * @typedef gnss_set_power_mode_rate_t
+ * @brief API for setting the receiver Power mode with a given update rate
+ *
+ * See gnss_set_power_mode_rate() for argument description
+ */
+typedef int (*gnss_set_power_mode_rate_t)(const struct device *dev, gnss_mode_t mode,
+					  uint16_t rate_ms);
+
 /**
  * @typedef gnss_resetn_pin_t
  * @brief API for hard reset of the receiver using external resetn pin.
@@ -260,6 +336,9 @@ __subsystem struct gnss_driver_api {
 	gnss_reset_t gnss_reset;
 	gnss_version_get_t gnss_version_get;
 	gnss_upload_assist_data_t gnss_upload_assist_data;
+	gnss_upload_assist_data_bulk_t gnss_upload_assist_data_bulk;
+	gnss_get_nav_db_t gnss_get_nav_db;
+	gnss_restore_nav_db_t gnss_restore_nav_db;
 	gnss_set_rate_t gnss_set_rate;
 	gnss_get_rate_t gnss_get_rate;
 	gnss_set_data_cb_t gnss_set_data_cb;
@@ -267,6 +346,7 @@ __subsystem struct gnss_driver_api {
 	gnss_set_backup_mode_t gnss_set_backup_mode;
 	gnss_wakeup_t gnss_wakeup;
 	gnss_set_power_mode_t gnss_set_power_mode;
+	gnss_set_power_mode_rate_t gnss_set_power_mode_rate;
 	gnss_resetn_pin_t gnss_resetn_pin;
 };
 
@@ -337,6 +417,81 @@ static inline int gnss_upload_assist_data(const struct device *dev, uint8_t *dat
 	return api->gnss_upload_assist_data(dev, data, size);
 }
 
+/**
+ * @brief Send many assistance data messages to GNSS receiver, keeping several
+ *        messages in flight instead of waiting for the ack of each message.
+ *        Rejected messages are retransmitted.
+ *
+ * @param[in] dev Pointer to the GNSS device
+ * @param[in] data Payload of the first MGA-ANO message, 76 bytes.
+ * @param[in] stride Distance in bytes from one payload to the next.
+ * @param[in] count Number of messages.
+ * @param[out] stats Result of the upload, also when it fails.
+ * 
+ * @return 0 if all messages were sent, error code otherwise
+ */
+static inline int gnss_upload_assist_data_bulk(const struct device *dev, const uint8_t *data,
+					       uint32_t stride, uint16_t count,
+					       struct gnss_assist_stats *stats)
+{
+	const struct gnss_driver_api *api = (const struct gnss_driver_api *)dev->api;
+
+	if (api->gnss_upload_assist_data_bulk == NULL) {
+		return -ENOSYS;
+	}
+	return api->gnss_upload_assist_data_bulk(dev, data, stride, count, stats);
+}
+
+/**
+ * @brief Read the navigation database of GNSS receiver, i.e. ephemerides,
+ *        almanacs and the other data needed for a hot start. The database
+ *        is kept as the messages sent by the receiver, to be given back
+ *        unmodified to gnss_restore_nav_db().
+ *
+ * @param[in] dev Pointer to the GNSS device
+ * @param[out] buf Buffer for the database.
+ * @param[in] max_size Size of buffer.
+ * @param[out] size Size of the database.
+ * 
+ * @return 0 if everything was ok, -ENOBUFS if the database does not fit,
+ *         error code otherwise
+ */
+static inline int gnss_get_nav_db(const struct device *dev, uint8_t *buf, uint32_t max_size,
+				  uint32_t *size)
+{
+	const struct gnss_driver_api *api = (const struct gnss_driver_api *)dev->api;
+
+	if (api->gnss_get_nav_db == NULL) {
+		return -ENOSYS;
+	}
+	return api->gnss_get_nav_db(dev, buf, max_size, size);
+}
+
+/**
+ * @brief Restore a navigation database read with gnss_get_nav_db(), after
+ *        giving the receiver the time and last known position. Outdated
+ *        data is discarded by the receiver.
+ *
+ * @param[in] dev Pointer to the GNSS device
+ * @param[in] hint Time and position, or NULL if neither is known.
+ * @param[in] buf Navigation database.
+ * @param[in] size Size of the database.
+ * @param[out] stats Result of the upload, also when it fails.
+ * 
+ * @return 0 if all messages were sent, error code otherwise
+ */
+static inline int gnss_restore_nav_db(const struct device *dev,
+				      const struct gnss_nav_hint *hint, const uint8_t *buf,
+				      uint32_t size, struct gnss_assist_stats *stats)
+{
+	const struct gnss_driver_api *api = (const struct gnss_driver_api *)dev->api;
+
+	if (api->gnss_restore_nav_db == NULL) {
+		return -ENOSYS;
+	}
+	return api->gnss_restore_nav_db(dev, hint, buf, size, stats);
+}
+
 /**
  * @brief Get rate of GNSS receiver
  *
@@ -434,6 +589,25 @@ static inline int gnss_set_power_mode(const struct device *dev, gnss_mode_t mode
 	return api->gnss_set_power_mode(dev, mode);
 }
 
+/**
+ * @brief sets the domain-specific power-mode of the receiver, with an update
+ *        rate other than the default rate of the mode
+ * @param[in] dev Pointer to the GNSS device
+ * @param[in] mode Power mode
+ * @param[in] rate_ms Update rate in milliseconds, 0 for the default rate
+ * @return 0 if OK, -ENOSYS if not supported, negative error code otherwise
+ */
+static inline int gnss_set_power_mode_rate(const struct device *dev, gnss_mode_t mode,
+					   uint16_t rate_ms)
+{
+	const struct gnss_driver_api *api = (const struct gnss_driver_api *)dev->api;
+
+	if (api->gnss_set_power_mode_rate == NULL) {
+		return -ENOSYS;
+	}
+	return api->gnss_set_power_mode_rate(dev, mode, rate_ms);
+}
+
 /**
 * @brief Hard reset of the receiver after starting the device.
 * @param[in] dev Pointer to the GNSS device
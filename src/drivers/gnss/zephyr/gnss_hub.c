@@ -14,15 +14,19 @@
   *     GNSS_HUB_ID_UART <-> GNSS_HUB_ID_DIAGNOSTICS
   * Simulator: 
   *     GNSS_HUB_ID_DIAGNOSTICS <-> GNSS_HUB_ID_DRIVER
+  *
+  * Every ring buffer has a single producer and a single consumer, the UART
+  * interrupt on one side and a thread on the other, so neither side needs to
+  * block the other when putting or consuming data.
   */
 static uint8_t *gnss_tx_buffer = NULL;
 static struct ring_buf gnss_tx_ring_buf;
 
 static uint8_t *gnss_rx_buffer = NULL;
-static uint32_t gnss_rx_cnt = 0;
+static struct ring_buf gnss_rx_ring_buf;
 
 static uint8_t *gnss_rx_2_buffer = NULL;
-static uint32_t gnss_rx_2_cnt = 0;
+static struct ring_buf gnss_rx_2_ring_buf;
 
 /* Semaphore for notifying about available data */
 static struct k_sem *gnss_rx_sem;
@@ -44,7 +48,7 @@ int gnss_hub_init(const struct device *uart_dev, struct k_sem *rx_sem, uint32_t
 		if (gnss_rx_buffer == NULL) {
 			return -ENOBUFS;
 		}
-		gnss_rx_cnt = 0;
+		ring_buf_init(&gnss_rx_ring_buf, CONFIG_GNSS_COMM_BUFFER_SIZE, gnss_rx_buffer);
 	}
 	if (gnss_tx_buffer == NULL) {
 		gnss_tx_buffer = k_malloc(CONFIG_GNSS_COMM_BUFFER_SIZE);
@@ -80,7 +84,8 @@ int gnss_hub_configure(uint8_t mode)
 			if (gnss_rx_2_buffer == NULL) {
 				return -ENOBUFS;
 			}
-			gnss_rx_2_cnt = 0;
+			ring_buf_init(&gnss_rx_2_ring_buf, CONFIG_GNSS_COMM_BUFFER_SIZE,
+				      gnss_rx_2_buffer);
 		}
 	} else if (mode == GNSS_HUB_MODE_SIMULATOR) {
 		/* Simulator mode is diagnostics connected to driver */
@@ -121,19 +126,12 @@ int gnss_hub_send(uint8_t hub_id, uint8_t *buffer, uint32_t cnt)
 		}
 	} else if ((hub_id == GNSS_HUB_ID_UART) &&
 		   ((hub_mode == GNSS_HUB_MODE_DEFAULT) || (hub_mode == GNSS_HUB_MODE_SNIFFER))) {
-		/* Put data into main buffer */
-		uint32_t free_space = CONFIG_GNSS_COMM_BUFFER_SIZE - gnss_rx_cnt;
-		uint32_t to_copy = MIN(cnt, free_space);
-		memcpy(&gnss_rx_buffer[gnss_rx_cnt], buffer, to_copy);
-		gnss_rx_cnt += to_copy;
+		/* Put data into main buffer, data not fitting is dropped */
+		ring_buf_put(&gnss_rx_ring_buf, buffer, cnt);
 
 		if (hub_mode == GNSS_HUB_MODE_SNIFFER) {
 			/* Put data into sniffer buffer */
-			uint32_t free_space = CONFIG_GNSS_COMM_BUFFER_SIZE - gnss_rx_2_cnt;
-			uint32_t to_copy = MIN(cnt, free_space);
-
-			memcpy(&gnss_rx_2_buffer[gnss_rx_2_cnt], buffer, to_copy);
-			gnss_rx_2_cnt += to_copy;
+			ring_buf_put(&gnss_rx_2_ring_buf, buffer, cnt);
 
 			if (diag_data_cb != NULL) {
 				diag_data_cb();
@@ -144,10 +142,7 @@ int gnss_hub_send(uint8_t hub_id, uint8_t *buffer, uint32_t cnt)
 		k_sem_give(gnss_rx_sem);
 	} else if ((hub_id == GNSS_HUB_ID_DIAGNOSTICS) && (hub_mode == GNSS_HUB_MODE_SIMULATOR)) {
 		/* Put data into main buffer */
-		uint32_t free_space = CONFIG_GNSS_COMM_BUFFER_SIZE - gnss_rx_cnt;
-		uint32_t to_copy = MIN(cnt, free_space);
-		memcpy(&gnss_rx_buffer[gnss_rx_cnt], buffer, to_copy);
-		gnss_rx_cnt += to_copy;
+		ring_buf_put(&gnss_rx_ring_buf, buffer, cnt);
 
 		/* Notify driver */
 		k_sem_give(gnss_rx_sem);
@@ -164,11 +159,11 @@ bool gnss_hub_rx_is_empty(uint8_t hub_id)
 	if ((hub_id == GNSS_HUB_ID_DRIVER) &&
 	    ((hub_mode == GNSS_HUB_MODE_DEFAULT) || (hub_mode == GNSS_HUB_MODE_SNIFFER) ||
 	     (hub_mode == GNSS_HUB_MODE_SIMULATOR))) {
-		return (gnss_rx_cnt == 0);
+		return ring_buf_is_empty(&gnss_rx_ring_buf);
 	} else if ((hub_id == GNSS_HUB_ID_DIAGNOSTICS) && (hub_mode == GNSS_HUB_MODE_SIMULATOR)) {
 		return ring_buf_is_empty(&gnss_tx_ring_buf);
 	} else if ((hub_id == GNSS_HUB_ID_DIAGNOSTICS) && (hub_mode == GNSS_HUB_MODE_SNIFFER)) {
-		return (gnss_rx_2_cnt == 0);
+		return ring_buf_is_empty(&gnss_rx_2_ring_buf);
 	} else if ((hub_id == GNSS_HUB_ID_UART) &&
 		   ((hub_mode == GNSS_HUB_MODE_DEFAULT) || (hub_mode == GNSS_HUB_MODE_SNIFFER))) {
 		return ring_buf_is_empty(&gnss_tx_ring_buf);
@@ -184,13 +179,12 @@ int gnss_hub_rx_get_data(uint8_t hub_id, uint8_t **buffer, uint32_t *cnt)
 	if ((hub_id == GNSS_HUB_ID_DRIVER) &&
 	    ((hub_mode == GNSS_HUB_MODE_DEFAULT) || (hub_mode == GNSS_HUB_MODE_SNIFFER) ||
 	     (hub_mode == GNSS_HUB_MODE_SIMULATOR))) {
-		*cnt = gnss_rx_cnt;
-		*buffer = gnss_rx_buffer;
+		*cnt = ring_buf_get_claim(&gnss_rx_ring_buf, buffer, CONFIG_GNSS_COMM_BUFFER_SIZE);
 	} else if ((hub_id == GNSS_HUB_ID_DIAGNOSTICS) && (hub_mode == GNSS_HUB_MODE_SIMULATOR)) {
 		*cnt = ring_buf_get_claim(&gnss_tx_ring_buf, buffer, CONFIG_GNSS_COMM_BUFFER_SIZE);
 	} else if ((hub_id == GNSS_HUB_ID_DIAGNOSTICS) && (hub_mode == GNSS_HUB_MODE_SNIFFER)) {
-		*cnt = gnss_rx_2_cnt;
-		*buffer = gnss_rx_2_buffer;
+		*cnt = ring_buf_get_claim(&gnss_rx_2_ring_buf, buffer,
+					  CONFIG_GNSS_COMM_BUFFER_SIZE);
 	} else if ((hub_id == GNSS_HUB_ID_UART) &&
 		   ((hub_mode == GNSS_HUB_MODE_DEFAULT) || (hub_mode == GNSS_HUB_MODE_SNIFFER))) {
 		*cnt = ring_buf_get_claim(&gnss_tx_ring_buf, buffer, CONFIG_GNSS_COMM_BUFFER_SIZE);
@@ -208,39 +202,11 @@ int gnss_hub_rx_consume(uint8_t hub_id, uint32_t cnt)
 	if ((hub_id == GNSS_HUB_ID_DRIVER) &&
 	    ((hub_mode == GNSS_HUB_MODE_DEFAULT) || (hub_mode == GNSS_HUB_MODE_SNIFFER) ||
 	     (hub_mode == GNSS_HUB_MODE_SIMULATOR))) {
-		if (cnt > gnss_rx_cnt) {
-			cnt = gnss_rx_cnt;
-		}
-
-		/* Consume data from buffer. It is necessary to block
-		* UART RX interrupt to avoid concurrent update of counter
-		* and buffer area. Preemption of thread must be disabled
-		* to minimize the time UART RX interrupts are disabled. 
-		*/
-		gnss_uart_block(true);
-
-		memmove(gnss_rx_buffer, &gnss_rx_buffer[cnt], gnss_rx_cnt - cnt);
-		gnss_rx_cnt -= cnt;
-
-		gnss_uart_block(false);
+		err = ring_buf_get_finish(&gnss_rx_ring_buf, cnt);
 	} else if ((hub_id == GNSS_HUB_ID_DIAGNOSTICS) && (hub_mode == GNSS_HUB_MODE_SIMULATOR)) {
 		err = ring_buf_get_finish(&gnss_tx_ring_buf, cnt);
 	} else if ((hub_id == GNSS_HUB_ID_DIAGNOSTICS) && (hub_mode == GNSS_HUB_MODE_SNIFFER)) {
-		if (cnt > gnss_rx_2_cnt) {
-			cnt = gnss_rx_2_cnt;
-		}
-
-		/* Consume data from buffer. It is necessary to block
-		* UART RX interrupt to avoid concurrent update of counter
-		* and buffer area. Preemption of thread must be disabled
-		* to minimize the time UART RX interrupts are disabled. 
-		*/
-		gnss_uart_block(true);
-
-		memmove(gnss_rx_2_buffer, &gnss_rx_2_buffer[cnt], gnss_rx_2_cnt - cnt);
-		gnss_rx_2_cnt -= cnt;
-
-		gnss_uart_block(false);
+		err = ring_buf_get_finish(&gnss_rx_2_ring_buf, cnt);
 	} else if (hub_id == GNSS_HUB_ID_UART) {
 		err = ring_buf_get_finish(&gnss_tx_ring_buf, cnt);
 	} else {
@@ -253,8 +219,8 @@ int gnss_hub_rx_consume(uint8_t hub_id, uint32_t cnt)
 int gnss_hub_flush_all(void)
 {
 	gnss_uart_block(true);
-	gnss_rx_cnt = 0;
-	gnss_rx_2_cnt = 0;
+	ring_buf_reset(&gnss_rx_ring_buf);
+	ring_buf_reset(&gnss_rx_2_ring_buf);
 	ring_buf_reset(&gnss_tx_ring_buf);
 	gnss_uart_block(false);
 
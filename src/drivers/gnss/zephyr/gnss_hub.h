@@ -87,7 +87,10 @@ int gnss_hub_send(uint8_t hub_id, uint8_t *buffer, uint32_t cnt);
 bool gnss_hub_rx_is_empty(uint8_t hub_id);
 
 /**
- * @brief Get data buffers for specified receiver ID. 
+ * @brief Get data buffers for specified receiver ID. The data is claimed in
+ *        place from a ring buffer, so only the part up to the end of the
+ *        buffer is returned when the data wraps around. The rest is returned
+ *        by the next call after consuming.
  *
  * @param[in] hub_id ID of receiver.
  * @param[out] buffer Pointer to buffer holding data. 
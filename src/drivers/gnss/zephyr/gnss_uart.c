@@ -18,6 +18,102 @@ static const struct device *gnss_uart_dev = NULL;
 static atomic_t gnss_uart_baudrate_change_req = ATOMIC_INIT(0x0);
 static uint32_t gnss_uart_baudrate = 0;
 
+#if CONFIG_GNSS_UART_ASYNC
+/* Received data is written by DMA alternately into the two buffers */
+static uint8_t gnss_uart_rx_buf[2][CONFIG_GNSS_UART_ASYNC_RX_BUF_SIZE];
+static uint8_t gnss_uart_rx_buf_next = 0;
+
+/* Set while a DMA transmit is ongoing, the transmitted data is consumed from 
+ * the TX buffer when it is done. */
+static atomic_t gnss_uart_tx_busy = ATOMIC_INIT(0x0);
+
+static unsigned int gnss_uart_irq_key;
+
+/**
+ * @brief Starts a DMA transmit of the data in the TX buffer, unless one is 
+ *        already ongoing. A requested baudrate change is performed when 
+ *        there is no more data to send. 
+ */
+static void gnss_uart_async_tx_next(void)
+{
+	while (!atomic_test_and_set_bit(&gnss_uart_tx_busy, 0)) {
+		uint8_t *data;
+		uint32_t size;
+
+		if ((gnss_hub_rx_get_data(GNSS_HUB_ID_UART, &data, &size) == 0) && (size > 0)) {
+			if (uart_tx(gnss_uart_dev, data, size, SYS_FOREVER_MS) == 0) {
+				return;
+			}
+			LOG_ERR("Failed starting GNSS TX.");
+		}
+		gnss_hub_rx_consume(GNSS_HUB_ID_UART, 0);
+
+		if (atomic_test_and_clear_bit(&gnss_uart_baudrate_change_req, 0)) {
+			gnss_uart_set_baudrate(gnss_uart_baudrate, true);
+		}
+		atomic_clear_bit(&gnss_uart_tx_busy, 0);
+
+		/* Data may have been added while busy, check again */
+		if (gnss_hub_rx_is_empty(GNSS_HUB_ID_UART)) {
+			return;
+		}
+	}
+}
+
+/**
+ * @brief Starts DMA reception into the first receive buffer. 
+ * 
+ * @return 0 if everything was ok, error code otherwise
+ */
+static int gnss_uart_async_rx_start(void)
+{
+	gnss_uart_rx_buf_next = 1;
+	return uart_rx_enable(gnss_uart_dev, gnss_uart_rx_buf[0], sizeof(gnss_uart_rx_buf[0]),
+			      CONFIG_GNSS_UART_ASYNC_RX_TIMEOUT_MS);
+}
+
+/**
+ * @brief Handles events from UART device in asynchronous mode. Received data
+ *        is passed on once per buffer or idle line, not per FIFO read. 
+ * 
+ * @param[in] uart_dev UART device to handle events for. 
+ * @param[in] evt Event from UART device. 
+ */
+static void gnss_uart_async_cb(const struct device *uart_dev, struct uart_event *evt,
+			       void *user_data)
+{
+	switch (evt->type) {
+	case UART_TX_DONE:
+	case UART_TX_ABORTED:
+		if (gnss_hub_rx_consume(GNSS_HUB_ID_UART, evt->data.tx.len) != 0) {
+			LOG_ERR("Failed finishing GNSS TX buffer operation.");
+		}
+		atomic_clear_bit(&gnss_uart_tx_busy, 0);
+		gnss_uart_async_tx_next();
+		break;
+	case UART_RX_RDY:
+		gnss_hub_send(GNSS_HUB_ID_UART, &evt->data.rx.buf[evt->data.rx.offset],
+			      evt->data.rx.len);
+		break;
+	case UART_RX_BUF_REQUEST:
+		uart_rx_buf_rsp(uart_dev, gnss_uart_rx_buf[gnss_uart_rx_buf_next],
+				sizeof(gnss_uart_rx_buf[0]));
+		gnss_uart_rx_buf_next ^= 1;
+		break;
+	case UART_RX_STOPPED:
+		LOG_WRN("GNSS RX stopped, reason %d", evt->data.rx_stop.reason);
+		break;
+	case UART_RX_DISABLED:
+		/* Reception is disabled after an error, restart it */
+		if (gnss_uart_async_rx_start() != 0) {
+			LOG_ERR("Failed restarting GNSS RX.");
+		}
+		break;
+	default:
+		break;
+	}
+}
+#else
 /**
  * @brief Flushes all data from UART device. 
  * 
@@ -107,6 +203,7 @@ static void gnss_uart_isr(const struct device *uart_dev, void *user_data)
 		}
 	}
 }
+#endif /* CONFIG_GNSS_UART_ASYNC */
 
 int gnss_uart_init(const struct device *uart_dev, struct k_sem *rx_sem, uint32_t baudrate)
 {
@@ -120,6 +217,16 @@ int gnss_uart_init(const struct device *uart_dev, struct k_sem *rx_sem, uint32_t
 	gnss_uart_dev = uart_dev;
 	gnss_uart_baudrate = baudrate;
 
+#if CONFIG_GNSS_UART_ASYNC
+	int err = uart_callback_set(gnss_uart_dev, gnss_uart_async_cb, NULL);
+	if (err != 0) {
+		return err;
+	}
+	err = gnss_uart_async_rx_start();
+	if ((err != 0) && (err != -EBUSY)) {
+		return err;
+	}
+#else
 	/* Make sure interrupts are disabled */
 	uart_irq_rx_disable(gnss_uart_dev);
 	uart_irq_tx_disable(gnss_uart_dev);
@@ -128,6 +235,7 @@ int gnss_uart_init(const struct device *uart_dev, struct k_sem *rx_sem, uint32_t
 	gnss_uart_flush(gnss_uart_dev);
 	uart_irq_callback_set(gnss_uart_dev, gnss_uart_isr);
 	uart_irq_rx_enable(gnss_uart_dev);
+#endif
 
 	return 0;
 }
@@ -178,12 +286,26 @@ int gnss_uart_set_baudrate(uint32_t baudrate, bool immediate)
 
 int gnss_uart_start_send(void)
 {
+#if CONFIG_GNSS_UART_ASYNC
+	gnss_uart_async_tx_next();
+#else
 	uart_irq_tx_enable(gnss_uart_dev);
+#endif
 	return 0;
 }
 
 void gnss_uart_block(bool block)
 {
+#if CONFIG_GNSS_UART_ASYNC
+	/* DMA keeps receiving, only the event callback is held back */
+	if (block) {
+		k_sched_lock();
+		gnss_uart_irq_key = irq_lock();
+	} else {
+		irq_unlock(gnss_uart_irq_key);
+		k_sched_unlock();
+	}
+#else
 	if (block) {
 		k_sched_lock();
 		uart_irq_rx_disable(gnss_uart_dev);
@@ -191,4 +313,5 @@ void gnss_uart_block(bool block)
 		uart_irq_rx_enable(gnss_uart_dev);
 		k_sched_unlock();
 	}
+#endif
 }
\ No newline at end of file
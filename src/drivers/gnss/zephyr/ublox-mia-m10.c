@@ -12,7 +12,6 @@
 #include "gnss.h"
 #include "gnss_hub.h"
 #include "ublox_protocol.h"
-#include "nmea_parser.h"
 
 LOG_MODULE_REGISTER(MIA_M10, CONFIG_GNSS_LOG_LEVEL);
 
@@ -42,30 +41,89 @@ static bool cmd_ack = false;
 static uint8_t cmd_buf[CONFIG_GNSS_MIA_M10_CMD_MAX_SIZE];
 static uint32_t cmd_size = 0;
 
-/* ANO data ack result */
-static struct k_sem mga_ack_sem;
-static bool mga_ack = false;
+/* Assistance data upload. MGA-ACKs are queued by the parser thread and
+ * matched to the messages in flight by the uploading thread. The messages
+ * are built in a buffer of their own, so cmd_mutex is only held while
+ * sending them.
+ */
+static struct k_mutex mga_mutex;
+K_MSGQ_DEFINE(mga_ack_msgq, sizeof(struct ublox_mga_ack), CONFIG_GNSS_MIA_M10_MGA_WINDOW, 1);
+static uint8_t mga_buf[CONFIG_GNSS_MIA_M10_CMD_MAX_SIZE];
+
+/* Size of a UBX message with the given payload size. */
+#define MIA_M10_UBX_SIZE(payload_size)                                                             \
+	(sizeof(struct ublox_header) + (payload_size) + sizeof(union ublox_checksum))
+
+/* Bytes of messages in flight, leaving room for a command in the TX buffer. */
+#define MIA_M10_MGA_TX_BUDGET (CONFIG_GNSS_COMM_BUFFER_SIZE - CONFIG_GNSS_MIA_M10_CMD_MAX_SIZE)
+
+/** @brief Assistance data message in flight. */
+struct mia_m10_mga_slot {
+	bool used;
+	/** Index of the message in the upload. */
+	uint16_t index;
+	/** Offset of the message in the upload data. */
+	uint32_t offset;
+	/** Size of the message as sent. */
+	uint16_t size;
+	/** Number of times the message has been sent. */
+	uint8_t tries;
+	/** Order in which the message was sent. */
+	uint32_t seq;
+};
+
+struct mia_m10_mga_upload {
+	const uint8_t *data;
+	/** Distance between MGA-ANO payloads, or 0 if data holds complete 
+	 *  UBX-MGA messages. */
+	uint32_t stride;
+	/** Offset of the next message not yet sent. */
+	uint32_t next_offset;
+	uint32_t seq;
+	uint8_t in_flight;
+	uint32_t bytes_in_flight;
+	struct gnss_assist_stats *stats;
+	struct mia_m10_mga_slot slots[CONFIG_GNSS_MIA_M10_MGA_WINDOW];
+};
+
+/* Navigation database being read, filled by the parser thread with the
+ * MGA-DBD messages from the receiver.
+ */
+static struct k_spinlock nav_db_lock;
+static K_SEM_DEFINE(nav_db_sem, 0, 1);
+static struct {
+	uint8_t *buf;
+	uint32_t max_size;
+	uint32_t size;
+	bool overflow;
+} nav_db;
 
 /* Semaphore for signalling thread about received data. */
 struct k_sem gnss_rx_sem;
 
-/* GNSS data is aggregated from three messages; NAV-PVT, NAV-DOP and 
- * NAV-STATUS. The time of week in the messages is used to find what
- * data belongs together. When a new TOW is encountered, the flags 
+/* GNSS data is aggregated from four messages; NAV-PVT, NAV-DOP, 
+ * NAV-STATUS and NAV-PL. The time of week in the messages is used to find
+ * what data belongs together. When a new TOW is encountered, the flags 
  * and buffers are reset. Data is copied and flag is set for each
  * incoming message. When all flags are set, a new GNSS data packet
  * is ready for use. 
+ * NAV-SAT is output at a lower rate, see CONFIG_GNSS_MIA_M10_NAV_SAT_RATE,
+ * and its C/N0 statistics are merged into the following packets.
  */
 #define GNSS_DATA_FLAG_NAV_DOP (1 << 0)
 #define GNSS_DATA_FLAG_NAV_PVT (1 << 1)
 #define GNSS_DATA_FLAG_NAV_STATUS (1 << 2)
 #define GNSS_DATA_FLAG_NAV_PL (1 << 3)
-#define GNSS_DATA_FLAG_NAV_SAT (1 << 4)
+#define GNSS_DATA_FLAGS_EPOCH                                                                      \
+	(GNSS_DATA_FLAG_NAV_DOP | GNSS_DATA_FLAG_NAV_PVT | GNSS_DATA_FLAG_NAV_STATUS |             \
+	 GNSS_DATA_FLAG_NAV_PL)
 
 static uint32_t gnss_data_flags = 0;
 static gnss_struct_t gnss_data_in_progress;
 static uint32_t gnss_tow_in_progress = 0;
 static uint64_t gnss_unix_timestamp = 0;
+/** @brief C/N0 statistics from the last NAV-SAT, see gnss_struct_t.cno */
+static uint8_t gnss_sat_cno[4];
 /** @brief, needed to fill the current mode in GNSS data reports */
 static gnss_mode_t gnss_current_mode = GNSSMODE_NOMODE;
 
@@ -111,7 +169,7 @@ static int mia_m10_sync_tow(uint32_t tow)
 }
 
 /**
- * @brief Register new piece of the GNSS data, (PVT, DOP or STATUS). 
+ * @brief Register new piece of the GNSS data, (PVT, DOP, STATUS or PL). 
  *        Data is signalled as ready for use when all pieces are registered. 
  *
  * @param[in] flag Flag of current piece of data. 
@@ -121,17 +179,11 @@ static int mia_m10_sync_tow(uint32_t tow)
 static int mia_m10_sync_complete(uint32_t flag)
 {
 	gnss_data_flags |= flag;
-#ifdef CONFIG_ZTEST
-	if (gnss_data_flags == (GNSS_DATA_FLAG_NAV_DOP | GNSS_DATA_FLAG_NAV_PVT |
-				GNSS_DATA_FLAG_NAV_STATUS | GNSS_DATA_FLAG_NAV_PL)) {
-#else
-	if (gnss_data_flags ==
-	    (GNSS_DATA_FLAG_NAV_DOP | GNSS_DATA_FLAG_NAV_PVT | GNSS_DATA_FLAG_NAV_STATUS |
-	     GNSS_DATA_FLAG_NAV_PL | GNSS_DATA_FLAG_NAV_SAT)) {
-#endif
+	if (gnss_data_flags == GNSS_DATA_FLAGS_EPOCH) {
 		/* Copy data from "in progress" to "working", and call callbacks */
 		if (k_mutex_lock(&gnss_data_mutex, K_MSEC(10)) == 0) {
 			memcpy(&gnss_data.latest, &gnss_data_in_progress, sizeof(gnss_struct_t));
+			memcpy(gnss_data.latest.cno, gnss_sat_cno, sizeof(gnss_data.latest.cno));
 
 			gnss_data.latest.updated_at = k_uptime_get_32();
 			gnss_data_is_valid = true;
@@ -150,6 +202,7 @@ static int mia_m10_sync_complete(uint32_t flag)
 				gnss_data.lastfix.height = gnss_data.latest.height;
 				gnss_data.lastfix.msss = gnss_data.latest.msss;
 				gnss_data.lastfix.updated_at = gnss_data.latest.updated_at;
+				gnss_data.lastfix.pvt_cycles = gnss_data.latest.pvt_cycles;
 
 				/* Report the last set mode for statistics collection */
 				gnss_data.lastfix.mode = gnss_data.latest.mode;
@@ -208,10 +261,12 @@ static uint64_t mia_m10_nav_pvt_to_unix_time(struct ublox_nav_pvt *nav_pvt)
 static int mia_m10_nav_pvt_handler(void *context, void *payload, uint32_t size)
 {
 	struct ublox_nav_pvt *nav_pvt = payload;
+	uint32_t pvt_cycles = k_cycle_get_32();
 
 	mia_m10_sync_tow(nav_pvt->iTOW);
 	/* As PVT is the main driver for the solution, set the current mode when receiving it */
 	gnss_data_in_progress.mode = gnss_current_mode;
+	gnss_data_in_progress.pvt_cycles = pvt_cycles;
 	gnss_data_in_progress.pvt_flags = nav_pvt->flags;
 	gnss_data_in_progress.pvt_valid = nav_pvt->valid;
 	gnss_data_in_progress.lon = nav_pvt->lon;
@@ -325,7 +380,9 @@ static int mia_m10_nav_pl_handler(void *context, void *payload, uint32_t size)
 }
 
 /**
- * @brief Handler for incoming NAV-SAT message.
+ * @brief Handler for incoming NAV-SAT message. The C/N0 statistics are 
+ *        not part of the epoch sync, they are kept until the next NAV-SAT
+ *        and added to every GNSS data packet until then.
  *
  * @param[in] context Context is unused.
  * @param[in] payload Payload containing NAV-SAT data.
@@ -336,47 +393,39 @@ static int mia_m10_nav_pl_handler(void *context, void *payload, uint32_t size)
 static int mia_m10_nav_sat_handler(void *context, void *payload, uint32_t size)
 {
 	struct ublox_nav_sat *nav_sat = payload;
-	uint8_t x = 0;
+	uint8_t cno[4] = { 0 };
 	uint8_t cnt = 0;
-	uint8_t max = 0;
-	uint8_t min = 0xFF;
 	uint16_t cno_ = 0;
 
-	mia_m10_sync_tow(nav_sat->iTOW);
-
-	gnss_data_in_progress.cno[0] = 0; //Clear last values
-	gnss_data_in_progress.cno[1] = 0;
-	gnss_data_in_progress.cno[2] = 0;
-	gnss_data_in_progress.cno[3] = 0;
+	if (size < offsetof(struct ublox_nav_sat, satinfo)) {
+		return -EINVAL;
+	}
+	uint8_t num_sv = MIN(nav_sat->numSv, MAX_SVID);
+	num_sv = MIN(num_sv, (size - offsetof(struct ublox_nav_sat, satinfo)) /
+				     sizeof(satpar_struct_t));
 
-	for (x = 0; x < nav_sat->numSv; x++) {
-		if (x > MAX_SVID)
-			break;
+	for (uint8_t x = 0; x < num_sv; x++) {
+		uint8_t sat_cno = nav_sat->satinfo[x].cno;
 
 		if (nav_sat->satinfo[x].svid == 27) { //If sat_id 27 then store it
-			gnss_data_in_progress.cno[0] = nav_sat->satinfo[x].cno;
-		}
-		if ((nav_sat->satinfo[x].cno < min) &&
-		    (nav_sat->satinfo[x].cno > 0)) { //Find min CNO above 0
-			gnss_data_in_progress.cno[1] = nav_sat->satinfo[x].cno;
-		}
-		if (nav_sat->satinfo[x].cno > max) { //Find max CNO
-			gnss_data_in_progress.cno[2] = nav_sat->satinfo[x].cno;
+			cno[0] = sat_cno;
 		}
-		if (nav_sat->satinfo[x].cno > 0) {
+		if (sat_cno > 0) {
+			if (cnt == 0 || sat_cno < cno[1]) {
+				cno[1] = sat_cno;
+			}
+			cno[2] = MAX(cno[2], sat_cno);
 			cnt++;
-			cno_ += nav_sat->satinfo[x].cno;
+			cno_ += sat_cno;
 		}
-
-		//LOG_DBG("GNSS SAT: %d, %d, %d, %d", nav_sat->numSv, nav_sat->satinfo[x].cno, nav_sat->satinfo[x].svid, nav_sat->satinfo[x].flags);
 	}
 
 	if (cnt > 0) {
-		gnss_data_in_progress.cno[3] =
-			cno_ / cnt; //Calculate avg cno for all seen satelites above 0 dBHz
+		cno[3] = cno_ / cnt; //Calculate avg cno for all seen satelites above 0 dBHz
 	}
 
-	mia_m10_sync_complete(GNSS_DATA_FLAG_NAV_SAT);
+	/* Read when completing an epoch, which is also done by the parser thread */
+	memcpy(gnss_sat_cno, cno, sizeof(gnss_sat_cno));
 
 	return 0;
 }
@@ -392,12 +441,42 @@ static int mia_m10_nav_sat_handler(void *context, void *payload, uint32_t size)
  */
 static int mia_m10_mga_ack_handler(void *context, void *payload, uint32_t size)
 {
-	struct ublox_mga_ack *mga_ack_msg = payload;
+	/* Matched to the message in flight by the uploading thread */
+	if (k_msgq_put(&mga_ack_msgq, payload, K_NO_WAIT) != 0) {
+		LOG_WRN("MGA-ACK dropped");
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Handler for incoming MGA-DBD message, part of the navigation 
+ *        database while it is read. 
+ *
+ * @param[in] context Context is unused. 
+ * @param[in] payload Payload containing MGA-DBD data. 
+ * @param[in] size Size of payload. 
+ * 
+ * @return 0 if everything was ok, error code otherwise
+ */
+static int mia_m10_mga_dbd_handler(void *context, void *payload, uint32_t size)
+{
+	k_spinlock_key_t key = k_spin_lock(&nav_db_lock);
 
-	/* Check if receiver accepted data */
-	mga_ack = (mga_ack_msg->infoCode == 0);
-	k_sem_give(&mga_ack_sem);
+	if (nav_db.buf != NULL && !nav_db.overflow) {
+		uint32_t msg_size;
+
+		/* Kept as the complete message, to be sent back unmodified */
+		if (ublox_build_mga_dbd(&nav_db.buf[nav_db.size], &msg_size,
+					nav_db.max_size - nav_db.size, payload, size) == 0) {
+			nav_db.size += msg_size;
+		} else {
+			nav_db.overflow = true;
+		}
+	}
 
+	k_spin_unlock(&nav_db_lock, key);
+	k_sem_give(&nav_db_sem);
 	return 0;
 }
 
@@ -418,9 +497,11 @@ static int mia_m10_setup(const struct device *dev, bool try_default_baud_first)
 	/* Clear GNSS data */
 	gnss_data_is_valid = false;
 	memset(&gnss_data, 0, sizeof(gnss_t));
+	memset(gnss_sat_cno, 0, sizeof(gnss_sat_cno));
 
 	/* Flush all buffers related to GNSS communication */
 	gnss_hub_flush_all();
+	ublox_parse_stream_reset();
 
 	/* TODO - Could this wait be removed somehow? */
 	/* Wait to assure startup */
@@ -507,8 +588,11 @@ static int mia_m10_setup(const struct device *dev, bool try_default_baud_first)
 		return ret;
 	}
 
-	/* Enable NAV-SAT output on UART, no handler */
-	ret = mia_m10_config_set_u8(UBX_CFG_MSGOUT_UBX_NAV_SAT_UART1, 1);
+	/* Enable NAV-SAT output on UART, once per CONFIG_GNSS_MIA_M10_NAV_SAT_RATE 
+	 * navigation solutions. 
+	 */
+	ret = mia_m10_config_set_u8(UBX_CFG_MSGOUT_UBX_NAV_SAT_UART1,
+				    CONFIG_GNSS_MIA_M10_NAV_SAT_RATE);
 	if (ret != 0) {
 		return ret;
 	}
@@ -527,6 +611,10 @@ static int mia_m10_setup(const struct device *dev, bool try_default_baud_first)
 	if (ret != 0) {
 		return ret;
 	}
+	ret = ublox_register_handler(UBX_MGA, UBX_MGA_DBD, mia_m10_mga_dbd_handler, NULL);
+	if (ret != 0) {
+		return ret;
+	}
 
 #if (CONFIG_GNSS_MIA_M10_FIXMODE != 0)
 	/* 3D fix only */
@@ -593,6 +681,64 @@ static int mia_m10_upload_assist_data(const struct device *dev, uint8_t *data, u
 	return 0;
 }
 
+/**
+ * @brief Uploads many assistance data messages to GNSS. 
+ *
+ * @param[in] dev Device context. 
+ * @param[in] data Payload of the first message. 
+ * @param[in] stride Distance from one payload to the next.
+ * @param[in] count Number of messages.
+ * @param[out] stats Result of the upload.
+ * 
+ * @return 0 if everything was ok, error code otherwise
+ */
+static int mia_m10_upload_assist_data_bulk(const struct device *dev, const uint8_t *data,
+					   uint32_t stride, uint16_t count,
+					   struct gnss_assist_stats *stats)
+{
+	ARG_UNUSED(dev);
+
+	return mia_m10_send_assist_data_bulk(data, stride, count, stats);
+}
+
+/**
+ * @brief Reads the navigation database of GNSS. 
+ *
+ * @param[in] dev Device context. 
+ * @param[out] buf Buffer for the database. 
+ * @param[in] max_size Size of buffer.
+ * @param[out] size Size of the database.
+ * 
+ * @return 0 if everything was ok, error code otherwise
+ */
+static int mia_m10_get_nav_db(const struct device *dev, uint8_t *buf, uint32_t max_size,
+			      uint32_t *size)
+{
+	ARG_UNUSED(dev);
+
+	return mia_m10_read_nav_db(buf, max_size, size);
+}
+
+/**
+ * @brief Restores the navigation database of GNSS. 
+ *
+ * @param[in] dev Device context. 
+ * @param[in] hint Time and position, or NULL. 
+ * @param[in] buf Navigation database. 
+ * @param[in] size Size of the database.
+ * @param[out] stats Result of the upload.
+ * 
+ * @return 0 if everything was ok, error code otherwise
+ */
+static int mia_m10_restore_nav_db(const struct device *dev, const struct gnss_nav_hint *hint,
+				  const uint8_t *buf, uint32_t size,
+				  struct gnss_assist_stats *stats)
+{
+	ARG_UNUSED(dev);
+
+	return mia_m10_send_nav_db(hint, buf, size, stats);
+}
+
 /**
  * @brief Set data rate of GNSS.
  *
@@ -683,44 +829,6 @@ static int mia_m10_data_fetch(const struct device *dev, gnss_t *data)
 	return 0;
 }
 
-/**
- * @brief Parse data from GNSS. 
- *
- * @param[in] buffer Buffer with data. 
- * @param[in] cnt Count of bytes in buffer. 
- * 
- * @return 0 if everything was ok, error code otherwise
- */
-static uint32_t mia_m10_parse_data(uint8_t *buffer, uint32_t cnt)
-{
-	uint32_t parsed = 0;
-	while ((cnt - parsed) > 0) {
-		if (buffer[parsed] == NMEA_START_DELIMITER) {
-			/* NMEA */
-			uint32_t i = nmea_parse(&buffer[parsed], (cnt - parsed));
-			if (i == 0) {
-				/* Nothing parsed means not enough data yet */
-				break;
-			} else {
-				parsed += i;
-			}
-		} else if (buffer[parsed] == UBLOX_SYNC_CHAR_1) {
-			/* UBLOX */
-			uint32_t i = ublox_parse(&buffer[parsed], (cnt - parsed));
-			if (i == 0) {
-				/* Nothing parsed means not enough data yet */
-				break;
-			} else {
-				parsed += i;
-			}
-		} else {
-			parsed++;
-		}
-	}
-
-	return parsed;
-}
-
 /**
  * @brief Thread function for handling received data. 
  *
@@ -730,30 +838,22 @@ static uint32_t mia_m10_parse_data(uint8_t *buffer, uint32_t cnt)
  */
 static void mia_m10_handle_received_data(void *dev)
 {
-	bool is_parsing;
-	uint32_t total_parsed_cnt;
+	uint32_t data_cnt;
 
 	while (true) {
 		k_sem_take(&gnss_rx_sem, K_FOREVER);
 
-		uint8_t *data_buffer;
-		uint32_t data_cnt;
-		gnss_hub_rx_get_data(GNSS_HUB_ID_DRIVER, &data_buffer, &data_cnt);
-
-		total_parsed_cnt = 0;
-		is_parsing = true;
-		while (is_parsing) {
-			uint32_t parsed_cnt = mia_m10_parse_data(&data_buffer[total_parsed_cnt],
-								 data_cnt - total_parsed_cnt);
+		/* The parser keeps partly received messages, so all data 
+		 * is consumed, also on each side of the wrap of the receive 
+		 * buffer. */
+		do {
+			uint8_t *data_buffer;
+			gnss_hub_rx_get_data(GNSS_HUB_ID_DRIVER, &data_buffer, &data_cnt);
 
-			if (parsed_cnt == 0) {
-				is_parsing = false;
-			}
-
-			total_parsed_cnt += parsed_cnt;
-		}
+			ublox_parse_stream(data_buffer, data_cnt);
 
-		gnss_hub_rx_consume(GNSS_HUB_ID_DRIVER, total_parsed_cnt);
+			gnss_hub_rx_consume(GNSS_HUB_ID_DRIVER, data_cnt);
+		} while (data_cnt > 0);
 
 		k_yield();
 	}
@@ -777,7 +877,7 @@ static int mia_m10_init(const struct device *dev)
 	k_mutex_init(&cmd_mutex);
 	k_sem_init(&cmd_ack_sem, 0, 1);
 	k_sem_init(&cmd_data_sem, 0, 1);
-	k_sem_init(&mga_ack_sem, 0, 1);
+	k_mutex_init(&mga_mutex);
 
 	k_mutex_init(&gnss_data_mutex);
 	k_mutex_init(&gnss_cb_mutex);
@@ -1114,42 +1214,384 @@ int mia_m10_send_reset(uint16_t mask, uint8_t mode)
 
 int mia_m10_send_assist_data(uint8_t *data, uint32_t size)
 {
+	struct gnss_assist_stats stats;
+
+	if (size != UBLOX_MGA_ANO_SIZE) {
+		return -EINVAL;
+	}
+
+	int ret = mia_m10_send_assist_data_bulk(data, size, 1, &stats);
+	if (ret == 0 && stats.accepted == 0) {
+		return -ECONNREFUSED;
+	}
+	return ret;
+}
+
+/**
+ * @brief Gets the size of a UBX message in the upload data.
+ *
+ * @param[in] upload Upload in progress. 
+ * @param[in] offset Offset of the message. 
+ * 
+ * @return size of the message as sent
+ */
+static uint32_t mia_m10_mga_size(const struct mia_m10_mga_upload *upload, uint32_t offset)
+{
+	if (upload->stride != 0) {
+		return MIA_M10_UBX_SIZE(UBLOX_MGA_ANO_SIZE);
+	}
+	const struct ublox_header *header = (const void *)&upload->data[offset];
+
+	return MIA_M10_UBX_SIZE(header->length);
+}
+
+/**
+ * @brief Sends an assistance data message of a bulk upload, and marks it as
+ *        in flight in the slot. 
+ *
+ * @param[in] upload Upload in progress. 
+ * @param[in] slot Slot for the message. 
+ * @param[in] index Index of the message. 
+ * 
+ * @return 0 if everything was ok, error code otherwise
+ */
+static int mia_m10_mga_send(struct mia_m10_mga_upload *upload, struct mia_m10_mga_slot *slot,
+			    uint16_t index)
+{
+	uint32_t offset = slot->used ? slot->offset : upload->next_offset;
+	uint8_t *msg = mga_buf;
+	uint32_t size;
 	int ret = 0;
 
-	if (k_mutex_lock(&cmd_mutex, K_MSEC(CONFIG_GNSS_MIA_M10_CMD_RESP_TIMEOUT)) == 0) {
-		ret = ublox_build_mga_ano(cmd_buf, &cmd_size, CONFIG_GNSS_MIA_M10_CMD_MAX_SIZE,
-					  data, size);
-		if (ret != 0) {
-			k_mutex_unlock(&cmd_mutex);
-			return ret;
+	if (upload->stride != 0) {
+		ret = ublox_build_mga_ano(mga_buf, &size, sizeof(mga_buf),
+					  (uint8_t *)&upload->data[offset], UBLOX_MGA_ANO_SIZE);
+	} else {
+		/* Already a complete message */
+		msg = (uint8_t *)&upload->data[offset];
+		size = mia_m10_mga_size(upload, offset);
+	}
+	if (ret != 0) {
+		return ret;
+	}
+
+	/* Commands and assistance data share the TX buffer */
+	if (k_mutex_lock(&cmd_mutex, K_MSEC(CONFIG_GNSS_MIA_M10_CMD_RESP_TIMEOUT)) != 0) {
+		return -EBUSY;
+	}
+	ret = gnss_hub_send(GNSS_HUB_ID_DRIVER, msg, size);
+	k_mutex_unlock(&cmd_mutex);
+	if (ret != 0) {
+		return ret;
+	}
+
+	if (!slot->used) {
+		slot->used = true;
+		slot->index = index;
+		slot->offset = offset;
+		slot->size = size;
+		slot->tries = 0;
+		upload->in_flight++;
+		upload->bytes_in_flight += size;
+		upload->next_offset += (upload->stride != 0) ? upload->stride : size;
+	}
+	slot->tries++;
+	slot->seq = upload->seq++;
+	return 0;
+}
+
+/**
+ * @brief Frees the slot of a message that is no longer in flight.
+ *
+ * @param[in] upload Upload in progress. 
+ * @param[in] slot Slot of the message. 
+ */
+static void mia_m10_mga_release(struct mia_m10_mga_upload *upload, struct mia_m10_mga_slot *slot)
+{
+	slot->used = false;
+	upload->in_flight--;
+	upload->bytes_in_flight -= slot->size;
+}
+
+/**
+ * @brief Retransmits a message that was rejected or never acknowledged, or
+ *        gives up on it after CONFIG_GNSS_MIA_M10_MGA_RETRIES retransmissions.
+ *
+ * @param[in] upload Upload in progress. 
+ * @param[in] slot Slot of the message. 
+ * 
+ * @return 0 if everything was ok, error code otherwise
+ */
+static int mia_m10_mga_retry(struct mia_m10_mga_upload *upload, struct mia_m10_mga_slot *slot)
+{
+	if (slot->tries <= CONFIG_GNSS_MIA_M10_MGA_RETRIES) {
+		upload->stats->retransmitted++;
+		return mia_m10_mga_send(upload, slot, slot->index);
+	}
+
+	upload->stats->rejected++;
+	mia_m10_mga_release(upload, slot);
+	return 0;
+}
+
+/**
+ * @brief Finds the message in flight an MGA-ACK belongs to. The receiver 
+ *        acknowledges in order, so this is the oldest message of the same 
+ *        type whose payload starts as in the ack.
+ *
+ * @param[in] upload Upload in progress. 
+ * @param[in] ack MGA-ACK message. 
+ * 
+ * @return slot of the message, or NULL if the ack is not for a message in flight
+ */
+static struct mia_m10_mga_slot *mia_m10_mga_match(struct mia_m10_mga_upload *upload,
+						  const struct ublox_mga_ack *ack)
+{
+	struct mia_m10_mga_slot *match = NULL;
+
+	for (int i = 0; i < CONFIG_GNSS_MIA_M10_MGA_WINDOW; i++) {
+		struct mia_m10_mga_slot *slot = &upload->slots[i];
+
+		if (!slot->used) {
+			continue;
 		}
+		const uint8_t *payload = &upload->data[slot->offset];
+		uint8_t msg_id = UBX_MGA_ANO;
 
-		/* Reset mga response parameters */
-		k_sem_reset(&mga_ack_sem);
+		if (upload->stride == 0) {
+			msg_id = ((const struct ublox_header *)payload)->msg_id;
+			payload += sizeof(struct ublox_header);
+		}
+		if (msg_id == ack->msgId && (match == NULL || slot->seq < match->seq) &&
+		    memcmp(payload, ack->msgPayloadStart, sizeof(ack->msgPayloadStart)) == 0) {
+			match = slot;
+		}
+	}
+	return match;
+}
 
-		ret = mia_m10_send_ubx_cmd(cmd_buf, cmd_size, false, false);
+/**
+ * @brief Sends the messages of an upload, and waits for all of them to be
+ *        acknowledged or given up. The result is added to the stats of the 
+ *        upload.
+ *
+ * @param[in] upload Upload to run. 
+ * @param[in] count Number of messages.
+ * 
+ * @return 0 if everything was ok, error code otherwise
+ */
+static int mia_m10_mga_run(struct mia_m10_mga_upload *upload, uint16_t count)
+{
+	struct gnss_assist_stats *stats = upload->stats;
+	uint16_t next = 0;
+	int ret = 0;
+
+	if (k_mutex_lock(&mga_mutex, K_MSEC(CONFIG_GNSS_MIA_M10_CMD_RESP_TIMEOUT)) != 0) {
+		return -EBUSY;
+	}
+	uint32_t start = k_uptime_get_32();
+	k_msgq_purge(&mga_ack_msgq);
+
+	while (next < count || upload->in_flight > 0) {
+		/* Keep the window full, as long as the TX buffer can take it */
+		for (int i = 0; i < CONFIG_GNSS_MIA_M10_MGA_WINDOW && next < count && ret == 0;
+		     i++) {
+			uint32_t size = mia_m10_mga_size(upload, upload->next_offset);
+
+			if (upload->in_flight > 0 &&
+			    upload->bytes_in_flight + size > MIA_M10_MGA_TX_BUDGET) {
+				break;
+			}
+			if (!upload->slots[i].used) {
+				ret = mia_m10_mga_send(upload, &upload->slots[i], next++);
+			}
+		}
 		if (ret != 0) {
-			k_mutex_unlock(&cmd_mutex);
-			return ret;
+			break;
 		}
 
-		/* Wait for ack */
-		if (k_sem_take(&mga_ack_sem, K_MSEC(CONFIG_GNSS_MIA_M10_CMD_RESP_TIMEOUT)) != 0) {
+		struct ublox_mga_ack ack;
+		if (k_msgq_get(&mga_ack_msgq, &ack, K_MSEC(CONFIG_GNSS_MIA_M10_CMD_RESP_TIMEOUT)) !=
+		    0) {
 			LOG_ERR("MGA-ACK timed out");
-			k_mutex_unlock(&cmd_mutex);
-			return -ETIME;
+			ret = -ETIME;
+			break;
+		}
+		struct mia_m10_mga_slot *slot = mia_m10_mga_match(upload, &ack);
+		if (slot == NULL) {
+			continue;
 		}
 
-		if (!mga_ack) {
-			k_mutex_unlock(&cmd_mutex);
-			return -ECONNREFUSED;
+		/* Messages sent before this one were never acknowledged */
+		for (int i = 0; i < CONFIG_GNSS_MIA_M10_MGA_WINDOW && ret == 0; i++) {
+			if (upload->slots[i].used && upload->slots[i].seq < slot->seq) {
+				ret = mia_m10_mga_retry(upload, &upload->slots[i]);
+			}
+		}
+		if (ret != 0) {
+			break;
 		}
 
-		k_mutex_unlock(&cmd_mutex);
-	} else {
+		if (ack.infoCode == 0) {
+			stats->accepted++;
+			mia_m10_mga_release(upload, slot);
+		} else {
+			LOG_DBG("MGA message %d rejected, %d", slot->index, ack.infoCode);
+			ret = mia_m10_mga_retry(upload, slot);
+			if (ret != 0) {
+				break;
+			}
+		}
+	}
+
+	stats->duration_ms += k_uptime_get_32() - start;
+	k_mutex_unlock(&mga_mutex);
+	return ret;
+}
+
+int mia_m10_send_assist_data_bulk(const uint8_t *data, uint32_t stride, uint16_t count,
+				  struct gnss_assist_stats *stats)
+{
+	struct mia_m10_mga_upload upload = { .data = data, .stride = stride, .stats = stats };
+
+	memset(stats, 0, sizeof(*stats));
+	int ret = mia_m10_mga_run(&upload, count);
+
+	LOG_DBG("MGA upload: %d accepted, %d rejected, %d retransmitted in %d ms",
+		stats->accepted, stats->rejected, stats->retransmitted, stats->duration_ms);
+	return ret;
+}
+
+int mia_m10_read_nav_db(uint8_t *buf, uint32_t max_size, uint32_t *size)
+{
+	/* Not while assistance data is uploaded */
+	if (k_mutex_lock(&mga_mutex, K_MSEC(CONFIG_GNSS_MIA_M10_CMD_RESP_TIMEOUT)) != 0) {
 		return -EBUSY;
 	}
 
+	k_spinlock_key_t key = k_spin_lock(&nav_db_lock);
+	nav_db.buf = buf;
+	nav_db.max_size = max_size;
+	nav_db.size = 0;
+	nav_db.overflow = false;
+	k_spin_unlock(&nav_db_lock, key);
+	k_sem_reset(&nav_db_sem);
+
+	int ret = -EBUSY;
+	if (k_mutex_lock(&cmd_mutex, K_MSEC(CONFIG_GNSS_MIA_M10_CMD_RESP_TIMEOUT)) == 0) {
+		ret = ublox_build_mga_dbd(cmd_buf, &cmd_size, CONFIG_GNSS_MIA_M10_CMD_MAX_SIZE,
+					  NULL, 0);
+		if (ret == 0) {
+			ret = gnss_hub_send(GNSS_HUB_ID_DRIVER, cmd_buf, cmd_size);
+		}
+		k_mutex_unlock(&cmd_mutex);
+	}
+
+	/* The database has no end marker, it is complete when the receiver 
+	 * stops sending MGA-DBD messages.
+	 */
+	k_timeout_t timeout = K_MSEC(CONFIG_GNSS_MIA_M10_CMD_RESP_TIMEOUT);
+	while (ret == 0 && k_sem_take(&nav_db_sem, timeout) == 0) {
+		timeout = K_MSEC(CONFIG_GNSS_MIA_M10_NAV_DB_IDLE_MS);
+	}
+
+	key = k_spin_lock(&nav_db_lock);
+	*size = nav_db.size;
+	bool overflow = nav_db.overflow;
+	nav_db.buf = NULL;
+	k_spin_unlock(&nav_db_lock, key);
+
+	k_mutex_unlock(&mga_mutex);
+
+	if (ret != 0) {
+		return ret;
+	}
+	if (overflow) {
+		return -ENOBUFS;
+	}
+	if (*size == 0) {
+		return -ETIME;
+	}
+	LOG_DBG("Navigation database read, %d bytes", *size);
+	return 0;
+}
+
+/**
+ * @brief Counts the UBX-MGA messages in a buffer, and checks that the 
+ *        buffer holds nothing else.
+ *
+ * @param[in] buf Buffer with the messages. 
+ * @param[in] size Size of buffer. 
+ * 
+ * @return number of messages, or negative error code if the buffer is invalid
+ */
+static int mia_m10_mga_count(const uint8_t *buf, uint32_t size)
+{
+	uint32_t offset = 0;
+	int count = 0;
+
+	while (offset < size) {
+		const struct ublox_header *header = (const void *)&buf[offset];
+
+		if (size - offset < MIA_M10_UBX_SIZE(0) || header->sync1 != UBLOX_SYNC_CHAR_1 ||
+		    header->sync2 != UBLOX_SYNC_CHAR_2 || header->msg_class != UBX_MGA ||
+		    size - offset < MIA_M10_UBX_SIZE(header->length) || count == UINT16_MAX) {
+			return -EINVAL;
+		}
+		offset += MIA_M10_UBX_SIZE(header->length);
+		count++;
+	}
+	return count;
+}
+
+int mia_m10_send_nav_db(const struct gnss_nav_hint *hint, const uint8_t *buf, uint32_t size,
+			struct gnss_assist_stats *stats)
+{
+	uint8_t ini_buf[MIA_M10_UBX_SIZE(sizeof(struct ublox_mga_ini_time_utc)) +
+			MIA_M10_UBX_SIZE(sizeof(struct ublox_mga_ini_pos_llh))];
+	uint32_t ini_size = 0;
+	uint32_t msg_size;
+	int ret;
+
+	memset(stats, 0, sizeof(*stats));
+
+	int count = mia_m10_mga_count(buf, size);
+	if (count < 0) {
+		return count;
+	}
+
+	/* Time and position first, for the receiver to use the database */
+	if (hint != NULL && hint->unix_time != 0) {
+		ret = ublox_build_mga_ini_time_utc(&ini_buf[ini_size], &msg_size,
+						   sizeof(ini_buf) - ini_size, hint->unix_time,
+						   hint->time_acc_s);
+		if (ret != 0) {
+			return ret;
+		}
+		ini_size += msg_size;
+	}
+	if (hint != NULL && hint->has_pos) {
+		ret = ublox_build_mga_ini_pos_llh(&ini_buf[ini_size], &msg_size,
+						  sizeof(ini_buf) - ini_size, hint->lat, hint->lon,
+						  hint->height * 10, hint->pos_acc_m * 100);
+		if (ret != 0) {
+			return ret;
+		}
+		ini_size += msg_size;
+	}
+
+	struct mia_m10_mga_upload upload = { .data = ini_buf, .stride = 0, .stats = stats };
+
+	ret = mia_m10_mga_run(&upload, mia_m10_mga_count(ini_buf, ini_size));
+	if (ret == 0) {
+		memset(&upload, 0, sizeof(upload));
+		upload.data = buf;
+		upload.stats = stats;
+		ret = mia_m10_mga_run(&upload, count);
+	}
+
+	LOG_DBG("Navigation database restored: %d accepted, %d rejected, %d retransmitted in %d ms",
+		stats->accepted, stats->rejected, stats->retransmitted, stats->duration_ms);
 	return ret;
 }
 
@@ -1180,7 +1622,17 @@ static int mia_m10_set_backup_mode(const struct device *dev)
 	return ret;
 }
 
-static int mia_m10_set_power_mode(const struct device *dev, gnss_mode_t mode)
+/**
+ * @brief Set power mode of GNSS, with the given update rate. 
+ *
+ * @param[in] dev Device context. 
+ * @param[in] mode Power mode. 
+ * @param[in] rate_ms Update rate in milliseconds, 0 for the default rate of the mode.
+ * 
+ * @return 0 if everything was ok, error code otherwise
+ */
+static int mia_m10_set_power_mode_rate(const struct device *dev, gnss_mode_t mode,
+				       uint16_t rate_ms)
 {
 	int ret;
 	uint16_t rate_val;
@@ -1202,6 +1654,9 @@ static int mia_m10_set_power_mode(const struct device *dev, gnss_mode_t mode)
 		ret = -EINVAL;
 		goto error_return;
 	}
+	if (rate_ms != 0) {
+		rate_val = rate_ms;
+	}
 
 	/*
      * @todo: Workaround:
@@ -1240,6 +1695,11 @@ error_return:
 	return ret;
 }
 
+static int mia_m10_set_power_mode(const struct device *dev, gnss_mode_t mode)
+{
+	return mia_m10_set_power_mode_rate(dev, mode, 0);
+}
+
 static int mia_m10_wakeup(const struct device *dev)
 {
 	LOG_DBG("mia_m10_wakeup");
@@ -1278,6 +1738,9 @@ static const struct gnss_driver_api mia_m10_api_funcs = {
 	.gnss_reset = mia_m10_reset,
 	.gnss_version_get = mia_m10_version_get,
 	.gnss_upload_assist_data = mia_m10_upload_assist_data,
+	.gnss_upload_assist_data_bulk = mia_m10_upload_assist_data_bulk,
+	.gnss_get_nav_db = mia_m10_get_nav_db,
+	.gnss_restore_nav_db = mia_m10_restore_nav_db,
 	.gnss_set_rate = mia_m10_set_rate,
 	.gnss_get_rate = mia_m10_get_rate,
 	.gnss_set_data_cb = mia_m10_set_data_cb,
@@ -1285,6 +1748,7 @@ static const struct gnss_driver_api mia_m10_api_funcs = {
 	.gnss_set_backup_mode = mia_m10_set_backup_mode,
 	.gnss_wakeup = mia_m10_wakeup,
 	.gnss_set_power_mode = mia_m10_set_power_mode,
+	.gnss_set_power_mode_rate = mia_m10_set_power_mode_rate,
 	.gnss_resetn_pin = mia_m10_resetn_pin
 };
 
@@ -119,4 +119,50 @@ int mia_m10_send_reset(uint16_t mask, uint8_t mode);
  */
 int mia_m10_send_assist_data(uint8_t *data, uint32_t size);
 
+/**
+ * @brief Send many assistance data messages to GNSS, with up to 
+ *        CONFIG_GNSS_MIA_M10_MGA_WINDOW messages in flight. The MGA-ACKs are
+ *        matched to the messages in flight, and rejected messages are 
+ *        retransmitted up to CONFIG_GNSS_MIA_M10_MGA_RETRIES times.
+ *
+ * @param[in] data Payload of the first MGA-ANO message. 
+ * @param[in] stride Distance in bytes from one payload to the next.
+ * @param[in] count Number of messages.
+ * @param[out] stats Result of the upload, also when it fails.
+ * 
+ * @return 0 if everything was ok, error code otherwise
+ */
+int mia_m10_send_assist_data_bulk(const uint8_t *data, uint32_t stride, uint16_t count,
+				  struct gnss_assist_stats *stats);
+
+/**
+ * @brief Polls the navigation database of GNSS, and collects the MGA-DBD 
+ *        messages of the reply until none has been received for 
+ *        CONFIG_GNSS_MIA_M10_NAV_DB_IDLE_MS.
+ *
+ * @param[out] buf Buffer for the MGA-DBD messages. 
+ * @param[in] max_size Size of buffer.
+ * @param[out] size Size of the messages.
+ * 
+ * @return 0 if everything was ok, -ENOBUFS if the database does not fit, 
+ *         -ETIME if there was no reply, error code otherwise
+ */
+int mia_m10_read_nav_db(uint8_t *buf, uint32_t max_size, uint32_t *size);
+
+/**
+ * @brief Sends MGA-INI messages with the time and position of the hint, 
+ *        followed by the UBX-MGA messages of a navigation database, in the
+ *        same way as mia_m10_send_assist_data_bulk.
+ *
+ * @param[in] hint Time and position, or NULL. 
+ * @param[in] buf UBX-MGA messages, as read with mia_m10_read_nav_db. 
+ * @param[in] size Size of the messages.
+ * @param[out] stats Result of the upload, also when it fails.
+ * 
+ * @return 0 if everything was ok, -EINVAL if buf holds anything else than
+ *         UBX-MGA messages, error code otherwise
+ */
+int mia_m10_send_nav_db(const struct gnss_nav_hint *hint, const uint8_t *buf, uint32_t size,
+			struct gnss_assist_stats *stats);
+
 #endif /* UBLOX_MIA_M10_H_ */
\ No newline at end of file
@@ -2,7 +2,9 @@
 
 #include "ubx_ids.h"
 
-#include <sys/mutex.h>
+#include <zephyr.h>
+#include <time.h>
+#include <sys/atomic.h>
 #include <logging/log.h>
 
 LOG_MODULE_REGISTER(UBLOX_PROTOCOL, CONFIG_GNSS_LOG_LEVEL);
@@ -24,38 +26,78 @@ LOG_MODULE_REGISTER(UBLOX_PROTOCOL, CONFIG_GNSS_LOG_LEVEL);
 #define UBLOX_MSG_IDENTIFIER(c, i) ((c << 8) | (i))
 #define UBLOX_MSG_IDENTIFIER_EMPTY 0
 
-/* This can be adjusted, but should never be larger than receive buffer 
- * Any payloads greater than this will lead to the message being discarded. */
-#define UBLOX_MAX_PAYLOAD_SIZE 512
-
 /* Registered handlers for periodic messages. 
  * Links the message class/ids to callbacks.
  */
 #define UBLOX_MAX_HANDLERS 20
+
+/* Handlers are found by hashing class/id into an open addressed table, 
+ * probing linearly on collisions. The hash puts NAV-PVT, DOP, STATUS, PL,
+ * SAT and MGA-ACK, DBD in separate slots, so none of them is probed for. 
+ * Must be a power of two. */
+#define UBLOX_HANDLER_SLOTS 32
+#define UBLOX_HANDLER_HASH(c, i) (((i) ^ ((i) >> 3) ^ (c)) & (UBLOX_HANDLER_SLOTS - 1))
+
 struct ublox_handler {
-	uint8_t msg_class;
-	uint8_t msg_id;
+	/* Class/id of the handler, set last when registering so the parser
+	 * never sees a half registered entry */
+	atomic_t identifier;
 	int (*handle)(void *, void *, uint32_t);
 	void *context;
 };
-static struct ublox_handler handlers[UBLOX_MAX_HANDLERS];
+static struct ublox_handler handlers[UBLOX_HANDLER_SLOTS];
 static uint32_t callback_count = 0;
 
+typedef int (*ublox_poll_handle_t)(void *, uint8_t, uint8_t, void *, uint32_t);
+typedef int (*ublox_ack_handle_t)(void *, uint8_t, uint8_t, bool);
+
 /* Sending commands will often result in an acknowledgement and data response.
  * These variables stores information of which command is awaiting response,
- * and where to relay the ack/data. 
+ * and where to relay the ack/data. The handles are taken atomically by the 
+ * parser, as each of them is a one-off. 
  */
-static struct k_mutex cmd_mutex;
-static uint16_t cmd_identifier = UBLOX_MSG_IDENTIFIER_EMPTY;
+static atomic_t cmd_identifier = ATOMIC_INIT(UBLOX_MSG_IDENTIFIER_EMPTY);
 static void *cmd_context = NULL;
-static int (*cmd_poll_handle)(void *, uint8_t, uint8_t, void *, uint32_t) = NULL;
-static int (*cmd_ack_handle)(void *, uint8_t, uint8_t, bool) = NULL;
+static atomic_ptr_t cmd_poll_handle = ATOMIC_PTR_INIT(NULL);
+static atomic_ptr_t cmd_ack_handle = ATOMIC_PTR_INIT(NULL);
+
+/* States of the streaming parser, one for each field of a message */
+enum ublox_stream_state {
+	UBLOX_STREAM_SYNC_1 = 0,
+	UBLOX_STREAM_SYNC_2,
+	UBLOX_STREAM_CLASS,
+	UBLOX_STREAM_ID,
+	UBLOX_STREAM_LENGTH_1,
+	UBLOX_STREAM_LENGTH_2,
+	UBLOX_STREAM_PAYLOAD,
+	UBLOX_STREAM_CK_A,
+	UBLOX_STREAM_CK_B
+};
+
+/* Message being received by the streaming parser. The checksum is updated 
+ * as bytes arrive, and only the payload is staged for the handlers. */
+static struct {
+	enum ublox_stream_state state;
+	uint8_t msg_class;
+	uint8_t msg_id;
+	uint16_t length;
+	uint16_t received;
+	uint8_t ck_a;
+	uint8_t ck_b;
+	uint8_t msg_ck_a;
+	uint8_t payload[UBLOX_MAX_PAYLOAD_SIZE] __aligned(4);
+} stream;
+
+/* Only updated by the thread running the streaming parser. */
+static struct ublox_parse_stats stream_stats;
 
 void ublox_protocol_init(void)
 {
 	callback_count = 0;
 	memset(handlers, 0, sizeof(handlers));
-	k_mutex_init(&cmd_mutex);
+	ublox_reset_response_handlers();
+	ublox_parse_stream_reset();
+	ublox_reset_parse_stats();
 }
 
 /**
@@ -69,19 +111,23 @@ void ublox_protocol_init(void)
  */
 static int ublox_resolve_handler(uint8_t msg_class, uint8_t msg_id, struct ublox_handler **handler)
 {
+	atomic_val_t msg_identifier = UBLOX_MSG_IDENTIFIER(msg_class, msg_id);
+	uint32_t slot = UBLOX_HANDLER_HASH(msg_class, msg_id);
+
 	*handler = NULL;
-	for (uint32_t i = 0; i < UBLOX_MAX_HANDLERS; i++) {
-		if ((handlers[i].msg_class == msg_class) && (handlers[i].msg_id == msg_id)) {
-			*handler = &handlers[i];
+	for (uint32_t i = 0; i < UBLOX_HANDLER_SLOTS; i++) {
+		atomic_val_t identifier = atomic_get(&handlers[slot].identifier);
+
+		if (identifier == msg_identifier) {
+			*handler = &handlers[slot];
+			return 0;
+		} else if (identifier == UBLOX_MSG_IDENTIFIER_EMPTY) {
 			break;
 		}
+		slot = (slot + 1) & (UBLOX_HANDLER_SLOTS - 1);
 	}
 
-	if (*handler == NULL) {
-		return -ENOMSG;
-	}
-
-	return 0;
+	return -ENOMSG;
 }
 
 int ublox_register_handler(uint8_t msg_class, uint8_t msg_id,
@@ -90,36 +136,29 @@ int ublox_register_handler(uint8_t msg_class, uint8_t msg_id,
 	struct ublox_handler *handler = NULL;
 	int ret = ublox_resolve_handler(msg_class, msg_id, &handler);
 	if (ret == 0) {
-		/* Handler already registered */
-		if (handler == NULL) {
-			/* Clear entry */
-			memset(handler, 0, sizeof(*handler));
-		} else {
-			/* Update it */
-			handler->handle = handle;
-			handler->context = context;
-		}
+		/* Handler already registered, update it */
+		handler->handle = handle;
+		handler->context = context;
 
 		return 0;
 	}
 
-	/* Iterate over all available slots, find empty */
-	for (uint32_t i = 0; i < UBLOX_MAX_HANDLERS; i++) {
-		if ((handlers[i].msg_class == 0) && (handlers[i].msg_id == 0)) {
-			handler = &handlers[i];
-			break;
-		}
+	if (callback_count >= UBLOX_MAX_HANDLERS) {
+		return -ENOBUFS;
 	}
 
-	if (handler == NULL) {
-		return -ENOBUFS;
+	/* Find first empty slot from the hashed one */
+	uint32_t slot = UBLOX_HANDLER_HASH(msg_class, msg_id);
+	while (atomic_get(&handlers[slot].identifier) != UBLOX_MSG_IDENTIFIER_EMPTY) {
+		slot = (slot + 1) & (UBLOX_HANDLER_SLOTS - 1);
 	}
+	handler = &handlers[slot];
 
 	/* Register entry */
-	handler->msg_class = msg_class;
-	handler->msg_id = msg_id;
 	handler->handle = handle;
 	handler->context = context;
+	atomic_set(&handler->identifier, UBLOX_MSG_IDENTIFIER(msg_class, msg_id));
+	callback_count++;
 
 	return 0;
 }
@@ -150,6 +189,29 @@ static uint16_t ublox_calculate_checksum(uint8_t *data, uint16_t length)
 	return (ck_a + (ck_b << 8));
 }
 
+/**
+ * @brief Takes the poll or ack handle for the awaited command, leaving it 
+ *        empty. 
+ *
+ * @param[in] handle Handle to take. 
+ * @param[in] msg_identifier Class/id the handle is taken for. 
+ *
+ * @return The handle, or NULL if none is set for the class/id. 
+ */
+static void *ublox_take_response_handle(atomic_ptr_t *handle, uint16_t msg_identifier)
+{
+	void *taken = atomic_ptr_set(handle, NULL);
+
+	/* A new command may have been set after checking the identifier, 
+	 * then the handle is put back for it */
+	if ((taken != NULL) && (atomic_get(&cmd_identifier) != msg_identifier)) {
+		atomic_ptr_cas(handle, NULL, taken);
+		return NULL;
+	}
+
+	return taken;
+}
+
 /**
  * @brief Function to process an identified U-blox message. 
  *        This function will first check if this is an ack for a command.
@@ -168,54 +230,46 @@ static int ublox_process_message(uint8_t msg_class, uint8_t msg_id, uint8_t *pay
 				 uint16_t length)
 {
 	uint16_t msg_identifier = UBLOX_MSG_IDENTIFIER(msg_class, msg_id);
+	atomic_val_t awaited_identifier = atomic_get(&cmd_identifier);
 
-	if (k_mutex_lock(&cmd_mutex, K_MSEC(10)) == 0) {
-		/* Handle acknowledgements */
-		if (msg_class == UBX_ACK) {
-			bool ack = msg_id == UBX_ACK_ACK;
-
-			struct ublox_ack_ack *msg_ack = (void *)payload;
+	/* Handle acknowledgements */
+	if (msg_class == UBX_ACK) {
+		bool ack = msg_id == UBX_ACK_ACK;
 
-			msg_identifier = UBLOX_MSG_IDENTIFIER(msg_ack->clsID, msg_ack->msgID);
+		struct ublox_ack_ack *msg_ack = (void *)payload;
 
-			if (msg_identifier == cmd_identifier) {
-				if (cmd_ack_handle != NULL) {
-					cmd_ack_handle(cmd_context, msg_ack->clsID, msg_ack->msgID,
-						       ack);
+		msg_identifier = UBLOX_MSG_IDENTIFIER(msg_ack->clsID, msg_ack->msgID);
 
-					/* Make sure to disable any further 
-					 * calls to this, as the ack is a 
-					 * one-off */
-					cmd_ack_handle = NULL;
+		if (msg_identifier == awaited_identifier) {
+			/* Take the handler to disable any further calls to 
+			 * it, as the ack is a one-off */
+			ublox_ack_handle_t ack_handle =
+				ublox_take_response_handle(&cmd_ack_handle, msg_identifier);
 
-					k_mutex_unlock(&cmd_mutex);
-					return 0;
-				}
+			if (ack_handle != NULL) {
+				ack_handle(cmd_context, msg_ack->clsID, msg_ack->msgID, ack);
+				return 0;
 			}
 		}
+	}
 
-		/* Is this a message awaiting poll response? */
-		if (msg_identifier == cmd_identifier) {
-			if (cmd_poll_handle != NULL) {
-				cmd_poll_handle(cmd_context, msg_class, msg_id, (void *)payload,
-						length);
-
-				/* Make sure to disable any further calls to 
-				 * this,as the poll is a one-off */
-				cmd_poll_handle = NULL;
+	/* Is this a message awaiting poll response? */
+	if (msg_identifier == awaited_identifier) {
+		/* Take the handler to disable any further calls to it, as the 
+		 * poll is a one-off */
+		ublox_poll_handle_t poll_handle =
+			ublox_take_response_handle(&cmd_poll_handle, msg_identifier);
 
-				k_mutex_unlock(&cmd_mutex);
-				return 0;
-			}
+		if (poll_handle != NULL) {
+			poll_handle(cmd_context, msg_class, msg_id, (void *)payload, length);
+			return 0;
 		}
-
-		k_mutex_unlock(&cmd_mutex);
 	}
 
 	/* Check registered handlers for match */
 	struct ublox_handler *handler = NULL;
 	int ret = ublox_resolve_handler(msg_class, msg_id, &handler);
-	if (ret == 0) {
+	if ((ret == 0) && (handler->handle != NULL)) {
 		ret = handler->handle(handler->context, payload, length);
 	}
 
@@ -302,21 +356,146 @@ uint32_t ublox_parse(uint8_t *data, uint32_t size)
 	return packet_length;
 }
 
-int ublox_reset_response_handlers(void)
+/**
+ * @brief Adds a byte to the running checksum of the streaming parser. 
+ *
+ * @param[in] byte Byte of message, from class up to and excluding CK_A. 
+ */
+static inline void ublox_stream_checksum(uint8_t byte)
+{
+	stream.ck_a += byte;
+	stream.ck_b += stream.ck_a;
+}
+
+void ublox_parse_stream_reset(void)
+{
+	stream.state = UBLOX_STREAM_SYNC_1;
+}
+
+void ublox_get_parse_stats(struct ublox_parse_stats *stats)
+{
+	memcpy(stats, &stream_stats, sizeof(*stats));
+}
+
+void ublox_reset_parse_stats(void)
 {
-	if (k_mutex_lock(&cmd_mutex, K_MSEC(10)) == 0) {
-		/* Remove class/id and function pointers for 
-		 * awaiting poll and ack */
-		cmd_identifier = UBLOX_MSG_IDENTIFIER_EMPTY;
-		cmd_poll_handle = NULL;
-		cmd_ack_handle = NULL;
-		cmd_context = NULL;
+	memset(&stream_stats, 0, sizeof(stream_stats));
+}
+
+uint32_t ublox_parse_stream(const uint8_t *data, uint32_t size)
+{
+	uint32_t processed = 0;
+	uint32_t i = 0;
+
+	stream_stats.bytes += size;
 
-		k_mutex_unlock(&cmd_mutex);
-	} else {
-		return -EBUSY;
+	while (i < size) {
+		if (stream.state == UBLOX_STREAM_PAYLOAD) {
+			/* Stage as much of the payload as is available */
+			uint32_t cnt = MIN(size - i, stream.length - stream.received);
+
+			for (uint32_t j = i; j < (i + cnt); j++) {
+				ublox_stream_checksum(data[j]);
+			}
+			memcpy(&stream.payload[stream.received], &data[i], cnt);
+			stream.received += cnt;
+			i += cnt;
+
+			if (stream.received == stream.length) {
+				stream.state = UBLOX_STREAM_CK_A;
+			}
+			continue;
+		}
+
+		uint8_t byte = data[i++];
+
+		switch (stream.state) {
+		case UBLOX_STREAM_SYNC_1:
+			if (byte == UBLOX_SYNC_CHAR_1) {
+				stream.state = UBLOX_STREAM_SYNC_2;
+			} else {
+				stream_stats.skipped++;
+			}
+			break;
+		case UBLOX_STREAM_SYNC_2:
+			if (byte == UBLOX_SYNC_CHAR_2) {
+				stream.ck_a = 0;
+				stream.ck_b = 0;
+				stream.state = UBLOX_STREAM_CLASS;
+			} else if (byte != UBLOX_SYNC_CHAR_1) {
+				stream_stats.skipped += 2;
+				stream.state = UBLOX_STREAM_SYNC_1;
+			} else {
+				stream_stats.skipped++;
+			}
+			break;
+		case UBLOX_STREAM_CLASS:
+			ublox_stream_checksum(byte);
+			stream.msg_class = byte;
+			stream.state = UBLOX_STREAM_ID;
+			break;
+		case UBLOX_STREAM_ID:
+			ublox_stream_checksum(byte);
+			stream.msg_id = byte;
+			stream.state = UBLOX_STREAM_LENGTH_1;
+			break;
+		case UBLOX_STREAM_LENGTH_1:
+			ublox_stream_checksum(byte);
+			stream.length = byte;
+			stream.state = UBLOX_STREAM_LENGTH_2;
+			break;
+		case UBLOX_STREAM_LENGTH_2:
+			ublox_stream_checksum(byte);
+			stream.length += (byte << 8);
+			stream.received = 0;
+
+			if (stream.length > UBLOX_MAX_PAYLOAD_SIZE) {
+				/* Payload is unreasonably large, look for 
+				 * next sync */
+				stream_stats.oversized++;
+				stream.state = UBLOX_STREAM_SYNC_1;
+			} else if (stream.length == 0) {
+				stream.state = UBLOX_STREAM_CK_A;
+			} else {
+				stream.state = UBLOX_STREAM_PAYLOAD;
+			}
+			break;
+		case UBLOX_STREAM_CK_A:
+			stream.msg_ck_a = byte;
+			stream.state = UBLOX_STREAM_CK_B;
+			break;
+		case UBLOX_STREAM_CK_B:
+			stream.state = UBLOX_STREAM_SYNC_1;
+
+			if ((stream.msg_ck_a != stream.ck_a) || (byte != stream.ck_b)) {
+				/* Wrong checksum, ignore data */
+				LOG_DBG("CRC expected %X was %X", stream.ck_a + (stream.ck_b << 8),
+					stream.msg_ck_a + (byte << 8));
+				stream_stats.checksum_errors++;
+				break;
+			}
+
+			ublox_process_message(stream.msg_class, stream.msg_id, stream.payload,
+					      stream.length);
+			stream_stats.messages++;
+			processed++;
+			break;
+		default:
+			break;
+		}
 	}
 
+	return processed;
+}
+
+int ublox_reset_response_handlers(void)
+{
+	/* Remove class/id and function pointers for awaiting poll and ack */
+	atomic_ptr_clear(&cmd_poll_handle);
+	atomic_ptr_clear(&cmd_ack_handle);
+	atomic_set(&cmd_identifier, UBLOX_MSG_IDENTIFIER_EMPTY);
+	cmd_context = NULL;
+
 	return 0;
 }
 
@@ -326,16 +505,14 @@ int ublox_set_response_handlers(uint8_t *buffer,
 {
 	struct ublox_header *header = (void *)buffer;
 
-	if (k_mutex_lock(&cmd_mutex, K_MSEC(10)) == 0) {
-		cmd_context = context;
-		cmd_poll_handle = poll_cb;
-		cmd_ack_handle = ack_cb;
-		cmd_identifier = UBLOX_MSG_IDENTIFIER(header->msg_class, header->msg_id);
-
-		k_mutex_unlock(&cmd_mutex);
-	} else {
-		return -EBUSY;
-	}
+	/* Handles are set last, so the identifier and context belong to any 
+	 * handle the parser takes */
+	atomic_ptr_clear(&cmd_poll_handle);
+	atomic_ptr_clear(&cmd_ack_handle);
+	cmd_context = context;
+	atomic_set(&cmd_identifier, UBLOX_MSG_IDENTIFIER(header->msg_class, header->msg_id));
+	atomic_ptr_set(&cmd_poll_handle, poll_cb);
+	atomic_ptr_set(&cmd_ack_handle, ack_cb);
 
 	return 0;
 }
@@ -629,7 +806,7 @@ int ublox_build_mga_ano(uint8_t *buffer, uint32_t *size, uint32_t max_size, uint
 			uint32_t data_size)
 {
 	/* Verify data size from interface description document */
-	if (data_size != 76) {
+	if (data_size != UBLOX_MGA_ANO_SIZE) {
 		return -EINVAL;
 	}
 
@@ -668,6 +845,103 @@ int ublox_build_mga_ano(uint8_t *buffer, uint32_t *size, uint32_t max_size, uint
 	return 0;
 }
 
+/**
+ * @brief Builds a message of the given class and id around a payload.
+ *
+ * @param[out] buffer Buffer to build message in. 
+ * @param[out] size Size of built message. 
+ * @param[in] max_size Maximum size of message. 
+ * @param[in] msg_class Message class. 
+ * @param[in] msg_id Message id. 
+ * @param[in] data Payload, may be NULL if data_size is 0. 
+ * @param[in] data_size Number of bytes in payload. 
+ * 
+ * @return 0 if everything was ok, error code otherwise
+ */
+static int ublox_build_msg(uint8_t *buffer, uint32_t *size, uint32_t max_size, uint8_t msg_class,
+			   uint8_t msg_id, const void *data, uint32_t data_size)
+{
+	uint32_t packet_length = UBLOX_OVERHEAD_SIZE + data_size;
+
+	if (data_size > UBLOX_MAX_PAYLOAD_SIZE) {
+		return -EINVAL;
+	}
+	if (max_size < packet_length) {
+		return -ENOBUFS;
+	}
+
+	struct ublox_header *header = (void *)buffer;
+	uint8_t *payload = (void *)&buffer[sizeof(struct ublox_header)];
+	union ublox_checksum *checksum = (void *)&buffer[sizeof(struct ublox_header) + data_size];
+
+	header->sync1 = UBLOX_SYNC_CHAR_1;
+	header->sync2 = UBLOX_SYNC_CHAR_2;
+	header->msg_class = msg_class;
+	header->msg_id = msg_id;
+	header->length = data_size;
+
+	if (data_size > 0) {
+		memcpy(payload, data, data_size);
+	}
+
+	checksum->ck = ublox_calculate_checksum(buffer, header->length);
+
+	*size = packet_length;
+
+	return 0;
+}
+
+int ublox_build_mga_dbd(uint8_t *buffer, uint32_t *size, uint32_t max_size, const uint8_t *data,
+			uint32_t data_size)
+{
+	return ublox_build_msg(buffer, size, max_size, UBX_MGA, UBX_MGA_DBD, data, data_size);
+}
+
+int ublox_build_mga_ini_pos_llh(uint8_t *buffer, uint32_t *size, uint32_t max_size, int32_t lat,
+				int32_t lon, int32_t alt_cm, uint32_t acc_cm)
+{
+	struct ublox_mga_ini_pos_llh pos = {
+		.type = UBX_MGA_INI_POS_LLH,
+		.version = 0,
+		.lat = lat,
+		.lon = lon,
+		.alt = alt_cm,
+		.posAcc = acc_cm,
+	};
+
+	return ublox_build_msg(buffer, size, max_size, UBX_MGA, UBX_MGA_INI, &pos, sizeof(pos));
+}
+
+int ublox_build_mga_ini_time_utc(uint8_t *buffer, uint32_t *size, uint32_t max_size,
+				 int64_t unix_time, uint16_t acc_s)
+{
+	time_t raw_time = (time_t)unix_time;
+	struct tm utc;
+
+	if (gmtime_r(&raw_time, &utc) == NULL) {
+		return -EINVAL;
+	}
+
+	/* Leap seconds unknown, the receiver uses its own value. */
+	struct ublox_mga_ini_time_utc time = {
+		.type = UBX_MGA_INI_TIME_UTC,
+		.version = 0,
+		.ref = 0,
+		.leapSecs = INT8_MIN,
+		.year = utc.tm_year + 1900,
+		.month = utc.tm_mon + 1,
+		.day = utc.tm_mday,
+		.hour = utc.tm_hour,
+		.minute = utc.tm_min,
+		.second = utc.tm_sec,
+		.ns = 0,
+		.tAccS = acc_s,
+		.tAccNs = 0,
+	};
+
+	return ublox_build_msg(buffer, size, max_size, UBX_MGA, UBX_MGA_INI, &time, sizeof(time));
+}
+
 int ublox_build_rxm_pmreq(uint8_t *buffer, uint32_t *size, uint32_t max_size)
 {
 	/* Calculate packet length */
@@ -13,6 +13,11 @@
 #define UBLOX_SYNC_CHAR_1 0xB5
 #define UBLOX_SYNC_CHAR_2 0x62
 
+/* This can be adjusted, and sets the size of the staging buffer of the 
+ * streaming parser. Any payloads greater than this will lead to the message 
+ * being discarded. */
+#define UBLOX_MAX_PAYLOAD_SIZE 512
+
 /**
  * @brief Initializes protocol parser. 
  *
@@ -42,6 +47,50 @@ int ublox_register_handler(uint8_t msg_class, uint8_t msg_id,
  */
 uint32_t ublox_parse(uint8_t *data, uint32_t size);
 
+/**
+ * @brief Function for parsing a stream of U-blox protocol data, as it is 
+ *        received. All data is consumed, and messages may be split at any 
+ *        byte between calls. Data outside of messages, such as NMEA, is 
+ *        skipped while looking for the sync characters. 
+ *
+ * @param[in] data Data to parse. 
+ * @param[in] size Size of data. 
+ * 
+ * @return Number of complete messages with correct checksum. 
+ */
+uint32_t ublox_parse_stream(const uint8_t *data, uint32_t size);
+
+/**
+ * @brief Discards any partly received message of the streaming parser. 
+ */
+void ublox_parse_stream_reset(void);
+
+/** @brief Counters of the streaming parser, since init or the last reset. */
+struct ublox_parse_stats {
+	/** Bytes given to the parser. */
+	uint32_t bytes;
+	/** Messages with correct checksum. */
+	uint32_t messages;
+	/** Messages discarded for wrong checksum. */
+	uint32_t checksum_errors;
+	/** Messages discarded for a payload larger than UBLOX_MAX_PAYLOAD_SIZE. */
+	uint32_t oversized;
+	/** Bytes skipped while looking for the sync characters. */
+	uint32_t skipped;
+};
+
+/**
+ * @brief Gets the counters of the streaming parser. 
+ *
+ * @param[out] stats Counters. 
+ */
+void ublox_get_parse_stats(struct ublox_parse_stats *stats);
+
+/**
+ * @brief Clears the counters of the streaming parser. 
+ */
+void ublox_reset_parse_stats(void);
+
 /**
  * @brief Resets stored response handlers for previous command.
  *        This is also done automatically when response has been handled. 
@@ -255,6 +304,9 @@ int ublox_build_cfg_valset(uint8_t *buffer, uint32_t *size, uint32_t max_size,
 int ublox_build_cfg_rst(uint8_t *buffer, uint32_t *size, uint32_t max_size, uint16_t mask,
 			uint8_t mode);
 
+/** @brief Size of the MGA-ANO payload. */
+#define UBLOX_MGA_ANO_SIZE 76
+
 /**
  * @brief Builds command for mga-ano, assistance data
  *
@@ -269,6 +321,54 @@ int ublox_build_cfg_rst(uint8_t *buffer, uint32_t *size, uint32_t max_size, uint
 int ublox_build_mga_ano(uint8_t *buffer, uint32_t *size, uint32_t max_size, uint8_t *data,
 			uint32_t data_size);
 
+/**
+ * @brief Builds command for mga-dbd, navigation database. Without data, 
+ *        this polls the navigation database of the receiver, which replies 
+ *        with a series of mga-dbd messages. These are sent back unmodified 
+ *        to restore the database. 
+ *
+ * @param[out] buffer Buffer to build command in. 
+ * @param[out] size Size of built command. 
+ * @param[in] max_size Maximum size of command. 
+ * @param[in] data Payload of a mga-dbd message from the receiver, or NULL. 
+ * @param[in] data_size Number of bytes in data. 
+ * 
+ * @return 0 if everything was ok, error code otherwise
+ */
+int ublox_build_mga_dbd(uint8_t *buffer, uint32_t *size, uint32_t max_size, const uint8_t *data,
+			uint32_t data_size);
+
+/**
+ * @brief Builds command for mga-ini-pos_llh, initial position assistance
+ *
+ * @param[out] buffer Buffer to build command in. 
+ * @param[out] size Size of built command. 
+ * @param[in] max_size Maximum size of command. 
+ * @param[in] lat Latitude [1e-7 deg]. 
+ * @param[in] lon Longitude [1e-7 deg]. 
+ * @param[in] alt_cm Height above ellipsoid [cm]. 
+ * @param[in] acc_cm Position accuracy, standard deviation [cm]. 
+ * 
+ * @return 0 if everything was ok, error code otherwise
+ */
+int ublox_build_mga_ini_pos_llh(uint8_t *buffer, uint32_t *size, uint32_t max_size, int32_t lat,
+				int32_t lon, int32_t alt_cm, uint32_t acc_cm);
+
+/**
+ * @brief Builds command for mga-ini-time_utc, initial time assistance. The 
+ *        time is valid on reception of the message.
+ *
+ * @param[out] buffer Buffer to build command in. 
+ * @param[out] size Size of built command. 
+ * @param[in] max_size Maximum size of command. 
+ * @param[in] unix_time UTC time in seconds since the epoch. 
+ * @param[in] acc_s Time accuracy [s]. 
+ * 
+ * @return 0 if everything was ok, error code otherwise
+ */
+int ublox_build_mga_ini_time_utc(uint8_t *buffer, uint32_t *size, uint32_t max_size,
+				 int64_t unix_time, uint16_t acc_s);
+
 /**
  * @brief Puts the receiver into backup-mode, waken up by interrupt
  * @param[out] buffer Buffer to build complete command in
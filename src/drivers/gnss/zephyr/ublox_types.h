@@ -191,6 +191,36 @@ struct UBLOX_STORAGE_ATTR ublox_mga_ack {
 	uint8_t msgPayloadStart[4];
 };
 
+/** @brief U-blox MGA-INI-POS_LLH message. */
+struct UBLOX_STORAGE_ATTR ublox_mga_ini_pos_llh {
+	uint8_t type;
+	uint8_t version;
+	uint8_t reserved0[2];
+	int32_t lat;
+	int32_t lon;
+	int32_t alt;
+	uint32_t posAcc;
+};
+
+/** @brief U-blox MGA-INI-TIME_UTC message. */
+struct UBLOX_STORAGE_ATTR ublox_mga_ini_time_utc {
+	uint8_t type;
+	uint8_t version;
+	uint8_t ref;
+	int8_t leapSecs;
+	uint16_t year;
+	uint8_t month;
+	uint8_t day;
+	uint8_t hour;
+	uint8_t minute;
+	uint8_t second;
+	uint8_t reserved0;
+	uint32_t ns;
+	uint16_t tAccS;
+	uint8_t reserved1[2];
+	uint32_t tAccNs;
+};
+
 /* Helper macros for getting various data types from buffer */
 #define GET_LE8(x) ((x[0] << 0))
 #define GET_LE16(x) ((x[0] << 0) | (x[1] << 8))
@@ -14,7 +14,11 @@
 
 #define UBX_MGA 0x13
 #define UBX_MGA_ANO 0x20
+#define UBX_MGA_INI 0x40
+#define UBX_MGA_INI_POS_LLH 0x01
+#define UBX_MGA_INI_TIME_UTC 0x10
 #define UBX_MGA_ACK 0x60
+#define UBX_MGA_DBD 0x80
 
 #define UBX_NAV 0x01
 #define UBX_NAV_DOP 0x04
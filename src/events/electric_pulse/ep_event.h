@@ -17,6 +17,11 @@ struct ep_status_event {
 
 	enum ep_status_flag ep_status;
 	bool is_first_pulse;
+
+	/** k_cycle_get_32() when the NAV-PVT message of the fix that caused
+	 *  the pulse arrived, 0 if not caused by a fix.
+	 */
+	uint32_t fix_cycles;
 };
 
 EVENT_TYPE_DECLARE(ep_status_event);
@@ -2,6 +2,67 @@
 
 EVENT_TYPE_DEFINE(gnss_data, false, NULL, NULL);
 
+struct gnss_snapshot {
+	atomic_t refs;
+	gnss_t gnss;
+};
+
+static struct gnss_snapshot gnss_snapshots[GNSS_SNAPSHOT_COUNT];
+
+const gnss_t gnss_snapshot_no_fix;
+
+static struct gnss_snapshot *gnss_snapshot_find(const gnss_t *gnss)
+{
+	for (int i = 0; i < GNSS_SNAPSHOT_COUNT; i++) {
+		if (&gnss_snapshots[i].gnss == gnss) {
+			return &gnss_snapshots[i];
+		}
+	}
+	return NULL;
+}
+
+gnss_t *gnss_snapshot_alloc(void)
+{
+	for (int i = 0; i < GNSS_SNAPSHOT_COUNT; i++) {
+		if (atomic_cas(&gnss_snapshots[i].refs, 0, 1)) {
+			return &gnss_snapshots[i].gnss;
+		}
+	}
+	return NULL;
+}
+
+void gnss_snapshot_ref(const gnss_t *gnss)
+{
+	struct gnss_snapshot *snapshot = gnss_snapshot_find(gnss);
+
+	if (snapshot != NULL) {
+		atomic_inc(&snapshot->refs);
+	}
+}
+
+void gnss_snapshot_unref(const gnss_t *gnss)
+{
+	struct gnss_snapshot *snapshot = gnss_snapshot_find(gnss);
+
+	if (snapshot != NULL) {
+		atomic_dec(&snapshot->refs);
+	}
+}
+
+/** @brief Releases the snapshot of a gnss_data event after the last
+ *         subscriber.
+ */
+static bool gnss_snapshot_event_handler(const struct event_header *eh)
+{
+	if (is_gnss_data(eh)) {
+		gnss_snapshot_unref(cast_gnss_data(eh)->gnss_data);
+	}
+	return false;
+}
+
+EVENT_LISTENER(gnss_snapshot, gnss_snapshot_event_handler);
+EVENT_SUBSCRIBE_FINAL(gnss_snapshot, gnss_data);
+
 EVENT_TYPE_DEFINE(gnss_set_mode_event, false, NULL, NULL);
 
 EVENT_TYPE_DEFINE(gnss_mode_changed_event, false, NULL, NULL);
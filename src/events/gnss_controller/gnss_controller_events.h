@@ -1,10 +1,50 @@
 #include <event_manager.h>
 #include "../../drivers/gnss/zephyr/gnss.h"
 
-/** @brief GNSS data received from the GNSS driver. */
+/** @brief Number of GNSS snapshots that can be in use at the same time, by the
+ *         GNSS controller, gnss_data events in flight and the subscribers
+ *         keeping the latest data.
+ */
+#define GNSS_SNAPSHOT_COUNT 6
+
+/** @brief Snapshot with all fields zero, published when the GNSS times out.
+ *         It is not part of the pool and never released.
+ */
+extern const gnss_t gnss_snapshot_no_fix;
+
+/**
+ * @brief Allocates a GNSS snapshot from the pool, holding one reference.
+ *        The contents are undefined, the caller fills all of it before
+ *        publishing, and it is never modified after that.
+ * 
+ * @return snapshot, or NULL if all snapshots are in use.
+ */
+gnss_t *gnss_snapshot_alloc(void);
+
+/**
+ * @brief Takes another reference to a snapshot the caller already holds a
+ *        reference to. Pointers outside the pool are ignored.
+ * 
+ * @param[in] gnss snapshot to keep.
+ */
+void gnss_snapshot_ref(const gnss_t *gnss);
+
+/**
+ * @brief Releases a reference to a snapshot, which is returned to the pool
+ *        when the last one is released. Pointers outside the pool are ignored.
+ * 
+ * @param[in] gnss snapshot to release, may be NULL.
+ */
+void gnss_snapshot_unref(const gnss_t *gnss);
+
+/** @brief GNSS data received from the GNSS driver. The event holds a reference
+ *         to the snapshot, which is released when all subscribers have been
+ *         notified. Subscribers keeping the data must take a reference, and
+ *         must not consume the event.
+ */
 struct gnss_data {
 	struct event_header header;
-	gnss_t gnss_data;
+	const gnss_t *gnss_data;
 	bool timed_out;
 };
 
@@ -14,6 +54,8 @@ EVENT_TYPE_DECLARE(gnss_data);
 struct gnss_set_mode_event {
 	struct event_header header;
 	gnss_mode_t mode;
+	/** Update rate in milliseconds, 0 for the default rate of the mode. */
+	uint16_t rate_ms;
 };
 
 EVENT_TYPE_DECLARE(gnss_set_mode_event);
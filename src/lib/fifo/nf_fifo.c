@@ -126,4 +126,113 @@ uint8_t fifo_dec_cnt(int16_t *fx_array, uint8_t size)
 		}
 	}
 	return my_counter;
-}
\ No newline at end of file
+}
+
+/** @brief Adds the position of the newest value to the back of a monotonic
+ *         queue, after removing the positions of values that can no longer
+ *         be the min (is_max false) or the max (is_max true).
+ */
+static void fifo_queue_push(fifo_stats_t *fifo, uint8_t *queue, uint8_t front, uint8_t *count,
+			    bool is_max)
+{
+	int16_t in = fifo->values[fifo->head];
+
+	while (*count > 0) {
+		int16_t back = fifo->values[queue[(front + *count - 1) % fifo->size]];
+		if (is_max ? (back > in) : (back < in)) {
+			break;
+		}
+		(*count)--;
+	}
+	queue[(front + *count) % fifo->size] = fifo->head;
+	(*count)++;
+}
+
+void fifo_stats_put(int16_t in, fifo_stats_t *fifo)
+{
+	uint8_t size = fifo->size;
+	int16_t newest = fifo->values[fifo->head];
+
+	fifo->head = (fifo->head + 1) % size;
+
+	/* The oldest element and its pair with the next element leave. */
+	int16_t oldest = fifo->values[fifo->head];
+	if (size > 1) {
+		int16_t next = fifo->values[(fifo->head + 1) % size];
+		fifo->inc_cnt -= (next > oldest);
+		fifo->dec_cnt -= (next < oldest);
+		fifo->inc_cnt += (in > newest);
+		fifo->dec_cnt += (in < newest);
+	}
+	if (fifo->min_queue[fifo->min_front] == fifo->head) {
+		fifo->min_front = (fifo->min_front + 1) % size;
+		fifo->min_count--;
+	}
+	if (fifo->max_queue[fifo->max_front] == fifo->head) {
+		fifo->max_front = (fifo->max_front + 1) % size;
+		fifo->max_count--;
+	}
+
+	fifo->sum += in - oldest;
+	fifo->values[fifo->head] = in;
+	fifo_queue_push(fifo, fifo->min_queue, fifo->min_front, &fifo->min_count, false);
+	fifo_queue_push(fifo, fifo->max_queue, fifo->max_front, &fifo->max_count, true);
+}
+
+void fifo_stats_fill(fifo_stats_t *fifo)
+{
+	int16_t newest = fifo->values[fifo->head];
+
+	for (uint8_t i = 0; i < fifo->size; i++) {
+		fifo->values[i] = newest;
+	}
+	fifo->sum = (int32_t)newest * fifo->size;
+	fifo->inc_cnt = 0;
+	fifo->dec_cnt = 0;
+	fifo->min_front = 0;
+	fifo->min_count = 1;
+	fifo->min_queue[0] = fifo->head;
+	fifo->max_front = 0;
+	fifo->max_count = 1;
+	fifo->max_queue[0] = fifo->head;
+}
+
+int16_t fifo_stats_avg(const fifo_stats_t *fifo)
+{
+	return (int16_t)(fifo->sum / fifo->size);
+}
+
+int16_t fifo_stats_slope(const fifo_stats_t *fifo)
+{
+	/* Slope is calculated as double of difference 
+	 * between newest value and average value.
+	 */
+	int32_t my_slope_rate = (fifo->values[fifo->head] - fifo_stats_avg(fifo)) * 2;
+
+	return (int16_t)CLAMP(my_slope_rate, INT16_MIN, INT16_MAX);
+}
+
+uint8_t fifo_stats_inc_cnt(const fifo_stats_t *fifo)
+{
+	return fifo->inc_cnt;
+}
+
+uint8_t fifo_stats_dec_cnt(const fifo_stats_t *fifo)
+{
+	return fifo->dec_cnt;
+}
+
+int16_t fifo_stats_min(const fifo_stats_t *fifo)
+{
+	return fifo->values[fifo->min_queue[fifo->min_front]];
+}
+
+int16_t fifo_stats_max(const fifo_stats_t *fifo)
+{
+	return fifo->values[fifo->max_queue[fifo->max_front]];
+}
+
+int16_t fifo_stats_delta(const fifo_stats_t *fifo)
+{
+	return fifo_stats_max(fifo) - fifo_stats_min(fifo);
+}
@@ -120,4 +120,81 @@ void fifo_fill(int16_t *fx_array, uint8_t size);
  */
 void fifo_put(int16_t in, int16_t *fx_array, uint8_t size);
 
+/** Fifo register of the last size values, with the statistics of the fifo_*
+ *  functions above updated on every put instead of recalculated from the 
+ *  whole array. The values are kept in a ring buffer, and min and max in 
+ *  monotonic queues of ring buffer positions, so that all operations take 
+ *  constant time. Starts with all values 0, like a zeroed fifo array.
+ *  Define with FIFO_STATS_DEFINE.
+ */
+typedef struct {
+	/** Ring buffer of values, with the newest at head. */
+	int16_t *values;
+	/** Positions of increasing values, the front is the position of the min. */
+	uint8_t *min_queue;
+	/** Positions of decreasing values, the front is the position of the max. */
+	uint8_t *max_queue;
+	uint8_t size;
+	uint8_t head;
+	uint8_t min_front;
+	uint8_t min_count;
+	uint8_t max_front;
+	uint8_t max_count;
+	uint8_t inc_cnt;
+	uint8_t dec_cnt;
+	int32_t sum;
+} fifo_stats_t;
+
+/** @brief Defines a static fifo_stats_t of size values, with its buffers.
+ *
+ * @param name name of the fifo_stats_t.
+ * @param n number of values, 1 to 255.
+ */
+#define FIFO_STATS_DEFINE(name, n)                                                                 \
+	BUILD_ASSERT((n) > 0 && (n) <= UINT8_MAX, "Invalid fifo size");                            \
+	static int16_t name##_values[n];                                                           \
+	static uint8_t name##_min_queue[n];                                                        \
+	static uint8_t name##_max_queue[n];                                                        \
+	static fifo_stats_t name = { .values = name##_values,                                      \
+				     .min_queue = name##_min_queue,                                \
+				     .max_queue = name##_max_queue,                                \
+				     .size = (n),                                                  \
+				     .min_count = 1,                                               \
+				     .max_count = 1 }
+
+/** @brief Puts an element into fifo register, dropping the oldest element.
+ * 
+ * @param[in] in value to store.
+ * @param[in,out] fifo fifo register.
+ */
+void fifo_stats_put(int16_t in, fifo_stats_t *fifo);
+
+/** @brief Makes all elements in a fifo equal to the last input, 
+ *         see fifo_fill.
+ * 
+ * @param[in,out] fifo fifo register.
+ */
+void fifo_stats_fill(fifo_stats_t *fifo);
+
+/** @brief Average of fifo register, see fifo_avg. */
+int16_t fifo_stats_avg(const fifo_stats_t *fifo);
+
+/** @brief Slope rate of fifo register, see fifo_slope. */
+int16_t fifo_stats_slope(const fifo_stats_t *fifo);
+
+/** @brief Number of increasing elements in fifo, see fifo_inc_cnt. */
+uint8_t fifo_stats_inc_cnt(const fifo_stats_t *fifo);
+
+/** @brief Number of decreasing elements in fifo, see fifo_dec_cnt. */
+uint8_t fifo_stats_dec_cnt(const fifo_stats_t *fifo);
+
+/** @brief Min value of fifo register, see fifo_min. */
+int16_t fifo_stats_min(const fifo_stats_t *fifo);
+
+/** @brief Max value of fifo register, see fifo_max. */
+int16_t fifo_stats_max(const fifo_stats_t *fifo);
+
+/** @brief Subtracts fifo_stats_min from fifo_stats_max, see fifo_delta. */
+int16_t fifo_stats_delta(const fifo_stats_t *fifo);
+
 #endif
\ No newline at end of file
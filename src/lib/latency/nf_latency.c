@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2022 Nofence AS
+ */
+
+#include <zephyr.h>
+#include <init.h>
+#include <string.h>
+#include <sys/util.h>
+#include <logging/log.h>
+
+#include "nf_latency.h"
+#include "error_event.h"
+
+LOG_MODULE_REGISTER(nf_latency, CONFIG_FIX_LATENCY_LOG_LEVEL);
+
+/* Log2 histogram with 4 buckets per power of two, the first 4 buckets hold
+ * 0-3 us. 96 buckets cover latencies up to 2^25 us (33 s), longer latencies
+ * are counted in the last bucket.
+ */
+#define LATENCY_SUB_BUCKETS 4
+#define LATENCY_BUCKETS 96
+
+typedef struct {
+	uint32_t count;
+	uint32_t min_us;
+	uint32_t max_us;
+	uint64_t sum_us;
+
+	/** Halved whenever a bucket saturates, keeping the distribution. */
+	uint16_t buckets[LATENCY_BUCKETS];
+} latency_hist_t;
+
+static latency_hist_t hists[LATENCY_STAGES];
+static struct k_spinlock hist_lock;
+
+static uint8_t latency_bucket(uint32_t us)
+{
+	if (us < LATENCY_SUB_BUCKETS) {
+		return us;
+	}
+	uint8_t msb = 31 - __builtin_clz(us);
+	uint32_t index = (msb - 1) * LATENCY_SUB_BUCKETS + ((us >> (msb - 2)) & 3);
+
+	return MIN(index, LATENCY_BUCKETS - 1);
+}
+
+/** @brief Largest latency that is counted in a bucket. */
+static uint32_t latency_bucket_max(uint8_t index)
+{
+	if (index < LATENCY_SUB_BUCKETS) {
+		return index;
+	}
+	uint8_t msb = index / LATENCY_SUB_BUCKETS + 1;
+	uint32_t sub = index % LATENCY_SUB_BUCKETS;
+
+	return ((LATENCY_SUB_BUCKETS + sub + 1) << (msb - 2)) - 1;
+}
+
+void latency_record(latency_stage_t stage, uint32_t stamp)
+{
+	if (stage >= LATENCY_STAGES || stamp == 0) {
+		return;
+	}
+	uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - stamp);
+	latency_hist_t *hist = &hists[stage];
+
+	k_spinlock_key_t key = k_spin_lock(&hist_lock);
+
+	if (hist->count == 0 || us < hist->min_us) {
+		hist->min_us = us;
+	}
+	if (us > hist->max_us) {
+		hist->max_us = us;
+	}
+	hist->count++;
+	hist->sum_us += us;
+
+	uint8_t index = latency_bucket(us);
+	if (hist->buckets[index] == UINT16_MAX) {
+		for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+			hist->buckets[i] /= 2;
+		}
+	}
+	hist->buckets[index]++;
+
+	k_spin_unlock(&hist_lock, key);
+}
+
+int latency_get_stats(latency_stage_t stage, latency_stats_t *stats)
+{
+	if (stage >= LATENCY_STAGES) {
+		return -EINVAL;
+	}
+	latency_hist_t *hist = &hists[stage];
+	memset(stats, 0, sizeof(*stats));
+
+	k_spinlock_key_t key = k_spin_lock(&hist_lock);
+
+	if (hist->count > 0) {
+		stats->count = hist->count;
+		stats->min_us = hist->min_us;
+		stats->max_us = hist->max_us;
+		stats->avg_us = hist->sum_us / hist->count;
+
+		uint32_t total = 0;
+		for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+			total += hist->buckets[i];
+		}
+
+		/* Smallest bucket where at least 99 % of the samples are counted. */
+		uint32_t rank = total - total / 100;
+		uint32_t seen = 0;
+		for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+			seen += hist->buckets[i];
+			if (seen >= rank) {
+				stats->p99_us = MIN(latency_bucket_max(i), hist->max_us);
+				break;
+			}
+		}
+	}
+
+	k_spin_unlock(&hist_lock, key);
+	return 0;
+}
+
+void latency_reset(void)
+{
+	k_spinlock_key_t key = k_spin_lock(&hist_lock);
+	memset(hists, 0, sizeof(hists));
+	k_spin_unlock(&hist_lock, key);
+}
+
+#if CONFIG_FIX_LATENCY_LOG_INTERVAL_MIN > 0
+
+/* Set in the code of latency summaries, which is then never a negative errno. */
+#define LATENCY_LOG_CODE_FLAG BIT(30)
+
+static void latency_log_fn(struct k_work *item);
+K_WORK_DELAYABLE_DEFINE(latency_log_work, latency_log_fn);
+
+/** @brief Writes a summary of all stages with samples to the system
+ *         diagnostic log, as a single ERR_DIAGNOSTIC warning, so that the
+ *         queue of the error handler is not flooded. The code is
+ *         -(LATENCY_LOG_CODE_FLAG | stage << 24 | p99 [ms]) of the stage with
+ *         the highest p99, and the message lists the p99 [ms] of every stage.
+ */
+static void latency_log_fn(struct k_work *item)
+{
+	char msg[CONFIG_ERROR_MAX_USER_MESSAGE_SIZE + 1] = "Fix latency p99 ms:";
+	size_t len = strlen(msg);
+	int slowest = -1;
+	uint32_t slowest_p99_us = 0;
+
+	for (latency_stage_t stage = 0; stage < LATENCY_STAGES; stage++) {
+		latency_stats_t stats;
+
+		if (latency_get_stats(stage, &stats) != 0 || stats.count == 0) {
+			continue;
+		}
+		LOG_INF("Fix latency stage %d: n %d, min %d, avg %d, max %d, p99 %d us", stage,
+			stats.count, stats.min_us, stats.avg_us, stats.max_us, stats.p99_us);
+
+		len += snprintk(&msg[len], sizeof(msg) - len, " %d=%d", stage,
+				stats.p99_us / USEC_PER_MSEC);
+		len = MIN(len, sizeof(msg) - 1);
+		if (slowest < 0 || stats.p99_us >= slowest_p99_us) {
+			slowest = stage;
+			slowest_p99_us = stats.p99_us;
+		}
+	}
+
+	if (slowest >= 0) {
+		int code = LATENCY_LOG_CODE_FLAG | (slowest << 24) |
+			   MIN(slowest_p99_us / USEC_PER_MSEC, 0xFFFFFF);
+		nf_app_warning(ERR_DIAGNOSTIC, -code, msg, len);
+	}
+	k_work_schedule(&latency_log_work, K_MINUTES(CONFIG_FIX_LATENCY_LOG_INTERVAL_MIN));
+}
+
+static int latency_init(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+	k_work_schedule(&latency_log_work, K_MINUTES(CONFIG_FIX_LATENCY_LOG_INTERVAL_MIN));
+	return 0;
+}
+
+SYS_INIT(latency_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+
+#endif /* CONFIG_FIX_LATENCY_LOG_INTERVAL_MIN > 0 */
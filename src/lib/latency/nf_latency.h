@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2022 Nofence AS
+ */
+
+#ifndef _NF_LATENCY_H_
+#define _NF_LATENCY_H_
+
+#include <zephyr.h>
+
+/** @brief Stages a GNSS fix passes from the UBX-NAV-PVT message to a
+ *         warning tone or electric pulse. The latency of every stage is
+ *         measured from the arrival of the NAV-PVT message.
+ */
+typedef enum {
+	/** GNSS controller published the fix as a gnss_data event. */
+	LATENCY_GNSS_PUBLISH = 0,
+
+	/** AMC event handler stored the fix in the gnss cache. */
+	LATENCY_AMC_CACHED = 1,
+
+	/** AMC work queue started processing the fix. */
+	LATENCY_AMC_START = 2,
+
+	/** AMC evaluated the corrections for the fix. */
+	LATENCY_AMC_CORRECTION = 3,
+
+	/** Warning tone frequency changed based on the fix. */
+	LATENCY_WARN_TONE = 4,
+
+	/** Electric pulse released based on the fix. */
+	LATENCY_PULSE = 5,
+
+	LATENCY_STAGES
+} latency_stage_t;
+
+/** @brief Latency statistics of a stage, in microseconds. The p99 is the
+ *         upper bound of the histogram bucket holding the 99th percentile,
+ *         which is at most 25 % above the exact value.
+ */
+typedef struct {
+	uint32_t count;
+	uint32_t min_us;
+	uint32_t avg_us;
+	uint32_t max_us;
+	uint32_t p99_us;
+} latency_stats_t;
+
+#if CONFIG_FIX_LATENCY
+
+/**
+ * @brief Records the latency of a stage, from the timestamp of the fix
+ *        until now. Can be called from any thread.
+ *
+ * @param[in] stage stage that was reached.
+ * @param[in] stamp k_cycle_get_32() when the NAV-PVT message of the fix
+ *                  arrived, see pvt_cycles in gnss_struct_t. Ignored if 0.
+ */
+void latency_record(latency_stage_t stage, uint32_t stamp);
+
+/**
+ * @brief Fetches the latency statistics of a stage.
+ *
+ * @param[in] stage stage to fetch.
+ * @param[out] stats statistics of the stage, all 0 if nothing is recorded.
+ *
+ * @return 0 on success, -EINVAL for an unknown stage.
+ */
+int latency_get_stats(latency_stage_t stage, latency_stats_t *stats);
+
+/** @brief Clears the statistics of all stages. */
+void latency_reset(void);
+
+#else
+
+static inline void latency_record(latency_stage_t stage, uint32_t stamp)
+{
+}
+
+static inline int latency_get_stats(latency_stage_t stage, latency_stats_t *stats)
+{
+	return -ENOTSUP;
+}
+
+static inline void latency_reset(void)
+{
+}
+
+#endif /* CONFIG_FIX_LATENCY */
+
+#endif /* _NF_LATENCY_H_ */
@@ -9,10 +9,12 @@
 #include "amc_dist.h"
 #include "amc_zone.h"
 #include "amc_gnss.h"
+#include "amc_gnss_sched.h"
 #include "amc_states_cache.h"
 #include "amc_correction.h"
 #include "amc_const.h"
 #include "nf_fifo.h"
+#include "nf_latency.h"
 #include "amc_handler.h"
 #include "amc_events.h"
 #include "sound_event.h"
@@ -48,16 +50,22 @@ static struct k_work handle_states_work;
 static struct k_work handle_corrections_work;
 static struct k_work handle_new_fence_work;
 
-/* Distance arrays. */
-static int16_t dist_array[FIFO_ELEMENTS];
-static int16_t dist_avg_array[FIFO_AVG_DISTANCE_ELEMENTS];
+/* Reads a new fence into the idle pasture cache slot. Submitted to the system
+ * work queue, so that fixes are still evaluated with the published pasture 
+ * while the new one is read from flash and indexed.
+ */
+static struct k_work stage_new_fence_work;
+
+/* Distance fifos. */
+FIFO_STATS_DEFINE(dist_fifo, FIFO_ELEMENTS);
+FIFO_STATS_DEFINE(dist_avg_fifo, FIFO_AVG_DISTANCE_ELEMENTS);
 
-/* Array to discover unstable position accuracy. */
-static int16_t acc_array[FIFO_ELEMENTS];
+/* Fifo to discover unstable position accuracy. */
+FIFO_STATS_DEFINE(acc_fifo, FIFO_ELEMENTS);
 
-/* Array used to discover abnormal height changes that might happen
+/* Fifo used to discover abnormal height changes that might happen
  * if gps signals gets reflected. */
-static int16_t height_avg_array[FIFO_ELEMENTS];
+FIFO_STATS_DEFINE(height_avg_fifo, FIFO_ELEMENTS);
 
 /* Static variables used in AMC logic. */
 static int16_t dist_change;
@@ -79,8 +87,44 @@ atomic_t current_beacon_status = ATOMIC_INIT(BEACON_STATUS_NOT_FOUND);
 
 static uint32_t maybe_out_of_fence_timestamp = 0;
 
+#if CONFIG_AMC_DIST_SAFE_RADIUS
+/**
+ * @brief Gets the distance limit up to which the exact distance calculation 
+ * may be skipped in the given zone, i.e. where the zone cannot change to a
+ * higher level.
+ * 
+ * @param zone Current zone.
+ * @return Distance limit, INT16_MIN if the distance must always be exact.
+ */
+static int16_t get_safe_dist_limit(amc_zone_t zone)
+{
+	switch (zone) {
+	case PSM_ZONE:
+		return LIM_CAUTION_LOW_DM;
+	case CAUTION_ZONE:
+		return LIM_PREWARN_LOW_DM;
+	default:
+		return INT16_MIN;
+	}
+}
+#endif
+
 static bool m_fence_update_pending = false;
 static uint32_t m_new_fence_version;
+
+/* Result of reading the new fence into the pasture cache. */
+static atomic_t m_new_fence_stage_err = ATOMIC_INIT(0);
+
+/**
+ * @brief Publishes the pasture staged from storage (if a valid fence), and 
+ * updates the fence status and version accordingly.
+ * 
+ * @param stage_err Result of staging the pasture with stg_read_pasture_data.
+ * 
+ * @return Zero if successfull, otherwise negative error code.
+ */
+static inline int install_pasture(int stage_err);
+
 /**
  * @brief Updates the current pasture from storage (if a valid fence).
  * 
@@ -95,6 +139,14 @@ static inline int update_pasture_from_stg(void);
  */
 int gnss_timeout_reset_fifo();
 
+/**
+ * @brief Work handler function that reads a new fence from storage into the 
+ * pasture cache, and then submits handle_new_fence_work to deploy it.
+ * 
+ * @param item Pointer to the work item.
+ */
+void stage_new_fence_fn(struct k_work *item);
+
 /**
  * @brief Work handler function that handles and deploy a new fence when 
  * available from storage.
@@ -135,7 +187,7 @@ void handle_gnss_data_fn(struct k_work *item);
  */
 static bool event_handler(const struct event_header *eh);
 
-static inline int update_pasture_from_stg(void)
+static inline int install_pasture(int stage_err)
 {
 	int err;
 	/* Add check for fence status, in case collar has rebooted after invalidation */
@@ -149,7 +201,16 @@ static inline int update_pasture_from_stg(void)
 		return 0;
 	}
 
-	err = stg_read_pasture_data(set_pasture_cache);
+	err = stage_err;
+	if (err == 0) {
+		err = pasture_cache_publish();
+		if (err == -EALREADY) {
+			/* Fence updated twice, and the staged pasture was
+			 * already published for the first update.
+			 */
+			err = 0;
+		}
+	}
 	if (err == -ENODATA) {
 		LOG_WRN("No pasture found on external flash. (%d)", err);
 		nf_app_warning(ERR_AMC, err, NULL, 0);
@@ -168,18 +229,11 @@ static inline int update_pasture_from_stg(void)
 		return err;
 	}
 
-	/* Take pasture sem, since we need to access the version to send to messaging module. */
-	err = k_sem_take(&fence_data_sem, K_SECONDS(CONFIG_FENCE_CACHE_TIMEOUT_SEC));
+	/* Pin pasture, since we need to access the version to send to messaging module. */
+	pasture_t *pasture = NULL;
+	uint8_t slot = pasture_cache_pin(&pasture);
 	do {
-		if (err) {
-			LOG_ERR("Error taking pasture semaphore for version check (%d)", err);
-			nf_app_error(ERR_AMC, err, NULL, 0);
-			break;
-		}
-
 		/* Verify it has been cached correctly. */
-		pasture_t *pasture = NULL;
-		get_pasture_cache(&pasture);
 		if (pasture == NULL) {
 			LOG_ERR("Pasture was not cached correctly. (%d)", -ENODATA);
 			nf_app_error(ERR_AMC, -ENODATA, NULL, 0);
@@ -228,16 +282,32 @@ static inline int update_pasture_from_stg(void)
 		LOG_INF("Pasture loaded:FenceVersion=%d,FenceStatus=%d",
 			pasture->m.ul_fence_def_version, get_fence_status());
 
-		k_sem_give(&fence_data_sem);
+		pasture_cache_unpin(slot);
 		return 0;
 	} while (0);
 	LOG_WRN("Failed to update pasture!");
 	/* Update fence status to unknown in case of failure */
 	force_fence_status(FenceStatus_FenceStatus_Invalid);
-	k_sem_give(&fence_data_sem);
+	pasture_cache_unpin(slot);
 	return err;
 }
 
+static inline int update_pasture_from_stg(void)
+{
+	int err = 0;
+
+	if (get_fence_status() != FenceStatus_TurnedOffByBLE) {
+		err = stg_read_pasture_data(pasture_cache_stage);
+	}
+	return install_pasture(err);
+}
+
+void stage_new_fence_fn(struct k_work *item)
+{
+	atomic_set(&m_new_fence_stage_err, stg_read_pasture_data(pasture_cache_stage));
+	k_work_submit_to_queue(&amc_work_q, &handle_new_fence_work);
+}
+
 void handle_new_fence_fn(struct k_work *item)
 {
 	int err;
@@ -251,7 +321,7 @@ void handle_new_fence_fn(struct k_work *item)
 		}
 	}
 
-	err = update_pasture_from_stg();
+	err = install_pasture(atomic_get(&m_new_fence_stage_err));
 	if (err != 0) {
 		LOG_WRN("Fence update request denied, error:%d", err);
 	}
@@ -289,7 +359,7 @@ void handle_corrections_fn()
 {
 	/* Fetch cached gnss data. */
 	LOG_INF("  handle_corrections_fn");
-	gnss_t *gnss = NULL;
+	const gnss_t *gnss = NULL;
 	int err = get_gnss_cache(&gnss);
 	if ((err != 0) && (err != -ETIMEDOUT)) {
 		LOG_ERR("Could not fetch GNSS cache %i", err);
@@ -302,32 +372,29 @@ void handle_corrections_fn()
 
 	process_correction(collar_mode, &gnss->lastfix, fence_status, current_zone, mean_dist,
 			   dist_change);
+	if (err == 0) {
+		latency_record(LATENCY_AMC_CORRECTION, gnss->latest.pvt_cycles);
+	}
 }
 
 void handle_gnss_data_fn(struct k_work *item)
 {
+	pasture_t *pasture = NULL;
+	uint8_t slot = 0;
+	int err;
+
 	if (m_fence_update_pending) {
 		LOG_DBG("AMC GNSS data not processed due to pending fence update");
 		goto cleanup;
 	}
 
-	/* Take fence semaphore since we're going to use the cached area. */
-	int err = k_sem_take(&fence_data_sem, K_SECONDS(CONFIG_FENCE_CACHE_TIMEOUT_SEC));
-	if (err) {
-		LOG_ERR("Error waiting for fence data semaphore to release. (%d)", err);
-		nf_app_error(ERR_AMC, err, NULL, 0);
-		goto cleanup;
-	}
-
-	/* Fetch cached fence and size. */
-	pasture_t *pasture = NULL;
-	err = get_pasture_cache(&pasture);
-	if (err || pasture == NULL) {
-		goto cleanup;
-	}
+	/* Pin the cached fence since we're going to use it. A new fence is
+	 * stored in the other slot, so this never waits for a fence update.
+	 */
+	slot = pasture_cache_pin(&pasture);
 
 	/* Fetch new, cached gnss data. */
-	gnss_t *gnss = NULL;
+	const gnss_t *gnss = NULL;
 	bool gnss_timeout = false;
 	err = get_gnss_cache(&gnss);
 	if (err == -ETIMEDOUT) {
@@ -335,6 +402,8 @@ void handle_gnss_data_fn(struct k_work *item)
 		gnss_timeout = true;
 	} else if (err != 0) {
 		goto cleanup;
+	} else {
+		latency_record(LATENCY_AMC_START, gnss->latest.pvt_cycles);
 	}
 
 	LOG_DBG("\n\n--== START ==--");
@@ -365,11 +434,19 @@ void handle_gnss_data_fn(struct k_work *item)
 	EVENT_SUBMIT(loc);
 
 	/* If any fence (pasture?) is valid and we have fix. */
-	if (gnss_has_fix() && fnc_valid_fence() && !overflow_xy && !gnss_timeout) {
+	if (gnss_has_fix() && fnc_valid_fence(pasture) && !overflow_xy && !gnss_timeout) {
 		/* Calculate distance to closest polygon. */
 		uint8_t fence_index = 0;
 		uint8_t vertex_index = 0;
-		instant_dist = fnc_calc_dist(pos_x, pos_y, &fence_index, &vertex_index);
+#if CONFIG_AMC_DIST_SAFE_RADIUS
+		instant_dist = fnc_calc_dist_lazy(pasture, slot, pos_x, pos_y,
+						  get_safe_dist_limit(zone_get()), &fence_index,
+						  &vertex_index);
+		LOG_DBG("  Skipped distance calculations: %u", fnc_get_dist_skip_count());
+#else
+		instant_dist =
+			fnc_calc_dist(pasture, slot, pos_x, pos_y, &fence_index, &vertex_index);
+#endif
 		LOG_INF("  Calculated distance: %d", instant_dist);
 
 		/* Reset dist_change since we acquired a new distance. */
@@ -385,9 +462,10 @@ void handle_gnss_data_fn(struct k_work *item)
 			LOG_INF("  Has accepted fix!");
 
 			/* Accepted position. Fill FIFOs. */
-			fifo_put(gnss->lastfix.h_acc_dm, acc_array, FIFO_ELEMENTS);
-			fifo_put(gnss->lastfix.height, height_avg_array, FIFO_ELEMENTS);
-			fifo_put(instant_dist, dist_array, FIFO_ELEMENTS);
+			fifo_stats_put(gnss->lastfix.h_acc_dm, &acc_fifo);
+			fifo_stats_put(gnss->lastfix.height, &height_avg_fifo);
+			fifo_stats_put(instant_dist, &dist_fifo);
+			gnss_sched_update(instant_dist, gnss);
 
 			/* If we have filled the distance FIFO, calculate
 			 * the average and store that value into
@@ -395,8 +473,7 @@ void handle_gnss_data_fn(struct k_work *item)
 			 */
 			if (++fifo_dist_elem_count >= FIFO_ELEMENTS) {
 				fifo_dist_elem_count = 0;
-				fifo_put(fifo_avg(dist_array, FIFO_ELEMENTS), dist_avg_array,
-					 FIFO_AVG_DISTANCE_ELEMENTS);
+				fifo_stats_put(fifo_stats_avg(&dist_fifo), &dist_avg_fifo);
 
 				if (++fifo_avg_dist_elem_count >= FIFO_AVG_DISTANCE_ELEMENTS) {
 					fifo_avg_dist_elem_count = FIFO_AVG_DISTANCE_ELEMENTS;
@@ -406,19 +483,19 @@ void handle_gnss_data_fn(struct k_work *item)
 			LOG_INF("  Does not have accepted fix!");
 			fifo_dist_elem_count = 0;
 			fifo_avg_dist_elem_count = 0;
+			gnss_sched_reset();
 		}
 
 		if (fifo_avg_dist_elem_count > 0) {
 			/* Fill avg/mean/delta fifos as we have collected
 			 * valid data over a short period. */
-			mean_dist = fifo_avg(dist_array, FIFO_ELEMENTS);
-			dist_change = fifo_slope(dist_array, FIFO_ELEMENTS);
-			dist_inc_count = fifo_inc_cnt(dist_array, FIFO_ELEMENTS);
-			acc_delta = fifo_delta(acc_array, FIFO_ELEMENTS);
-			height_delta = fifo_delta(height_avg_array, FIFO_ELEMENTS);
+			mean_dist = fifo_stats_avg(&dist_fifo);
+			dist_change = fifo_stats_slope(&dist_fifo);
+			dist_inc_count = fifo_stats_inc_cnt(&dist_fifo);
+			acc_delta = fifo_stats_delta(&acc_fifo);
+			height_delta = fifo_stats_delta(&height_avg_fifo);
 			if (fifo_avg_dist_elem_count >= FIFO_AVG_DISTANCE_ELEMENTS) {
-				dist_avg_change =
-					fifo_slope(dist_avg_array, FIFO_AVG_DISTANCE_ELEMENTS);
+				dist_avg_change = fifo_stats_slope(&dist_avg_fifo);
 			}
 		}
 		LOG_INF("  mean_dist: %d, dist_change: %d, dist_inc_count: %d, acc_delta: %d, height_delta: %d",
@@ -470,6 +547,7 @@ void handle_gnss_data_fn(struct k_work *item)
 		 * work in order to stop correction if already running */
 		fifo_dist_elem_count = 0;
 		fifo_avg_dist_elem_count = 0;
+		gnss_sched_reset();
 		zone_set(NO_ZONE);
 
 		k_work_submit_to_queue(&amc_work_q, &handle_states_work);
@@ -477,13 +555,15 @@ void handle_gnss_data_fn(struct k_work *item)
 	} else {
 		fifo_dist_elem_count = 0;
 		fifo_avg_dist_elem_count = 0;
+		gnss_sched_reset();
 		zone_set(NO_ZONE);
 	}
 
 cleanup:
-	/* Calculation finished, give semaphore so we can swap memory region
-	 * on next GNSS request. Also notifying we're not using fence data area. */
-	k_sem_give(&fence_data_sem);
+	/* Calculation finished, notifying we're not using the fence data area. */
+	if (pasture != NULL) {
+		pasture_cache_unpin(slot);
+	}
 	LOG_DBG("--== END ==--\n\n");
 }
 
@@ -505,6 +585,7 @@ int amc_module_init(void)
 
 	k_work_init(&handle_new_gnss_work, handle_gnss_data_fn);
 	k_work_init(&handle_new_fence_work, handle_new_fence_fn);
+	k_work_init(&stage_new_fence_work, stage_new_fence_fn);
 	k_work_init(&handle_corrections_work, handle_corrections_fn);
 	k_work_init(&handle_states_work, handle_states_fn);
 
@@ -525,18 +606,21 @@ static bool event_handler(const struct event_header *eh)
 	if (is_new_fence_available(eh)) {
 		struct new_fence_available *ev = cast_new_fence_available(eh);
 		m_new_fence_version = ev->new_fence_version;
-		k_work_submit_to_queue(&amc_work_q, &handle_new_fence_work);
+		k_work_submit(&stage_new_fence_work);
 		return false;
 	}
 	if (is_gnss_data(eh)) {
 		struct gnss_data *event = cast_gnss_data(eh);
 
-		int err = set_gnss_cache(&event->gnss_data, event->timed_out);
+		int err = set_gnss_cache(event->gnss_data, event->timed_out);
 		if (err) {
 			LOG_ERR("Could not set gnss cahce. (%d)", err);
 			nf_app_error(ERR_AMC, err, NULL, 0);
 			return false;
 		}
+		if (!event->timed_out) {
+			latency_record(LATENCY_AMC_CACHED, event->gnss_data->latest.pvt_cycles);
+		}
 
 		/* No need to handle states/correction here, this is done
 		 * within handle_new_gnss_work. */
@@ -7,67 +7,172 @@
 
 #include "pasture_structure.h"
 #include "amc_cache.h"
+#include "amc_dist.h"
 #include "amc_states_cache.h"
+#include "gnss_controller_events.h"
 #include "embedded.pb.h"
 
 //LOG_MODULE_REGISTER(amc_cache, CONFIG_AMC_LIB_LOG_LEVEL);
 LOG_MODULE_REGISTER(amc_cache, 0);
 
-K_SEM_DEFINE(fence_data_sem, 1, 1);
+/* Serializes writers of the pasture cache, readers never take it. */
+K_SEM_DEFINE(pasture_write_sem, 1, 1);
 K_SEM_DEFINE(gnss_data_sem, 1, 1);
 
-/** Use two memory regions so we can swap the pointer between them
- * so that instead of waiting for semaphore to be released, we schedule
- * a pointer swap to the other region once we've read the data. Use an
- * atomic variable if both threads try to access and update that
- * gnss data is available or consumed.
- * 
- * @note Need to include correct GNSS header.
+/** GNSS snapshot in use by the consumer since the last get_gnss_cache, and
+ * the newest snapshot written since then, if any. The cache holds a
+ * reference to both, so the snapshot returned by get_gnss_cache stays
+ * valid until the next call, without copying the GNSS data.
  */
-static gnss_t cached_gnssdata_area_1;
-static gnss_t cached_gnssdata_area_2;
-static gnss_t *current_gnssdata_area = &cached_gnssdata_area_1;
-atomic_t new_gnss_written = ATOMIC_INIT(false);
+static const gnss_t *current_gnss = &gnss_snapshot_no_fix;
+static const gnss_t *written_gnss = NULL;
 static bool m_gnss_timeout = false;
 
-/* Cached fence data header and a max coordinate region. Links the coordinate
- * region to the header. Important! Is set to NULL everytime it's free'd
- * to ensure that we're calculating with a valid cached fence.
+/** Pasture cache slots, each holding a pasture in the packed format with room
+ *  for the largest pasture. Readers pin the published slot, while a new
+ *  pasture is stored in the other slot and then published by swapping
+ *  pasture_published. A slot is only reused when no reader pins it.
  */
-static pasture_t pasture_cache;
+typedef struct {
+	uint8_t buf[PASTURE_MAX_SIZE] __aligned(4);
+	atomic_t readers;
+} pasture_slot_t;
+
+static pasture_slot_t pasture_slots[PASTURE_CACHE_SLOTS];
+static atomic_t pasture_published = ATOMIC_INIT(0);
+
+/** A pasture is stored in the idle slot, but not yet published. */
+static bool pasture_staged;
+
+/* Interval in milliseconds for polling a pinned slot in set_pasture_cache. */
+#define PASTURE_UNPIN_POLL_MS 1
 
 int get_pasture_cache(pasture_t **pasture)
 {
-	if (pasture_cache.m.ul_total_fences == 0) {
+	pasture_t *cache = (pasture_t *)pasture_slots[atomic_get(&pasture_published)].buf;
+
+	if (cache->m.ul_total_fences == 0) {
 		LOG_WRN("Switching to \'No pasture\'!");
 	}
 
-	*pasture = &pasture_cache;
+	*pasture = cache;
 	return 0;
 }
 
-int set_pasture_cache(uint8_t *pasture, size_t len)
+uint8_t pasture_cache_pin(pasture_t **pasture)
 {
-	if (len != sizeof(pasture_t)) {
-		return -EINVAL;
+	atomic_val_t slot;
+
+	/* The slot is only ours if it is still published after pinning it,
+	 * otherwise a writer may already be storing a new pasture in it.
+	 */
+	while (true) {
+		slot = atomic_get(&pasture_published);
+		atomic_inc(&pasture_slots[slot].readers);
+		if (atomic_get(&pasture_published) == slot) {
+			break;
+		}
+		atomic_dec(&pasture_slots[slot].readers);
 	}
-	int err = k_sem_take(&fence_data_sem, K_SECONDS(CONFIG_FENCE_CACHE_TIMEOUT_SEC));
+
+	*pasture = (pasture_t *)pasture_slots[slot].buf;
+	return (uint8_t)slot;
+}
+
+void pasture_cache_unpin(uint8_t slot)
+{
+	atomic_dec(&pasture_slots[slot].readers);
+}
+
+int pasture_cache_stage(uint8_t *pasture, size_t len)
+{
+	bool is_legacy = false;
+
+	if (!pasture_layout_valid(pasture, len)) {
+		/* Pasture written to flash by earlier firmware. */
+		is_legacy = (len == sizeof(pasture_legacy_t) &&
+			     ((pasture_legacy_t *)pasture)->m.ul_total_fences <= FENCE_MAX);
+		if (!is_legacy) {
+			return -EINVAL;
+		}
+	}
+	int err = k_sem_take(&pasture_write_sem, K_SECONDS(CONFIG_FENCE_CACHE_TIMEOUT_SEC));
 	if (err) {
 		LOG_ERR("Error semaphore for fence cache %i", err);
 		return err;
 	}
 
-	/* Clear any previous pasture cache. */
-	memset(&pasture_cache, 0, sizeof(pasture_t));
+	/* Wait for readers that pinned the idle slot before the previous 
+	 * pasture was published.
+	 */
+	uint8_t slot = (atomic_get(&pasture_published) + 1) % PASTURE_CACHE_SLOTS;
+	int64_t timeout = k_uptime_get() + CONFIG_FENCE_CACHE_TIMEOUT_SEC * MSEC_PER_SEC;
+	while (atomic_get(&pasture_slots[slot].readers) != 0) {
+		if (k_uptime_get() >= timeout) {
+			LOG_ERR("Pasture cache slot %d still in use", slot);
+			k_sem_give(&pasture_write_sem);
+			return -EBUSY;
+		}
+		k_sleep(K_MSEC(PASTURE_UNPIN_POLL_MS));
+	}
 
-	/* Memcpy the contents. */
-	memcpy(&pasture_cache, (pasture_t *)pasture, sizeof(pasture_t));
+	pasture_t *cache = (pasture_t *)pasture_slots[slot].buf;
 
-	k_sem_give(&fence_data_sem);
+	/* Clear any previous pasture in the slot. */
+	pasture_staged = false;
+	memset(cache, 0, sizeof(pasture_slots[slot].buf));
+
+	if (is_legacy) {
+		err = pasture_from_legacy(cache, sizeof(pasture_slots[slot].buf),
+					  (pasture_legacy_t *)pasture);
+		if (err) {
+			/* The slot is not published, keep the current pasture. */
+			LOG_ERR("Error converting pasture %i", err);
+			k_sem_give(&pasture_write_sem);
+			return err;
+		}
+	} else {
+		/* Memcpy the contents. */
+		memcpy(cache, pasture, len);
+	}
+
+	/* Index the new pasture for the distance calculations. */
+	fnc_build_dist_index(cache, slot);
+	pasture_staged = true;
+
+	k_sem_give(&pasture_write_sem);
+	return err;
+}
+
+int pasture_cache_publish(void)
+{
+	int err = k_sem_take(&pasture_write_sem, K_SECONDS(CONFIG_FENCE_CACHE_TIMEOUT_SEC));
+	if (err) {
+		LOG_ERR("Error semaphore for fence cache %i", err);
+		return err;
+	}
+
+	if (!pasture_staged) {
+		k_sem_give(&pasture_write_sem);
+		return -EALREADY;
+	}
+	atomic_set(&pasture_published, (atomic_get(&pasture_published) + 1) % PASTURE_CACHE_SLOTS);
+	pasture_staged = false;
+
+	k_sem_give(&pasture_write_sem);
 	return 0;
 }
 
-int set_gnss_cache(gnss_t *gnss, const bool timed_out)
+int set_pasture_cache(uint8_t *pasture, size_t len)
+{
+	int err = pasture_cache_stage(pasture, len);
+	if (err) {
+		return err;
+	}
+	return pasture_cache_publish();
+}
+
+int set_gnss_cache(const gnss_t *gnss, const bool timed_out)
 {
 	/* We only need to take semaphore if AMC have not yet consumed
          * the previous GNSS data, which means we have to wait until it
@@ -85,20 +190,17 @@ int set_gnss_cache(gnss_t *gnss, const bool timed_out)
 	m_gnss_timeout = timed_out;
 	if (m_gnss_timeout == false) {
 		/* GNSS data is only updated if GNSS data is valid, i.e. the 
-		 * GNSS has NOT timed out (See gnss_controller) */
-		if (current_gnssdata_area == &cached_gnssdata_area_1) {
-			memcpy(&cached_gnssdata_area_2, gnss, sizeof(gnss_t));
-		} else {
-			memcpy(&cached_gnssdata_area_1, gnss, sizeof(gnss_t));
-		}
-
-		atomic_set(&new_gnss_written, true);
+		 * GNSS has NOT timed out (See gnss_controller). Data that was
+		 * never consumed is released. */
+		gnss_snapshot_ref(gnss);
+		gnss_snapshot_unref(written_gnss);
+		written_gnss = gnss;
 	}
 	k_sem_give(&gnss_data_sem);
 	return 0;
 }
 
-int get_gnss_cache(gnss_t **gnss)
+int get_gnss_cache(const gnss_t **gnss)
 {
 	int err = 0;
 	err = k_sem_take(&gnss_data_sem, K_SECONDS(CONFIG_GNSS_CACHE_TIMEOUT_SEC));
@@ -108,19 +210,16 @@ int get_gnss_cache(gnss_t **gnss)
 	}
 
 	/* Fetch GNSS data. Checks if we received new valid data, 
-         * swap the pointer to point at the newly written GNSS data 
-         * area if we have. If not, just return the current location.
+         * and release the previous snapshot for the newly written one
+         * if we have. If not, just return the current snapshot.
 	 */
-	if ((m_gnss_timeout == false) && (atomic_get(&new_gnss_written) == true)) {
-		if (current_gnssdata_area == &cached_gnssdata_area_1) {
-			current_gnssdata_area = &cached_gnssdata_area_2;
-		} else {
-			current_gnssdata_area = &cached_gnssdata_area_1;
-		}
-		atomic_set(&new_gnss_written, false);
+	if ((m_gnss_timeout == false) && (written_gnss != NULL)) {
+		gnss_snapshot_unref(current_gnss);
+		current_gnss = written_gnss;
+		written_gnss = NULL;
 	}
 
-	*gnss = current_gnssdata_area;
+	*gnss = current_gnss;
 	if (gnss == NULL) {
 		err = -ENODATA;
 	} else if (m_gnss_timeout == true) {
@@ -130,7 +229,7 @@ int get_gnss_cache(gnss_t **gnss)
 	return err;
 }
 
-bool fnc_valid(fence_t *fence)
+bool fnc_valid(const fence_t *fence)
 {
 	return (fence->m.n_points > 2 && fence->m.n_points <= 40 &&
 		(fence->m.e_fence_type == FenceDefinitionMessage_FenceType_Normal ||
@@ -138,14 +237,8 @@ bool fnc_valid(fence_t *fence)
 	/** @todo: [LEGACY CODE] Also test timespan from storage fence definition here. */
 }
 
-bool fnc_valid_fence(void)
+bool fnc_valid_fence(const pasture_t *pasture)
 {
-	pasture_t *pasture = NULL;
-
-	if (get_pasture_cache(&pasture)) {
-		return false;
-	}
-
 	if ((get_fence_status() == FenceStatus_FenceStatus_Invalid) ||
 	    (get_fence_status() == FenceStatus_TurnedOffByBLE)) {
 		return false;
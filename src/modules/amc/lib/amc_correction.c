@@ -14,6 +14,7 @@ LOG_MODULE_REGISTER(amc_correction, CONFIG_AMC_LIB_LOG_LEVEL);
 #include "messaging_module_events.h"
 
 #include "movement_controller.h"
+#include "nf_latency.h"
 
 /* For playing sound and fetching freq limits and zapping. */
 #include "sound_event.h"
@@ -47,6 +48,9 @@ static uint8_t correction_warn_on = 0;
 static atomic_t last_warn_freq = ATOMIC_INIT(0);
 static atomic_t can_update_buzzer = ATOMIC_INIT(false);
 static atomic_t last_mean_dist = ATOMIC_INIT(0);
+
+/* Arrival of the NAV-PVT message of the fix behind the last correction. */
+static atomic_t last_fix_cycles = ATOMIC_INIT(0);
 static void buzzer_update_fn();
 K_WORK_DELAYABLE_DEFINE(update_buzzer_work, buzzer_update_fn);
 
@@ -108,6 +112,7 @@ static void buzzer_update_fn()
 					new_sound_set_warn_freq_event();
 				freq_ev->freq = set_frequency;
 				EVENT_SUBMIT(freq_ev);
+				latency_record(LATENCY_WARN_TONE, atomic_get(&last_fix_cycles));
 
 				/** @note It will zap immediately once we 
 			 	 *  reach WARN_FREQ_MAX, and wait 200ms 
@@ -123,6 +128,7 @@ static void buzzer_update_fn()
 							new_ep_status_event();
 						ep_ev->ep_status = EP_RELEASE;
 						ep_ev->is_first_pulse = get_zap_pain_cnt() == 0;
+						ep_ev->fix_cycles = atomic_get(&last_fix_cycles);
 						EVENT_SUBMIT(ep_ev);
 						zap_eval_doing = true;
 						zap_timestamp = k_uptime_get_32();
@@ -420,10 +426,11 @@ uint8_t get_correction_status(void)
 	return correction_started + correction_warn_on;
 }
 
-void process_correction(Mode amc_mode, gnss_last_fix_struct_t *gnss, FenceStatus fs,
-			amc_zone_t zone, int16_t mean_dist, int16_t dist_change)
+void process_correction(Mode amc_mode, const gnss_last_fix_struct_t *gnss,
+			FenceStatus fs, amc_zone_t zone, int16_t mean_dist, int16_t dist_change)
 {
 	atomic_set(&last_mean_dist, mean_dist);
+	atomic_set(&last_fix_cycles, gnss->pvt_cycles);
 
 	if (amc_mode == Mode_Teach || amc_mode == Mode_Fence) {
 		LOG_DBG("  amc_mode in teach or fence");
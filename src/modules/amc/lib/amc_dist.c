@@ -11,45 +11,12 @@ LOG_MODULE_REGISTER(amc_dist, CONFIG_AMC_LIB_LOG_LEVEL);
 #include "pasture_structure.h"
 #include "embedded.pb.h"
 #include "trigonometry.h"
+#include <stdlib.h>
 
-/** @brief Determent if the point is inside the defined closed polyline.
- * 
- * @note Does not consider if the fence is inverted. That
- *       means, inside an inverted fence really means outside.
- * 
- * @param fence fence(polygon) to check.
- * @param testx x coordinate of test point.
- * @param testy y coordinate of test point.
- * 
- * @returns True if inside.
- */
-static uint8_t fnc_pt_in_closed_polyline(fence_t *fence, int16_t testx, int16_t testy)
-{
-	uint8_t i, j;
-	uint8_t c = 0;
-	int32_t myX[2];
-	int32_t myY[2];
-	int32_t mytestx;
-	int32_t mytesty;
-
-	mytestx = testx;
-	mytesty = testy;
-
-	for (i = 0, j = (fence->m.n_points - 1); i < fence->m.n_points; j = i++) {
-		myX[0] = fence->coordinates[i].s_x_dm;
-		myX[1] = fence->coordinates[j].s_x_dm;
-		myY[0] = fence->coordinates[i].s_y_dm;
-		myY[1] = fence->coordinates[j].s_y_dm;
-		if (((myY[0] > mytesty) != (myY[1] > mytesty)) &&
-		    (mytestx <
-		     ((myX[1] - myX[0]) * (mytesty - myY[0])) / (myY[1] - myY[0]) + myX[0])) {
-			/* Toggle each time the test results in "cutting a fenceline". */
-			c = !c;
-		}
-	}
-
-	return c;
-}
+/** Largest squared distance g_u32_SquareRootRounded() maps to 65535. Beyond
+ *  this the rounded distance wraps to 0 in fnc_distance().
+ */
+#define DIST_SQ_NO_WRAP_MAX 0xFFFF0000UL
 
 uint16_t fnc_distance(int16_t Ax, int16_t Ay, int16_t Bx, int16_t By)
 {
@@ -68,6 +35,19 @@ uint16_t fnc_distance(int16_t Ax, int16_t Ay, int16_t Bx, int16_t By)
 	return (uint16_t)my_distance;
 }
 
+/** @brief Squared distance between A and B, as seen by fnc_distance(). It wraps
+ *         like the int32 calculation there, and is 0 where the rounded root
+ *         wraps to 0, so it orders distances the same way.
+ */
+static uint32_t fnc_distance_sq(int16_t Ax, int16_t Ay, int16_t Bx, int16_t By)
+{
+	uint32_t d1 = (uint32_t)((int32_t)Ax - Bx);
+	uint32_t d2 = (uint32_t)((int32_t)Ay - By);
+	uint32_t my_distance = d1 * d1 + d2 * d2;
+
+	return (my_distance > DIST_SQ_NO_WRAP_MAX) ? 0 : my_distance;
+}
+
 typedef struct {
 	int32_t X;
 	int32_t Y;
@@ -87,7 +67,7 @@ static int32_t fnc_dot(vec32_t *a, vec32_t *b)
 	return (int32_t)a->X * b->X + (int32_t)a->Y * b->Y;
 }
 
-/** @brief Compute the distance from a segment AB to point C.
+/** @brief Compute the squared distance from a segment AB to point C.
  * 
  * @param A_X x value of vertex A.
  * @param A_Y y value of vertex A.
@@ -96,12 +76,12 @@ static int32_t fnc_dot(vec32_t *a, vec32_t *b)
  * @param C_X x value of vertex C.
  * @param C_Y y value of vertex C.
  * 
- * @return The computed distance to actual vertex in polygon.
+ * @return The squared distance to actual vertex in polygon, see fnc_distance_sq().
 */
-static uint16_t fnc_ln_pt_dist(int16_t A_X, int16_t A_Y, int16_t B_X, int16_t B_Y, int16_t C_X,
-			       int16_t C_Y)
+static uint32_t fnc_ln_pt_dist_sq(int16_t A_X, int16_t A_Y, int16_t B_X, int16_t B_Y,
+				  int16_t C_X, int16_t C_Y)
 {
-	uint16_t d;
+	uint32_t d;
 	vec32_t v, w;
 	int32_t v_x, v_y;
 	v.X = v_x = (int32_t)B_X - A_X;
@@ -120,109 +100,900 @@ static uint16_t fnc_ln_pt_dist(int16_t A_X, int16_t A_Y, int16_t B_X, int16_t B_
 
 	int64_t c1 = fnc_dot(&w, &v);
 	if (c1 <= 0) {
-		d = fnc_distance(C_X, C_Y, A_X, A_Y);
+		d = fnc_distance_sq(C_X, C_Y, A_X, A_Y);
 	} else {
 		int64_t c2 = fnc_dot(&v, &v);
 		if (c2 <= c1) {
-			d = fnc_distance(C_X, C_Y, B_X, B_Y);
+			d = fnc_distance_sq(C_X, C_Y, B_X, B_Y);
 		} else {
 			int16_t PB_x, PB_y;
 			PB_x = (int16_t)(A_X + (c1 * v_x) / c2);
 			PB_y = (int16_t)(A_Y + (c1 * v_y) / c2);
-			d = fnc_distance(C_X, C_Y, PB_x, PB_y);
+			d = fnc_distance_sq(C_X, C_Y, PB_x, PB_y);
 		}
 	}
-	if (d > UINT16_MAX) {
-		d = UINT16_MAX;
-	}
 
 	return d;
 }
 
-int16_t fnc_calc_dist(int16_t pos_x, int16_t pos_y, uint8_t *p_fence_index, uint8_t *p_vertex_index)
+struct fence_index;
+
+/** Fence of the cached pasture, with its coordinates located in the coordinate
+ *  pool, and its segment reciprocals and spatial index in the same pasture
+ *  cache slot. Set up by fnc_build_dist_index().
+ */
+typedef struct {
+	fence_header_t m;
+	const fence_coordinate_t *coordinates;
+	bool is_valid;
+#if CONFIG_AMC_DIST_COMPILED_PASTURE
+	/** Reciprocals of the segments, see segment_len_sq_inv. */
+	const uint32_t *len_sq_inv;
+#endif
+#if CONFIG_AMC_DIST_SPATIAL_INDEX
+	const struct fence_index *idx;
+	/** Segment references of the slot, see fence_index_t. */
+	const uint8_t *refs;
+#endif
+} dist_fence_t;
+
+/* Every pasture cache slot has its own index, built before the slot is
+ * published. Readers only use the index of the slot they have pinned.
+ */
+static dist_fence_t dist_fences[PASTURE_CACHE_SLOTS][FENCE_MAX];
+
+/** Incremented for every indexed pasture, so that the state kept between 
+ *  calculations is not used with another pasture.
+ */
+static uint32_t dist_generation[PASTURE_CACHE_SLOTS];
+static uint32_t dist_next_generation;
+
+#if CONFIG_AMC_DIST_COMPILED_PASTURE
+/** Segment from vertex i (A) to the previous vertex (B). For vertex 0 the
+ *  previous vertex is the last one, closing the polygon for the containment
+ *  test. Derived from the coordinates where used, see fnc_segment().
+ */
+typedef struct {
+	/** B - A, used for the projection. */
+	int32_t v_x;
+	int32_t v_y;
+	/** Squared length of the vector, halved if halved is set. */
+	int32_t len_sq;
+	/** B - A does not fit in int16, so vectors are always halved. */
+	bool halved;
+} segment_t;
+
+/** floor((2^(31 + bits) - 1) / len_sq) of every segment, in [2^31, 2^32), where
+ *  bits is the number of significant bits in len_sq, or 0 if len_sq <= 0. Only
+ *  the division is precomputed, indexed like the coordinate pool of the pasture
+ *  in the slot.
+ */
+static uint32_t segment_len_sq_inv[PASTURE_CACHE_SLOTS][PASTURE_MAX_COORDINATES];
+
+/** @brief Int32 dot product wrapping on overflow, like fnc_dot(). */
+static int32_t fnc_dot_wrap(int32_t a_x, int32_t a_y, int32_t b_x, int32_t b_y)
+{
+	return (int32_t)((uint32_t)a_x * (uint32_t)b_x + (uint32_t)a_y * (uint32_t)b_y);
+}
+
+/** @brief Gets the segment from vertex A to vertex B. */
+static void fnc_segment(const fence_coordinate_t *a, const fence_coordinate_t *b, segment_t *seg)
+{
+	int32_t v_x = seg->v_x = (int32_t)b->s_x_dm - a->s_x_dm;
+	int32_t v_y = seg->v_y = (int32_t)b->s_y_dm - a->s_y_dm;
+
+	seg->halved = v_x < INT16_MIN || v_x > INT16_MAX || v_y < INT16_MIN || v_y > INT16_MAX;
+	if (seg->halved) {
+		v_x /= 2;
+		v_y /= 2;
+	}
+
+	/* A wrapped (negative) length always selects endpoint B. */
+	seg->len_sq = fnc_dot_wrap(v_x, v_y, v_x, v_y);
+}
+
+/** @brief Computes the segment reciprocals of a fence. */
+static void fnc_compile_fence(const dist_fence_t *fence, uint32_t *len_sq_inv)
+{
+	uint8_t n_points = fence->m.n_points;
+
+	for (uint8_t i = 0; i < n_points; i++) {
+		segment_t seg;
+		fnc_segment(&fence->coordinates[i],
+			    &fence->coordinates[i > 0 ? i - 1 : n_points - 1], &seg);
+
+		if (seg.len_sq > 0) {
+			uint8_t len_sq_bits = 32 - __builtin_clz(seg.len_sq);
+			len_sq_inv[i] = ((1ULL << (31 + len_sq_bits)) - 1) / seg.len_sq;
+		} else {
+			len_sq_inv[i] = 0;
+		}
+	}
+}
+
+/** @brief Computes trunc(c1 * v / len_sq) for 0 < c1 < len_sq without a
+ *         division.
+ *
+ * The fixed-point ratio c1 / len_sq is at most 5 / 2^32 too small, so the
+ * estimated quotient is at most 1 too small, and one correction step makes
+ * it exact.
+ */
+static int32_t fnc_seg_proj(const segment_t *seg, uint32_t len_sq_inv, int32_t c1, int32_t v)
+{
+	uint8_t len_sq_bits = 32 - __builtin_clz(seg->len_sq);
+	uint32_t u = (uint32_t)abs(v);
+	uint32_t ratio = ((uint64_t)c1 * len_sq_inv) >> (len_sq_bits - 1);
+	uint32_t q = ((uint64_t)ratio * u) >> 32;
+
+	if ((uint64_t)(q + 1) * (uint32_t)seg->len_sq <= (uint64_t)c1 * u) {
+		q++;
+	}
+	return v < 0 ? -(int32_t)q : (int32_t)q;
+}
+
+/** @brief Compiled version of fnc_ln_pt_dist_sq(), giving the same result.
+ *
+ * @param len_sq_inv reciprocal of segment AB, see segment_len_sq_inv.
+ * @param a vertex A.
+ * @param b vertex B.
+ * @param C_X x value of vertex C.
+ * @param C_Y y value of vertex C.
+ *
+ * @return The squared distance to actual vertex in polygon, see fnc_distance_sq().
+ */
+static uint32_t fnc_seg_dist_sq(uint32_t len_sq_inv, const fence_coordinate_t *a,
+				const fence_coordinate_t *b, int16_t C_X, int16_t C_Y)
+{
+	segment_t seg;
+	fnc_segment(a, b, &seg);
+
+	int32_t v_x = seg.v_x;
+	int32_t v_y = seg.v_y;
+	int32_t w_x = (int32_t)C_X - a->s_x_dm;
+	int32_t w_y = (int32_t)C_Y - a->s_y_dm;
+
+	if (seg.halved) {
+		v_x /= 2;
+		v_y /= 2;
+		w_x /= 2;
+		w_y /= 2;
+	} else if (w_x < INT16_MIN || w_x > INT16_MAX || w_y < INT16_MIN || w_y > INT16_MAX) {
+		/* Halving depends on the position, the precomputed length is not used. */
+		return fnc_ln_pt_dist_sq(a->s_x_dm, a->s_y_dm, b->s_x_dm, b->s_y_dm, C_X, C_Y);
+	}
+
+	int32_t c1 = fnc_dot_wrap(w_x, w_y, v_x, v_y);
+	if (c1 <= 0) {
+		return fnc_distance_sq(C_X, C_Y, a->s_x_dm, a->s_y_dm);
+	}
+	if (seg.len_sq <= c1) {
+		return fnc_distance_sq(C_X, C_Y, b->s_x_dm, b->s_y_dm);
+	}
+	return fnc_distance_sq(
+		C_X, C_Y, (int16_t)(a->s_x_dm + fnc_seg_proj(&seg, len_sq_inv, c1, seg.v_x)),
+		(int16_t)(a->s_y_dm + fnc_seg_proj(&seg, len_sq_inv, c1, seg.v_y)));
+}
+#endif
+
+/** @brief Squared distance from a point to the segment ending in vertex i of
+ *         a fence.
+ */
+static uint32_t fnc_segment_dist_sq(const dist_fence_t *fence, uint8_t i, int16_t pos_x,
+				    int16_t pos_y)
+{
+#if CONFIG_AMC_DIST_COMPILED_PASTURE
+	return fnc_seg_dist_sq(fence->len_sq_inv[i], &fence->coordinates[i],
+			       &fence->coordinates[i - 1], pos_x, pos_y);
+#else
+	return fnc_ln_pt_dist_sq(fence->coordinates[i].s_x_dm, fence->coordinates[i].s_y_dm,
+				 fence->coordinates[i - 1].s_x_dm,
+				 fence->coordinates[i - 1].s_y_dm, pos_x, pos_y);
+#endif
+}
+
+/** @brief Determent if the edge from vertex i to vertex j is cut by a ray from
+ *         the test point in positive x direction.
+ *
+ * @note The int32 crossing calculation overflows for very large fences. The
+ *       compiled version reproduces that, but without a division.
+ *
+ * @param fence fence(polygon) to check.
+ * @param i first vertex of the edge.
+ * @param j second vertex of the edge, i - 1 or the last vertex for i = 0.
+ * @param testx x coordinate of test point.
+ * @param testy y coordinate of test point.
+ *
+ * @returns True if the edge is cut.
+ */
+static bool fnc_edge_crossed(const dist_fence_t *fence, uint8_t i, uint8_t j, int16_t testx,
+			     int16_t testy)
+{
+	int32_t y0 = fence->coordinates[i].s_y_dm;
+	int32_t y1 = fence->coordinates[j].s_y_dm;
+
+	if ((y0 > testy) == (y1 > testy)) {
+		return false;
+	}
+
+#if CONFIG_AMC_DIST_COMPILED_PASTURE
+	int32_t v_x = (int32_t)fence->coordinates[j].s_x_dm - fence->coordinates[i].s_x_dm;
+
+	/* testx - x0 < trunc(num / den), with den > 0. */
+	int64_t num = (int32_t)((uint32_t)v_x * (uint32_t)(testy - y0));
+	int64_t den = y1 - y0;
+	if (den < 0) {
+		num = -num;
+		den = -den;
+	}
+	int64_t a = (int32_t)testx - fence->coordinates[i].s_x_dm;
+	return (num >= 0) ? ((a + 1) * den <= num) : (a * den < num);
+#else
+	int32_t x0 = fence->coordinates[i].s_x_dm;
+	int32_t x1 = fence->coordinates[j].s_x_dm;
+
+	return testx < ((x1 - x0) * (testy - y0)) / (y1 - y0) + x0;
+#endif
+}
+
+/** @brief Checks if a point being inside the closed polyline of a fence means
+ *         the distance to the fence is positive.
+ */
+static bool fnc_is_outside_type(const dist_fence_t *fence, bool is_in_closed_polyline)
 {
-	/* Fetch pasture from cache. */
-	pasture_t *pasture = NULL;
-	get_pasture_cache(&pasture);
+	if (fence->m.e_fence_type == FenceDefinitionMessage_FenceType_Normal) {
+		return !is_in_closed_polyline;
+	}
+	return is_in_closed_polyline;
+}
+
+/** Best segment of a search, keeping the range of squared distances that
+ *  round to the best distance, so the square root is only taken when a
+ *  segment is strictly better.
+ */
+typedef struct {
+	uint16_t dist;
+	uint32_t dist_sq_lo;
+	uint32_t dist_sq_hi;
+	uint8_t vertex;
+	bool found;
+} dist_best_t;
+
+static void fnc_best_set_dist(dist_best_t *best, uint16_t dist)
+{
+	uint32_t sq = (uint32_t)dist * dist;
+
+	/* g_u32_SquareRootRounded() gives dist for [dist^2 - dist + 1, dist^2 + dist]. */
+	best->dist = dist;
+	best->dist_sq_lo = (dist > 0) ? sq - dist + 1 : 0;
+	best->dist_sq_hi = sq + dist;
+}
+
+static void fnc_best_init(dist_best_t *best, uint16_t bound)
+{
+	fnc_best_set_dist(best, bound);
+	best->vertex = 0;
+	best->found = false;
+}
+
+/** @brief Evaluates a segment and keeps it if it beats the current best,
+ *         prioritizing the lowest vertex index for equal distances.
+ */
+static void fnc_eval_segment(const dist_fence_t *fence, uint8_t i, int16_t pos_x, int16_t pos_y,
+			     dist_best_t *best)
+{
+	uint32_t d_sq = fnc_segment_dist_sq(fence, i, pos_x, pos_y);
+
+	if (d_sq < best->dist_sq_lo) {
+		fnc_best_set_dist(best, g_u32_SquareRootRounded(d_sq));
+		best->vertex = i;
+		best->found = true;
+	} else if (best->found && d_sq <= best->dist_sq_hi && i < best->vertex) {
+		best->vertex = i;
+	}
+}
+
+/** @brief Walks a fence once, giving both the containment and the shortest
+ *         distance below INT16_MAX.
+ *
+ * @param fence fence(polygon) to search.
+ * @param pos_x x coordinate of the point.
+ * @param pos_y y coordinate of the point.
+ * @param best shortest distance found, lowest vertex index on equal distance.
+ *
+ * @returns True if the point is inside the closed polyline.
+ */
+static bool fnc_fence_scan(const dist_fence_t *fence, int16_t pos_x, int16_t pos_y,
+			   dist_best_t *best)
+{
+	uint8_t n_points = fence->m.n_points;
+	bool c = false;
+
+	fnc_best_init(best, INT16_MAX);
+	for (uint8_t i = 0, j = n_points - 1; i < n_points; j = i++) {
+		if (fnc_edge_crossed(fence, i, j, pos_x, pos_y)) {
+			/* Toggle each time the test results in "cutting a fenceline". */
+			c = !c;
+		}
+		if (i > 0) {
+			fnc_eval_segment(fence, i, pos_x, pos_y, best);
+		}
+	}
+	return c;
+}
+
+#if CONFIG_AMC_DIST_SPATIAL_INDEX
+/** Margin in dm between the geometric distance to a segment and the value
+ *  returned by fnc_ln_pt_dist_sq(). The projected point is truncated towards
+ *  zero (< sqrt(2) dm) and the square root is rounded (0.5 dm), so a segment
+ *  geometrically further away than "best + margin" can never beat "best".
+ */
+#define DIST_PRUNE_MARGIN_DM 2
+
+typedef struct {
+	int32_t min_x;
+	int32_t min_y;
+	int32_t max_x;
+	int32_t max_y;
+} bbox_t;
+
+#define GRID_DIM CONFIG_AMC_DIST_GRID_DIM
+#define GRID_CELLS (GRID_DIM * GRID_DIM)
+
+/** Spatial index of a single fence. The grid covers the bounding box of the
+ *  fence, and every cell lists the segments (by vertex index) whose bounding
+ *  box overlaps the cell, as a range in grid_refs.
+ */
+typedef struct fence_index {
+	bbox_t bbox;
+	int32_t cell_w;
+	int32_t cell_h;
+	uint16_t cell_start[GRID_CELLS + 1];
+	bool has_grid;
+} fence_index_t;
+
+static fence_index_t fence_indices[PASTURE_CACHE_SLOTS][FENCE_MAX];
+static uint8_t grid_refs[PASTURE_CACHE_SLOTS][CONFIG_AMC_DIST_GRID_MAX_REFS];
+
+#if CONFIG_AMC_DIST_TEMPORAL_SEED
+/** Position and nearest segment of the previous distance calculation. */
+static struct {
+	bool valid;
+	uint32_t generation;
+	int16_t pos_x;
+	int16_t pos_y;
+	uint8_t fence_index;
+	uint8_t vertex_index;
+} dist_seed;
+#endif
+
+/** @brief Squared distance from a point to an axis aligned box, 0 if inside. */
+static uint64_t fnc_bbox_dist_sq(const bbox_t *box, int16_t x, int16_t y)
+{
+	int32_t dx = 0;
+	int32_t dy = 0;
+
+	if (x < box->min_x) {
+		dx = box->min_x - x;
+	} else if (x > box->max_x) {
+		dx = x - box->max_x;
+	}
+	if (y < box->min_y) {
+		dy = box->min_y - y;
+	} else if (y > box->max_y) {
+		dy = y - box->max_y;
+	}
+	return (uint64_t)((int64_t)dx * dx + (int64_t)dy * dy);
+}
+
+/** @brief Squared distance from a point to the farthest corner of a box. */
+static uint64_t fnc_bbox_far_sq(const bbox_t *box, int16_t x, int16_t y)
+{
+	int32_t dx = MAX(abs(x - box->min_x), abs(x - box->max_x));
+	int32_t dy = MAX(abs(y - box->min_y), abs(y - box->max_y));
+
+	return (uint64_t)((int64_t)dx * dx + (int64_t)dy * dy);
+}
+
+/** @brief Bounding box of all vertices of a fence. */
+static void fnc_fence_bbox(const dist_fence_t *fence, bbox_t *box)
+{
+	box->min_x = box->max_x = fence->coordinates[0].s_x_dm;
+	box->min_y = box->max_y = fence->coordinates[0].s_y_dm;
+	for (uint8_t i = 1; i < fence->m.n_points; i++) {
+		box->min_x = MIN(box->min_x, fence->coordinates[i].s_x_dm);
+		box->max_x = MAX(box->max_x, fence->coordinates[i].s_x_dm);
+		box->min_y = MIN(box->min_y, fence->coordinates[i].s_y_dm);
+		box->max_y = MAX(box->max_y, fence->coordinates[i].s_y_dm);
+	}
+}
+
+/** @brief Bounding box of the segment ending in vertex i of a fence. */
+static void fnc_segment_bbox(const dist_fence_t *fence, uint8_t i, bbox_t *box)
+{
+	const fence_coordinate_t *a = &fence->coordinates[i];
+	const fence_coordinate_t *b = &fence->coordinates[i - 1];
+
+	box->min_x = MIN(a->s_x_dm, b->s_x_dm);
+	box->max_x = MAX(a->s_x_dm, b->s_x_dm);
+	box->min_y = MIN(a->s_y_dm, b->s_y_dm);
+	box->max_y = MAX(a->s_y_dm, b->s_y_dm);
+}
+
+/** @brief Squared pruning limit for a current best distance. */
+static uint64_t fnc_prune_limit_sq(uint16_t best)
+{
+	uint64_t limit = (uint64_t)best + DIST_PRUNE_MARGIN_DM;
+
+	return limit * limit;
+}
+
+/** @brief Searches the grid of an indexed fence, visiting cells in order of
+ *         increasing distance until no cell can contain a better segment.
+ */
+static void fnc_grid_search(const dist_fence_t *fence, int16_t pos_x, int16_t pos_y,
+			    dist_best_t *best)
+{
+	const fence_index_t *idx = fence->idx;
+	uint64_t cell_sq[GRID_CELLS];
+	uint8_t order[GRID_CELLS];
+	uint64_t visited = 0;
+
+	/* Sort the cells by distance to the position. */
+	for (uint8_t c = 0; c < GRID_CELLS; c++) {
+		bbox_t cell;
+		cell.min_x = idx->bbox.min_x + (c % GRID_DIM) * idx->cell_w;
+		cell.min_y = idx->bbox.min_y + (c / GRID_DIM) * idx->cell_h;
+		cell.max_x = cell.min_x + idx->cell_w - 1;
+		cell.max_y = cell.min_y + idx->cell_h - 1;
+		cell_sq[c] = fnc_bbox_dist_sq(&cell, pos_x, pos_y);
+
+		uint8_t j = c;
+		while (j > 0 && cell_sq[order[j - 1]] > cell_sq[c]) {
+			order[j] = order[j - 1];
+			j--;
+		}
+		order[j] = c;
+	}
+
+	for (uint8_t k = 0; k < GRID_CELLS; k++) {
+		uint8_t c = order[k];
+		if (cell_sq[c] > fnc_prune_limit_sq(best->dist)) {
+			break;
+		}
+		for (uint16_t r = idx->cell_start[c]; r < idx->cell_start[c + 1]; r++) {
+			uint8_t i = fence->refs[r];
+			if (visited & BIT64(i)) {
+				continue;
+			}
+			visited |= BIT64(i);
+
+			bbox_t seg;
+			fnc_segment_bbox(fence, i, &seg);
+			if (fnc_bbox_dist_sq(&seg, pos_x, pos_y) > fnc_prune_limit_sq(best->dist)) {
+				continue;
+			}
+			fnc_eval_segment(fence, i, pos_x, pos_y, best);
+		}
+	}
+}
+
+/** @brief Checks if the distances from a point to a fence can wrap, so that
+ *         the fence must be searched without pruning on geometry.
+ */
+static bool fnc_needs_full_scan(const dist_fence_t *fence, int16_t pos_x, int16_t pos_y)
+{
+	return fnc_bbox_far_sq(&fence->idx->bbox, pos_x, pos_y) > DIST_SQ_NO_WRAP_MAX;
+}
+
+/** @brief Finds the shortest distance from a point to the segments of a 
+ *         fence, as long as it is less than a given bound.
+ * 
+ * @param fence fence(polygon) to search.
+ * @param pos_x x coordinate of the point.
+ * @param pos_y y coordinate of the point.
+ * @param bound only distances less than this are of interest.
+ * @param seed_vertex vertex index of a segment likely to be close, evaluated 
+ *                    first to bound the search. 0 if none.
+ * @param p_dist shortest distance found, lowest vertex index on equal distance.
+ * @param p_vertex vertex index of the segment with the shortest distance.
+ * 
+ * @returns True if a segment closer than bound was found.
+ */
+static bool fnc_fence_min_dist(const dist_fence_t *fence, int16_t pos_x, int16_t pos_y,
+			       uint16_t bound, uint8_t seed_vertex, uint16_t *p_dist,
+			       uint8_t *p_vertex)
+{
+	const fence_index_t *idx = fence->idx;
+	dist_best_t best;
+
+	fnc_best_init(&best, bound);
+	if (seed_vertex > 0) {
+		fnc_eval_segment(fence, seed_vertex, pos_x, pos_y, &best);
+	}
+
+	if (fnc_bbox_dist_sq(&idx->bbox, pos_x, pos_y) > fnc_prune_limit_sq(best.dist)) {
+		return false;
+	}
+	if (idx->has_grid) {
+		fnc_grid_search(fence, pos_x, pos_y, &best);
+	} else {
+		for (uint8_t i = 1; i < fence->m.n_points; i++) {
+			bbox_t seg;
+			fnc_segment_bbox(fence, i, &seg);
+			if (fnc_bbox_dist_sq(&seg, pos_x, pos_y) > fnc_prune_limit_sq(best.dist)) {
+				continue;
+			}
+			fnc_eval_segment(fence, i, pos_x, pos_y, &best);
+		}
+	}
+	*p_dist = best.dist;
+	*p_vertex = best.vertex;
+	return best.found;
+}
+
+/** @brief Checks if a point is outside the area a fence keeps the animal in,
+ *         i.e. if the distance to the fence is positive.
+ */
+static bool fnc_is_outside(const dist_fence_t *fence, int16_t pos_x, int16_t pos_y)
+{
+	/* No edge of the polyline can be crossed from outside its bounding box,
+	 * unless the crossing calculation in fnc_edge_crossed() overflows.
+	 */
+	const bbox_t *box = &fence->idx->bbox;
+	if (pos_y < box->min_y || pos_y >= box->max_y ||
+	    (pos_x >= box->max_x &&
+	     (int64_t)(box->max_x - box->min_x) * (box->max_y - box->min_y) <= INT32_MAX)) {
+		return fnc_is_outside_type(fence, false);
+	}
+
+	uint8_t n_points = fence->m.n_points;
+	bool c = false;
+	for (uint8_t i = 0, j = n_points - 1; i < n_points; j = i++) {
+		if (fnc_edge_crossed(fence, i, j, pos_x, pos_y)) {
+			c = !c;
+		}
+	}
+	return fnc_is_outside_type(fence, c);
+}
+#endif
+
+/** Last exact distance calculation, for bounding the distance of later fixes. */
+static struct {
+	bool valid;
+	uint32_t generation;
+	int16_t pos_x;
+	int16_t pos_y;
+	int16_t dist;
+	uint8_t fence_index;
+	uint8_t vertex_index;
+} safe_radius;
+
+static atomic_t dist_skip_count = ATOMIC_INIT(0);
+
+int16_t fnc_calc_dist_lazy(const pasture_t *pasture, uint8_t slot, int16_t pos_x, int16_t pos_y,
+			   int16_t limit, uint8_t *p_fence_index, uint8_t *p_vertex_index)
+{
+	if (safe_radius.valid && safe_radius.generation == dist_generation[slot]) {
+		/* The distance changes at most as much as the position. Use
+		 * max + min / 2 (rounded up), which is never less than the 
+		 * euclidean displacement, to avoid the square root.
+		 */
+		int32_t dx = abs(pos_x - safe_radius.pos_x);
+		int32_t dy = abs(pos_y - safe_radius.pos_y);
+		int32_t bound = safe_radius.dist + MAX(dx, dy) + (MIN(dx, dy) + 1) / 2;
+
+		if (bound + CONFIG_AMC_DIST_SAFE_RADIUS_MARGIN_DM < limit) {
+			atomic_inc(&dist_skip_count);
+			*p_fence_index = safe_radius.fence_index;
+			*p_vertex_index = safe_radius.vertex_index;
+			return (int16_t)bound;
+		}
+	}
+
+	int16_t dist = fnc_calc_dist(pasture, slot, pos_x, pos_y, p_fence_index, p_vertex_index);
+
+	safe_radius.valid = (dist != INT16_MAX);
+	safe_radius.generation = dist_generation[slot];
+	safe_radius.pos_x = pos_x;
+	safe_radius.pos_y = pos_y;
+	safe_radius.dist = dist;
+	safe_radius.fence_index = *p_fence_index;
+	safe_radius.vertex_index = *p_vertex_index;
+	return dist;
+}
+
+uint32_t fnc_get_dist_skip_count(void)
+{
+	return (uint32_t)atomic_get(&dist_skip_count);
+}
+
+void fnc_build_dist_index(const pasture_t *pasture, uint8_t slot)
+{
+	uint8_t n_fences = MIN(pasture->m.ul_total_fences, FENCE_MAX);
+
+	/* Invalidates the seed and the safe radius of the previous pasture. */
+	dist_generation[slot] = ++dist_next_generation;
+
+	for (uint8_t f = 0; f < n_fences; f++) {
+		dist_fence_t *fence = &dist_fences[slot][f];
+		fence->m = pasture->fences[f].m;
+		fence->coordinates = pasture_fence_coordinates(pasture, &pasture->fences[f]);
+		fence->is_valid = fnc_valid(&pasture->fences[f]);
+#if CONFIG_AMC_DIST_COMPILED_PASTURE
+		fence->len_sq_inv = &segment_len_sq_inv[slot][pasture->fences[f].first_coordinate];
+#endif
+#if CONFIG_AMC_DIST_SPATIAL_INDEX
+		fence->idx = &fence_indices[slot][f];
+		fence->refs = grid_refs[slot];
+#endif
+	}
+
+#if CONFIG_AMC_DIST_COMPILED_PASTURE
+	for (uint8_t f = 0; f < n_fences; f++) {
+		if (dist_fences[slot][f].is_valid) {
+			fnc_compile_fence(
+				&dist_fences[slot][f],
+				&segment_len_sq_inv[slot][pasture->fences[f].first_coordinate]);
+		}
+	}
+#endif
+
+#if CONFIG_AMC_DIST_SPATIAL_INDEX
+	uint16_t n_refs = 0;
+
+	memset(fence_indices[slot], 0, sizeof(fence_indices[slot]));
+
+	for (uint8_t f = 0; f < n_fences; f++) {
+		dist_fence_t *fence = &dist_fences[slot][f];
+		fence_index_t *idx = &fence_indices[slot][f];
+
+		if (!fence->is_valid) {
+			continue;
+		}
+
+		fnc_fence_bbox(fence, &idx->bbox);
+		idx->cell_w = (idx->bbox.max_x - idx->bbox.min_x) / GRID_DIM + 1;
+		idx->cell_h = (idx->bbox.max_y - idx->bbox.min_y) / GRID_DIM + 1;
+
+		/* Put every segment into each cell its bounding box overlaps. */
+		uint16_t first_ref = n_refs;
+		idx->has_grid = true;
+		for (uint8_t c = 0; c < GRID_CELLS && idx->has_grid; c++) {
+			idx->cell_start[c] = n_refs;
+			for (uint8_t i = 1; i < fence->m.n_points; i++) {
+				bbox_t seg;
+				fnc_segment_bbox(fence, i, &seg);
+				if ((c % GRID_DIM) < (seg.min_x - idx->bbox.min_x) / idx->cell_w ||
+				    (c % GRID_DIM) > (seg.max_x - idx->bbox.min_x) / idx->cell_w ||
+				    (c / GRID_DIM) < (seg.min_y - idx->bbox.min_y) / idx->cell_h ||
+				    (c / GRID_DIM) > (seg.max_y - idx->bbox.min_y) / idx->cell_h) {
+					continue;
+				}
+				if (n_refs >= CONFIG_AMC_DIST_GRID_MAX_REFS) {
+					LOG_WRN("No room to index fence %d, using linear search", f);
+					idx->has_grid = false;
+					n_refs = first_ref;
+					break;
+				}
+				grid_refs[slot][n_refs++] = i;
+			}
+		}
+		idx->cell_start[GRID_CELLS] = n_refs;
+	}
+	LOG_DBG("Indexed %d fences using %d segment references", n_fences, n_refs);
+#endif
+}
+
+/** @brief Gets the fence and vertex index to seed the search with, if the 
+ *         previous nearest segment is still relevant for the position.
+ * 
+ * @returns True if a seed is available.
+ */
+static bool fnc_get_seed(uint32_t generation, int16_t pos_x, int16_t pos_y,
+			 uint8_t *p_fence_index, uint8_t *p_vertex_index)
+{
+#if CONFIG_AMC_DIST_TEMPORAL_SEED
+	if (!dist_seed.valid || dist_seed.generation != generation ||
+	    abs(pos_x - dist_seed.pos_x) > CONFIG_AMC_DIST_SEED_MAX_STEP_DM ||
+	    abs(pos_y - dist_seed.pos_y) > CONFIG_AMC_DIST_SEED_MAX_STEP_DM) {
+		return false;
+	}
+	*p_fence_index = dist_seed.fence_index;
+	*p_vertex_index = dist_seed.vertex_index;
+	return true;
+#else
+	ARG_UNUSED(generation);
+	ARG_UNUSED(pos_x);
+	ARG_UNUSED(pos_y);
+	ARG_UNUSED(p_fence_index);
+	ARG_UNUSED(p_vertex_index);
+	return false;
+#endif
+}
+
+static void fnc_set_seed(uint32_t generation, int16_t pos_x, int16_t pos_y, uint8_t fence_index,
+			 uint8_t vertex_index)
+{
+#if CONFIG_AMC_DIST_TEMPORAL_SEED
+	dist_seed.valid = true;
+	dist_seed.generation = generation;
+	dist_seed.pos_x = pos_x;
+	dist_seed.pos_y = pos_y;
+	dist_seed.fence_index = fence_index;
+	dist_seed.vertex_index = vertex_index;
+#else
+	ARG_UNUSED(generation);
+	ARG_UNUSED(pos_x);
+	ARG_UNUSED(pos_y);
+	ARG_UNUSED(fence_index);
+	ARG_UNUSED(vertex_index);
+#endif
+}
+
+/** Per fence state of a distance calculation. */
+typedef struct {
+	bool is_valid;
+	bool is_outside;
+	bool on_fence_line;
+	/** The fence was walked once by fnc_fence_scan(), with the result in scan. */
+	bool is_scanned;
+	dist_best_t scan;
+} fence_state_t;
+
+/** @brief Determines on which side of a fence a point is. Fences that cannot
+ *         be searched with pruning are walked once for both the side and
+ *         the distance.
+ */
+static void fnc_fence_prepare(fence_state_t *state, const dist_fence_t *fence, int16_t pos_x,
+			      int16_t pos_y)
+{
+	state->is_valid = fence->is_valid;
+	state->is_outside = false;
+	state->on_fence_line = false;
+	state->is_scanned = false;
+	if (!state->is_valid) {
+		return;
+	}
+
+#if CONFIG_AMC_DIST_SPATIAL_INDEX
+	if (!fnc_needs_full_scan(fence, pos_x, pos_y)) {
+		state->is_outside = fnc_is_outside(fence, pos_x, pos_y);
+		return;
+	}
+#endif
+	state->is_scanned = true;
+	state->is_outside =
+		fnc_is_outside_type(fence, fnc_fence_scan(fence, pos_x, pos_y, &state->scan));
+}
+
+/** @brief Finds the shortest distance from a point to a fence, as long as it
+ *         is less than a given bound. See fnc_fence_min_dist().
+ */
+static bool fnc_fence_search(const fence_state_t *state, const dist_fence_t *fence, int16_t pos_x,
+			     int16_t pos_y, uint16_t bound, uint8_t seed_vertex, uint16_t *p_dist,
+			     uint8_t *p_vertex)
+{
+	if (state->is_scanned) {
+		if (!state->scan.found || state->scan.dist >= bound) {
+			return false;
+		}
+		*p_dist = state->scan.dist;
+		*p_vertex = state->scan.vertex;
+		return true;
+	}
+#if CONFIG_AMC_DIST_SPATIAL_INDEX
+	return fnc_fence_min_dist(fence, pos_x, pos_y, bound, seed_vertex, p_dist, p_vertex);
+#else
+	return false;
+#endif
+}
+
+int16_t fnc_calc_dist(const pasture_t *pasture, uint8_t slot, int16_t pos_x, int16_t pos_y,
+		      uint8_t *p_fence_index, uint8_t *p_vertex_index)
+{
+	const dist_fence_t *fences = dist_fences[slot];
+	uint32_t generation = dist_generation[slot];
 
 	/* Fetch pasture info. */
 	uint8_t n_fences = pasture->m.ul_total_fences;
 
-	int16_t my_dist[FENCE_MAX];
+	fence_state_t state[FENCE_MAX];
 	uint8_t vertex_index[FENCE_MAX];
 
-	uint16_t my_tmp;
-	uint8_t i;
-	/* Find distance to all fences. */
+	uint16_t dist;
+	uint8_t vertex = 0;
+
 	for (uint8_t fence_index = 0; fence_index < n_fences; fence_index++) {
-		fence_t *cur_fence = &pasture->fences[fence_index];
-
-		my_dist[fence_index] = INT16_MAX;
-		vertex_index[fence_index] = 0;
-
-		if (fnc_valid(cur_fence)) {
-			for (i = 1; i < cur_fence->m.n_points; i++) {
-				my_tmp = fnc_ln_pt_dist(cur_fence->coordinates[i].s_x_dm,
-							cur_fence->coordinates[i].s_y_dm,
-							cur_fence->coordinates[i - 1].s_x_dm,
-							cur_fence->coordinates[i - 1].s_y_dm, pos_x,
-							pos_y);
-
-				if (my_tmp < my_dist[fence_index]) {
-					/* Save the shortest distance discovered. */
-					my_dist[fence_index] = my_tmp;
-					vertex_index[fence_index] = i;
-				}
-			}
+		fnc_fence_prepare(&state[fence_index], &fences[fence_index], pos_x, pos_y);
+	}
 
-			/* Further testing only if sufficiently small distance 
-			 * to a fence vertex was found. 
-			 */
-			if (my_dist[fence_index] < INT16_MAX) {
-				bool is_in_closed_polyline =
-					fnc_pt_in_closed_polyline(cur_fence, pos_x, pos_y);
-
-				if ((cur_fence->m.e_fence_type ==
-					     FenceDefinitionMessage_FenceType_Normal &&
-				     is_in_closed_polyline) ||
-				    (cur_fence->m.e_fence_type ==
-					     FenceDefinitionMessage_FenceType_Inverted &&
-				     !is_in_closed_polyline)) {
-					my_dist[fence_index] = -my_dist[fence_index];
-				}
+	/* Search the fence nearest on the previous fix first. Its distance 
+	 * bounds the search of the other fences in the same class. 
+	 */
+	uint8_t seed_fence = 0;
+	uint8_t seed_vertex = 0;
+	bool has_seed = fnc_get_seed(generation, pos_x, pos_y, &seed_fence, &seed_vertex) &&
+			seed_fence < n_fences && state[seed_fence].is_valid;
+	uint16_t seed_dist = INT16_MAX;
+	if (has_seed) {
+		has_seed = fnc_fence_search(&state[seed_fence], &fences[seed_fence], pos_x, pos_y,
+					    INT16_MAX, seed_vertex, &seed_dist, &vertex);
+		vertex_index[seed_fence] = vertex;
+	}
+
+	/* Choose the fence with the shortest distance, of course prioritizing 
+	 * outside fences (positive) distances. Only the fences we are outside 
+	 * of can give a positive distance, so search those first, and only 
+	 * search the rest if none did. A distance of 0 belongs to the inside 
+	 * fences even when we are outside. On equal distance the lowest fence 
+	 * index wins, so a fence before the current best may also match it.
+	 */
+	uint16_t outside_dist = INT16_MAX;
+	int16_t outside_index = -1;
+	if (has_seed && state[seed_fence].is_outside) {
+		if (seed_dist > 0) {
+			outside_dist = seed_dist;
+			outside_index = seed_fence;
+		} else {
+			state[seed_fence].on_fence_line = true;
+		}
+	}
+	for (uint8_t fence_index = 0; fence_index < n_fences; fence_index++) {
+		if (!state[fence_index].is_outside || (has_seed && fence_index == seed_fence)) {
+			continue;
+		}
+		uint16_t bound = (fence_index < outside_index) ? outside_dist + 1 : outside_dist;
+		if (fnc_fence_search(&state[fence_index], &fences[fence_index], pos_x, pos_y,
+				     bound, 0, &dist, &vertex)) {
+			vertex_index[fence_index] = vertex;
+			if (dist > 0) {
+				outside_dist = dist;
+				outside_index = fence_index;
+			} else {
+				state[fence_index].on_fence_line = true;
 			}
 		}
 	}
+	if (outside_index >= 0) {
+		*p_fence_index = outside_index;
+		*p_vertex_index = vertex_index[outside_index];
+		fnc_set_seed(generation, pos_x, pos_y, *p_fence_index, *p_vertex_index);
+		return outside_dist;
+	}
 
-	/* Choose the fence with the shortest distance, 
-         * of course prioritizing outside fences (postive) distances.
-         */
-	int16_t my_dist_outside_result = INT16_MAX;
-	uint8_t my_dist_outside_result_ind = -1;
-	int16_t my_dist_inside_result = INT16_MIN;
-	uint8_t my_dist_inside_result_ind = -1;
+	uint16_t inside_dist = INT16_MAX;
+	int16_t inside_index = -1;
+	bool seed_is_inside = has_seed && !state[seed_fence].is_outside;
+	if (seed_is_inside) {
+		inside_dist = seed_dist;
+		inside_index = seed_fence;
+	}
 	for (uint8_t fence_index = 0; fence_index < n_fences; fence_index++) {
-		if (my_dist[fence_index] > 0) { /* Outside fence - positive. */
-			if (my_dist[fence_index] < my_dist_outside_result) {
-				my_dist_outside_result = my_dist[fence_index];
-				my_dist_outside_result_ind = fence_index;
-			}
-		} else { /* Inside fence - negative or 0. */
-			if (my_dist[fence_index] > my_dist_inside_result) {
-				my_dist_inside_result = my_dist[fence_index];
-				my_dist_inside_result_ind = fence_index;
+		if (inside_dist == 0 && fence_index > inside_index) {
+			break;
+		}
+		if (seed_is_inside && fence_index == seed_fence) {
+			continue;
+		}
+		uint16_t bound = (fence_index < inside_index) ? inside_dist + 1 : inside_dist;
+		if (state[fence_index].on_fence_line) {
+			if (0 < bound) {
+				inside_dist = 0;
+				inside_index = fence_index;
 			}
+		} else if (state[fence_index].is_valid && !state[fence_index].is_outside &&
+			   fnc_fence_search(&state[fence_index], &fences[fence_index], pos_x,
+					    pos_y, bound, 0, &dist, &vertex)) {
+			inside_dist = dist;
+			inside_index = fence_index;
+			vertex_index[fence_index] = vertex;
 		}
 	}
-
-	if (my_dist_outside_result != INT16_MAX && my_dist_outside_result_ind != -1) {
-		*p_fence_index = my_dist_outside_result_ind;
-		*p_vertex_index = vertex_index[my_dist_outside_result_ind];
-		return my_dist_outside_result;
-	} else if (my_dist_inside_result != INT16_MIN && my_dist_inside_result_ind != -1) {
-		*p_fence_index = my_dist_inside_result_ind;
-		*p_vertex_index = vertex_index[my_dist_inside_result_ind];
-		return my_dist_inside_result;
+	if (inside_index >= 0) {
+		*p_fence_index = inside_index;
+		*p_vertex_index = vertex_index[inside_index];
+		fnc_set_seed(generation, pos_x, pos_y, *p_fence_index, *p_vertex_index);
+		return -(int16_t)inside_dist;
 	}
 	return INT16_MAX;
 }
@@ -115,7 +115,7 @@ int gnss_update_dist_flags(int16_t dist_avg_change, int16_t dist_change,
 	return ret;
 }
 
-static int gnss_check_accuracy(gnss_t *gnss_data)
+static int gnss_check_accuracy(const gnss_t *gnss_data)
 {
 	int ret = 0;
 
@@ -150,7 +150,7 @@ static int gnss_check_accuracy(gnss_t *gnss_data)
 	return ret;
 }
 
-int gnss_update(gnss_t *gnss_data)
+int gnss_update(const gnss_t *gnss_data)
 {
 	int ret = 0;
 
@@ -165,7 +165,7 @@ int gnss_update(gnss_t *gnss_data)
 	return 0;
 }
 
-int gnss_calc_xy(gnss_t *gnss_data, int16_t *x_dm, int16_t *y_dm, int32_t origin_lon,
+int gnss_calc_xy(const gnss_t *gnss_data, int16_t *x_dm, int16_t *y_dm, int32_t origin_lon,
 		 int32_t origin_lat, uint16_t k_lon, uint16_t k_lat)
 {
 	int ret = 0;
@@ -187,7 +187,7 @@ int gnss_calc_xy(gnss_t *gnss_data, int16_t *x_dm, int16_t *y_dm, int32_t origin
 	return ret;
 }
 
-int gnss_update_mode(gnss_mode_t mode)
+int gnss_update_mode(gnss_mode_t mode, uint16_t rate_ms)
 {
 	if (mode >= GNSSMODE_SIZE) {
 		return -EINVAL;
@@ -196,6 +196,7 @@ int gnss_update_mode(gnss_mode_t mode)
 	gnss_mode = mode;
 	struct gnss_set_mode_event *ev = new_gnss_set_mode_event();
 	ev->mode = mode;
+	ev->rate_ms = rate_ms;
 	EVENT_SUBMIT(ev);
 
 	return 0;
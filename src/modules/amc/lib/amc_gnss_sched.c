@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2022 Nofence AS
+ */
+
+#include <zephyr.h>
+#include <logging/log.h>
+LOG_MODULE_REGISTER(amc_gnss_sched, CONFIG_AMC_LIB_LOG_LEVEL);
+
+#include "amc_gnss_sched.h"
+
+/* Distance and ground speed of the last accepted fix. */
+static bool sched_valid = false;
+static int16_t sched_dist_dm;
+static uint32_t sched_speed_mm_s;
+static uint32_t sched_updated_at;
+
+void gnss_sched_update(int16_t dist_dm, const gnss_t *gnss_data)
+{
+	sched_valid = true;
+	sched_dist_dm = dist_dm;
+	sched_speed_mm_s = gnss_data->latest.speed;
+	sched_updated_at = k_uptime_get_32();
+}
+
+void gnss_sched_reset(void)
+{
+	sched_valid = false;
+}
+
+uint16_t gnss_sched_get_rate(amc_zone_t zone, movement_state_t mov_state)
+{
+#if CONFIG_AMC_GNSS_SCHED
+	int16_t boundary_dm;
+
+	if (zone == PSM_ZONE) {
+		boundary_dm = CONFIG_ZONE_CAUTION_DIST;
+	} else if (zone == CAUTION_ZONE) {
+		boundary_dm = CONFIG_ZONE_PREWARN_DIST;
+	} else {
+		return 0;
+	}
+
+	/* The distance must be from a fix within the longest rate */
+	if (!sched_valid ||
+	    (k_uptime_get_32() - sched_updated_at) > CONFIG_AMC_GNSS_SCHED_MAX_RATE_MS) {
+		return 0;
+	}
+
+	int32_t remaining_dm = boundary_dm - CONFIG_AMC_GNSS_SCHED_MARGIN_DM - sched_dist_dm;
+	if (remaining_dm <= 0) {
+		return 0;
+	}
+
+	uint32_t speed_mm_s = (mov_state == STATE_NORMAL) ? CONFIG_AMC_GNSS_SCHED_SPEED_MM_S :
+							     CONFIG_AMC_GNSS_SCHED_REST_SPEED_MM_S;
+	speed_mm_s = MAX(MAX(speed_mm_s, sched_speed_mm_s), 1);
+
+	/* Earliest time the boundary can be reached, whole steps only to
+	 * avoid reconfiguring the receiver on every fix.
+	 */
+	uint64_t time_ms = (uint64_t)remaining_dm * 100 * MSEC_PER_SEC / speed_mm_s;
+	uint32_t rate_ms = MIN(time_ms, CONFIG_AMC_GNSS_SCHED_MAX_RATE_MS);
+	rate_ms -= rate_ms % CONFIG_AMC_GNSS_SCHED_STEP_MS;
+	rate_ms = MAX(rate_ms, CONFIG_AMC_GNSS_SCHED_STEP_MS);
+
+	LOG_DBG("GNSS rate %d ms, %d dm to zone boundary at %d mm/s", rate_ms, remaining_dm,
+		speed_mm_s);
+	return (uint16_t)rate_ms;
+#else
+	return 0;
+#endif
+}
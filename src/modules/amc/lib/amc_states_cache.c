@@ -12,6 +12,7 @@ LOG_MODULE_REGISTER(amc_states, CONFIG_AMC_LIB_LOG_LEVEL);
 #include "pasture_structure.h"
 #include "amc_zone.h"
 #include "amc_gnss.h"
+#include "amc_gnss_sched.h"
 #include "amc_const.h"
 #include "amc_correction.h"
 #include "stg_config.h"
@@ -45,6 +46,7 @@ static Mode current_mode = Mode_Mode_UNKNOWN;
 static FenceStatus current_fence_status = FenceStatus_FenceStatus_UNKNOWN;
 static CollarStatus current_collar_status = CollarStatus_CollarStatus_UNKNOWN;
 static gnss_mode_t current_gnss_mode = GNSSMODE_NOMODE;
+static uint16_t current_gnss_rate_ms = 0;
 
 /* Variable used to check GNSS mode. */
 static bool first_time_since_start = true;
@@ -79,9 +81,20 @@ void update_power_state(enum pwr_state_flag state)
 	atomic_set(&power_state, state);
 }
 
+/** @brief Checks if there's any valid fence in the published pasture. */
+static bool valid_fence(void)
+{
+	pasture_t *pasture = NULL;
+	uint8_t slot = pasture_cache_pin(&pasture);
+	bool valid = fnc_valid_fence(pasture);
+
+	pasture_cache_unpin(slot);
+	return valid;
+}
+
 static bool trace_mode_conditions()
 {
-	if (!fnc_valid_fence()) {
+	if (!valid_fence()) {
 		return true;
 	}
 
@@ -301,7 +314,7 @@ Mode calc_mode(void)
 	Mode new_mode = current_mode;
 	switch (current_mode) {
 	case Mode_Mode_UNKNOWN:
-		if (fnc_valid_fence()) {
+		if (valid_fence()) {
 			LOG_INF("Unknown->Teach");
 			new_mode = Mode_Teach;
 		} else if (fnc_valid_def()) {
@@ -376,7 +389,7 @@ static inline bool is_inside_fence_relaxed()
 {
 	amc_zone_t cur_zone = zone_get();
 	/** @todo gpsp_isGpsFresh()??????? */
-	return fnc_valid_fence() /*&& gpsp_isGpsFresh()*/ && gnss_has_accepted_fix() &&
+	return valid_fence() /*&& gpsp_isGpsFresh()*/ && gnss_has_accepted_fix() &&
 	       !(cur_zone == WARN_ZONE || cur_zone == NO_ZONE);
 }
 
@@ -458,7 +471,7 @@ FenceStatus calc_fence_status(uint32_t maybe_out_of_fence, enum beacon_status_ty
 	}
 	case FenceStatus_BeaconContact: {
 		if (beacon_status != BEACON_STATUS_REGION_NEAR) {
-			if (fnc_valid_fence()) {
+			if (valid_fence()) {
 				new_fence_status = FenceStatus_NotStarted;
 				LOG_INF("FenceStatus:BeaconContact->NotStarted");
 			} else {
@@ -658,6 +671,8 @@ void restart_force_gnss_to_fix(void)
 void set_sensor_modes(Mode mode, FenceStatus fs, CollarStatus cs, amc_zone_t zone)
 {
 	uint8_t gnss_mode = GNSSMODE_CAUTION;
+	/* Set when the mode follows from the zone, and the rate can be scheduled */
+	bool zone_mode = false;
 
 	if (cs == CollarStatus_Sleep || cs == CollarStatus_OffAnimal ||
 	    fs == FenceStatus_BeaconContact || fs == FenceStatus_BeaconContactNormal) {
@@ -682,11 +697,13 @@ void set_sensor_modes(Mode mode, FenceStatus fs, CollarStatus cs, amc_zone_t zon
 				gnss_mode = GNSSMODE_MAX;
 			} else if (zone == CAUTION_ZONE) {
 				gnss_mode = GNSSMODE_CAUTION;
+				zone_mode = true;
 			} else if (zone == PSM_ZONE) {
 				/* [LEGACY] PSHUSTAD: See  
 				 * http://youtrack.axbit.no/youtrack/issue/NOF-186 
 				 */
 				gnss_mode = GNSSMODE_PSM;
+				zone_mode = true;
 			}
 			/* Nozone. */
 			else {
@@ -707,6 +724,7 @@ void set_sensor_modes(Mode mode, FenceStatus fs, CollarStatus cs, amc_zone_t zon
 			if (fs != FenceStatus_BeaconContact &&
 			    fs != FenceStatus_BeaconContactNormal) {
 				gnss_mode = GNSSMODE_CAUTION;
+				zone_mode = false;
 			}
 		} else {
 			/* GPS fix recently, do not check anymore. */
@@ -723,6 +741,7 @@ void set_sensor_modes(Mode mode, FenceStatus fs, CollarStatus cs, amc_zone_t zon
 	if (get_correction_status() > 0) {
 		/* GNSSMODE_MAX is needed whenever the warning tone is playing. */
 		gnss_mode = GNSSMODE_MAX;
+		zone_mode = false;
 	}
 
 	/** @todo [LEGACY] NOF-512 Always set backupmode 
@@ -730,11 +749,16 @@ void set_sensor_modes(Mode mode, FenceStatus fs, CollarStatus cs, amc_zone_t zon
 	  */
 	if (atomic_get(&power_state) == PWR_CRITICAL) {
 		gnss_mode = GNSSMODE_INACTIVE;
+		zone_mode = false;
 	}
 
+	uint16_t gnss_rate_ms =
+		zone_mode ? gnss_sched_get_rate(zone, atomic_get(&movement_state)) : 0;
+
 	/* Send GNSS mode change event from amc_gnss.c */
-	if (current_gnss_mode != gnss_mode) {
+	if (current_gnss_mode != gnss_mode || current_gnss_rate_ms != gnss_rate_ms) {
 		current_gnss_mode = gnss_mode;
-		gnss_update_mode(current_gnss_mode);
+		current_gnss_rate_ms = gnss_rate_ms;
+		gnss_update_mode(current_gnss_mode, current_gnss_rate_ms);
 	}
 }
@@ -33,7 +33,7 @@ static amc_zone_t zone = NO_ZONE;
 
 static uint64_t zone_updated_at = 0;
 
-int zone_update(int16_t instant_dist, gnss_t *gnss_data, amc_zone_t *updated_zone)
+int zone_update(int16_t instant_dist, const gnss_t *gnss_data, amc_zone_t *updated_zone)
 {
 	int ret = 0;
 	amc_zone_t new_zone;
@@ -8,17 +8,19 @@
 #include "pasture_structure.h"
 #include "gnss.h"
 
-extern struct k_sem fence_data_sem;
+/** Number of pasture cache slots. A new pasture is stored in the slot that
+ *  is not published, and then published by swapping the slots.
+ */
+#define PASTURE_CACHE_SLOTS 2
 
 /**
  * @brief Fetches the cached fence data and outputs the length and 
  *        pointer location to the cached fence.
  * 
- * @note Semaphore locking when using the cached area must be handled outside
- *       this function, since we give the caller a pointer to the area.
+ * @note Only a pinned pasture is guaranteed not to be replaced while in use,
+ *       see pasture_cache_pin.
  * 
  * @param[out] pasture pointer to where the cached pasture is stored.
- * @param[in] len length of the pasture struct.
  * 
  * @return 0 on success.
  * @return -ENODATA if pasture has 0 fences.
@@ -26,15 +28,58 @@ extern struct k_sem fence_data_sem;
 int get_pasture_cache(pasture_t **pasture);
 
 /**
- * @brief Free's previous fence cache and stores a new one based on
- *        input data. It is of type uint8_t* and not fence_t* since this
- *        function is fed into the storage controller which reads out
+ * @brief Pins the published pasture, so that its slot is not reused by
+ *        set_pasture_cache until unpinned. Never blocks, not even while a new
+ *        pasture is being stored.
+ * 
+ * @param[out] pasture pointer to where the cached pasture is stored.
+ * 
+ * @return slot of the pasture, to pass to pasture_cache_unpin.
+ */
+uint8_t pasture_cache_pin(pasture_t **pasture);
+
+/**
+ * @brief Releases a pasture pinned with pasture_cache_pin.
+ * 
+ * @param[in] slot slot returned by pasture_cache_pin.
+ */
+void pasture_cache_unpin(uint8_t slot);
+
+/**
+ * @brief Stores a new pasture in the slot that is not published, and indexes
+ *        it for the distance calculations. Readers are never blocked, only a
+ *        reader that has pinned the idle slot since before the previous
+ *        publish delays it. It is of type uint8_t* and not fence_t* since 
+ *        this function is fed into the storage controller which reads out
  *        raw binary data.
  * 
- * @param[in] pasture pointer to where the pasture is buffered.
- * @param[in] len length of the pasture struct.
+ * @param[in] pasture pointer to a packed pasture_t, or a pasture_legacy_t
+ *                    written by earlier firmware.
+ * @param[in] len length of the pasture, see pasture_size.
  * 
- * @return 0 on success, otherwise negative errno.
+ * @return 0 on success, otherwise negative errno and nothing is staged.
+ */
+int pasture_cache_stage(uint8_t *pasture, size_t len);
+
+/**
+ * @brief Publishes the pasture stored by pasture_cache_stage. Takes no 
+ *        longer than swapping the slots.
+ * 
+ * @return 0 on success.
+ * @return -EALREADY if no pasture is staged, e.g. when the staged pasture
+ *         was already published by an earlier call.
+ */
+int pasture_cache_publish(void);
+
+/**
+ * @brief Stores a new pasture with pasture_cache_stage, and then publishes 
+ *        it.
+ * 
+ * @param[in] pasture see pasture_cache_stage.
+ * @param[in] len length of the pasture, see pasture_size.
+ * 
+ * @return 0 on success, otherwise negative errno and the published pasture
+ *         is kept.
  */
 int set_pasture_cache(uint8_t *pasture, size_t len);
 
@@ -44,15 +89,15 @@ int set_pasture_cache(uint8_t *pasture, size_t len);
  * 
  * @return true if valid, false if not valid.
 */
-bool fnc_valid(fence_t *fence);
+bool fnc_valid(const fence_t *fence);
 
 /** @brief Checks if there's any valid fence in the pasture. 
  * 
- * @note Mutex must be taken outside of this function.
+ * @param[in] pasture pasture pinned with pasture_cache_pin.
  * 
  * @return true if valid fence exists.
 */
-bool fnc_valid_fence(void);
+bool fnc_valid_fence(const pasture_t *pasture);
 
 /** @brief Checks if the cached pasture has valid definition.
  * 
@@ -66,26 +111,27 @@ bool fnc_valid_def(void);
  * @brief Fetches the cached gnss data and outputs the
  *        pointer location to the cached gnss area.
  * 
- * @note No need to lock semaphores outside, since we use two gnss cached
- *       areas. Whenever we consume gnss_cache, we check if we have new
- *       data written to the other cached area, and swap them if its true.
+ * @note No need to lock semaphores outside, since the cache holds a
+ *       reference to the returned GNSS snapshot until the next call.
+ *       Whenever we consume gnss_cache, we check if a newer snapshot has
+ *       been written, and switch to it if its true.
  * 
  * @param[out] gnss pointer to where the cached gnss is stored.
  * 
  * @return 0 on success.
  * @return -ENODATA if gnss cache has not been set.
  */
-int get_gnss_cache(gnss_t **gnss);
+int get_gnss_cache(const gnss_t **gnss);
 
 /**
- * @brief Updates the gnss cache area that is not being read from. Locks
- *        If consumer has not yet processed the previous GNSS entry.
+ * @brief Keeps a reference to a GNSS snapshot for the consumer. Fails if
+ *        the consumer is switching to the previous GNSS entry.
  * 
- * @param[in] gnss gnss data to cache.
+ * @param[in] gnss gnss snapshot to cache, see gnss_snapshot_ref.
  * @param[in] timed_out Flag indicating whether or not the GNSS timed out.
  * 
  * @return 0 on success, otherwise negative errno on semaphore error.
  */
-int set_gnss_cache(gnss_t *gnss, const bool timed_out);
+int set_gnss_cache(const gnss_t *gnss, const bool timed_out);
 
 #endif /* _AMC_CACHE_H_ */
\ No newline at end of file
@@ -6,9 +6,24 @@
 #define _AMC_DIST_H_
 
 #include <zephyr.h>
+#include "pasture_structure.h"
+
+/** @brief Builds the precomputed segment constants and the spatial index 
+ *         used by fnc_calc_dist for a pasture cache slot. Must be called 
+ *         whenever a pasture is stored in a slot, before it is published.
+ * 
+ * @param[in] pasture pointer to the pasture to index.
+ * @param[in] slot pasture cache slot holding the pasture.
+ */
+void fnc_build_dist_index(const pasture_t *pasture, uint8_t slot);
 
 /** @brief Computes the distance from a point to any polygon in cached pasture.
  * 
+ * @note With CONFIG_AMC_DIST_TEMPORAL_SEED the search starts from the nearest
+ *       segment of the previous call, which is cheapest for consecutive fixes.
+ * 
+ * @param[in] pasture pasture pinned with pasture_cache_pin.
+ * @param[in] slot slot returned by pasture_cache_pin.
  * @param[in] pos_x x position from gps measurement.
  * @param[in] pos_y y position from gps measurement.
  * @param[out] p_fence_index pointer to which polygon is closest.
@@ -18,7 +33,32 @@
  * @return 0 On fence line.
  * @return >0 Outside fence distance.
 */
-int16_t fnc_calc_dist(int16_t pos_x, int16_t pos_y, uint8_t *p_fence_index,
-		      uint8_t *p_vertex_index);
+int16_t fnc_calc_dist(const pasture_t *pasture, uint8_t slot, int16_t pos_x, int16_t pos_y,
+		      uint8_t *p_fence_index, uint8_t *p_vertex_index);
+
+/** @brief Computes the distance like fnc_calc_dist, but skips the polygon 
+ *         evaluation while the distance is safely below a limit. The 
+ *         distance can change at most as much as the position since the 
+ *         last exact calculation, so the last exact distance plus the 
+ *         displacement is returned instead, as long as that plus 
+ *         CONFIG_AMC_DIST_SAFE_RADIUS_MARGIN_DM is below the limit.
+ * 
+ * @param[in] pasture pasture pinned with pasture_cache_pin.
+ * @param[in] slot slot returned by pasture_cache_pin.
+ * @param[in] pos_x x position from gps measurement.
+ * @param[in] pos_y y position from gps measurement.
+ * @param[in] limit the distance is calculated exactly when it may reach this.
+ * @param[out] p_fence_index pointer to which polygon is closest.
+ * @param[out] p_vertex_index pointer to which vertex is closest in closest polygon.
+ * 
+ * @return Distance as fnc_calc_dist, or an upper bound of it when skipped.
+ */
+int16_t fnc_calc_dist_lazy(const pasture_t *pasture, uint8_t slot, int16_t pos_x, int16_t pos_y,
+			   int16_t limit, uint8_t *p_fence_index, uint8_t *p_vertex_index);
+
+/** @brief Gets the number of exact distance calculations skipped by 
+ *         fnc_calc_dist_lazy since boot.
+ */
+uint32_t fnc_get_dist_skip_count(void);
 
 #endif /* _AMC_DIST_H_ */
\ No newline at end of file
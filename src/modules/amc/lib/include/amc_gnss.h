@@ -27,10 +27,11 @@ int gnss_init(gnss_timeout_cb timeout_cb);
 /** @brief Set GNSS power mode by submitting an event to GNSS controller.
  * 
  * @param[in] mode Power mode value to set. 
+ * @param[in] rate_ms Update rate in milliseconds, 0 for the default rate of the mode.
  * 
  * @returns 0 on success, error code otherwise. 
  */
-int gnss_update_mode(gnss_mode_t mode);
+int gnss_update_mode(gnss_mode_t mode, uint16_t rate_ms);
 
 /** @brief Get GNSS power mode. 
  * 
@@ -50,7 +51,7 @@ void gnss_set_mode(gnss_mode_t mode);
  * 
  * @returns 0 on success, error code otherwise. 
  */
-int gnss_update(gnss_t *gnss_data);
+int gnss_update(const gnss_t *gnss_data);
 
 /** @brief Convert latitude&longitude into X&Y coordinates based on origins
  * 
@@ -64,7 +65,7 @@ int gnss_update(gnss_t *gnss_data);
  * 
  * @returns 0 on success, error code otherwise. 
  */
-int gnss_calc_xy(gnss_t *gnss_data, int16_t *x_dm, int16_t *y_dm, int32_t origin_lon,
+int gnss_calc_xy(const gnss_t *gnss_data, int16_t *x_dm, int16_t *y_dm, int32_t origin_lon,
 		 int32_t origin_lat, uint16_t k_lon, uint16_t k_lat);
 
 /** @brief Validate that GNSS fix is as good as possible and update flags.
@@ -0,0 +1,39 @@
+/*
+ * Copyright (c) 2022 Nofence AS
+ */
+
+#ifndef _AMC_GNSS_SCHED_H_
+#define _AMC_GNSS_SCHED_H_
+
+#include <zephyr.h>
+
+#include "gnss.h"
+#include "amc_zone.h"
+#include "movement_events.h"
+
+/** @brief Registers the distance to the fence of a new accepted fix, used
+ *         to schedule the following fixes.
+ * 
+ * @param[in] dist_dm Distance to the fence, negative inside the pasture.
+ * @param[in] gnss_data GNSS data of the fix.
+ */
+void gnss_sched_update(int16_t dist_dm, const gnss_t *gnss_data);
+
+/** @brief Forgets the last distance, e.g. when the fix is lost. The default
+ *         rate of the GNSS mode is then used until the next accepted fix.
+ */
+void gnss_sched_reset(void);
+
+/** @brief Calculates the GNSS update rate for the zone, such that the next 
+ *         fix is taken before the animal can reach the next zone. The animal 
+ *         is assumed to head straight for the fence, at the highest of its 
+ *         ground speed and the speed bound of its movement state.
+ * 
+ * @param[in] zone Current zone, only PSM and caution zone are scheduled.
+ * @param[in] mov_state Current movement state.
+ * 
+ * @returns Update rate in milliseconds, 0 for the default rate of the GNSS mode.
+ */
+uint16_t gnss_sched_get_rate(amc_zone_t zone, movement_state_t mov_state);
+
+#endif /* _AMC_GNSS_SCHED_H_ */
@@ -200,6 +200,7 @@ int commander_stimulator_handler(enum diagnostics_interface interface, uint8_t c
 		struct ep_status_event *ready_ep_event = new_ep_status_event();
 		ready_ep_event->ep_status = EP_RELEASE;
 		ready_ep_event->is_first_pulse = false;
+		ready_ep_event->fix_cycles = 0;
 		EVENT_SUBMIT(ready_ep_event);
 		k_sleep(K_SECONDS(2));
 		struct sound_status_event *ev_idle = new_sound_status_event();
@@ -226,6 +227,7 @@ int commander_stimulator_handler(enum diagnostics_interface interface, uint8_t c
 			struct ep_status_event *ready_ep_event = new_ep_status_event();
 			ready_ep_event->ep_status = EP_RELEASE;
 			ready_ep_event->is_first_pulse = false;
+			ready_ep_event->fix_cycles = 0;
 			EVENT_SUBMIT(ready_ep_event);
 			increment_zap_count(); //Added to enable server to report the amount of zap and not via BLE
 			k_sleep(K_SECONDS(6));
@@ -14,6 +14,7 @@
 #include "diagnostic_flags.h"
 #include "approtect.h"
 #include "nf_version.h"
+#include "nf_latency.h"
 
 #include <logging/log.h>
 LOG_MODULE_REGISTER(diag_cmd_system, 4);
@@ -67,6 +68,7 @@ int commander_system_handler(enum diagnostics_interface interface, uint8_t cmd,
 
 		struct gnss_set_mode_event *ev = new_gnss_set_mode_event();
 		ev->mode = diag->force_gnss_mode;
+		ev->rate_ms = 0;
 		EVENT_SUBMIT(ev);
 
 		commander_send_resp(interface, SYSTEM, cmd, resp, NULL, 0);
@@ -83,6 +85,7 @@ int commander_system_handler(enum diagnostics_interface interface, uint8_t cmd,
 
 		struct gnss_set_mode_event *ev = new_gnss_set_mode_event();
 		ev->mode = diag->force_gnss_mode;
+		ev->rate_ms = 0;
 		EVENT_SUBMIT(ev);
 
 		commander_send_resp(interface, SYSTEM, cmd, resp, NULL, 0);
@@ -135,6 +138,7 @@ int commander_system_handler(enum diagnostics_interface interface, uint8_t cmd,
 
 		struct gnss_set_mode_event *ev = new_gnss_set_mode_event();
 		ev->mode = diag->force_gnss_mode;
+		ev->rate_ms = 0;
 		EVENT_SUBMIT(ev);
 
 		commander_send_resp(interface, SYSTEM, cmd, resp, NULL, 0);
@@ -196,6 +200,11 @@ int commander_system_handler(enum diagnostics_interface interface, uint8_t cmd,
 			LOG_ERR("could not clear SYSTEM_DIAG partition: %d", err);
 			resp = ERROR;
 		}
+		err = stg_clear_partition(STG_PARTITION_GNSS);
+		if (err) {
+			LOG_ERR("could not clear GNSS partition: %d", err);
+			resp = ERROR;
+		}
 
 		err = stg_config_u8_write(STG_U8_TEACH_MODE_FINISHED, 0);
 		err = stg_config_u8_write(STG_U8_KEEP_MODE, 0);
@@ -285,6 +294,28 @@ int commander_system_handler(enum diagnostics_interface interface, uint8_t cmd,
 		commander_send_resp(interface, SYSTEM, cmd, DATA, &fwversion, sizeof(uint16_t));
 		break;
 	}
+	case GET_FIX_LATENCY: {
+		/* Statistics of every stage, in the order of latency_stage_t.
+		 * A non-zero first data byte clears them after reading.
+		 */
+		latency_stats_t stats[LATENCY_STAGES];
+		for (latency_stage_t stage = 0; stage < LATENCY_STAGES; stage++) {
+			err = latency_get_stats(stage, &stats[stage]);
+			if (err != 0) {
+				break;
+			}
+		}
+		if (err != 0) {
+			resp = (err == -ENOTSUP) ? NOT_IMPLEMENTED : ERROR;
+			commander_send_resp(interface, SYSTEM, cmd, resp, NULL, 0);
+			break;
+		}
+		if (size >= 1 && data[0]) {
+			latency_reset();
+		}
+		commander_send_resp(interface, SYSTEM, cmd, DATA, (uint8_t *)stats, sizeof(stats));
+		break;
+	}
 	default:
 		resp = UNKNOWN_CMD;
 		commander_send_resp(interface, SYSTEM, cmd, resp, NULL, 0);
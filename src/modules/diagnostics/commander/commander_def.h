@@ -79,6 +79,7 @@ typedef enum {
 	READ_THREAD_CONTROL = 0x41,
 
 	FORCE_POLL_REQ = 0x42,
+	GET_FIX_LATENCY = 0x43,
 	CLEAR_PASTURE = 0xC0,
 	ERASE_FLASH = 0xEF,
 
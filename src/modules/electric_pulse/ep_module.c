@@ -13,6 +13,7 @@
 #include "ep_event.h"
 #include "error_event.h"
 #include "messaging_module_events.h"
+#include "nf_latency.h"
 
 #define MODULE ep_module
 LOG_MODULE_REGISTER(MODULE, CONFIG_EP_MODULE_LOG_LEVEL);
@@ -114,7 +115,7 @@ int ep_module_init(void)
 	return ret;
 }
 
-static int ep_module_release(bool first_pulse)
+static int ep_module_release(bool first_pulse, uint32_t fix_cycles)
 {
 	if (!device_is_ready(ep_ctrl_pwm_dev)) {
 		LOG_WRN("Electic pulse PWM device not ready!");
@@ -157,6 +158,7 @@ static int ep_module_release(bool first_pulse)
 	if (ret != 0) {
 		LOG_WRN("Unable to set electic pulse PWM signal!");
 	} else {
+		latency_record(LATENCY_PULSE, fix_cycles);
 		k_busy_wait(ep_duration_us);
 		g_last_pulse_time = current_time;
 	}
@@ -190,7 +192,7 @@ static bool event_handler(const struct event_header *eh)
 		case EP_RELEASE: {
 			if (g_trigger_ready) {
 				g_trigger_ready = false;
-				err = ep_module_release(event->is_first_pulse);
+				err = ep_module_release(event->is_first_pulse, event->fix_cycles);
 				if (err < 0) {
 					LOG_ERR("Error in ep release (%d)", err);
 					nf_app_error(ERR_EP_MODULE, err, NULL, 0);
@@ -8,6 +8,16 @@
 #include "gnss.h"
 #include "kernel.h"
 #include "diagnostics_events.h"
+#include "nf_latency.h"
+
+#if CONFIG_GNSS_ANO_UPLOAD || CONFIG_GNSS_HOT_START
+#include <date_time.h>
+#include <time.h>
+#include "storage.h"
+#endif
+#if CONFIG_GNSS_ANO_UPLOAD
+#include "UBX.h"
+#endif
 
 #define STACK_SIZE 1024
 #define PRIORITY 7
@@ -23,11 +33,23 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_GNSS_CONTROLLER_LOG_LEVEL);
 static _Noreturn void publish_gnss_data(void *ctx);
 static int gnss_data_update_cb(const gnss_t *);
 static void gnss_timed_out(void);
-static int gnss_set_mode(gnss_mode_t mode, bool wakeup);
+static int gnss_set_mode(gnss_mode_t mode, uint16_t rate_ms, bool wakeup);
 static void gnss_thread_fn(void);
+static void gnss_controller_request_ano_upload(void);
+#if CONFIG_GNSS_ANO_UPLOAD
+static void gnss_controller_upload_ano(void);
+#endif
+static void gnss_controller_request_hot_start(bool save);
+#if CONFIG_GNSS_HOT_START
+static void gnss_controller_save_hot_start(void);
+static void gnss_controller_restore_hot_start(void);
+#endif
 
-static gnss_t gnss_data_buffer;
+/* Latest snapshot from the GNSS driver, not yet published. */
+static atomic_ptr_t gnss_data_pending = ATOMIC_PTR_INIT(NULL);
 static gnss_mode_t current_mode = GNSSMODE_NOMODE;
+/* Rate requested with the current mode, 0 for the default rate of the mode. */
+static uint16_t requested_rate_ms = 0;
 static uint16_t current_rate_ms = UINT16_MAX;
 const struct device *gnss_dev = NULL;
 static uint8_t gnss_reset_count = 0;
@@ -42,14 +64,21 @@ K_THREAD_STACK_DEFINE(pub_gnss_stack, STACK_SIZE);
 K_THREAD_DEFINE(send_to_gnss, CONFIG_GNSS_STACK_SIZE, gnss_thread_fn, NULL, NULL, NULL,
 		K_PRIO_COOP(CONFIG_GNSS_THREAD_PRIORITY), 0, 0);
 
-enum gnss_action_e { GNSS_ACTION_NUL = 0, GNSS_ACTION_SET_MODE };
+enum gnss_action_e {
+	GNSS_ACTION_NUL = 0,
+	GNSS_ACTION_SET_MODE,
+	GNSS_ACTION_UPLOAD_ANO,
+	GNSS_ACTION_SAVE_HOT_START,
+	GNSS_ACTION_RESTORE_HOT_START
+};
 
 typedef struct gnss_msgq_t {
 	enum gnss_action_e action;
 	void *arg;
+	uint16_t rate_ms;
 } gnss_msgq_t;
 
-K_MSGQ_DEFINE(gnss_msgq, sizeof(gnss_msgq_t), 1, 4);
+K_MSGQ_DEFINE(gnss_msgq, sizeof(gnss_msgq_t), 4, 4);
 
 static void gnss_thread_fn(void)
 {
@@ -64,11 +93,17 @@ static void gnss_thread_fn(void)
 			int retries = CONFIG_GNSS_CMD_RETRIES;
 			gnss_mode_t mode = (gnss_mode_t)(msg.arg);
 			do {
-				rc = gnss_set_mode(mode, true);
+				rc = gnss_set_mode(mode, msg.rate_ms, true);
 			} while ((retries-- > 0) && (rc != 0));
 
 			if (rc == 0) {
+				if (current_mode == GNSSMODE_INACTIVE &&
+				    mode != GNSSMODE_INACTIVE) {
+					/* Woke up from backup mode. */
+					gnss_controller_request_ano_upload();
+				}
 				current_mode = mode;
+				requested_rate_ms = msg.rate_ms;
 			} else {
 				LOG_ERR("Failed to set mode %d with %d retries", rc,
 					CONFIG_GNSS_CMD_RETRIES);
@@ -81,12 +116,280 @@ static void gnss_thread_fn(void)
 			EVENT_SUBMIT(ev);
 			break;
 		}
+#if CONFIG_GNSS_ANO_UPLOAD
+		case GNSS_ACTION_UPLOAD_ANO:
+			gnss_controller_upload_ano();
+			break;
+#endif
+#if CONFIG_GNSS_HOT_START
+		case GNSS_ACTION_SAVE_HOT_START:
+			gnss_controller_save_hot_start();
+			break;
+		case GNSS_ACTION_RESTORE_HOT_START:
+			gnss_controller_restore_hot_start();
+			break;
+#endif
 		default:
 			LOG_ERR("Unrecognized action %d", msg.action);
 		}
 	}
 }
 
+/** @brief Schedules an upload of the stored AssistNow Offline data for the
+ *         current date on the GNSS thread, see gnss_controller_upload_ano.
+ */
+static void gnss_controller_request_ano_upload(void)
+{
+#if CONFIG_GNSS_ANO_UPLOAD
+	gnss_msgq_t msg = { .action = GNSS_ACTION_UPLOAD_ANO, .arg = NULL };
+
+	if (k_msgq_put(&gnss_msgq, &msg, K_NO_WAIT) != 0) {
+		LOG_WRN("ANO upload not scheduled, GNSS thread busy");
+	}
+#endif
+}
+
+#if CONFIG_GNSS_ANO_UPLOAD
+/* Current date as YYMMDD, and the result of the upload for it. */
+static uint32_t ano_upload_date;
+static struct gnss_assist_stats ano_upload_stats;
+
+static uint32_t gnss_ano_frame_date(const UBX_MGA_ANO_RAW_t *frame)
+{
+	return frame->mga_ano.year * 10000 + frame->mga_ano.month * 100 + frame->mga_ano.day;
+}
+
+/** @brief Uploads the MGA-ANO frames of an ANO entry that are for the current
+ *         date to the GNSS receiver in one bulk transfer. The entries are 
+ *         stored by date, so the walk is stopped at the first frame for a 
+ *         later date.
+ * 
+ * @return 0 to continue with the next entry, -EINTR when done, otherwise
+ *         negative errno from the upload.
+ */
+static int gnss_ano_upload_cb(uint8_t *data, size_t len)
+{
+	const UBX_MGA_ANO_RAW_t *frames = (const UBX_MGA_ANO_RAW_t *)data;
+	size_t count = len / sizeof(UBX_MGA_ANO_RAW_t);
+	size_t first = 0;
+
+	while (first < count && gnss_ano_frame_date(&frames[first]) < ano_upload_date) {
+		first++;
+	}
+	size_t last = first;
+	while (last < count && gnss_ano_frame_date(&frames[last]) == ano_upload_date) {
+		last++;
+	}
+
+	if (last > first) {
+		struct gnss_assist_stats stats = { 0 };
+		int ret = gnss_upload_assist_data_bulk(gnss_dev,
+						       (const uint8_t *)&frames[first].mga_ano,
+						       sizeof(UBX_MGA_ANO_RAW_t), last - first,
+						       &stats);
+
+		ano_upload_stats.accepted += stats.accepted;
+		ano_upload_stats.rejected += stats.rejected;
+		ano_upload_stats.retransmitted += stats.retransmitted;
+		ano_upload_stats.duration_ms += stats.duration_ms;
+		if (ret != 0) {
+			return ret;
+		}
+	}
+	return last < count ? -EINTR : 0;
+}
+
+/** @brief Uploads the stored AssistNow Offline data for the current date to
+ *         the GNSS receiver, to shorten the time to first fix. Nothing is
+ *         uploaded before the date is known.
+ */
+static void gnss_controller_upload_ano(void)
+{
+	int64_t now_ms;
+
+	if (date_time_now(&now_ms) != 0) {
+		LOG_INF("Date unknown, ANO data not uploaded");
+		return;
+	}
+	time_t now = (time_t)(now_ms / MSEC_PER_SEC);
+	struct tm gm_time;
+
+	gmtime_r(&now, &gm_time);
+	ano_upload_date = (gm_time.tm_year - 100) * 10000 + (gm_time.tm_mon + 1) * 100 +
+			  gm_time.tm_mday;
+	memset(&ano_upload_stats, 0, sizeof(ano_upload_stats));
+
+	int ret = stg_read_ano_data(gnss_ano_upload_cb, true, 0);
+	struct gnss_assist_stats *stats = &ano_upload_stats;
+	uint32_t frames_per_sec = stats->accepted * MSEC_PER_SEC / MAX(stats->duration_ms, 1);
+
+	if (ret == -ENODATA) {
+		LOG_INF("No ANO data stored");
+	} else if (ret != 0) {
+		LOG_WRN("ANO upload failed after %d frames, %d", stats->accepted, ret);
+	} else {
+		LOG_INF("Uploaded %d ANO frames in %d ms (%d/s), %d rejected, %d retransmitted",
+			stats->accepted, stats->duration_ms, frames_per_sec, stats->rejected,
+			stats->retransmitted);
+	}
+}
+#endif
+
+#if CONFIG_GNSS_HOT_START
+/* Uptime [s] of the last successful save, and whether a save is queued. */
+static atomic_t hot_start_saved_at_s;
+static atomic_t hot_start_save_pending;
+#endif
+
+/** @brief Schedules a save of the navigation database of the receiver, or a
+ *         restore of the saved one, on the GNSS thread. Saves are only 
+ *         scheduled once every CONFIG_GNSS_HOT_START_SAVE_INTERVAL_MIN
+ *         after the last successful one, and one at a time.
+ * 
+ * @param save true to save, false to restore.
+ */
+static void gnss_controller_request_hot_start(bool save)
+{
+#if CONFIG_GNSS_HOT_START
+	if (save) {
+		uint32_t since_s = k_uptime_get() / MSEC_PER_SEC -
+				   (uint32_t)atomic_get(&hot_start_saved_at_s);
+
+		if (since_s < CONFIG_GNSS_HOT_START_SAVE_INTERVAL_MIN * 60 ||
+		    !atomic_cas(&hot_start_save_pending, 0, 1)) {
+			return;
+		}
+	}
+	gnss_msgq_t msg = { .action = save ? GNSS_ACTION_SAVE_HOT_START :
+					     GNSS_ACTION_RESTORE_HOT_START,
+			    .arg = NULL };
+
+	if (k_msgq_put(&gnss_msgq, &msg, K_NO_WAIT) != 0) {
+		LOG_WRN("GNSS hot start not scheduled, GNSS thread busy");
+		if (save) {
+			atomic_clear(&hot_start_save_pending);
+		}
+	}
+#else
+	ARG_UNUSED(save);
+#endif
+}
+
+#if CONFIG_GNSS_HOT_START
+/* Time accuracy of the network time from the modem. */
+#define GNSS_HOT_START_TIME_ACC_S 2
+
+/* Header of the receiver state in the GNSS partition, followed by the 
+ * navigation database.
+ */
+typedef struct {
+	uint32_t db_size;
+	int32_t lat;
+	int32_t lon;
+	/** Height above ellipsoid [dm]. */
+	int16_t height;
+	uint8_t has_pos;
+	uint8_t reserved;
+} gnss_hot_start_header_t;
+
+/* Receiver state as stored in the GNSS partition, with room for the padding
+ * of the last entry when read back. Only used on the GNSS thread.
+ */
+static uint8_t hot_start_buf[sizeof(gnss_hot_start_header_t) + CONFIG_GNSS_HOT_START_MAX_SIZE +
+			     sizeof(uint32_t)] __aligned(4);
+
+/** @brief Saves the navigation database of the receiver and the last 
+ *         position with a fix to the GNSS partition.
+ */
+static void gnss_controller_save_hot_start(void)
+{
+	gnss_hot_start_header_t *header = (gnss_hot_start_header_t *)hot_start_buf;
+	gnss_t gnss;
+
+	memset(header, 0, sizeof(*header));
+	if (gnss_data_fetch(gnss_dev, &gnss) == 0 && gnss.has_lastfix) {
+		header->has_pos = 1;
+		header->lat = gnss.lastfix.lat;
+		header->lon = gnss.lastfix.lon;
+		header->height = gnss.lastfix.height;
+	}
+
+	uint32_t size = 0;
+	int ret = gnss_get_nav_db(gnss_dev, &hot_start_buf[sizeof(*header)],
+				  CONFIG_GNSS_HOT_START_MAX_SIZE, &size);
+	if (ret == 0) {
+		header->db_size = size;
+		ret = stg_write_gnss_data(hot_start_buf, sizeof(*header) + size);
+	}
+
+	if (ret != 0) {
+		/* Retried on the next fix. */
+		LOG_WRN("GNSS navigation database not saved, %d", ret);
+	} else {
+		atomic_set(&hot_start_saved_at_s, (atomic_val_t)(k_uptime_get() / MSEC_PER_SEC));
+		LOG_INF("Saved GNSS navigation database, %d bytes", size);
+	}
+	atomic_clear(&hot_start_save_pending);
+}
+
+/** @brief Restores a saved navigation database, with the saved position
+ *         and the current time when known.
+ * 
+ * @return 0 if the database was restored, otherwise negative errno.
+ */
+static int gnss_controller_apply_hot_start(uint8_t *data, size_t len)
+{
+	const gnss_hot_start_header_t *header = (const gnss_hot_start_header_t *)data;
+
+	/* Stored entries may be padded. */
+	if (len < sizeof(*header) || header->db_size > len - sizeof(*header)) {
+		return -EINVAL;
+	}
+
+	struct gnss_nav_hint hint = { 0 };
+	int64_t now_ms;
+
+	if (date_time_now(&now_ms) == 0) {
+		hint.unix_time = now_ms / MSEC_PER_SEC;
+		hint.time_acc_s = GNSS_HOT_START_TIME_ACC_S;
+	}
+	if (header->has_pos) {
+		hint.has_pos = true;
+		hint.lat = header->lat;
+		hint.lon = header->lon;
+		hint.height = header->height;
+		hint.pos_acc_m = CONFIG_GNSS_HOT_START_POS_ACC_M;
+	}
+
+	struct gnss_assist_stats stats = { 0 };
+	int ret = gnss_restore_nav_db(gnss_dev, &hint, &data[sizeof(*header)], header->db_size,
+				      &stats);
+
+	LOG_INF("Restored GNSS navigation database: %d accepted, %d rejected in %d ms, %d",
+		stats.accepted, stats.rejected, stats.duration_ms, ret);
+	return ret;
+}
+
+/** @brief Restores the saved navigation database of the receiver, to shorten
+ *         the time to first fix after a power cycle or reset.
+ */
+static void gnss_controller_restore_hot_start(void)
+{
+	size_t len;
+	int ret = stg_read_gnss_data(hot_start_buf, sizeof(hot_start_buf), &len);
+
+	if (ret == 0) {
+		ret = gnss_controller_apply_hot_start(hot_start_buf, len);
+	}
+
+	if (ret == -ENODATA) {
+		LOG_INF("No GNSS navigation database stored");
+	} else if (ret != 0) {
+		LOG_WRN("GNSS navigation database not restored, %d", ret);
+	}
+}
+#endif
+
 struct k_thread pub_gnss_thread;
 static bool initialized = false;
 
@@ -97,11 +400,8 @@ k_tid_t pub_gnss_thread_id;
 /** @brief Sends a timeout event from the GNSS controller */
 static void gnss_controller_send_timeout_event(void)
 {
-	gnss_t gnss_no_fix;
-	memset(&gnss_no_fix, 0, sizeof(gnss_t));
-
 	struct gnss_data *new_data = new_gnss_data();
-	new_data->gnss_data = gnss_no_fix;
+	new_data->gnss_data = &gnss_snapshot_no_fix;
 	new_data->timed_out = true;
 
 	EVENT_SUBMIT(new_data);
@@ -129,11 +429,15 @@ static int gnss_controller_reset_and_setup_gnss(uint16_t mask)
 		LOG_ERR("gnss_setup failed %d", ret);
 		return ret;
 	}
-	ret = gnss_set_mode(current_mode, false);
+	ret = gnss_set_mode(current_mode, requested_rate_ms, false);
 	if (ret != 0) {
 		LOG_ERR("gnss_set_mode %d", ret);
 		return ret;
 	}
+	if (mask != GNSS_RESET_MASK_HOT) {
+		gnss_controller_request_hot_start(false);
+		gnss_controller_request_ano_upload();
+	}
 	return 0;
 }
 
@@ -263,6 +567,8 @@ int gnss_controller_init(void)
 		nf_app_error(ERR_GNSS_CONTROLLER, ret, msg, sizeof(*msg));
 		return ret;
 	}
+	gnss_controller_request_hot_start(false);
+	gnss_controller_request_ano_upload();
 
 #if defined(CONFIG_TEST)
 	pub_gnss_thread_id =
@@ -278,6 +584,7 @@ static _Noreturn void publish_gnss_data(void *ctx)
 {
 	int ret;
 	int timeout_ms;
+	uint32_t msss = 0;
 	while (true) {
 		if (current_rate_ms == UINT16_MAX ||
 		    current_rate_ms < CONFIG_GNSS_MINIMUM_ALLOWED_GNSS_RATE) {
@@ -287,22 +594,38 @@ static _Noreturn void publish_gnss_data(void *ctx)
 			timeout_ms = current_rate_ms + CONFIG_GNSS_TIMEOUT_SLACK_MS;
 		}
 		if ((ret = k_sem_take(&new_data_sem, K_MSEC(timeout_ms))) == 0) {
+			const gnss_t *gnss = atomic_ptr_set(&gnss_data_pending, NULL);
+			if (gnss == NULL) {
+				continue;
+			}
 			gnss_reset_count = 0;
 			gnss_timeout_count = 0;
+			LOG_DBG("  GNSS data: %d, %d, %d, %d, %d", gnss->latest.lon,
+				gnss->latest.lat, gnss->latest.pvt_flags, gnss->latest.h_acc_dm,
+				gnss->latest.num_sv);
+
+			/* The snapshot may be released as soon as it is submitted. */
+			uint32_t pvt_cycles = gnss->latest.pvt_cycles;
+			bool fix_ok = gnss->fix_ok;
+			msss = gnss->latest.msss;
+
+			/* The reference of the pending snapshot is passed to the event. */
 			struct gnss_data *new_data = new_gnss_data();
-			new_data->gnss_data = gnss_data_buffer;
+			new_data->gnss_data = gnss;
 			new_data->timed_out = false;
-			LOG_DBG("  GNSS data: %d, %d, %d, %d, %d", gnss_data_buffer.latest.lon,
-				gnss_data_buffer.latest.lat, gnss_data_buffer.latest.pvt_flags,
-				gnss_data_buffer.latest.h_acc_dm, gnss_data_buffer.latest.num_sv);
 			EVENT_SUBMIT(new_data);
+			latency_record(LATENCY_GNSS_PUBLISH, pvt_cycles);
 			initialized = true;
+
+			if (fix_ok) {
+				gnss_controller_request_hot_start(true);
+			}
 		} else {
 			if (initialized && current_mode != GNSSMODE_INACTIVE) {
 				gnss_timed_out();
 			}
 		}
-		if (gnss_data_buffer.latest.msss >= MS_IN_49_DAYS && gnss_reset_count == 0) {
+		if (msss >= MS_IN_49_DAYS && gnss_reset_count == 0) {
 			gnss_controller_reset_and_setup_gnss(GNSS_RESET_MASK_COLD);
 		}
 	}
@@ -310,12 +633,20 @@ static _Noreturn void publish_gnss_data(void *ctx)
 
 static int gnss_data_update_cb(const gnss_t *data)
 {
-	memcpy(&gnss_data_buffer, data, sizeof(gnss_t));
+	gnss_t *gnss = gnss_snapshot_alloc();
+	if (gnss == NULL) {
+		LOG_WRN("No free GNSS snapshot, dropping data");
+		return -ENOMEM;
+	}
+	memcpy(gnss, data, sizeof(gnss_t));
+
+	/* Replace any data not yet published. */
+	gnss_snapshot_unref(atomic_ptr_set(&gnss_data_pending, gnss));
 	k_sem_give(&new_data_sem);
 	return 0;
 }
 
-static int gnss_set_mode(gnss_mode_t mode, bool wakeup)
+static int gnss_set_mode(gnss_mode_t mode, uint16_t rate_ms, bool wakeup)
 {
 	int ret;
 
@@ -348,7 +679,11 @@ static int gnss_set_mode(gnss_mode_t mode, bool wakeup)
 		}
 		current_rate_ms = UINT16_MAX;
 	} else if (mode == GNSSMODE_PSM || mode == GNSSMODE_CAUTION || mode == GNSSMODE_MAX) {
-		ret = gnss_set_power_mode(gnss_dev, mode);
+		if (rate_ms != 0) {
+			ret = gnss_set_power_mode_rate(gnss_dev, mode, rate_ms);
+		} else {
+			ret = gnss_set_power_mode(gnss_dev, mode);
+		}
 		if (ret != 0) {
 			LOG_ERR("failed to set GNSS to mode %u %d", mode, ret);
 			return ret;
@@ -368,10 +703,11 @@ static bool gnss_controller_event_handler(const struct event_header *eh)
 	if (is_gnss_set_mode_event(eh)) {
 		struct gnss_set_mode_event *ev = cast_gnss_set_mode_event(eh);
 		LOG_DBG("MODE = %d old = %d ", ev->mode, current_mode);
-		if (ev->mode != current_mode) {
+		if (ev->mode != current_mode || ev->rate_ms != requested_rate_ms) {
 			LOG_DBG("setting mode");
 			gnss_msgq_t msg;
 			msg.arg = (void *)(ev->mode);
+			msg.rate_ms = ev->rate_ms;
 			msg.action = GNSS_ACTION_SET_MODE;
 			k_msgq_put(&gnss_msgq, &msg, K_NO_WAIT);
 		}
@@ -52,7 +52,8 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_MESSAGING_LOG_LEVEL);
 #define BYTESWAP16(x) (((x) << 8) | ((x) >> 8))
 
 #define EMPTY_FENCE_CRC 0xFFFF
-static pasture_t pasture_temp;
+static uint8_t pasture_temp_buf[PASTURE_MAX_SIZE] __aligned(4);
+static pasture_t *const pasture_temp = (pasture_t *)pasture_temp_buf;
 static uint8_t cached_fences_counter = 0;
 static uint32_t cached_msss = 0;
 static uint32_t cached_ttff = 0;
@@ -839,27 +840,28 @@ static bool event_handler(const struct event_header *eh)
 	nofence_wdt_kick(WDT_MODULE_MESSAGING);
 	if (is_pwr_reboot_event(eh)) {
 		reboot_scheduled = true;
+		stg_request_log_flush();
 		return false;
 	}
 	if (is_gnss_data(eh)) {
 		struct gnss_data *ev = cast_gnss_data(eh);
-		cached_gnss_mode = (gnss_mode_t)ev->gnss_data.lastfix.mode;
+		cached_gnss_mode = (gnss_mode_t)ev->gnss_data->lastfix.mode;
 
 		/* Update that we received GNSS data regardless of validity. */
 		update_cache_reg(GNSS_STRUCT);
 
 		/* TODO, review pshustad, might block the event manager for 50 ms ? */
 		if (k_sem_take(&cache_lock_sem, K_MSEC(50)) == 0) {
-			if (ev->gnss_data.fix_ok && ev->gnss_data.has_lastfix) {
-				cached_fix = ev->gnss_data.lastfix;
+			if (ev->gnss_data->fix_ok && ev->gnss_data->has_lastfix) {
+				cached_fix = ev->gnss_data->lastfix;
 			}
-			cached_ttff = ev->gnss_data.latest.ttff;
-			cached_msss = ev->gnss_data.latest.msss;
+			cached_ttff = ev->gnss_data->latest.ttff;
+			cached_msss = ev->gnss_data->latest.msss;
 			k_sem_give(&cache_lock_sem);
 		}
 
-		if (ev->gnss_data.fix_ok && ev->gnss_data.has_lastfix) {
-			time_t gm_time = (time_t)ev->gnss_data.lastfix.unix_timestamp;
+		if (ev->gnss_data->fix_ok && ev->gnss_data->has_lastfix) {
+			time_t gm_time = (time_t)ev->gnss_data->lastfix.unix_timestamp;
 			struct tm *tm_time = gmtime(&gm_time);
 
 			if (tm_time->tm_year < 2015) {
@@ -1043,6 +1045,10 @@ static bool event_handler(const struct event_header *eh)
 	}
 	if (is_pwr_status_event(eh)) {
 		struct pwr_status_event *ev = cast_pwr_status_event(eh);
+		if (ev->pwr_state == PWR_LOW || ev->pwr_state == PWR_CRITICAL) {
+			/* Do not lose staged log records if the battery runs out. */
+			stg_request_log_flush();
+		}
 		if (ev->pwr_state != PWR_CHARGING) {
 			/* We want battery voltage in deci volt */
 			atomic_set(&cached_batt, (uint16_t)(ev->battery_mv / 10));
@@ -1195,37 +1201,39 @@ bool validate_pasture()
 	uint16_t pasture_value_16;
 	uint32_t pasture_value_32;
 
-	pasture_value_32 = pasture_temp.m.ul_fence_def_version;
+	pasture_value_32 = pasture_temp->m.ul_fence_def_version;
 	crc = nf_crc16_uint32(pasture_value_32, &crc);
 
-	pasture_value_32 = pasture_temp.m.l_origin_lon;
+	pasture_value_32 = pasture_temp->m.l_origin_lon;
 	crc = nf_crc16_uint32(pasture_value_32, &crc);
 
-	pasture_value_32 = pasture_temp.m.l_origin_lat;
+	pasture_value_32 = pasture_temp->m.l_origin_lat;
 	crc = nf_crc16_uint32(pasture_value_32, &crc);
 
-	pasture_value_16 = pasture_temp.m.us_k_lon;
+	pasture_value_16 = pasture_temp->m.us_k_lon;
 	crc = nf_crc16_uint16(pasture_value_16, &crc);
 
-	pasture_value_16 = pasture_temp.m.us_k_lat;
+	pasture_value_16 = pasture_temp->m.us_k_lat;
 	crc = nf_crc16_uint16(pasture_value_16, &crc);
 
-	if (pasture_temp.m.ul_total_fences == 0) {
+	if (pasture_temp->m.ul_total_fences == 0) {
 		/* Ignore CRC for No pasture */
-		return crc == pasture_temp.m.us_pasture_crc;
+		return crc == pasture_temp->m.us_pasture_crc;
 	}
 
-	for (uint8_t i = 0; i < pasture_temp.m.ul_total_fences; i++) {
-		fence_t *target_fence = &pasture_temp.fences[i];
+	for (uint8_t i = 0; i < pasture_temp->m.ul_total_fences; i++) {
+		fence_t *target_fence = &pasture_temp->fences[i];
+		fence_coordinate_t *coordinates =
+			pasture_fence_coordinates(pasture_temp, target_fence);
 		for (uint8_t j = 0; j < target_fence->m.n_points; j++) {
-			pasture_value_16 = target_fence->coordinates[j].s_x_dm;
+			pasture_value_16 = coordinates[j].s_x_dm;
 			crc = nf_crc16_uint16(pasture_value_16, &crc);
 
-			pasture_value_16 = target_fence->coordinates[j].s_y_dm;
+			pasture_value_16 = coordinates[j].s_y_dm;
 			crc = nf_crc16_uint16(pasture_value_16, &crc);
 		}
 	}
-	return crc == pasture_temp.m.us_pasture_crc;
+	return crc == pasture_temp->m.us_pasture_crc;
 }
 
 EVENT_LISTENER(MODULE, event_handler);
@@ -1454,9 +1462,9 @@ int messaging_module_init(void)
 	k_work_init_delayable(&m_fence_update_req.work, fence_update_req_fn);
 	k_work_init_delayable(&fota_wdt_work, fota_wdt_work_fn);
 
-	memset(&pasture_temp, 0, sizeof(pasture_t));
+	pasture_init(pasture_temp, sizeof(pasture_temp_buf), 0);
 	cached_fences_counter = 0;
-	pasture_temp.m.us_pasture_crc = EMPTY_FENCE_CRC;
+	pasture_temp->m.us_pasture_crc = EMPTY_FENCE_CRC;
 
 	/* Initialize nofence watchdog */
 	nofence_wdt_init();
@@ -2129,9 +2137,9 @@ uint8_t process_fence_msg(FenceDefinitionResponse *fenceResp)
 	}
 
 	if (frame == 0) {
-		memset(&pasture_temp, 0, sizeof(pasture_t));
+		pasture_init(pasture_temp, sizeof(pasture_temp_buf), 0);
 		cached_fences_counter = 0;
-		pasture_temp.m.us_pasture_crc = EMPTY_FENCE_CRC;
+		pasture_temp->m.us_pasture_crc = EMPTY_FENCE_CRC;
 	}
 
 	if (fenceResp->which_m == FenceDefinitionResponse_xHeader_tag) {
@@ -2143,10 +2151,22 @@ uint8_t process_fence_msg(FenceDefinitionResponse *fenceResp)
 			return 0;
 		}
 
+		/* Reserve the fence table, the coordinates follow it. */
+		err = pasture_init(pasture_temp, sizeof(pasture_temp_buf),
+				   fenceResp->m.xHeader.ulTotalFences);
+		if (err) {
+			LOG_ERR("No room for a pasture of %d fences. (%d)",
+				fenceResp->m.xHeader.ulTotalFences, err);
+			nf_app_error(ERR_MESSAGING, err, NULL, 0);
+
+			return 0;
+		}
+		pasture_temp->m.us_pasture_crc = EMPTY_FENCE_CRC;
+
 		/* Pasture header. */
 		if (fenceResp->m.xHeader.has_bKeepMode) {
-			pasture_temp.m.has_keep_mode = true;
-			pasture_temp.m.keep_mode = fenceResp->m.xHeader.bKeepMode;
+			pasture_temp->m.has_keep_mode = true;
+			pasture_temp->m.keep_mode = fenceResp->m.xHeader.bKeepMode;
 
 			/* Write to ext flash storage. */
 			err = stg_config_u8_write(STG_U8_KEEP_MODE,
@@ -2159,29 +2179,33 @@ uint8_t process_fence_msg(FenceDefinitionResponse *fenceResp)
 		}
 
 		if (fenceResp->has_usFenceCRC) {
-			pasture_temp.m.has_us_pasture_crc = true;
-			pasture_temp.m.us_pasture_crc = fenceResp->usFenceCRC;
+			pasture_temp->m.has_us_pasture_crc = true;
+			pasture_temp->m.us_pasture_crc = fenceResp->usFenceCRC;
 		}
-		pasture_temp.m.l_origin_lat = fenceResp->m.xHeader.lOriginLat;
-		pasture_temp.m.l_origin_lon = fenceResp->m.xHeader.lOriginLon;
-		pasture_temp.m.us_k_lat = fenceResp->m.xHeader.usK_LAT;
-		pasture_temp.m.us_k_lon = fenceResp->m.xHeader.usK_LON;
-		pasture_temp.m.ul_fence_def_version = fenceResp->ulFenceDefVersion;
-		pasture_temp.m.ul_total_fences = fenceResp->m.xHeader.ulTotalFences;
+		pasture_temp->m.l_origin_lat = fenceResp->m.xHeader.lOriginLat;
+		pasture_temp->m.l_origin_lon = fenceResp->m.xHeader.lOriginLon;
+		pasture_temp->m.us_k_lat = fenceResp->m.xHeader.usK_LAT;
+		pasture_temp->m.us_k_lon = fenceResp->m.xHeader.usK_LON;
+		pasture_temp->m.ul_fence_def_version = fenceResp->ulFenceDefVersion;
+		pasture_temp->m.ul_total_fences = fenceResp->m.xHeader.ulTotalFences;
 
 	} else if (FenceDefinitionResponse_xFence_tag) {
-		/* Fence frame info to store into pasture's fence array. */
-		fence_t *loc = &pasture_temp.fences[cached_fences_counter];
-
 		/* Fence header. */
-		loc->m.n_points = fenceResp->m.xFence.rgulPoints_count;
-		loc->m.us_id = fenceResp->m.xFence.usId;
-		loc->m.e_fence_type = fenceResp->m.xFence.eFenceType;
-		loc->m.fence_no = fenceResp->m.xFence.fenceNo;
+		fence_t fence = { .m = { .n_points = fenceResp->m.xFence.rgulPoints_count,
+					 .us_id = fenceResp->m.xFence.usId,
+					 .e_fence_type = fenceResp->m.xFence.eFenceType,
+					 .fence_no = fenceResp->m.xFence.fenceNo } };
+
+		/* Append the fence coordinates to the pasture's coordinate pool. */
+		err = pasture_add_fence(pasture_temp, sizeof(pasture_temp_buf),
+					cached_fences_counter, &fence,
+					(const fence_coordinate_t *)fenceResp->m.xFence.rgulPoints);
+		if (err) {
+			LOG_ERR("Could not cache fence frame %i. (%d)", frame, err);
+			nf_app_error(ERR_MESSAGING, err, NULL, 0);
 
-		/* Fence coordinates. */
-		memcpy(loc->coordinates, fenceResp->m.xFence.rgulPoints,
-		       loc->m.n_points * sizeof(fence_coordinate_t));
+			return 0;
+		}
 
 		/* Increment number of fences stored in pasture. */
 		cached_fences_counter++;
@@ -2190,18 +2214,18 @@ uint8_t process_fence_msg(FenceDefinitionResponse *fenceResp)
 	LOG_INF("Cached fence frame %i successfully.", frame);
 	if (frame == fenceResp->ucTotalFrames - 1) {
 		/* Validate pasture. */
-		if (cached_fences_counter != pasture_temp.m.ul_total_fences) {
+		if (cached_fences_counter != pasture_temp->m.ul_total_fences) {
 			LOG_ERR("Cached %i frames, but expected %i.", cached_fences_counter,
-				pasture_temp.m.ul_total_fences);
+				pasture_temp->m.ul_total_fences);
 			nf_app_error(ERR_MESSAGING, -EIO, NULL, 0);
 
 			return 0;
 		}
 
-		if (pasture_temp.m.ul_total_fences == 0) {
+		if (pasture_temp->m.ul_total_fences == 0) {
 			/* No pasture*/
-			err = stg_write_pasture_data((uint8_t *)&pasture_temp,
-						     sizeof(pasture_temp));
+			err = stg_write_pasture_data((uint8_t *)pasture_temp,
+						     pasture_size(pasture_temp));
 			if (err) {
 				return err;
 			}
@@ -2215,7 +2239,7 @@ uint8_t process_fence_msg(FenceDefinitionResponse *fenceResp)
 		}
 
 		LOG_INF("Validated CRC for pasture and will write it to flash.");
-		err = stg_write_pasture_data((uint8_t *)&pasture_temp, sizeof(pasture_temp));
+		err = stg_write_pasture_data((uint8_t *)pasture_temp, pasture_size(pasture_temp));
 		if (err) {
 			return err;
 		}
@@ -2241,7 +2265,7 @@ uint8_t process_ano_msg(UbxAnoReply *anoResp)
 						   temp->mga_ano.day);
 
 	/* Write to storage controller's ANO WRITE partition. */
-	int err = stg_write_ano_data((uint8_t *)&anoResp->rgucBuf, anoResp->rgucBuf.size);
+	int err = stg_write_ano_data(anoResp->rgucBuf.bytes, anoResp->rgucBuf.size);
 
 	if (err) {
 		LOG_ERR("Error writing ano frame to storage controller (%d)", err);
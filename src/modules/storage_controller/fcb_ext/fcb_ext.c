@@ -12,7 +12,8 @@
 #include "UBX.h"
 
 int fcb_walk_from_entry(fcb_read_cb cb, struct fcb *fcb, struct fcb_entry *start_entry,
-			uint16_t num_entries, struct k_mutex *flash_mutex)
+			uint16_t num_entries, struct k_mutex *flash_mutex, uint8_t *buf,
+			size_t buf_size)
 {
 	int err = 0;
 	int read_entry_counter = 0;
@@ -39,20 +40,20 @@ int fcb_walk_from_entry(fcb_read_cb cb, struct fcb *fcb, struct fcb_entry *start
 			return -ENODATA;
 		}
 
-		uint8_t *data = k_malloc(target_entry.fe_data_len);
+		if (target_entry.fe_data_len > buf_size) {
+			return -ENOMEM;
+		}
 
-		err = flash_area_read(fcb->fap, FCB_ENTRY_FA_DATA_OFF(target_entry), data,
+		err = flash_area_read(fcb->fap, FCB_ENTRY_FA_DATA_OFF(target_entry), buf,
 				      target_entry.fe_data_len);
 
 		if (err) {
-			k_free(data);
 			return err;
 		}
 		if (flash_mutex != NULL)
 			k_mutex_unlock(flash_mutex); //shouldn't wait for the
 		// callback to return
-		err = cb(data, target_entry.fe_data_len);
-		k_free(data);
+		err = cb(buf, target_entry.fe_data_len);
 
 		if (err) {
 			/* Used if caller wants to abort walk process. I.e -EINTR. */
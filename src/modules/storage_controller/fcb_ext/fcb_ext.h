@@ -37,11 +37,16 @@ typedef int (*fcb_read_cb)(uint8_t *data, size_t len);
  *                    all entries. The function will exit regardless once all
  *                    entries are consumed if this number 
  *                    is higher than entries that exists.
+ * @param[in] flash_mutex mutex of the partition, unlocked before the callback.
+ * @param[in] buf buffer that every entry is read into before the callback.
+ * @param[in] buf_size size of buf, which must hold the largest entry.
  * 
  * @return 0 on success, otherwise negative errno.
  * @return -EINTR if caller aborted walk process.
+ * @return -ENOMEM if an entry is larger than buf.
  */
 int fcb_walk_from_entry(fcb_read_cb cb, struct fcb *fcb, struct fcb_entry *start_entry,
-			uint16_t num_entries, struct k_mutex *flash_mutex);
+			uint16_t num_entries, struct k_mutex *flash_mutex, uint8_t *buf,
+			size_t buf_size);
 
 #endif /* _FCB_EXT_H_ */
\ No newline at end of file
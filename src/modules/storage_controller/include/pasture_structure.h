@@ -6,6 +6,7 @@
 #define _PASTURE_DEF_H_
 
 #include <zephyr.h>
+#include <string.h>
 #include "embedded.pb.h"
 
 #define FENCE_MAX 10
@@ -13,6 +14,12 @@
 /** From embedded.pb.h rgulPoints_count */
 #define FENCE_MAX_TOTAL_COORDINATES 40
 
+/** Coordinates shared by all fences in a pasture. */
+#define PASTURE_MAX_COORDINATES (FENCE_MAX * FENCE_MAX_TOTAL_COORDINATES)
+
+/** Marks a packed pasture, to tell it apart from the fixed size layout. */
+#define PASTURE_FORMAT_PACKED 0x5041
+
 typedef struct {
 	/** Relative coordinates of fence pole 
          *  in DECIMETERS from global origin.
@@ -26,49 +33,197 @@ typedef struct {
 } fence_coordinate_t;
 
 typedef struct {
-	struct {
-		/** Fence ID. */
-		uint16_t us_id;
+	/** Fence ID. */
+	uint16_t us_id;
 
-		/** Number of coordinates in polygon. */
-		uint8_t n_points;
+	/** Number of coordinates in polygon. */
+	uint8_t n_points;
 
-		/** Fence type. */
-		uint8_t e_fence_type;
+	/** Fence type. */
+	uint8_t e_fence_type;
 
-		/** Fence number. */
-		uint32_t fence_no;
-	} m;
+	/** Fence number. */
+	uint32_t fence_no;
+} fence_header_t;
 
-	fence_coordinate_t coordinates[FENCE_MAX_TOTAL_COORDINATES];
-} fence_t;
+typedef struct {
+	fence_header_t m;
 
-#define MAX_FENCE_DEFINITION_SIZE                                                                  \
-	sizeof(fence_t) + sizeof(fence_coordinate_t) * FENCE_MAX_TOTAL_COORDINATES
+	/** Index of the first coordinate of the fence in the coordinate pool. */
+	uint16_t first_coordinate;
+} fence_t;
 
 typedef struct {
-	struct {
-		uint32_t ul_fence_def_version;
+	uint32_t ul_fence_def_version;
 
-		bool has_us_pasture_crc;
-		uint16_t us_pasture_crc;
+	bool has_us_pasture_crc;
+	uint16_t us_pasture_crc;
 
-		bool has_keep_mode;
-		bool keep_mode;
+	bool has_keep_mode;
+	bool keep_mode;
 
-		int32_t l_origin_lat;
-		int32_t l_origin_lon;
+	int32_t l_origin_lat;
+	int32_t l_origin_lon;
 
-		uint32_t ul_total_fences;
+	uint32_t ul_total_fences;
 
-		uint16_t us_k_lat;
-		uint16_t us_k_lon;
+	uint16_t us_k_lat;
+	uint16_t us_k_lon;
 
-		/* WIP, need to set status somewhere. */
-		FenceStatus status;
-	} m;
+	/* WIP, need to set status somewhere. */
+	FenceStatus status;
+} pasture_header_t;
 
-	fence_t fences[FENCE_MAX];
+/** Packed pasture, used for the download, the flash records and the AMC
+ *  cache. The header is followed by a table of ul_total_fences fences,
+ *  and then by the coordinate pool holding the coordinates of all fences.
+ *  Use PASTURE_SIZE or pasture_size for the size in bytes.
+ */
+typedef struct {
+	pasture_header_t m;
+
+	/** Always PASTURE_FORMAT_PACKED. */
+	uint16_t format;
+
+	/** Number of coordinates in the coordinate pool. */
+	uint16_t n_coordinates;
+
+	fence_t fences[];
 } pasture_t;
 
-#endif /* _PASTURE_DEF_H_ */
\ No newline at end of file
+#define PASTURE_SIZE(n_fences, n_coordinates)                                                      \
+	(sizeof(pasture_t) + (n_fences) * sizeof(fence_t) +                                        \
+	 (n_coordinates) * sizeof(fence_coordinate_t))
+
+/** Size of a buffer that can hold any pasture. */
+#define PASTURE_MAX_SIZE PASTURE_SIZE(FENCE_MAX, PASTURE_MAX_COORDINATES)
+
+/** Fixed size pasture written to flash by earlier firmware, where every
+ *  fence reserves FENCE_MAX_TOTAL_COORDINATES coordinates.
+ */
+typedef struct {
+	fence_header_t m;
+
+	fence_coordinate_t coordinates[FENCE_MAX_TOTAL_COORDINATES];
+} fence_legacy_t;
+
+typedef struct {
+	pasture_header_t m;
+
+	fence_legacy_t fences[FENCE_MAX];
+} pasture_legacy_t;
+
+/** @brief Size in bytes of a packed pasture. */
+static inline size_t pasture_size(const pasture_t *pasture)
+{
+	return PASTURE_SIZE(pasture->m.ul_total_fences, pasture->n_coordinates);
+}
+
+/** @brief Gets the coordinates of a fence in a packed pasture. */
+static inline fence_coordinate_t *pasture_fence_coordinates(const pasture_t *pasture,
+							    const fence_t *fence)
+{
+	fence_coordinate_t *pool =
+		(fence_coordinate_t *)&pasture->fences[pasture->m.ul_total_fences];
+	return &pool[fence->first_coordinate];
+}
+
+/** @brief Starts an empty packed pasture with a table of n_fences fences.
+ *         The fences are added with pasture_add_fence.
+ *
+ * @return 0 on success, -ENOMEM if the fence table does not fit in size.
+ */
+static inline int pasture_init(pasture_t *pasture, size_t size, uint32_t n_fences)
+{
+	if (n_fences > FENCE_MAX || PASTURE_SIZE(n_fences, 0) > size) {
+		return -ENOMEM;
+	}
+	memset(pasture, 0, PASTURE_SIZE(n_fences, 0));
+	pasture->m.ul_total_fences = n_fences;
+	pasture->format = PASTURE_FORMAT_PACKED;
+	return 0;
+}
+
+/** @brief Appends the coordinates of a fence to the coordinate pool and
+ *         sets its entry in the fence table.
+ *
+ * @param[in,out] pasture packed pasture, with ul_total_fences set.
+ * @param[in] size size in bytes of the buffer holding the pasture.
+ * @param[in] index index of the fence in the fence table.
+ * @param[in] fence fence header, first_coordinate is ignored.
+ * @param[in] coordinates fence->m.n_points coordinates of the fence.
+ *
+ * @return 0 on success, -EINVAL for an invalid index or number of points,
+ *         -ENOMEM if the coordinates do not fit in size.
+ */
+static inline int pasture_add_fence(pasture_t *pasture, size_t size, uint8_t index,
+				    const fence_t *fence, const fence_coordinate_t *coordinates)
+{
+	uint8_t n_points = fence->m.n_points;
+
+	if (index >= pasture->m.ul_total_fences || n_points > FENCE_MAX_TOTAL_COORDINATES) {
+		return -EINVAL;
+	}
+	if (pasture->n_coordinates + n_points > PASTURE_MAX_COORDINATES ||
+	    PASTURE_SIZE(pasture->m.ul_total_fences, pasture->n_coordinates + n_points) > size) {
+		return -ENOMEM;
+	}
+
+	fence_t *dst = &pasture->fences[index];
+	dst->m = fence->m;
+	dst->first_coordinate = pasture->n_coordinates;
+	memcpy(pasture_fence_coordinates(pasture, dst), coordinates,
+	       n_points * sizeof(fence_coordinate_t));
+	pasture->n_coordinates += n_points;
+	return 0;
+}
+
+/** @brief Checks that len bytes hold a complete packed pasture, with all
+ *         fences inside the coordinate pool.
+ */
+static inline bool pasture_layout_valid(const uint8_t *data, size_t len)
+{
+	const pasture_t *pasture = (const pasture_t *)data;
+
+	if (len < sizeof(pasture_t) || pasture->format != PASTURE_FORMAT_PACKED ||
+	    pasture->m.ul_total_fences > FENCE_MAX ||
+	    pasture->n_coordinates > PASTURE_MAX_COORDINATES || len != pasture_size(pasture)) {
+		return false;
+	}
+	for (uint8_t i = 0; i < pasture->m.ul_total_fences; i++) {
+		const fence_t *fence = &pasture->fences[i];
+		if (fence->m.n_points > FENCE_MAX_TOTAL_COORDINATES ||
+		    fence->first_coordinate + fence->m.n_points > pasture->n_coordinates) {
+			return false;
+		}
+	}
+	return true;
+}
+
+/** @brief Converts a pasture in the fixed size layout of earlier firmware
+ *         to a packed pasture.
+ *
+ * @return 0 on success, negative errno from pasture_init or
+ *         pasture_add_fence otherwise.
+ */
+static inline int pasture_from_legacy(pasture_t *pasture, size_t size,
+				      const pasture_legacy_t *legacy)
+{
+	int err = pasture_init(pasture, size, legacy->m.ul_total_fences);
+	if (err) {
+		return err;
+	}
+	pasture->m = legacy->m;
+
+	for (uint8_t i = 0; i < legacy->m.ul_total_fences; i++) {
+		fence_t fence = { .m = legacy->fences[i].m };
+
+		err = pasture_add_fence(pasture, size, i, &fence, legacy->fences[i].coordinates);
+		if (err) {
+			return err;
+		}
+	}
+	return 0;
+}
+
+#endif /* _PASTURE_DEF_H_ */
@@ -45,6 +45,42 @@ static struct flash_sector log_sectors[FLASH_LOG_NUM_SECTORS];
 static struct fcb_entry active_log_entry = { .fe_sector = NULL, .fe_elem_off = 0 };
 K_MUTEX_DEFINE(log_mutex);
 
+#if CONFIG_STORAGE_LOG_COALESCE
+/* Starts a log entry holding several records, each behind a
+ * stg_log_record_hdr and padded to a multiple of 4 bytes. Records stored
+ * by messaging start with their length, which never matches.
+ */
+#define STG_LOG_BATCH_MAGIC 0xB47C8A7CU
+BUILD_ASSERT((STG_LOG_BATCH_MAGIC & 0xFFFF) > NofenceMessage_size);
+BUILD_ASSERT(CONFIG_STORAGE_LOG_COALESCE_SIZE % 4 == 0);
+#define STG_LOG_BATCH_SIZE CONFIG_STORAGE_LOG_COALESCE_SIZE
+
+struct stg_log_record_hdr {
+	uint16_t len;
+	uint16_t reserved;
+};
+
+/* Log records not yet written to flash, guarded by log_mutex. */
+static uint32_t log_batch[STG_LOG_BATCH_SIZE / sizeof(uint32_t)] = { STG_LOG_BATCH_MAGIC };
+static size_t log_batch_len = sizeof(uint32_t);
+static struct k_work_delayable log_flush_work;
+
+/* Callback of the log read in progress, the entries fully passed to it,
+ * and the records passed to it from the entry being read.
+ */
+static fcb_read_cb log_read_cb;
+static uint16_t log_read_entries;
+static uint16_t log_read_sent;
+
+/* Entry the last log read was aborted in, and the records of it already
+ * passed, which are skipped when the entry is read again.
+ */
+static struct fcb_entry log_resume_entry = { .fe_sector = NULL, .fe_elem_off = 0 };
+static uint16_t log_resume_sent;
+#else
+#define STG_LOG_BATCH_SIZE 0
+#endif
+
 /* System diagnostic partition. */
 static struct fcb_entry active_system_diag_entry = { .fe_sector = NULL, .fe_elem_off = 0 };
 static const struct flash_area *system_diag_area;
@@ -67,6 +103,61 @@ static struct fcb pasture_fcb;
 static struct flash_sector pasture_sectors[FLASH_PASTURE_NUM_SECTORS];
 K_MUTEX_DEFINE(pasture_mutex);
 
+/* GNSS partition. */
+static const struct flash_area *gnss_area;
+static struct fcb gnss_fcb;
+static struct flash_sector gnss_sectors[FLASH_GNSS_NUM_SECTORS];
+K_MUTEX_DEFINE(gnss_mutex);
+
+/** Entries stored in one sector of a partition. */
+struct stg_sector_usage {
+	uint16_t entries;
+	uint32_t bytes;
+};
+
+/** Entries stored in a partition, recovered when the partition is mounted
+ *  and then kept up to date on append, rotate and clear.
+ */
+struct stg_partition_usage {
+	struct stg_sector_usage *sectors;
+	uint32_t entries;
+	uint32_t bytes;
+};
+
+static struct stg_sector_usage log_usage_sectors[FLASH_LOG_NUM_SECTORS];
+static struct stg_sector_usage ano_usage_sectors[FLASH_ANO_NUM_SECTORS];
+static struct stg_sector_usage pasture_usage_sectors[FLASH_PASTURE_NUM_SECTORS];
+static struct stg_sector_usage system_diag_usage_sectors[FLASH_SYSTEM_DIAG_NUM_SECTORS];
+static struct stg_sector_usage gnss_usage_sectors[FLASH_GNSS_NUM_SECTORS];
+
+static struct stg_partition_usage log_usage = { .sectors = log_usage_sectors };
+static struct stg_partition_usage ano_usage = { .sectors = ano_usage_sectors };
+static struct stg_partition_usage pasture_usage = { .sectors = pasture_usage_sectors };
+static struct stg_partition_usage system_diag_usage = { .sectors = system_diag_usage_sectors };
+static struct stg_partition_usage gnss_usage = { .sectors = gnss_usage_sectors };
+
+/* Largest entry of the log, ANO and system diagnostic partitions. */
+#define STG_WALK_LOG_SIZE MAX(MAX(sizeof(log_rec_t), NofenceMessage_size), STG_LOG_BATCH_SIZE)
+#define STG_WALK_ANO_SIZE sizeof(((UbxAnoReply *)0)->rgucBuf.bytes)
+#define STG_WALK_DATA_SIZE MAX(STG_WALK_ANO_SIZE, sizeof(system_diagnostic_t))
+#define STG_WALK_BUF_SIZE ROUND_UP(MAX(STG_WALK_LOG_SIZE, STG_WALK_DATA_SIZE), 4)
+
+/* Buffers for reading the entries of the log, ANO and system diagnostic
+ * partitions, one for each read that may be in progress. The partition
+ * mutex is released while the entries are handled by the callback, so a
+ * buffer is taken for the whole read instead of sharing one per partition.
+ */
+K_MEM_SLAB_DEFINE(walk_slab, STG_WALK_BUF_SIZE, CONFIG_STORAGE_WALK_BUFFERS, 4);
+
+/* Chunk of an unaligned entry copied to the stack for every flash write. */
+#define STG_WRITE_CHUNK_SIZE 64
+
+/* Largest pasture, also in the layout of earlier firmware. Only used with
+ * pasture_mutex held.
+ */
+static uint8_t pasture_buf[ROUND_UP(MAX(PASTURE_MAX_SIZE, sizeof(pasture_legacy_t)), 4)]
+	__aligned(4);
+
 K_KERNEL_STACK_DEFINE(erase_flash_thread, CONFIG_STORAGE_THREAD_SIZE);
 
 static void erase_flash_fn(struct k_work *item);
@@ -92,11 +183,23 @@ void erase_flash_fn(struct k_work *item)
 	if (err) {
 		return;
 	}
+	err = stg_clear_partition(STG_PARTITION_GNSS);
+	if (err) {
+		return;
+	}
 
 	struct update_flash_erase *ev = new_update_flash_erase();
 	EVENT_SUBMIT(ev);
 }
 
+#if CONFIG_STORAGE_LOG_COALESCE
+static void log_flush_work_fn(struct k_work *item)
+{
+	ARG_UNUSED(item);
+	(void)stg_flush_log_data();
+}
+#endif
+
 /** @brief Gets fcb structure based on partition.
  * 
  * @param partition which partition to get fcb from
@@ -115,6 +218,8 @@ struct fcb *get_fcb(flash_partition_t partition)
 		fcb = &pasture_fcb;
 	} else if (partition == STG_PARTITION_SYSTEM_DIAG) {
 		fcb = &system_diag_fcb;
+	} else if (partition == STG_PARTITION_GNSS) {
+		fcb = &gnss_fcb;
 	} else {
 		LOG_ERR("Invalid partition given.");
 		return NULL;
@@ -138,11 +243,101 @@ struct k_mutex *get_mutex(flash_partition_t partition)
 		return &pasture_mutex;
 	} else if (partition == STG_PARTITION_SYSTEM_DIAG) {
 		return &system_diag_mutex;
+	} else if (partition == STG_PARTITION_GNSS) {
+		return &gnss_mutex;
 	}
 	LOG_ERR("Invalid partition given.");
 	return NULL;
 }
 
+/** @brief Gets the entry accounting of a partition.
+ * 
+ * @param partition which partition to get the accounting from
+ * 
+ * @return pointer to the accounting of the partition
+ */
+static struct stg_partition_usage *get_usage(flash_partition_t partition)
+{
+	if (partition == STG_PARTITION_LOG) {
+		return &log_usage;
+	} else if (partition == STG_PARTITION_ANO) {
+		return &ano_usage;
+	} else if (partition == STG_PARTITION_PASTURE) {
+		return &pasture_usage;
+	} else if (partition == STG_PARTITION_SYSTEM_DIAG) {
+		return &system_diag_usage;
+	} else if (partition == STG_PARTITION_GNSS) {
+		return &gnss_usage;
+	}
+	LOG_ERR("Invalid partition given.");
+	return NULL;
+}
+
+/** @brief Resets the entry accounting of a partition, after it is cleared.
+ */
+static void usage_reset(flash_partition_t partition)
+{
+	struct stg_partition_usage *usage = get_usage(partition);
+	struct fcb *fcb = get_fcb(partition);
+
+	memset(usage->sectors, 0, fcb->f_sector_cnt * sizeof(usage->sectors[0]));
+	usage->entries = 0;
+	usage->bytes = 0;
+}
+
+/** @brief Accounts for a new entry of len bytes, in the sector of entry.
+ */
+static void usage_add(flash_partition_t partition, struct fcb_entry *entry, size_t len)
+{
+	struct stg_partition_usage *usage = get_usage(partition);
+	struct fcb *fcb = get_fcb(partition);
+	struct stg_sector_usage *sector = &usage->sectors[entry->fe_sector - fcb->f_sectors];
+
+	sector->entries++;
+	sector->bytes += len;
+	usage->entries++;
+	usage->bytes += len;
+}
+
+/** @brief Drops the entries of a sector erased by fcb_rotate.
+ */
+static void usage_drop_sector(flash_partition_t partition, struct flash_sector *erased)
+{
+	struct stg_partition_usage *usage = get_usage(partition);
+	struct fcb *fcb = get_fcb(partition);
+	struct stg_sector_usage *sector = &usage->sectors[erased - fcb->f_sectors];
+
+	usage->entries -= sector->entries;
+	usage->bytes -= sector->bytes;
+	sector->entries = 0;
+	sector->bytes = 0;
+}
+
+/** @brief Recovers the entry accounting of a partition by walking all of
+ *         its entries once, when the partition is mounted.
+ */
+static void usage_recover(flash_partition_t partition)
+{
+	struct fcb *fcb = get_fcb(partition);
+	struct fcb_entry entry = { .fe_sector = NULL, .fe_elem_off = 0 };
+
+	usage_reset(partition);
+	while (fcb_getnext(fcb, &entry) == 0) {
+		usage_add(partition, &entry, entry.fe_data_len);
+	}
+}
+
+/** @brief Clears the partition and its entry accounting. The partition
+ *         mutex must be held.
+ */
+static int clear_fcb(flash_partition_t partition)
+{
+	int err = fcb_clear(get_fcb(partition));
+
+	usage_reset(partition);
+	return err;
+}
+
 static inline int init_fcb_on_partition(flash_partition_t partition)
 {
 	int err;
@@ -174,6 +369,11 @@ static inline int init_fcb_on_partition(flash_partition_t partition)
 		area_id = FLASH_AREA_ID(system_diagnostic);
 		area = system_diag_area;
 		sector_ptr = system_diag_sectors;
+	} else if (partition == STG_PARTITION_GNSS) {
+		sector_cnt = FLASH_GNSS_NUM_SECTORS;
+		area_id = FLASH_AREA_ID(gnss_partition);
+		area = gnss_area;
+		sector_ptr = gnss_sectors;
 	} else {
 		LOG_ERR("Invalid partition given. %d", -EINVAL);
 		return -EINVAL;
@@ -231,8 +431,10 @@ static inline int init_fcb_on_partition(flash_partition_t partition)
 		return err;
 	}
 
-	LOG_INF("Setup FCB for partition %d: %d sectors with sizes %db.", partition,
-		fcb->f_sector_cnt, fcb->f_sectors[0].fs_size);
+	usage_recover(partition);
+
+	LOG_INF("Setup FCB for partition %d: %d sectors with sizes %db, %d entries.", partition,
+		fcb->f_sector_cnt, fcb->f_sectors[0].fs_size, get_usage(partition)->entries);
 
 	return err;
 }
@@ -246,6 +448,7 @@ int stg_init_storage_controller(void)
 	k_mutex_unlock(&ano_mutex);
 	k_mutex_unlock(&pasture_mutex);
 	k_mutex_unlock(&system_diag_mutex);
+	k_mutex_unlock(&gnss_mutex);
 
 	/* Initialize FCB on LOG and ANO partitions
 	 * based on pm_static.yml/.dts flash setup.
@@ -270,6 +473,11 @@ int stg_init_storage_controller(void)
 		return err;
 	}
 
+	err = init_fcb_on_partition(STG_PARTITION_GNSS);
+	if (err) {
+		return err;
+	}
+
 	/* Setup work threads. */
 	if (!queue_inited) {
 		k_work_queue_init(&erase_q);
@@ -277,6 +485,9 @@ int stg_init_storage_controller(void)
 				   K_THREAD_STACK_SIZEOF(erase_flash_thread),
 				   CONFIG_STORAGE_THREAD_PRIORITY, NULL);
 		k_work_init(&erase_work, erase_flash_fn);
+#if CONFIG_STORAGE_LOG_COALESCE
+		k_work_init_delayable(&log_flush_work, log_flush_work_fn);
+#endif
 		queue_inited = true;
 	}
 
@@ -288,6 +499,26 @@ int stg_init_storage_controller(void)
 	return 0;
 }
 
+/** @brief Reads entries from start_entry with fcb_walk_from_entry, into a
+ *         buffer from walk_slab.
+ */
+static int stg_walk(fcb_read_cb cb, struct fcb *fcb, struct fcb_entry *start_entry,
+		    uint16_t num_entries, struct k_mutex *flash_mutex)
+{
+	void *buf;
+
+	if (k_mem_slab_alloc(&walk_slab, &buf, K_MSEC(CONFIG_MUTEX_READ_WRITE_TIMEOUT))) {
+		LOG_ERR("No read buffer available.");
+		return -ENOMEM;
+	}
+
+	int err = fcb_walk_from_entry(cb, fcb, start_entry, num_entries, flash_mutex, buf,
+				      STG_WALK_BUF_SIZE);
+
+	k_mem_slab_free(&walk_slab, &buf);
+	return err;
+}
+
 int stg_write_to_partition(flash_partition_t partition, uint8_t *data, size_t len)
 {
 	struct fcb_entry loc;
@@ -301,38 +532,63 @@ int stg_write_to_partition(flash_partition_t partition, uint8_t *data, size_t le
 		padding = 4 - multiple;
 	}
 	size_t new_len = len + padding;
-	uint8_t *new_data = k_malloc(new_len);
-	memset(new_data, 0xFF, new_len);
-	memcpy(new_data, data, len);
 
 	/* Appending a new entry, rotate(replaces) oldest if no space. */
 	err = fcb_append(fcb, new_len, &loc);
 	if (err == -ENOSPC) {
+		struct flash_sector *oldest = fcb->f_oldest;
+
 		err = fcb_rotate(fcb);
 		if (err) {
 			LOG_ERR("Unable to rotate fcb from -ENOSPC, err %d", err);
-			k_free(new_data);
 			return err;
 		}
+		usage_drop_sector(partition, oldest);
 		/* Retry appending. */
 		err = fcb_append(fcb, new_len, &loc);
 		if (err) {
 			LOG_ERR("Unable to recover in appending function, err %d", err);
 			nf_app_error(ERR_STORAGE_CONTROLLER, -ENOTRECOVERABLE, NULL, 0);
-			k_free(new_data);
 			return err;
 		}
 		LOG_INF("Rotated FCB since it's full.");
 	} else if (err) {
 		LOG_ERR("Error appending new fcb entry, err %d", err);
-		k_free(new_data);
 		return err;
 	}
 
-	err = flash_area_write(fcb->fap, FCB_ENTRY_FA_DATA_OFF(loc), new_data, new_len);
+	/* The QSPI flash driver only writes from word aligned buffers, so
+	 * unaligned data is copied to the stack in chunks. The last partial
+	 * word is padded with 0xFF.
+	 */
+	size_t aligned_len = len - multiple;
+
+	if (((uintptr_t)data % 4) == 0) {
+		if (aligned_len > 0) {
+			err = flash_area_write(fcb->fap, FCB_ENTRY_FA_DATA_OFF(loc), data,
+					       aligned_len);
+		}
+	} else {
+		uint32_t chunk[STG_WRITE_CHUNK_SIZE / sizeof(uint32_t)];
+
+		for (size_t off = 0; err == 0 && off < aligned_len; off += sizeof(chunk)) {
+			size_t chunk_len = MIN(sizeof(chunk), aligned_len - off);
+
+			memcpy(chunk, &data[off], chunk_len);
+			err = flash_area_write(fcb->fap, FCB_ENTRY_FA_DATA_OFF(loc) + off, chunk,
+					       chunk_len);
+		}
+	}
+	if (err == 0 && padding > 0) {
+		uint32_t tail;
+
+		memset(&tail, 0xFF, sizeof(tail));
+		memcpy(&tail, &data[aligned_len], multiple);
+		err = flash_area_write(fcb->fap, FCB_ENTRY_FA_DATA_OFF(loc) + aligned_len, &tail,
+				       sizeof(tail));
+	}
 	if (err) {
 		LOG_ERR("Error writing to flash area. err %d", err);
-		k_free(new_data);
 		return err;
 	}
 
@@ -340,9 +596,11 @@ int stg_write_to_partition(flash_partition_t partition, uint8_t *data, size_t le
 	err = fcb_append_finish(fcb, &loc);
 	if (err) {
 		LOG_ERR("Error finishing new entry. err %d", err);
+		return err;
 	}
-	k_free(new_data);
-	return err;
+
+	usage_add(partition, &loc, new_len);
+	return 0;
 }
 
 int stg_clear_partition(flash_partition_t partition)
@@ -368,22 +626,189 @@ int stg_clear_partition(flash_partition_t partition)
 	} else if (partition == STG_PARTITION_LOG) {
 		active_log_entry.fe_sector = NULL;
 		active_log_entry.fe_elem_off = 0;
+#if CONFIG_STORAGE_LOG_COALESCE
+		log_resume_entry.fe_sector = NULL;
+#endif
 	} else if (partition == STG_PARTITION_SYSTEM_DIAG) {
 		active_system_diag_entry.fe_sector = NULL;
 		active_system_diag_entry.fe_elem_off = 0;
 	}
 
-	struct fcb *fcb = get_fcb(partition);
-	int err = fcb_clear(fcb);
+	int err = clear_fcb(partition);
 
 	k_mutex_unlock(mtx);
 	return err;
 }
 
+#if CONFIG_STORAGE_LOG_COALESCE
+/** @brief Writes the staged log records as one entry. log_mutex must be held.
+ */
+static int log_batch_flush(void)
+{
+	if (log_batch_len == sizeof(uint32_t)) {
+		return 0;
+	}
+
+	/* The records stay staged if the write fails, to be retried. */
+	int err = stg_write_to_partition(STG_PARTITION_LOG, (uint8_t *)log_batch, log_batch_len);
+	if (err) {
+		LOG_ERR("Error writing staged log records, err %d", err);
+		return err;
+	}
+
+	log_batch_len = sizeof(uint32_t);
+	k_work_cancel_delayable(&log_flush_work);
+	return 0;
+}
+
+/** @brief Stages a log record, writing the staged records first if it does
+ *         not fit. log_mutex must be held.
+ */
+static int log_batch_add(uint8_t *data, size_t len)
+{
+	struct stg_log_record_hdr hdr = { .len = len, .reserved = 0xFFFF };
+	size_t size = sizeof(hdr) + ROUND_UP(len, 4);
+	int err;
+
+	if (size > sizeof(log_batch) - sizeof(uint32_t)) {
+		/* Too large to be staged, written as an entry of its own. */
+		err = log_batch_flush();
+		if (err) {
+			return err;
+		}
+		return stg_write_to_partition(STG_PARTITION_LOG, data, len);
+	}
+
+	if (log_batch_len + size > sizeof(log_batch)) {
+		err = log_batch_flush();
+		if (err) {
+			return err;
+		}
+	}
+
+	uint8_t *record = (uint8_t *)log_batch + log_batch_len;
+
+	memcpy(record, &hdr, sizeof(hdr));
+	memcpy(&record[sizeof(hdr)], data, len);
+	memset(&record[sizeof(hdr) + len], 0xFF, size - sizeof(hdr) - len);
+
+	if (log_batch_len == sizeof(uint32_t)) {
+		k_work_schedule_for_queue(&erase_q, &log_flush_work,
+					  K_SECONDS(CONFIG_STORAGE_LOG_COALESCE_MAX_AGE_SEC));
+	}
+	log_batch_len += size;
+	return 0;
+}
+
+/** @brief Passes the records of a log entry to log_read_cb one at a time,
+ *         skipping the first skip records.
+ */
+static int log_batch_read_cb(uint8_t *data, size_t len, uint16_t skip)
+{
+	uint32_t magic = 0;
+
+	log_read_sent = 0;
+	if (len >= sizeof(magic)) {
+		memcpy(&magic, data, sizeof(magic));
+	}
+	if (magic != STG_LOG_BATCH_MAGIC) {
+		/* Written before coalescing, or too large to be staged. */
+		return log_read_cb(data, len);
+	}
+
+	size_t offset = sizeof(magic);
+	struct stg_log_record_hdr hdr;
+
+	while (offset + sizeof(hdr) <= len) {
+		memcpy(&hdr, &data[offset], sizeof(hdr));
+		offset += sizeof(hdr);
+		if (hdr.len > len - offset) {
+			LOG_ERR("Invalid staged log record of %d bytes.", hdr.len);
+			return -EINVAL;
+		}
+
+		if (log_read_sent >= skip) {
+			int err = log_read_cb(&data[offset], hdr.len);
+			if (err) {
+				return err;
+			}
+		}
+		log_read_sent++;
+		offset += ROUND_UP(hdr.len, 4);
+	}
+	return 0;
+}
+
+/** @brief Walk callback of a log read, counting the entries fully passed.
+ *         Only the first entry of a read can have records to skip.
+ */
+static int log_read_entry_cb(uint8_t *data, size_t len)
+{
+	uint16_t skip = log_read_entries == 0 ? log_resume_sent : 0;
+	int err = log_batch_read_cb(data, len, skip);
+
+	if (err == 0) {
+		log_read_entries++;
+		log_read_sent = 0;
+	}
+	return err;
+}
+
+/** @brief Records where a log read was aborted, so that the next read
+ *         resumes after the last record passed instead of sending the
+ *         entries and records before it again.
+ *
+ * @param first_entry entry the read started from.
+ * @param last_entry last entry fully passed, as updated by the walk.
+ */
+static void log_read_aborted(struct fcb_entry *first_entry, struct fcb_entry *last_entry)
+{
+	if (log_read_entries > 0) {
+		memcpy(&active_log_entry, last_entry, sizeof(struct fcb_entry));
+		memcpy(&log_resume_entry, last_entry, sizeof(struct fcb_entry));
+		if (fcb_getnext(&log_fcb, &log_resume_entry)) {
+			log_resume_entry.fe_sector = NULL;
+		}
+	} else {
+		memcpy(&log_resume_entry, first_entry, sizeof(struct fcb_entry));
+	}
+	log_resume_sent = log_read_sent;
+}
+#endif
+
+int stg_flush_log_data(void)
+{
+#if CONFIG_STORAGE_LOG_COALESCE
+	if (k_mutex_lock(&log_mutex, K_MSEC(CONFIG_MUTEX_READ_WRITE_TIMEOUT))) {
+		return -ETIMEDOUT;
+	}
+
+	int err = log_batch_flush();
+
+	k_mutex_unlock(&log_mutex);
+	return err;
+#else
+	return 0;
+#endif
+}
+
+void stg_request_log_flush(void)
+{
+#if CONFIG_STORAGE_LOG_COALESCE
+	if (queue_inited) {
+		k_work_reschedule_for_queue(&erase_q, &log_flush_work, K_NO_WAIT);
+	}
+#endif
+}
+
 int stg_read_log_data(fcb_read_cb cb, uint16_t num_entries)
 {
 	k_mutex_lock(&log_mutex, K_NO_WAIT);
 	if (log_mutex.lock_count == 1) {
+#if CONFIG_STORAGE_LOG_COALESCE
+		/* Staged records are read too. */
+		(void)log_batch_flush();
+#endif
 		if (fcb_is_empty(&log_fcb)) {
 			k_mutex_unlock(&log_mutex);
 			return -ENODATA;
@@ -399,9 +824,28 @@ int stg_read_log_data(fcb_read_cb cb, uint16_t num_entries)
 			return -ENODATA;
 		}
 
-		err = fcb_walk_from_entry(cb, &log_fcb, &start_entry, num_entries, &log_mutex);
+#if CONFIG_STORAGE_LOG_COALESCE
+		/* Log reads are serialized by the caller, as for active_log_entry. */
+		struct fcb_entry first_entry;
+
+		memcpy(&first_entry, &start_entry, sizeof(struct fcb_entry));
+		if (log_resume_entry.fe_sector != start_entry.fe_sector ||
+		    log_resume_entry.fe_elem_off != start_entry.fe_elem_off) {
+			log_resume_sent = 0;
+		}
+		log_resume_entry.fe_sector = NULL;
+		log_read_cb = cb;
+		log_read_entries = 0;
+		log_read_sent = 0;
+		err = stg_walk(log_read_entry_cb, &log_fcb, &start_entry, num_entries, &log_mutex);
+#else
+		err = stg_walk(cb, &log_fcb, &start_entry, num_entries, &log_mutex);
+#endif
 		if (err != 0) {
 			LOG_ERR("Error reading from log partition.");
+#if CONFIG_STORAGE_LOG_COALESCE
+			log_read_aborted(&first_entry, &start_entry);
+#endif
 			k_mutex_unlock(&log_mutex);
 			return err;
 		}
@@ -496,7 +940,7 @@ static inline void update_ano_active_entry(struct fcb_entry *entry)
 		memcpy(&start_entry, entry, sizeof(struct fcb_entry));
 	}
 
-	int err = fcb_walk_from_entry(check_if_ano_valid_cb, &ano_fcb, &start_entry, 0, &ano_mutex);
+	int err = stg_walk(check_if_ano_valid_cb, &ano_fcb, &start_entry, 0, &ano_mutex);
 
 	if (err == -EINTR) {
 		/* Found valid boot partition, copy the entry header. */
@@ -539,7 +983,7 @@ int stg_read_ano_data(fcb_read_cb cb, bool last_valid_ano, uint16_t num_entries)
 		return -ENODATA;
 	}
 
-	err = fcb_walk_from_entry(cb, &ano_fcb, &start_entry, num_entries, &ano_mutex);
+	err = stg_walk(cb, &ano_fcb, &start_entry, num_entries, &ano_mutex);
 
 	if (err && err != -EINTR) {
 		k_mutex_unlock(&ano_mutex);
@@ -575,17 +1019,18 @@ int stg_read_pasture_data(fcb_read_cb cb)
 	}
 
 	size_t fence_size = entry.fe_data_len;
-	uint8_t *fence = k_malloc(fence_size);
+	if (fence_size > sizeof(pasture_buf)) {
+		k_mutex_unlock(&pasture_mutex);
+		return -ENOMEM;
+	}
 
-	err = flash_area_read(fcb->fap, FCB_ENTRY_FA_DATA_OFF(entry), fence, fence_size);
+	err = flash_area_read(fcb->fap, FCB_ENTRY_FA_DATA_OFF(entry), pasture_buf, fence_size);
 	if (err) {
-		k_free(fence);
 		k_mutex_unlock(&pasture_mutex);
 		return err;
 	}
 
-	err = cb(fence, fence_size);
-	k_free(fence);
+	err = cb(pasture_buf, fence_size);
 	k_mutex_unlock(&pasture_mutex);
 	return err;
 }
@@ -594,7 +1039,11 @@ int stg_write_log_data(uint8_t *data, size_t len)
 {
 	if (k_mutex_lock(&log_mutex, K_MSEC(CONFIG_MUTEX_READ_WRITE_TIMEOUT)) == 0 &&
 	    log_mutex.lock_count <= 1) {
+#if CONFIG_STORAGE_LOG_COALESCE
+		int err = log_batch_add(data, len);
+#else
 		int err = stg_write_to_partition(STG_PARTITION_LOG, data, len);
+#endif
 		if (err) {
 			LOG_ERR("Error writing to log partition.");
 		}
@@ -659,8 +1108,7 @@ int stg_read_system_diagnostic_log(fcb_read_cb cb, uint16_t num_entries)
 		return -ENODATA;
 	}
 
-	err = fcb_walk_from_entry(cb, &system_diag_fcb, &start_entry, num_entries,
-				  &system_diag_mutex);
+	err = stg_walk(cb, &system_diag_fcb, &start_entry, num_entries, &system_diag_mutex);
 	if (err && err != -EINTR) {
 		LOG_ERR("Error reading from system diagnostic partition.");
 	}
@@ -688,7 +1136,72 @@ int stg_write_system_diagnostic_log(uint8_t *data, size_t len)
 	return err;
 }
 
+int stg_read_gnss_data(uint8_t *buf, size_t size, size_t *len)
+{
+	if (k_mutex_lock(&gnss_mutex, K_MSEC(CONFIG_MUTEX_READ_WRITE_TIMEOUT))) {
+		return -ETIMEDOUT;
+	}
+
+	if (fcb_is_empty(&gnss_fcb)) {
+		k_mutex_unlock(&gnss_mutex);
+		return -ENODATA;
+	}
+
+	/* The partition only holds the entries of the latest state. */
+	struct fcb_entry entry = { .fe_sector = NULL, .fe_elem_off = 0 };
+	int err = 0;
+	size_t offset = 0;
+
+	while (err == 0 && fcb_getnext(&gnss_fcb, &entry) == 0) {
+		if (entry.fe_data_len > size - offset) {
+			err = -ENOMEM;
+			break;
+		}
+		err = flash_area_read(gnss_fcb.fap, FCB_ENTRY_FA_DATA_OFF(entry), &buf[offset],
+				      entry.fe_data_len);
+		offset += entry.fe_data_len;
+	}
+
+	*len = offset;
+	k_mutex_unlock(&gnss_mutex);
+	return err;
+}
+
+int stg_write_gnss_data(uint8_t *data, size_t len)
+{
+	if (k_mutex_lock(&gnss_mutex, K_MSEC(CONFIG_MUTEX_READ_WRITE_TIMEOUT))) {
+		return -ETIMEDOUT;
+	}
+
+	int err = clear_fcb(STG_PARTITION_GNSS);
+
+	for (size_t offset = 0; offset < len && err == 0; offset += STG_GNSS_ENTRY_SIZE) {
+		err = stg_write_to_partition(STG_PARTITION_GNSS, &data[offset],
+					     MIN(STG_GNSS_ENTRY_SIZE, len - offset));
+	}
+
+	if (err) {
+		LOG_ERR("Error writing to GNSS partition %i", err);
+		/* Do not leave a partial state. */
+		clear_fcb(STG_PARTITION_GNSS);
+	}
+
+	k_mutex_unlock(&gnss_mutex);
+	return err;
+}
+
 uint32_t get_num_entries(flash_partition_t partition)
+{
+	stg_partition_stats_t stats;
+	int err = stg_get_partition_stats(partition, &stats);
+
+	if (err) {
+		return err;
+	}
+	return stats.entries;
+}
+
+int stg_get_partition_stats(flash_partition_t partition, stg_partition_stats_t *stats)
 {
 	struct fcb *fcb = get_fcb(partition);
 	struct k_mutex *mtx = get_mutex(partition);
@@ -698,22 +1211,27 @@ uint32_t get_num_entries(flash_partition_t partition)
 	}
 
 	if (k_mutex_lock(mtx, K_MSEC(CONFIG_MUTEX_READ_WRITE_TIMEOUT))) {
-		LOG_ERR("Mutex timeout in storage controller when clearing.");
+		LOG_ERR("Mutex timeout in storage controller when getting stats.");
 		return -ETIMEDOUT;
 	}
 
-	struct fcb_entry oldest_entry;
+	struct stg_partition_usage *usage = get_usage(partition);
 
-	memset(&oldest_entry, 0, sizeof(struct fcb_entry));
-	oldest_entry.fe_sector = NULL;
+	stats->entries = usage->entries;
+	stats->bytes = usage->bytes;
 
-	uint32_t cnt = 0;
-	while (fcb_getnext(fcb, &oldest_entry) == 0) {
-		cnt++;
-	}
+	/* Sectors are given consecutive ids as they are taken into use, from
+	 * the oldest sector up to the active one.
+	 */
+	uint8_t oldest = fcb->f_oldest - fcb->f_sectors;
+	uint8_t active = fcb->f_active.fe_sector - fcb->f_sectors;
+	uint8_t in_use = (active + fcb->f_sector_cnt - oldest) % fcb->f_sector_cnt;
+
+	stats->newest_sector_id = fcb->f_active_id;
+	stats->oldest_sector_id = fcb->f_active_id - in_use;
 
 	k_mutex_unlock(mtx);
-	return cnt;
+	return 0;
 }
 
 int stg_fcb_reset_and_init()
@@ -722,6 +1240,7 @@ int stg_fcb_reset_and_init()
 	memset(&ano_fcb, 0, sizeof(ano_fcb));
 	memset(&pasture_fcb, 0, sizeof(pasture_fcb));
 	memset(&system_diag_fcb, 0, sizeof(pasture_fcb));
+	memset(&gnss_fcb, 0, sizeof(gnss_fcb));
 
 	memset(&active_ano_entry, 0, sizeof(struct fcb_entry));
 	memset(&last_sent_ano_entry, 0, sizeof(struct fcb_entry));
@@ -732,6 +1251,9 @@ int stg_fcb_reset_and_init()
 	last_sent_ano_entry.fe_sector = NULL;
 	active_log_entry.fe_sector = NULL;
 	active_system_diag_entry.fe_sector = NULL;
+#if CONFIG_STORAGE_LOG_COALESCE
+	log_resume_entry.fe_sector = NULL;
+#endif
 
 	return stg_init_storage_controller();
 }
@@ -13,9 +13,22 @@ typedef enum {
 	STG_PARTITION_LOG = 0,
 	STG_PARTITION_ANO = 1,
 	STG_PARTITION_PASTURE = 2,
-	STG_PARTITION_SYSTEM_DIAG = 3
+	STG_PARTITION_SYSTEM_DIAG = 3,
+	STG_PARTITION_GNSS = 4
 } flash_partition_t;
 
+/** Entries stored in a partition, see stg_get_partition_stats. */
+typedef struct {
+	/** Number of entries. */
+	uint32_t entries;
+	/** Bytes of data in the entries, including padding. */
+	uint32_t bytes;
+	/** FCB id of the sector holding the oldest entries. */
+	uint16_t oldest_sector_id;
+	/** FCB id of the sector new entries are written to. */
+	uint16_t newest_sector_id;
+} stg_partition_stats_t;
+
 /** 
  * @brief Setup external flash driver
  * 
@@ -65,6 +78,10 @@ int stg_write_to_partition(flash_partition_t partition, uint8_t *data, size_t le
  * @brief Reads all the new available log data and calls the callback function
  *        with all the unread log entries.
  * 
+ * @note With CONFIG_STORAGE_LOG_COALESCE, the staged records are written 
+ *       first, the callback is called for every record of an entry, and 
+ *       records of a coalesced entry are given without padding.
+ * 
  * @param[in] cb pointer location to the callback function that is 
  *               called during the fcb walk.
  * @param[in] num_entries number of entries we want to read. If 0, read all.
@@ -111,6 +128,21 @@ int stg_read_pasture_data(fcb_read_cb cb);
  */
 int stg_write_log_data(uint8_t *data, size_t len);
 
+/** 
+ * @brief Writes the log records staged in RAM with 
+ *        CONFIG_STORAGE_LOG_COALESCE to the LOG partition.
+ * 
+ * @return 0 on success, otherwise negative errno
+ */
+int stg_flush_log_data(void);
+
+/** 
+ * @brief Requests the staged log records to be written from the storage
+ *        work queue, without waiting for the flash. Used on low battery 
+ *        and before a reboot.
+ */
+void stg_request_log_flush(void);
+
 /** 
  * @brief Writes ano data to external flash ANO partition.
  * 
@@ -150,6 +182,19 @@ bool stg_log_pointing_to_last();
  */
 uint32_t get_num_entries(flash_partition_t partition);
 
+/** 
+ * @brief Gets the number of entries and bytes stored on the given partition.
+ *        These are counted when the partition is mounted and kept up to 
+ *        date on every write, rotate and clear, so the partition is not 
+ *        read.
+ * 
+ * @param[in] partition which partition to get the stats from.
+ * @param[out] stats the stats of the partition.
+ * 
+ * @return 0 on success, otherwise negative errno.
+ */
+int stg_get_partition_stats(flash_partition_t partition, stg_partition_stats_t *stats);
+
 /** 
  * @brief Reads the newest pasture and callbacks the data.
  * 
@@ -171,6 +216,34 @@ int stg_read_system_diagnostic_log(fcb_read_cb cb, uint16_t num_entries);
  */
 int stg_write_system_diagnostic_log(uint8_t *data, size_t len);
 
+/** 
+ * @brief Reads the GNSS receiver state into a buffer given by the caller.
+ * 
+ * @note The data may end with up to 3 bytes of padding, see 
+ *       stg_write_to_partition.
+ * 
+ * @param[out] buf buffer to read the state into.
+ * @param[in] size size of buf.
+ * @param[out] len length of the state read into buf.
+ * 
+ * @return 0 on success 
+ * @return -ENODATA if no data available.
+ * @return -ENOMEM if the state does not fit in buf, Otherwise negative errno.
+ */
+int stg_read_gnss_data(uint8_t *buf, size_t size, size_t *len);
+
+/** 
+ * @brief Writes the GNSS receiver state to external flash GNSS partition,
+ *        replacing the previous state. The state is split over entries
+ *        of STG_GNSS_ENTRY_SIZE bytes, since an entry can not span sectors.
+ * 
+ * @param[in] data pointer location to of data to be written
+ * @param[in] len length of data
+ * 
+ * @return 0 on success, otherwise negative errno
+ */
+int stg_write_gnss_data(uint8_t *data, size_t len);
+
 #define SECTOR_SIZE MAX(CONFIG_NORDIC_QSPI_NOR_FLASH_LAYOUT_PAGE_SIZE, CONFIG_STORAGE_SECTOR_SIZE)
 
 #define FLASH_LOG_NUM_SECTORS PM_LOG_PARTITION_SIZE / SECTOR_SIZE
@@ -181,4 +254,8 @@ int stg_write_system_diagnostic_log(uint8_t *data, size_t len);
 
 #define FLASH_SYSTEM_DIAG_NUM_SECTORS PM_SYSTEM_DIAGNOSTIC_SIZE / SECTOR_SIZE
 
+#define FLASH_GNSS_NUM_SECTORS PM_GNSS_PARTITION_SIZE / SECTOR_SIZE
+
+#define STG_GNSS_ENTRY_SIZE 1024
+
 #endif /* _STORAGE_H_ */
@@ -49,6 +49,7 @@ static struct shared_state {
 	FenceStatus cur_fence_status;
 	acc_activity_t cur_activity_level;
 	gnss_mode_t cur_gnss_pwr_m;
+	gnss_mode_t last_gnss_set_mode;
 	uint8_t cur_gnss_pvt_flags;
 	uint16_t cur_steps;
 	int16_t cur_height_max;
@@ -65,6 +66,7 @@ static struct shared_state {
 	uint16_t pos_count;
 } shared_state = { .cur_activity_level = ACTIVITY_NO,
 		   .cur_gnss_pwr_m = GNSSMODE_NOMODE,
+		   .last_gnss_set_mode = GNSSMODE_SIZE,
 		   .cur_height_max = INT16_MIN,
 		   .cur_height_min = INT16_MAX,
 		   .cur_speed_min = UINT16_MAX,
@@ -150,24 +152,29 @@ static bool event_handler_impl(const struct event_header *eh)
 		return false;
 	} else if (is_gnss_data(eh)) {
 		struct gnss_data *ev = cast_gnss_data(eh);
-		shared_state.cur_gnss_pwr_m = ev->gnss_data.latest.mode;
-		shared_state.cur_gnss_pvt_flags = ev->gnss_data.latest.pvt_flags;
-		if (ev->gnss_data.fix_ok) {
+		shared_state.cur_gnss_pwr_m = ev->gnss_data->latest.mode;
+		shared_state.cur_gnss_pvt_flags = ev->gnss_data->latest.pvt_flags;
+		if (ev->gnss_data->fix_ok) {
 			shared_state.cur_gnss_samples++;
 			shared_state.cur_height_max =
-				MAX(shared_state.cur_height_max, ev->gnss_data.latest.height);
+				MAX(shared_state.cur_height_max, ev->gnss_data->latest.height);
 			shared_state.cur_height_min =
-				MIN(shared_state.cur_height_min, ev->gnss_data.latest.height);
-			shared_state.cur_height_sum += (int32_t)ev->gnss_data.latest.height;
+				MIN(shared_state.cur_height_min, ev->gnss_data->latest.height);
+			shared_state.cur_height_sum += (int32_t)ev->gnss_data->latest.height;
 			shared_state.cur_speed_max =
-				MAX(shared_state.cur_speed_max, ev->gnss_data.latest.speed);
+				MAX(shared_state.cur_speed_max, ev->gnss_data->latest.speed);
 			shared_state.cur_speed_min =
-				MIN(shared_state.cur_speed_min, ev->gnss_data.latest.speed);
-			shared_state.cur_speed_sum += (uint32_t)ev->gnss_data.latest.speed;
+				MIN(shared_state.cur_speed_min, ev->gnss_data->latest.speed);
+			shared_state.cur_speed_sum += (uint32_t)ev->gnss_data->latest.speed;
 		}
 		return false;
 	} else if (is_gnss_set_mode_event(eh)) {
 		struct gnss_set_mode_event *ev = cast_gnss_set_mode_event(eh);
+		/* Only mode switches are counted, not scheduled rate changes. */
+		if (ev->mode == shared_state.last_gnss_set_mode) {
+			return false;
+		}
+		shared_state.last_gnss_set_mode = ev->mode;
 		switch (ev->mode) {
 		case GNSSMODE_INACTIVE:
 			shared_state.cur_gnss_modes.usOffCount++;
@@ -2,7 +2,7 @@
 #include "storage.h"
 #include "pasture_structure.h"
 
-pasture_t pasture;
+static uint8_t pasture_buf[PASTURE_MAX_SIZE] __aligned(4);
 
 int stg_read_pasture_data(fcb_read_cb cb)
 {
@@ -11,32 +11,25 @@ int stg_read_pasture_data(fcb_read_cb cb)
 		return retval;
 	}
 
-	pasture.m.ul_total_fences = 2;
-
-	pasture.fences[0].m.fence_no = 0;
-	pasture.fences[0].m.e_fence_type = FenceDefinitionMessage_FenceType_Normal;
-	pasture.fences[0].m.n_points = 3;
-	pasture.fences[0].coordinates[0].s_x_dm = 1;
-	pasture.fences[0].coordinates[0].s_y_dm = 2;
-	pasture.fences[0].coordinates[1].s_x_dm = 3;
-	pasture.fences[0].coordinates[1].s_y_dm = 4;
-	pasture.fences[0].coordinates[2].s_x_dm = 5;
-	pasture.fences[0].coordinates[2].s_y_dm = 6;
-
-	pasture.fences[1].m.fence_no = 1;
-	pasture.fences[1].m.e_fence_type = FenceDefinitionMessage_FenceType_Normal;
-	pasture.fences[1].m.n_points = 3;
-	pasture.fences[1].coordinates[0].s_x_dm = 1;
-	pasture.fences[1].coordinates[0].s_y_dm = 2;
-	pasture.fences[1].coordinates[1].s_x_dm = 3;
-	pasture.fences[1].coordinates[1].s_y_dm = 4;
-	pasture.fences[1].coordinates[2].s_x_dm = 5;
-	pasture.fences[1].coordinates[2].s_y_dm = 6;
-
-	pasture.m.status = FenceStatus_FenceStatus_Normal;
-	pasture.m.ul_fence_def_version = 1337;
-
-	zassert_false(cb((uint8_t *)&pasture, sizeof(pasture)), "");
+	pasture_t *pasture = (pasture_t *)pasture_buf;
+	fence_coordinate_t points[] = { { .s_x_dm = 1, .s_y_dm = 2 },
+					{ .s_x_dm = 3, .s_y_dm = 4 },
+					{ .s_x_dm = 5, .s_y_dm = 6 } };
+	fence_t fence = { .m = { .e_fence_type = FenceDefinitionMessage_FenceType_Normal,
+				 .n_points = 3 } };
+
+	zassert_false(pasture_init(pasture, sizeof(pasture_buf), 2), "");
+
+	fence.m.fence_no = 0;
+	zassert_false(pasture_add_fence(pasture, sizeof(pasture_buf), 0, &fence, points), "");
+
+	fence.m.fence_no = 1;
+	zassert_false(pasture_add_fence(pasture, sizeof(pasture_buf), 1, &fence, points), "");
+
+	pasture->m.status = FenceStatus_FenceStatus_Normal;
+	pasture->m.ul_fence_def_version = 1337;
+
+	zassert_false(cb(pasture_buf, pasture_size(pasture)), "");
 
 	return retval;
 }
\ No newline at end of file
@@ -180,9 +180,9 @@ void test_fence_status(void)
 
 	/* Beacon Contact -> Unknown */
 	/* We only enter this state if pasture is invalid. */
-	pasture_t empty_pasture;
-	memset(&empty_pasture, 0, sizeof(pasture_t));
-	zassert_equal(set_pasture_cache((uint8_t *)&empty_pasture, sizeof(empty_pasture)), 0, "");
+	static uint8_t empty_pasture[PASTURE_SIZE(0, 0)] __aligned(4);
+	zassert_false(pasture_init((pasture_t *)empty_pasture, sizeof(empty_pasture), 0), "");
+	zassert_equal(set_pasture_cache(empty_pasture, sizeof(empty_pasture)), 0, "");
 
 	ztest_returns_value(stg_config_u8_write, 0);
 
@@ -787,11 +787,8 @@ void test_correction_gnss_timeout(void)
 	*/
 	k_sem_reset(&warning_stop_sem);
 
-	gnss_t gnss_data_timeout;
-	memset(&gnss_data_timeout, 0, sizeof(gnss_t));
-
 	struct gnss_data *gnss_evt = new_gnss_data();
-	gnss_evt->gnss_data = gnss_data_timeout;
+	gnss_evt->gnss_data = &gnss_snapshot_no_fix;
 	gnss_evt->timed_out = true;
 	EVENT_SUBMIT(gnss_evt);
 
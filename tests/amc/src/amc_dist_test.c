@@ -3,6 +3,7 @@
 #include "amc_cache.h"
 #include "amc_dist.h"
 #include "embedded.pb.h"
+#include "trigonometry.h"
 #include <ztest.h>
 #include <math.h>
 #include <stdlib.h>
@@ -15,10 +16,47 @@ const uint8_t VERTEX_TOP = 2;
 const uint8_t VERTEX_LEFT = 3;
 const uint8_t VERTEX_BOTTOM = 4;
 
+int set_legacy_pasture_cache(pasture_legacy_t *legacy)
+{
+	static uint8_t pasture_buf[PASTURE_MAX_SIZE] __aligned(4);
+	pasture_t *pasture = (pasture_t *)pasture_buf;
+
+	int err = pasture_from_legacy(pasture, sizeof(pasture_buf), legacy);
+	if (err) {
+		return err;
+	}
+	return set_pasture_cache(pasture_buf, pasture_size(pasture));
+}
+
+/** @brief fnc_calc_dist() for the published pasture, pinned like the AMC handler does. */
+static int16_t calc_dist(int16_t pos_x, int16_t pos_y, uint8_t *p_fence_index,
+			 uint8_t *p_vertex_index)
+{
+	pasture_t *pasture = NULL;
+	uint8_t slot = pasture_cache_pin(&pasture);
+	int16_t dist = fnc_calc_dist(pasture, slot, pos_x, pos_y, p_fence_index, p_vertex_index);
+
+	pasture_cache_unpin(slot);
+	return dist;
+}
+
+/** @brief fnc_calc_dist_lazy() for the published pasture. */
+static int16_t calc_dist_lazy(int16_t pos_x, int16_t pos_y, int16_t limit, uint8_t *p_fence_index,
+			      uint8_t *p_vertex_index)
+{
+	pasture_t *pasture = NULL;
+	uint8_t slot = pasture_cache_pin(&pasture);
+	int16_t dist = fnc_calc_dist_lazy(pasture, slot, pos_x, pos_y, limit, p_fence_index,
+					  p_vertex_index);
+
+	pasture_cache_unpin(slot);
+	return dist;
+}
+
 void test_fnc_calc_dist_quadratic(void)
 {
 	/* Pasture. */
-	pasture_t pasture = {
+	pasture_legacy_t pasture = {
 		.m.ul_total_fences = 1,
 	};
 
@@ -35,56 +73,56 @@ void test_fnc_calc_dist_quadratic(void)
 	};
 	pasture.fences[0].m.n_points = sizeof(points1) / sizeof(points1[0]);
 	memcpy(pasture.fences[0].coordinates, points1, sizeof(points1));
-	zassert_false(set_pasture_cache((uint8_t *)&pasture, sizeof(pasture)), "");
+	zassert_false(set_legacy_pasture_cache(&pasture), "");
 
 	int16_t d;
 	uint8_t fence_index;
 	uint8_t vertex_index;
 
-	d = fnc_calc_dist(0, 0, &fence_index, &vertex_index);
+	d = calc_dist(0, 0, &fence_index, &vertex_index);
 	zassert_equal(-10, d, "");
 	zassert_equal(0, fence_index, "");
 	zassert_equal(VERTEX_RIGHT, vertex_index, "");
 
-	d = fnc_calc_dist(10, 10, &fence_index, &vertex_index);
+	d = calc_dist(10, 10, &fence_index, &vertex_index);
 	zassert_equal(0, d, "");
 	zassert_equal(VERTEX_RIGHT, vertex_index, "");
 
-	d = fnc_calc_dist(10, 20, &fence_index, &vertex_index);
+	d = calc_dist(10, 20, &fence_index, &vertex_index);
 	zassert_equal(10, d, "");
 	zassert_equal(VERTEX_RIGHT, vertex_index, "");
 
-	d = fnc_calc_dist(10, 30, &fence_index, &vertex_index);
+	d = calc_dist(10, 30, &fence_index, &vertex_index);
 	zassert_equal(20, d, "");
 	zassert_equal(VERTEX_RIGHT, vertex_index, "");
 
-	d = fnc_calc_dist(-5, -3, &fence_index, &vertex_index);
+	d = calc_dist(-5, -3, &fence_index, &vertex_index);
 	zassert_equal(-5, d, "");
 	zassert_equal(VERTEX_LEFT, vertex_index, "");
 
-	d = fnc_calc_dist(-5, 3, &fence_index, &vertex_index);
+	d = calc_dist(-5, 3, &fence_index, &vertex_index);
 	zassert_equal(-5, d, "");
 	zassert_equal(VERTEX_LEFT, vertex_index, "");
 
-	d = fnc_calc_dist(5, -3, &fence_index, &vertex_index);
+	d = calc_dist(5, -3, &fence_index, &vertex_index);
 	zassert_equal(-5, d, "");
 	zassert_equal(VERTEX_RIGHT, vertex_index, "");
 
-	d = fnc_calc_dist(5, 3, &fence_index, &vertex_index);
+	d = calc_dist(5, 3, &fence_index, &vertex_index);
 	zassert_equal(-5, d, "");
 	zassert_equal(VERTEX_RIGHT, vertex_index, "");
 
-	d = fnc_calc_dist(15, 15, &fence_index, &vertex_index);
+	d = calc_dist(15, 15, &fence_index, &vertex_index);
 	zassert_equal((int16_t)sqrt(5 * 5 + 5 * 5), d, "");
 
-	d = fnc_calc_dist(-15, -15, &fence_index, &vertex_index);
+	d = calc_dist(-15, -15, &fence_index, &vertex_index);
 	zassert_equal((int16_t)sqrt(5 * 5 + 5 * 5), d, "");
 }
 
 void test_fnc_calc_dist_quadratic_max(void)
 {
 	/* Pasture. */
-	pasture_t pasture = {
+	pasture_legacy_t pasture = {
 		.m.ul_total_fences = 1,
 	};
 
@@ -119,41 +157,41 @@ void test_fnc_calc_dist_quadratic_max(void)
 
 	pasture.fences[0].m.n_points = sizeof(points1) / sizeof(points1[0]);
 	memcpy(pasture.fences[0].coordinates, points1, sizeof(points1));
-	zassert_false(set_pasture_cache((uint8_t *)&pasture, sizeof(pasture)), "");
+	zassert_false(set_legacy_pasture_cache(&pasture), "");
 
 	int16_t d;
 	uint8_t fence_index;
 	uint8_t vertex_index;
 
-	d = fnc_calc_dist(0, 0, &fence_index, &vertex_index);
+	d = calc_dist(0, 0, &fence_index, &vertex_index);
 	zassert_equal(-10, d, "");
 
-	d = fnc_calc_dist(10, 10, &fence_index, &vertex_index);
+	d = calc_dist(10, 10, &fence_index, &vertex_index);
 	zassert_equal(0, d, "");
 
-	d = fnc_calc_dist(10, 20, &fence_index, &vertex_index);
+	d = calc_dist(10, 20, &fence_index, &vertex_index);
 	zassert_equal(10, d, "");
 
-	d = fnc_calc_dist(10, 30, &fence_index, &vertex_index);
+	d = calc_dist(10, 30, &fence_index, &vertex_index);
 	zassert_equal(20, d, "");
 
-	d = fnc_calc_dist(-5, -5, &fence_index, &vertex_index);
+	d = calc_dist(-5, -5, &fence_index, &vertex_index);
 	zassert_equal(-5, d, "");
 
-	d = fnc_calc_dist(-5, 5, &fence_index, &vertex_index);
+	d = calc_dist(-5, 5, &fence_index, &vertex_index);
 	zassert_equal(-5, d, "");
 
-	d = fnc_calc_dist(5, -5, &fence_index, &vertex_index);
+	d = calc_dist(5, -5, &fence_index, &vertex_index);
 	zassert_equal(-5, d, "");
 
-	d = fnc_calc_dist(5, 5, &fence_index, &vertex_index);
+	d = calc_dist(5, 5, &fence_index, &vertex_index);
 	zassert_equal(-5, d, "");
 }
 
 void test_fnc_calc_dist_rect(void)
 {
 	/* Pasture. */
-	pasture_t pasture = {
+	pasture_legacy_t pasture = {
 		.m.ul_total_fences = 1,
 	};
 
@@ -171,41 +209,41 @@ void test_fnc_calc_dist_rect(void)
 	};
 	pasture.fences[0].m.n_points = sizeof(points1) / sizeof(points1[0]);
 	memcpy(pasture.fences[0].coordinates, points1, sizeof(points1));
-	zassert_false(set_pasture_cache((uint8_t *)&pasture, sizeof(pasture)), "");
+	zassert_false(set_legacy_pasture_cache(&pasture), "");
 
 	int16_t d;
 	uint8_t fence_index;
 	uint8_t vertex_index;
 
-	d = fnc_calc_dist(50, 0, &fence_index, &vertex_index);
+	d = calc_dist(50, 0, &fence_index, &vertex_index);
 	zassert_equal(-10, d, "");
 
-	d = fnc_calc_dist(100, 10, &fence_index, &vertex_index);
+	d = calc_dist(100, 10, &fence_index, &vertex_index);
 	zassert_equal(0, d, "");
 
-	d = fnc_calc_dist(50, 20, &fence_index, &vertex_index);
+	d = calc_dist(50, 20, &fence_index, &vertex_index);
 	zassert_equal(10, d, "");
 
-	d = fnc_calc_dist(50, 30, &fence_index, &vertex_index);
+	d = calc_dist(50, 30, &fence_index, &vertex_index);
 	zassert_equal(20, d, "");
 
-	d = fnc_calc_dist(-50, -5, &fence_index, &vertex_index);
+	d = calc_dist(-50, -5, &fence_index, &vertex_index);
 	zassert_equal(-5, d, "");
 
-	d = fnc_calc_dist(-50, 5, &fence_index, &vertex_index);
+	d = calc_dist(-50, 5, &fence_index, &vertex_index);
 	zassert_equal(-5, d, "");
 
-	d = fnc_calc_dist(50, -5, &fence_index, &vertex_index);
+	d = calc_dist(50, -5, &fence_index, &vertex_index);
 	zassert_equal(-5, d, "");
 
-	d = fnc_calc_dist(50, 5, &fence_index, &vertex_index);
+	d = calc_dist(50, 5, &fence_index, &vertex_index);
 	zassert_equal(-5, d, "");
 }
 
 void test_fnc_calc_dist_2_fences_hole(void)
 {
 	/* Pasture. */
-	pasture_t pasture = {
+	pasture_legacy_t pasture = {
 		.m.ul_total_fences = 2,
 	};
 
@@ -235,50 +273,50 @@ void test_fnc_calc_dist_2_fences_hole(void)
 	pasture.fences[1].m.n_points = sizeof(points2) / sizeof(points2[0]);
 	memcpy(pasture.fences[1].coordinates, points2, sizeof(points2));
 
-	zassert_false(set_pasture_cache((uint8_t *)&pasture, sizeof(pasture)), "");
+	zassert_false(set_legacy_pasture_cache(&pasture), "");
 
 	int16_t d;
 	uint8_t fence_index;
 	uint8_t vertex_index;
 
-	d = fnc_calc_dist(0, 0, &fence_index, &vertex_index);
+	d = calc_dist(0, 0, &fence_index, &vertex_index);
 	zassert_equal(10, d, "");
 	zassert_equal(1, fence_index, "");
 	zassert_equal(VERTEX_RIGHT, vertex_index, "");
 
-	d = fnc_calc_dist(0, 10, &fence_index, &vertex_index);
+	d = calc_dist(0, 10, &fence_index, &vertex_index);
 	zassert_equal(0, d, "");
 	zassert_equal(1, fence_index, "");
 	zassert_equal(VERTEX_TOP, vertex_index, "");
 
-	d = fnc_calc_dist(0, 14, &fence_index, &vertex_index);
+	d = calc_dist(0, 14, &fence_index, &vertex_index);
 	zassert_equal(-4, d, "");
 	zassert_equal(1, fence_index, "");
 	zassert_equal(VERTEX_TOP, vertex_index, "");
 
-	d = fnc_calc_dist(0, 16, &fence_index, &vertex_index);
+	d = calc_dist(0, 16, &fence_index, &vertex_index);
 	zassert_equal(-4, d, "");
 	zassert_equal(0, fence_index, "");
 	zassert_equal(VERTEX_TOP, vertex_index, "");
 
-	d = fnc_calc_dist(0, 20, &fence_index, &vertex_index);
+	d = calc_dist(0, 20, &fence_index, &vertex_index);
 	zassert_equal(0, d, "");
 	zassert_equal(0, fence_index, "");
 	zassert_equal(VERTEX_TOP, vertex_index, "");
 
-	d = fnc_calc_dist(0, 25, &fence_index, &vertex_index);
+	d = calc_dist(0, 25, &fence_index, &vertex_index);
 	zassert_equal(5, d, "");
 	zassert_equal(0, fence_index, "");
 	zassert_equal(VERTEX_TOP, vertex_index, "");
 
-	d = fnc_calc_dist(0, 105, &fence_index, &vertex_index);
+	d = calc_dist(0, 105, &fence_index, &vertex_index);
 	zassert_equal(85, d, "");
 	zassert_equal(0, fence_index, "");
 	zassert_equal(VERTEX_TOP, vertex_index, "");
 
-	d = fnc_calc_dist(0, 1020, &fence_index, &vertex_index);
+	d = calc_dist(0, 1020, &fence_index, &vertex_index);
 	zassert_equal(1000, d, "");
-	d = fnc_calc_dist(0, INT16_MAX - 100, &fence_index, &vertex_index);
+	d = calc_dist(0, INT16_MAX - 100, &fence_index, &vertex_index);
 	zassert_equal(INT16_MAX - 100 - 20, d, "");
 }
 
@@ -287,7 +325,7 @@ void test_fnc_calc_dist_2_fences_max_size(void)
 	const int16_t MAX_FENCE = 32500;
 
 	/* Pasture. */
-	pasture_t pasture = {
+	pasture_legacy_t pasture = {
 		.m.ul_total_fences = 1,
 	};
 
@@ -308,48 +346,48 @@ void test_fnc_calc_dist_2_fences_max_size(void)
 
 	pasture.fences[0].m.n_points = sizeof(points1) / sizeof(points1[0]);
 	memcpy(pasture.fences[0].coordinates, points1, sizeof(points1));
-	zassert_false(set_pasture_cache((uint8_t *)&pasture, sizeof(pasture)), "");
+	zassert_false(set_legacy_pasture_cache(&pasture), "");
 
 	int16_t d;
 	uint8_t fence_index;
 	uint8_t vertex_index;
 
-	d = fnc_calc_dist(0, -MAX_FENCE, &fence_index, &vertex_index);
+	d = calc_dist(0, -MAX_FENCE, &fence_index, &vertex_index);
 	zassert_equal(0, d, "");
 
-	d = fnc_calc_dist(0, 0, &fence_index, &vertex_index);
+	d = calc_dist(0, 0, &fence_index, &vertex_index);
 	zassert_equal(-MAX_FENCE, d, "");
 
-	d = fnc_calc_dist(MAX_FENCE, MAX_FENCE, &fence_index, &vertex_index);
+	d = calc_dist(MAX_FENCE, MAX_FENCE, &fence_index, &vertex_index);
 	zassert_equal(-0, d, "");
 
-	d = fnc_calc_dist(MAX_FENCE, -MAX_FENCE, &fence_index, &vertex_index);
+	d = calc_dist(MAX_FENCE, -MAX_FENCE, &fence_index, &vertex_index);
 	zassert_equal(-0, d, "");
 
-	d = fnc_calc_dist(-MAX_FENCE, MAX_FENCE, &fence_index, &vertex_index);
+	d = calc_dist(-MAX_FENCE, MAX_FENCE, &fence_index, &vertex_index);
 	zassert_equal(-0, d, "");
 
-	d = fnc_calc_dist(-MAX_FENCE, -MAX_FENCE, &fence_index, &vertex_index);
+	d = calc_dist(-MAX_FENCE, -MAX_FENCE, &fence_index, &vertex_index);
 	zassert_equal(-0, d, "");
 
 	/* INT MAX/MIN. */
-	d = fnc_calc_dist(0, INT16_MAX, &fence_index, &vertex_index);
+	d = calc_dist(0, INT16_MAX, &fence_index, &vertex_index);
 	zassert_equal((int32_t)INT16_MAX - MAX_FENCE, d, "");
 
-	d = fnc_calc_dist(0, INT16_MIN, &fence_index, &vertex_index);
+	d = calc_dist(0, INT16_MIN, &fence_index, &vertex_index);
 	zassert_equal(abs(INT16_MIN + MAX_FENCE), d, "");
 
-	d = fnc_calc_dist(INT16_MAX, INT16_MAX, &fence_index, &vertex_index);
+	d = calc_dist(INT16_MAX, INT16_MAX, &fence_index, &vertex_index);
 	zassert_equal(round(sqrt(2 * pow(INT16_MAX - MAX_FENCE, 2))), d, "");
 
-	d = fnc_calc_dist(INT16_MIN, INT16_MIN, &fence_index, &vertex_index);
+	d = calc_dist(INT16_MIN, INT16_MIN, &fence_index, &vertex_index);
 	zassert_equal(round(sqrt(2 * pow(INT16_MIN + MAX_FENCE, 2))), d, "");
 }
 
 void test_fnc_calc_dist_2_fences_hole2(void)
 {
 	/* Pasture. */
-	pasture_t pasture = {
+	pasture_legacy_t pasture = {
 		.m.ul_total_fences = 2,
 	};
 
@@ -381,76 +419,429 @@ void test_fnc_calc_dist_2_fences_hole2(void)
 	pasture.fences[1].m.n_points = sizeof(points2) / sizeof(points2[0]);
 	memcpy(pasture.fences[1].coordinates, points2, sizeof(points2));
 
-	zassert_false(set_pasture_cache((uint8_t *)&pasture, sizeof(pasture)), "");
+	zassert_false(set_legacy_pasture_cache(&pasture), "");
 
 	uint8_t fence_index;
 	uint8_t vertex_index;
 	int16_t d;
 
-	d = fnc_calc_dist(0, 0, &fence_index, &vertex_index);
+	d = calc_dist(0, 0, &fence_index, &vertex_index);
 	zassert_equal(-50, d, "");
 	zassert_equal(0, fence_index, "");
 	zassert_equal(VERTEX_BOTTOM, vertex_index, "");
 
 	/* Up. */
-	d = fnc_calc_dist(0, 10, &fence_index, &vertex_index);
+	d = calc_dist(0, 10, &fence_index, &vertex_index);
 	zassert_equal(-60, d, "");
 	zassert_equal(0, fence_index, "");
 	zassert_equal(VERTEX_BOTTOM, vertex_index, "");
 
-	d = fnc_calc_dist(0, 20, &fence_index, &vertex_index);
+	d = calc_dist(0, 20, &fence_index, &vertex_index);
 	zassert_equal(-60, d, "");
 	zassert_equal(1, fence_index, "");
 	zassert_equal(VERTEX_BOTTOM, vertex_index, "");
 
-	d = fnc_calc_dist(0, 30, &fence_index, &vertex_index);
+	d = calc_dist(0, 30, &fence_index, &vertex_index);
 	zassert_equal(-50, d, "");
 	zassert_equal(1, fence_index, "");
 	zassert_equal(VERTEX_BOTTOM, vertex_index, "");
 
-	d = fnc_calc_dist(0, 70, &fence_index, &vertex_index);
+	d = calc_dist(0, 70, &fence_index, &vertex_index);
 	zassert_equal(-10, d, "");
 	zassert_equal(1, fence_index, "");
 	zassert_equal(VERTEX_BOTTOM, vertex_index, "");
 
-	d = fnc_calc_dist(0, 80, &fence_index, &vertex_index);
+	d = calc_dist(0, 80, &fence_index, &vertex_index);
 	zassert_equal(0, d, "");
 	zassert_equal(1, fence_index, "");
 	zassert_equal(VERTEX_BOTTOM, vertex_index, "");
 
-	d = fnc_calc_dist(0, 85, &fence_index, &vertex_index);
+	d = calc_dist(0, 85, &fence_index, &vertex_index);
 	zassert_equal(5, d, "");
 	zassert_equal(1, fence_index, "");
 	zassert_equal(VERTEX_TOP, vertex_index, "");
 
-	d = fnc_calc_dist(0, 90, &fence_index, &vertex_index);
+	d = calc_dist(0, 90, &fence_index, &vertex_index);
 	zassert_equal(0, d, "");
 	zassert_equal(1, fence_index, "");
 	zassert_equal(VERTEX_TOP, vertex_index, "");
 
-	d = fnc_calc_dist(0, 95, &fence_index, &vertex_index);
+	d = calc_dist(0, 95, &fence_index, &vertex_index);
 	zassert_equal(-5, d, "");
 	zassert_equal(0, fence_index, "");
 	zassert_equal(VERTEX_TOP, vertex_index, "");
 
-	d = fnc_calc_dist(0, 100, &fence_index, &vertex_index);
+	d = calc_dist(0, 100, &fence_index, &vertex_index);
 	zassert_equal(0, d, "");
 	zassert_equal(0, fence_index, "");
 	zassert_equal(VERTEX_TOP, vertex_index, "");
 
-	d = fnc_calc_dist(0, 105, &fence_index, &vertex_index);
+	d = calc_dist(0, 105, &fence_index, &vertex_index);
 	zassert_equal(5, d, "");
 	zassert_equal(0, fence_index, "");
 	zassert_equal(VERTEX_TOP, vertex_index, "");
 
-	d = fnc_calc_dist(0, 1000, &fence_index, &vertex_index);
+	d = calc_dist(0, 1000, &fence_index, &vertex_index);
 	zassert_equal(900, d, "");
 
 	/* Down. */
-	d = fnc_calc_dist(0, -10, &fence_index, &vertex_index);
+	d = calc_dist(0, -10, &fence_index, &vertex_index);
 	zassert_equal(-40, d, "");
-	d = fnc_calc_dist(0, -20, &fence_index, &vertex_index);
+	d = calc_dist(0, -20, &fence_index, &vertex_index);
 	zassert_equal(-30, d, "");
-	d = fnc_calc_dist(0, -50, &fence_index, &vertex_index);
+	d = calc_dist(0, -50, &fence_index, &vertex_index);
 	zassert_equal(0, d, "");
-}
\ No newline at end of file
+}
+/* Reference implementation of the full (unindexed) distance search, used to
+ * verify that the optimized search in amc_dist.c gives identical results.
+ */
+static uint16_t ref_distance(int16_t Ax, int16_t Ay, int16_t Bx, int16_t By)
+{
+	int32_t d1 = (int32_t)Ax - Bx;
+	int32_t d2 = (int32_t)Ay - By;
+
+	d1 *= d1;
+	d2 *= d2;
+	return (uint16_t)g_u32_SquareRootRounded((uint32_t)d1 + d2);
+}
+
+static uint16_t ref_ln_pt_dist(int16_t A_X, int16_t A_Y, int16_t B_X, int16_t B_Y, int16_t C_X,
+			       int16_t C_Y)
+{
+	int32_t v_x = (int32_t)B_X - A_X;
+	int32_t v_y = (int32_t)B_Y - A_Y;
+	int32_t vX = v_x, vY = v_y;
+	int32_t wX = (int32_t)C_X - A_X;
+	int32_t wY = (int32_t)C_Y - A_Y;
+
+	if (vX < INT16_MIN || vX > INT16_MAX || vY < INT16_MIN || vY > INT16_MAX ||
+	    wX < INT16_MIN || wX > INT16_MAX || wY < INT16_MIN || wY > INT16_MAX) {
+		vX /= 2;
+		vY /= 2;
+		wX /= 2;
+		wY /= 2;
+	}
+
+	int64_t c1 = (int32_t)(wX * vX + wY * vY);
+	if (c1 <= 0) {
+		return ref_distance(C_X, C_Y, A_X, A_Y);
+	}
+	int64_t c2 = (int32_t)(vX * vX + vY * vY);
+	if (c2 <= c1) {
+		return ref_distance(C_X, C_Y, B_X, B_Y);
+	}
+	return ref_distance(C_X, C_Y, (int16_t)(A_X + (c1 * v_x) / c2),
+			    (int16_t)(A_Y + (c1 * v_y) / c2));
+}
+
+static bool ref_pt_in_closed_polyline(fence_legacy_t *fence, int16_t testx, int16_t testy)
+{
+	bool c = false;
+
+	for (uint8_t i = 0, j = fence->m.n_points - 1; i < fence->m.n_points; j = i++) {
+		int32_t x0 = fence->coordinates[i].s_x_dm, x1 = fence->coordinates[j].s_x_dm;
+		int32_t y0 = fence->coordinates[i].s_y_dm, y1 = fence->coordinates[j].s_y_dm;
+		if (((y0 > testy) != (y1 > testy)) &&
+		    (testx < ((x1 - x0) * (testy - y0)) / (y1 - y0) + x0)) {
+			c = !c;
+		}
+	}
+	return c;
+}
+
+static int16_t ref_calc_dist(pasture_legacy_t *pasture, int16_t pos_x, int16_t pos_y,
+			     uint8_t *p_fence_index, uint8_t *p_vertex_index)
+{
+	int16_t dist[FENCE_MAX];
+	uint8_t vertex[FENCE_MAX];
+	int16_t out_dist = INT16_MAX, in_dist = INT16_MIN;
+	int out_index = -1, in_index = -1;
+
+	for (uint8_t f = 0; f < pasture->m.ul_total_fences; f++) {
+		fence_legacy_t *fence = &pasture->fences[f];
+		fence_t header = { .m = fence->m };
+		dist[f] = INT16_MAX;
+		vertex[f] = 0;
+		if (!fnc_valid(&header)) {
+			continue;
+		}
+		for (uint8_t i = 1; i < fence->m.n_points; i++) {
+			uint16_t d = ref_ln_pt_dist(
+				fence->coordinates[i].s_x_dm, fence->coordinates[i].s_y_dm,
+				fence->coordinates[i - 1].s_x_dm, fence->coordinates[i - 1].s_y_dm,
+				pos_x, pos_y);
+			if (d < dist[f]) {
+				dist[f] = d;
+				vertex[f] = i;
+			}
+		}
+		if (dist[f] < INT16_MAX) {
+			bool in = ref_pt_in_closed_polyline(fence, pos_x, pos_y);
+			if ((fence->m.e_fence_type == FenceDefinitionMessage_FenceType_Normal && in) ||
+			    (fence->m.e_fence_type == FenceDefinitionMessage_FenceType_Inverted &&
+			     !in)) {
+				dist[f] = -dist[f];
+			}
+		}
+	}
+	for (uint8_t f = 0; f < pasture->m.ul_total_fences; f++) {
+		if (dist[f] > 0 && dist[f] < out_dist) {
+			out_dist = dist[f];
+			out_index = f;
+		} else if (dist[f] <= 0 && dist[f] > in_dist) {
+			in_dist = dist[f];
+			in_index = f;
+		}
+	}
+	if (out_index >= 0) {
+		*p_fence_index = out_index;
+		*p_vertex_index = vertex[out_index];
+		return out_dist;
+	} else if (in_index >= 0) {
+		*p_fence_index = in_index;
+		*p_vertex_index = vertex[in_index];
+		return in_dist;
+	}
+	return INT16_MAX;
+}
+
+static uint32_t rand_state = 1;
+
+/* Deterministic pseudo random number in [lo, hi]. */
+static int32_t test_rand(int32_t lo, int32_t hi)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return lo + (int32_t)((rand_state >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+static int16_t test_rand_coord(int32_t center, int32_t spread)
+{
+	return (int16_t)CLAMP(center + test_rand(-spread, spread), INT16_MIN, INT16_MAX);
+}
+
+/* Fills a pasture with random fences, both small and spanning the whole 
+ * coordinate range, including inverted, invalid and open polylines.
+ */
+static void test_random_pasture(pasture_legacy_t *pasture)
+{
+	const int32_t spreads[] = { 20, 200, 2000, 20000, INT16_MAX };
+	int32_t spread = spreads[test_rand(0, ARRAY_SIZE(spreads) - 1)];
+
+	memset(pasture, 0, sizeof(pasture_legacy_t));
+	pasture->m.ul_total_fences = test_rand(1, FENCE_MAX);
+
+	for (uint8_t f = 0; f < pasture->m.ul_total_fences; f++) {
+		fence_legacy_t *fence = &pasture->fences[f];
+		int32_t cx = test_rand(-spread, spread) / 2;
+		int32_t cy = test_rand(-spread, spread) / 2;
+		int32_t size = test_rand(1, spread);
+
+		fence->m.n_points = test_rand(1, FENCE_MAX_TOTAL_COORDINATES);
+		fence->m.e_fence_type = (test_rand(0, 9) == 0) ? UINT8_MAX : test_rand(0, 1);
+		for (uint8_t i = 0; i < fence->m.n_points; i++) {
+			fence->coordinates[i].s_x_dm = test_rand_coord(cx, size);
+			fence->coordinates[i].s_y_dm = test_rand_coord(cy, size);
+		}
+		if (fence->m.n_points > 3 && test_rand(0, 1)) {
+			fence->coordinates[fence->m.n_points - 1] = fence->coordinates[0];
+		}
+	}
+}
+
+void test_fnc_calc_dist_random_pastures(void)
+{
+	static pasture_legacy_t pasture;
+
+	for (int p = 0; p < 200; p++) {
+		test_random_pasture(&pasture);
+		zassert_false(set_legacy_pasture_cache(&pasture), "");
+
+		for (int n = 0; n < 100; n++) {
+			int16_t x, y;
+			if (n % 2) {
+				/* Close to a random vertex. */
+				fence_legacy_t *fence = &pasture.fences[test_rand(
+					0, pasture.m.ul_total_fences - 1)];
+				fence_coordinate_t *c =
+					&fence->coordinates[test_rand(0, fence->m.n_points - 1)];
+				x = test_rand_coord(c->s_x_dm, 10);
+				y = test_rand_coord(c->s_y_dm, 10);
+			} else {
+				x = test_rand_coord(0, INT16_MAX);
+				y = test_rand_coord(0, INT16_MAX);
+			}
+
+			uint8_t ref_fence = 0, ref_vertex = 0;
+			uint8_t fence_index = 0, vertex_index = 0;
+			int16_t ref = ref_calc_dist(&pasture, x, y, &ref_fence, &ref_vertex);
+			int16_t d = calc_dist(x, y, &fence_index, &vertex_index);
+
+			zassert_equal(ref, d, "Distance mismatch at (%d, %d)", x, y);
+			zassert_equal(ref_fence, fence_index, "Fence mismatch at (%d, %d)", x, y);
+			zassert_equal(ref_vertex, vertex_index, "Vertex mismatch at (%d, %d)", x,
+				      y);
+		}
+	}
+}
+
+void test_fnc_calc_dist_random_tracks(void)
+{
+	static pasture_legacy_t pasture;
+
+	/* Consecutive positions a few dm apart, with an occasional jump, so 
+	 * that the search is seeded from the previous nearest segment.
+	 */
+	for (int p = 0; p < 100; p++) {
+		test_random_pasture(&pasture);
+		zassert_false(set_legacy_pasture_cache(&pasture), "");
+
+		fence_coordinate_t *start = &pasture.fences[0].coordinates[0];
+		int16_t x = start->s_x_dm;
+		int16_t y = start->s_y_dm;
+		for (int n = 0; n < 200; n++) {
+			int32_t step = (test_rand(0, 19) == 0) ? 2000 : 5;
+			x = test_rand_coord(x, step);
+			y = test_rand_coord(y, step);
+
+			uint8_t ref_fence = 0, ref_vertex = 0;
+			uint8_t fence_index = 0, vertex_index = 0;
+			int16_t ref = ref_calc_dist(&pasture, x, y, &ref_fence, &ref_vertex);
+			int16_t d = calc_dist(x, y, &fence_index, &vertex_index);
+
+			zassert_equal(ref, d, "Distance mismatch at (%d, %d)", x, y);
+			zassert_equal(ref_fence, fence_index, "Fence mismatch at (%d, %d)", x, y);
+			zassert_equal(ref_vertex, vertex_index, "Vertex mismatch at (%d, %d)", x,
+				      y);
+		}
+	}
+}
+
+/* Compares with the reference on a grid over the whole coordinate range, and 
+ * around every vertex.
+ */
+static void test_compare_pasture(pasture_legacy_t *pasture)
+{
+	zassert_false(set_legacy_pasture_cache(pasture), "");
+
+	for (int32_t n = 0; n < 2 * 65 * 65; n++) {
+		int16_t x, y;
+		if (n < 65 * 65) {
+			x = (int16_t)CLAMP(INT16_MIN + (n % 65) * 1024, INT16_MIN, INT16_MAX);
+			y = (int16_t)CLAMP(INT16_MIN + (n / 65) * 1024, INT16_MIN, INT16_MAX);
+		} else {
+			uint8_t f = test_rand(0, pasture->m.ul_total_fences - 1);
+			fence_legacy_t *fence = &pasture->fences[f];
+			fence_coordinate_t *c =
+				&fence->coordinates[test_rand(0, fence->m.n_points - 1)];
+			x = test_rand_coord(c->s_x_dm, 3);
+			y = test_rand_coord(c->s_y_dm, 3);
+		}
+
+		uint8_t ref_fence = 0, ref_vertex = 0;
+		uint8_t fence_index = 0, vertex_index = 0;
+		int16_t ref = ref_calc_dist(pasture, x, y, &ref_fence, &ref_vertex);
+		int16_t d = calc_dist(x, y, &fence_index, &vertex_index);
+
+		zassert_equal(ref, d, "Distance mismatch at (%d, %d)", x, y);
+		zassert_equal(ref_fence, fence_index, "Fence mismatch at (%d, %d)", x, y);
+		zassert_equal(ref_vertex, vertex_index, "Vertex mismatch at (%d, %d)", x, y);
+	}
+}
+
+void test_fnc_calc_dist_exact_kernels(void)
+{
+	static pasture_legacy_t pasture;
+
+	/* Segments halved as they do not fit in int16, a squared segment 
+	 * length wrapping int32, a thin sliver, and edges where the crossing 
+	 * calculation of the containment test overflows.
+	 */
+	const fence_coordinate_t fences[][5] = {
+		{ { -32500, -32500 }, { 32500, -32500 }, { 32500, 32500 }, { -32500, 32500 },
+		  { -32500, -32500 } },
+		{ { INT16_MIN, INT16_MIN }, { INT16_MAX, INT16_MIN }, { 0, INT16_MAX } },
+		{ { INT16_MIN, INT16_MIN }, { 0, 0 }, { 0, INT16_MIN } },
+		{ { 0, 0 }, { 30000, 1 }, { 0, 2 } },
+		{ { INT16_MAX, INT16_MIN }, { INT16_MIN, INT16_MAX }, { INT16_MIN, INT16_MIN },
+		  { 100, -100 } },
+	};
+	const uint8_t n_points[] = { 5, 3, 3, 3, 4 };
+
+	for (uint8_t f = 0; f < ARRAY_SIZE(fences); f++) {
+		for (uint8_t type = 0; type < 2; type++) {
+			memset(&pasture, 0, sizeof(pasture));
+			pasture.m.ul_total_fences = 1;
+			pasture.fences[0].m.e_fence_type = type;
+			pasture.fences[0].m.n_points = n_points[f];
+			memcpy(pasture.fences[0].coordinates, fences[f],
+			       n_points[f] * sizeof(fence_coordinate_t));
+			test_compare_pasture(&pasture);
+		}
+	}
+
+	/* All of them in one pasture. */
+	memset(&pasture, 0, sizeof(pasture));
+	pasture.m.ul_total_fences = ARRAY_SIZE(fences);
+	for (uint8_t f = 0; f < ARRAY_SIZE(fences); f++) {
+		pasture.fences[f].m.e_fence_type = f % 2;
+		pasture.fences[f].m.n_points = n_points[f];
+		memcpy(pasture.fences[f].coordinates, fences[f],
+		       n_points[f] * sizeof(fence_coordinate_t));
+	}
+	test_compare_pasture(&pasture);
+}
+
+void test_fnc_calc_dist_lazy(void)
+{
+	static pasture_legacy_t pasture;
+	const int16_t limit = -700;
+
+	memset(&pasture, 0, sizeof(pasture));
+	pasture.m.ul_total_fences = 1;
+	pasture.fences[0].m.e_fence_type = FenceDefinitionMessage_FenceType_Normal;
+	fence_coordinate_t points[] = {
+		{ .s_x_dm = -2000, .s_y_dm = -2000 }, { .s_x_dm = 2000, .s_y_dm = -2000 },
+		{ .s_x_dm = 2000, .s_y_dm = 2000 },   { .s_x_dm = -2000, .s_y_dm = 2000 },
+		{ .s_x_dm = -2000, .s_y_dm = -2000 },
+	};
+	pasture.fences[0].m.n_points = ARRAY_SIZE(points);
+	memcpy(pasture.fences[0].coordinates, points, sizeof(points));
+	zassert_false(set_legacy_pasture_cache(&pasture), "");
+
+	uint8_t fence_index, vertex_index;
+	uint32_t skipped = fnc_get_dist_skip_count();
+
+	/* First fix is always exact. */
+	int16_t d = calc_dist_lazy(0, 0, limit, &fence_index, &vertex_index);
+	zassert_equal(-2000, d, "");
+	zassert_equal(skipped, fnc_get_dist_skip_count(), "");
+
+	/* Moving towards the fence gives an upper bound, never below the 
+	 * exact distance, until it gets close to the limit.
+	 */
+	int16_t x = 0;
+	while (true) {
+		x += 37;
+		int16_t exact = calc_dist(x, 10, &fence_index, &vertex_index);
+		d = calc_dist_lazy(x, 10, limit, &fence_index, &vertex_index);
+		zassert_true(d >= exact, "Bound %d below exact %d", d, exact);
+		if (d == exact) {
+			break;
+		}
+		zassert_true(d + CONFIG_AMC_DIST_SAFE_RADIUS_MARGIN_DM < limit, "");
+	}
+	zassert_true(fnc_get_dist_skip_count() > skipped, "");
+	zassert_true(d + CONFIG_AMC_DIST_SAFE_RADIUS_MARGIN_DM >= limit - 50, "");
+
+	/* Never skipped with the limit below the distance. */
+	skipped = fnc_get_dist_skip_count();
+	d = calc_dist_lazy(x + 1, 10, INT16_MIN, &fence_index, &vertex_index);
+	zassert_equal(calc_dist(x + 1, 10, &fence_index, &vertex_index), d, "");
+	zassert_equal(skipped, fnc_get_dist_skip_count(), "");
+
+	/* A new pasture invalidates the last exact distance. */
+	zassert_false(set_legacy_pasture_cache(&pasture), "");
+	d = calc_dist_lazy(x, 10, 0, &fence_index, &vertex_index);
+	zassert_equal(calc_dist(x, 10, &fence_index, &vertex_index), d, "");
+	zassert_equal(skipped, fnc_get_dist_skip_count(), "");
+}
@@ -0,0 +1,44 @@
+#include "amc_test_common.h"
+#include "amc_const.h"
+#include "nf_fifo.h"
+#include <ztest.h>
+
+FIFO_STATS_DEFINE(test_fifo, FIFO_AVG_DISTANCE_ELEMENTS);
+static int16_t test_array[FIFO_AVG_DISTANCE_ELEMENTS];
+
+static void check_fifo_stats(void)
+{
+	uint8_t size = FIFO_AVG_DISTANCE_ELEMENTS;
+
+	zassert_equal(fifo_stats_avg(&test_fifo), fifo_avg(test_array, size), "");
+	zassert_equal(fifo_stats_slope(&test_fifo), fifo_slope(test_array, size), "");
+	zassert_equal(fifo_stats_inc_cnt(&test_fifo), fifo_inc_cnt(test_array, size), "");
+	zassert_equal(fifo_stats_dec_cnt(&test_fifo), fifo_dec_cnt(test_array, size), "");
+	zassert_equal(fifo_stats_min(&test_fifo), fifo_min(test_array, size), "");
+	zassert_equal(fifo_stats_max(&test_fifo), fifo_max(test_array, size), "");
+	zassert_equal(fifo_stats_delta(&test_fifo), fifo_delta(test_array, size), "");
+}
+
+void test_fifo_stats(void)
+{
+	/* Starts as a zeroed fifo array. */
+	check_fifo_stats();
+
+	/* Gives the same statistics as the fifo array functions, for small
+	 * steps with many equal values, and for large random steps. 
+	 */
+	uint32_t seed = 1;
+	for (int n = 0; n < 5000; n++) {
+		seed = seed * 1103515245 + 12345;
+		int16_t in = (n % 3 == 0) ? (int16_t)(seed >> 16) : (int16_t)((seed >> 16) % 7) - 3;
+
+		if (n % 97 == 0) {
+			fifo_fill(test_array, FIFO_AVG_DISTANCE_ELEMENTS);
+			fifo_stats_fill(&test_fifo);
+		} else {
+			fifo_put(in, test_array, FIFO_AVG_DISTANCE_ELEMENTS);
+			fifo_stats_put(in, &test_fifo);
+		}
+		check_fifo_stats();
+	}
+}
@@ -1,5 +1,6 @@
 #include "amc_test_common.h"
 #include "amc_gnss.h"
+#include "amc_gnss_sched.h"
 #include <ztest.h>
 #include "amc_states_cache.h"
 #include "embedded.pb.h"
@@ -232,6 +233,56 @@ void test_gnss_mode(void)
 	zassert_equal(current_gnss_mode, GNSSMODE_PSM, "");
 }
 
+void test_gnss_sched(void)
+{
+	gnss_t fix;
+	memset(&fix, 0, sizeof(fix));
+
+	/* No accepted fix yet, default rate of the mode. */
+	gnss_sched_reset();
+	zassert_equal(gnss_sched_get_rate(PSM_ZONE, STATE_NORMAL), 0, "");
+
+	/* 355 dm to the caution zone, 11.8 s at the speed of a moving animal. */
+	gnss_sched_update(-500, &fix);
+	zassert_equal(gnss_sched_get_rate(PSM_ZONE, STATE_NORMAL), 10000, "");
+
+	/* Limited by the longest rate when the animal rests. */
+	zassert_equal(gnss_sched_get_rate(PSM_ZONE, STATE_SLEEP), 30000, "");
+
+	/* GNSS speed noise of a resting animal, in mm/s as given by the
+	 * receiver, does not shorten the rate.
+	 */
+	fix.latest.speed = 150;
+	gnss_sched_update(-500, &fix);
+	zassert_equal(gnss_sched_get_rate(PSM_ZONE, STATE_SLEEP), 30000, "");
+
+	/* Walking below the speed bound, 11.8 s. */
+	fix.latest.speed = 1200;
+	gnss_sched_update(-500, &fix);
+	zassert_equal(gnss_sched_get_rate(PSM_ZONE, STATE_NORMAL), 10000, "");
+
+	/* Ground speed above the speed bound, 7.1 s. */
+	fix.latest.speed = 5000;
+	gnss_sched_update(-500, &fix);
+	zassert_equal(gnss_sched_get_rate(PSM_ZONE, STATE_NORMAL), 6000, "");
+
+	/* Close to the prewarn zone, the shortest scheduled rate. */
+	fix.latest.speed = 0;
+	gnss_sched_update(-100, &fix);
+	zassert_equal(gnss_sched_get_rate(CAUTION_ZONE, STATE_NORMAL), 2000, "");
+
+	/* Within the margin, default rate of the mode. */
+	gnss_sched_update(-90, &fix);
+	zassert_equal(gnss_sched_get_rate(CAUTION_ZONE, STATE_NORMAL), 0, "");
+
+	/* Only PSM and caution zone are scheduled. */
+	gnss_sched_update(-500, &fix);
+	zassert_equal(gnss_sched_get_rate(WARN_ZONE, STATE_NORMAL), 0, "");
+
+	gnss_sched_reset();
+	zassert_equal(gnss_sched_get_rate(PSM_ZONE, STATE_NORMAL), 0, "");
+}
+
 static bool event_handler(const struct event_header *eh)
 {
 	if (is_gnss_set_mode_event(eh)) {
@@ -0,0 +1,52 @@
+#include "amc_test_common.h"
+#include "nf_latency.h"
+#include <ztest.h>
+
+static void record_us(latency_stage_t stage, uint32_t us)
+{
+	latency_record(stage, k_cycle_get_32() - k_us_to_cyc_ceil32(us));
+}
+
+void test_latency_stats(void)
+{
+	latency_stats_t stats;
+
+	/* The AMC does not release pulses in these tests, so this stage is
+	 * only recorded here.
+	 */
+	latency_reset();
+	zassert_equal(latency_get_stats(LATENCY_PULSE, &stats), 0, "");
+	zassert_equal(stats.count, 0, "");
+	zassert_equal(stats.p99_us, 0, "");
+	zassert_equal(latency_get_stats(LATENCY_STAGES, &stats), -EINVAL, "");
+
+	/* Unknown timestamps are ignored. */
+	latency_record(LATENCY_PULSE, 0);
+	zassert_ok(latency_get_stats(LATENCY_PULSE, &stats), "");
+	zassert_equal(stats.count, 0, "");
+
+	/* One outlier in 100 samples is above the 99th percentile. */
+	for (int i = 0; i < 99; i++) {
+		record_us(LATENCY_PULSE, 1000);
+	}
+	record_us(LATENCY_PULSE, 100000);
+
+	zassert_ok(latency_get_stats(LATENCY_PULSE, &stats), "");
+	zassert_equal(stats.count, 100, "");
+	zassert_within(stats.min_us, 1000, 100, "min %d", stats.min_us);
+	zassert_within(stats.max_us, 100000, 100, "max %d", stats.max_us);
+	zassert_within(stats.avg_us, 1990, 100, "avg %d", stats.avg_us);
+	zassert_true(stats.p99_us >= stats.min_us && stats.p99_us < 1250, "p99 %d",
+		     stats.p99_us);
+
+	/* With more outliers, the p99 is in their bucket, bounded by the max. */
+	for (int i = 0; i < 10; i++) {
+		record_us(LATENCY_PULSE, 100000);
+	}
+	zassert_ok(latency_get_stats(LATENCY_PULSE, &stats), "");
+	zassert_equal(stats.p99_us, stats.max_us, "p99 %d", stats.p99_us);
+
+	latency_reset();
+	zassert_ok(latency_get_stats(LATENCY_PULSE, &stats), "");
+	zassert_equal(stats.count, 0, "");
+}
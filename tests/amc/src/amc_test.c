@@ -69,14 +69,14 @@ void test_init_and_update_pasture(void)
 void test_set_get_pasture(void)
 {
 	/* Pasture. */
-	pasture_t pasture = {
-		.m.ul_total_fences = 1,
-	};
+	static uint8_t pasture_buf[PASTURE_MAX_SIZE] __aligned(4);
+	pasture_t *pasture = (pasture_t *)pasture_buf;
+	zassert_false(pasture_init(pasture, sizeof(pasture_buf), 1), "");
 
 	/* Fences. */
-	pasture.fences[0].m.e_fence_type = FenceDefinitionMessage_FenceType_Normal;
-	pasture.fences[0].m.us_id = 0;
-	pasture.fences[0].m.fence_no = 0;
+	fence_t fence = { .m = { .e_fence_type = FenceDefinitionMessage_FenceType_Normal,
+				 .us_id = 0,
+				 .fence_no = 0 } };
 
 	/* Coordinates. */
 	fence_coordinate_t points1[] = {
@@ -84,22 +84,115 @@ void test_set_get_pasture(void)
 		{ .s_x_dm = -10, .s_y_dm = 10 }, { .s_x_dm = -10, .s_y_dm = -10 },
 		{ .s_x_dm = 10, .s_y_dm = -10 },
 	};
-	pasture.fences[0].m.n_points = sizeof(points1) / sizeof(points1[0]);
-	memcpy(&pasture.fences[0].coordinates[0], points1, sizeof(points1));
+	fence.m.n_points = sizeof(points1) / sizeof(points1[0]);
+	zassert_false(pasture_add_fence(pasture, sizeof(pasture_buf), 0, &fence, points1), "");
 
-	zassert_false(set_pasture_cache((uint8_t *)&pasture, sizeof(pasture)), "");
+	zassert_false(set_pasture_cache(pasture_buf, pasture_size(pasture)), "");
 
-	pasture_t wrong_pasture;
-	memset(&wrong_pasture, 0, sizeof(pasture_t));
-	pasture_t *new_pasture = &wrong_pasture;
+	pasture_t *new_pasture = NULL;
 	zassert_false(get_pasture_cache(&new_pasture), "");
-	zassert_mem_equal(&pasture, new_pasture, sizeof(pasture_t), "");
+	zassert_equal(pasture_size(new_pasture), pasture_size(pasture), "");
+	zassert_mem_equal(pasture, new_pasture, pasture_size(pasture), "");
+
+	/* A truncated pasture is rejected. */
+	zassert_equal(set_pasture_cache(pasture_buf, pasture_size(pasture) - 1), -EINVAL, "");
+}
+
+void test_set_legacy_pasture(void)
+{
+	/* Pasture in the fixed size layout of earlier firmware. */
+	static pasture_legacy_t legacy;
+	memset(&legacy, 0, sizeof(legacy));
+	legacy.m.ul_total_fences = 2;
+	legacy.m.ul_fence_def_version = 1337;
+
+	fence_coordinate_t points1[] = {
+		{ .s_x_dm = 10, .s_y_dm = -10 }, { .s_x_dm = 10, .s_y_dm = 10 },
+		{ .s_x_dm = -10, .s_y_dm = 10 }, { .s_x_dm = -10, .s_y_dm = -10 },
+		{ .s_x_dm = 10, .s_y_dm = -10 },
+	};
+	for (uint8_t f = 0; f < legacy.m.ul_total_fences; f++) {
+		legacy.fences[f].m.e_fence_type = FenceDefinitionMessage_FenceType_Normal;
+		legacy.fences[f].m.fence_no = f;
+		legacy.fences[f].m.n_points = sizeof(points1) / sizeof(points1[0]) - f;
+		memcpy(legacy.fences[f].coordinates, points1, sizeof(points1));
+	}
+
+	/* Is converted to the packed layout when cached. */
+	zassert_false(set_pasture_cache((uint8_t *)&legacy, sizeof(legacy)), "");
+
+	pasture_t *pasture = NULL;
+	zassert_false(get_pasture_cache(&pasture), "");
+	zassert_mem_equal(&pasture->m, &legacy.m, sizeof(legacy.m), "");
+	zassert_equal(pasture->n_coordinates, 9, "");
+	zassert_equal(pasture_size(pasture), PASTURE_SIZE(2, 9), "");
+	for (uint8_t f = 0; f < legacy.m.ul_total_fences; f++) {
+		zassert_mem_equal(&pasture->fences[f].m, &legacy.fences[f].m,
+				  sizeof(legacy.fences[f].m), "");
+		zassert_mem_equal(pasture_fence_coordinates(pasture, &pasture->fences[f]),
+				  legacy.fences[f].coordinates,
+				  legacy.fences[f].m.n_points * sizeof(fence_coordinate_t), "");
+	}
+	zassert_true(fnc_valid_fence(pasture), "");
+}
+
+void test_pasture_cache_pin(void)
+{
+	static uint8_t pasture_buf[PASTURE_SIZE(0, 0)] __aligned(4);
+	pasture_t *pasture = (pasture_t *)pasture_buf;
+	zassert_false(pasture_init(pasture, sizeof(pasture_buf), 0), "");
+
+	pasture->m.ul_fence_def_version = 1;
+	zassert_false(set_pasture_cache(pasture_buf, pasture_size(pasture)), "");
+
+	/* A pinned pasture stays intact while a new one is published. */
+	pasture_t *pinned = NULL;
+	uint8_t slot = pasture_cache_pin(&pinned);
+	zassert_equal(pinned->m.ul_fence_def_version, 1, "");
+
+	pasture->m.ul_fence_def_version = 2;
+	zassert_false(set_pasture_cache(pasture_buf, pasture_size(pasture)), "");
+
+	pasture_t *published = NULL;
+	zassert_false(get_pasture_cache(&published), "");
+	zassert_equal(published->m.ul_fence_def_version, 2, "");
+	zassert_equal(pinned->m.ul_fence_def_version, 1, "");
+	zassert_not_equal(pinned, published, "");
+
+	/* Once unpinned, its slot is reused for the next pasture. */
+	pasture_cache_unpin(slot);
+	pasture->m.ul_fence_def_version = 3;
+	zassert_false(set_pasture_cache(pasture_buf, pasture_size(pasture)), "");
+	zassert_false(get_pasture_cache(&published), "");
+	zassert_equal(published, pinned, "");
+	zassert_equal(published->m.ul_fence_def_version, 3, "");
+
+	/* A pasture of earlier firmware that can not be converted is not
+	 * published.
+	 */
+	static pasture_legacy_t legacy = { .m.ul_total_fences = 1 };
+
+	legacy.fences[0].m.n_points = FENCE_MAX_TOTAL_COORDINATES + 1;
+	zassert_not_equal(set_pasture_cache((uint8_t *)&legacy, sizeof(legacy)), 0, "");
+	zassert_false(get_pasture_cache(&published), "");
+	zassert_equal(published, pinned, "");
+	zassert_equal(published->m.ul_fence_def_version, 3, "");
+
+	/* A staged pasture is only used once published. */
+	pasture->m.ul_fence_def_version = 4;
+	zassert_false(pasture_cache_stage(pasture_buf, pasture_size(pasture)), "");
+	zassert_false(get_pasture_cache(&published), "");
+	zassert_equal(published->m.ul_fence_def_version, 3, "");
+	zassert_false(pasture_cache_publish(), "");
+	zassert_false(get_pasture_cache(&published), "");
+	zassert_equal(published->m.ul_fence_def_version, 4, "");
+	zassert_equal(pasture_cache_publish(), -EALREADY, "");
 }
 
 void test_fnc_valid_fence_exists(void)
 {
 	/* Pasture. */
-	pasture_t pasture = {
+	pasture_legacy_t pasture = {
 		.m.ul_total_fences = 1,
 	};
 
@@ -117,17 +210,24 @@ void test_fnc_valid_fence_exists(void)
 	};
 	pasture.fences[0].m.n_points = sizeof(points1) / sizeof(points1[0]);
 	memcpy(pasture.fences[0].coordinates, points1, sizeof(points1));
-	zassert_false(set_pasture_cache((uint8_t *)&pasture, sizeof(pasture)), "");
-	zassert_true(fnc_valid_fence(), "");
+	zassert_false(set_legacy_pasture_cache(&pasture), "");
+
+	pasture_t *cached = NULL;
+	zassert_false(get_pasture_cache(&cached), "");
+	zassert_true(fnc_valid_fence(cached), "");
 }
 
 void test_empty_fence(void)
 {
-	pasture_t pasture = {
-		.m.ul_total_fences = 0,
-	};
-	zassert_false(set_pasture_cache((uint8_t *)&pasture, sizeof(pasture)), "");
-	zassert_false(fnc_valid_fence(), "");
+	static uint8_t pasture_buf[PASTURE_SIZE(0, 0)] __aligned(4);
+	pasture_t *pasture = (pasture_t *)pasture_buf;
+
+	zassert_false(pasture_init(pasture, sizeof(pasture_buf), 0), "");
+	zassert_false(set_pasture_cache(pasture_buf, pasture_size(pasture)), "");
+
+	pasture_t *cached = NULL;
+	zassert_false(get_pasture_cache(&cached), "");
+	zassert_false(fnc_valid_fence(cached), "");
 }
 
 void test_update_pasture(void)
@@ -137,7 +237,7 @@ void test_update_pasture(void)
 	 * new fence definition and fence status (NotStarted) to server.
 	 */
 
-	/* update_pasture_from_stg() */
+	/* stage_new_fence_fn() */
 	ztest_returns_value(stg_read_pasture_data, 0);
 
 	/* Read keep mode from storage and set teach mode */
@@ -182,7 +282,7 @@ void test_update_pasture_teach_mode(void)
 	 * server. 
 	 */
 
-	/* update_pasture_from_stg() */
+	/* stage_new_fence_fn() */
 	ztest_returns_value(stg_read_pasture_data, 0);
 
 	/* Fails to read keep_mode from storage */
@@ -223,7 +323,7 @@ void test_update_pasture_stg_fail(void)
 	 * If read from storage fails, send error event and return immediately.
 	 */
 
-	/* update_pasture_from_stg() */
+	/* stage_new_fence_fn() */
 	ztest_returns_value(stg_read_pasture_data, -1); //Fails to read
 
 	/* handle_states_fn()/calc_mode() */
@@ -255,16 +355,22 @@ static void update_position(int32_t origin_lat, int32_t origin_lon, int delta_la
 	my_lat += delta_lat;
 	my_lon += delta_lon;
 
+	gnss_t *gnss = gnss_snapshot_alloc();
+	zassert_not_null(gnss, "No free GNSS snapshot");
+	memset(gnss, 0, sizeof(gnss_t));
+	gnss->fix_ok = true;
+	gnss->has_lastfix = true;
+	gnss->latest.pvt_flags = 1;
+	gnss->latest.num_sv = 7;
+	gnss->latest.h_dop = 80;
+	gnss->latest.h_acc_dm = 65;
+	gnss->latest.height = 100;
+	gnss->latest.lat = my_lat;
+	gnss->latest.lon = my_lon;
+
 	struct gnss_data *new_position = new_gnss_data();
-	new_position->gnss_data.fix_ok = true;
-	new_position->gnss_data.has_lastfix = true;
-	new_position->gnss_data.latest.pvt_flags = 1;
-	new_position->gnss_data.latest.num_sv = 7;
-	new_position->gnss_data.latest.h_dop = 80;
-	new_position->gnss_data.latest.h_acc_dm = 65;
-	new_position->gnss_data.latest.height = 100;
-	new_position->gnss_data.latest.lat = my_lat;
-	new_position->gnss_data.latest.lon = my_lon;
+	new_position->gnss_data = gnss;
+	new_position->timed_out = false;
 	EVENT_SUBMIT(new_position);
 	return;
 }
@@ -273,7 +379,7 @@ void test_update_pasture_integration(void)
 {
 	/* set pasture cache to a 20x20 offset by 1000m to the right from the
 	 * origin. */
-	pasture_t pasture = {
+	pasture_legacy_t pasture = {
 		.m.ul_total_fences = 1,
 		.m.ul_fence_def_version = 1337, //todo: set_pasture_cache is
 		// not updating this value in the unit tests!
@@ -293,14 +399,14 @@ void test_update_pasture_integration(void)
 	};
 	pasture.fences[0].m.n_points = sizeof(points1) / sizeof(points1[0]);
 	memcpy(&pasture.fences[0].coordinates[0], points1, sizeof(points1));
-	zassert_false(set_pasture_cache((uint8_t *)&pasture, sizeof(pasture)), "");
+	zassert_false(set_legacy_pasture_cache(&pasture), "");
 	pasture_t *new_pasture = NULL;
 	zassert_false(get_pasture_cache(&new_pasture), "");
-	zassert_mem_equal(&pasture, new_pasture, sizeof(pasture_t), "");
+	zassert_mem_equal(&pasture.m, &new_pasture->m, sizeof(pasture.m), "");
 	k_sem_reset(&fence_sema);
 	//	zassert_equal(k_sem_take(&fence_sema, K_SECONDS(10)), 0, "");
 
-	/* update_pasture_from_stg() */
+	/* stage_new_fence_fn() */
 	ztest_returns_value(stg_read_pasture_data, 0);
 
 	/* Read keep mode from storage */
@@ -313,7 +419,7 @@ void test_update_pasture_integration(void)
 	struct new_fence_available *event = new_new_fence_available();
 	event->new_fence_version = pasture.m.ul_fence_def_version;
 	EVENT_SUBMIT(event);
-	zassert_false(set_pasture_cache((uint8_t *)&pasture, sizeof(pasture)), "");
+	zassert_false(set_legacy_pasture_cache(&pasture), "");
 
 	// for (int i=0; i<100; i++) {
 	// 	update_position(1, 1);
@@ -327,7 +433,7 @@ void test_warning_beacon_scan(void)
 	 * Test that beacon scanning is triggered when the AMC zone is updated from a non-warning zone
 	 * to a prewarn (PREWARN_ZONE)- or warn zone (WARN_ZONE).
 	 */
-	pasture_t pasture = {
+	pasture_legacy_t pasture = {
 		.m.ul_total_fences = 1,
 		.m.ul_fence_def_version = 1337,
 		.m.l_origin_lat = 100000000,
@@ -346,7 +452,7 @@ void test_warning_beacon_scan(void)
 	};
 	pasture.fences[0].m.n_points = sizeof(points1) / sizeof(points1[0]);
 	memcpy(pasture.fences[0].coordinates, points1, sizeof(points1));
-	zassert_false(set_pasture_cache((uint8_t *)&pasture, sizeof(pasture)), "");
+	zassert_false(set_legacy_pasture_cache(&pasture), "");
 
 	zone_set(NO_ZONE);
 
@@ -490,7 +596,8 @@ void test_main(void)
 {
 	ztest_test_suite(
 		amc_tests, ztest_unit_test(test_init_and_update_pasture),
-		ztest_unit_test(test_set_get_pasture), ztest_unit_test(test_fnc_valid_fence_exists),
+		ztest_unit_test(test_set_get_pasture), ztest_unit_test(test_set_legacy_pasture),
+		ztest_unit_test(test_pasture_cache_pin), ztest_unit_test(test_fnc_valid_fence_exists),
 		ztest_unit_test(test_empty_fence), ztest_unit_test(test_update_pasture_teach_mode),
 		ztest_unit_test(test_update_pasture_stg_fail), ztest_unit_test(test_update_pasture),
 		ztest_unit_test(test_warning_beacon_scan), ztest_unit_test(test_zone_update_evt),
@@ -502,14 +609,24 @@ void test_main(void)
 			 ztest_unit_test(test_fnc_calc_dist_rect),
 			 ztest_unit_test(test_fnc_calc_dist_2_fences_hole),
 			 ztest_unit_test(test_fnc_calc_dist_2_fences_hole2),
-			 ztest_unit_test(test_fnc_calc_dist_2_fences_max_size));
+			 ztest_unit_test(test_fnc_calc_dist_2_fences_max_size),
+			 ztest_unit_test(test_fnc_calc_dist_random_pastures),
+			 ztest_unit_test(test_fnc_calc_dist_random_tracks),
+			 ztest_unit_test(test_fnc_calc_dist_exact_kernels),
+			 ztest_unit_test(test_fnc_calc_dist_lazy));
 	ztest_run_test_suite(amc_dist_tests);
 
 	ztest_test_suite(amc_zone_tests, ztest_unit_test(test_zone_calc));
 	ztest_run_test_suite(amc_zone_tests);
 
+	ztest_test_suite(amc_fifo_tests, ztest_unit_test(test_fifo_stats));
+	ztest_run_test_suite(amc_fifo_tests);
+
+	ztest_test_suite(amc_latency_tests, ztest_unit_test(test_latency_stats));
+	ztest_run_test_suite(amc_latency_tests);
+
 	ztest_test_suite(amc_gnss_tests, ztest_unit_test(test_gnss_fix),
-			 ztest_unit_test(test_gnss_mode));
+			 ztest_unit_test(test_gnss_mode), ztest_unit_test(test_gnss_sched));
 
 	ztest_run_test_suite(amc_gnss_tests);
 
@@ -5,17 +5,33 @@
 #ifndef _AMC_TEST_COMMON_H_
 #define _AMC_TEST_COMMON_H_
 
+#include "pasture_structure.h"
+
 void test_fnc_calc_dist_quadratic(void);
 void test_fnc_calc_dist_quadratic_max(void);
 void test_fnc_calc_dist_rect(void);
 void test_fnc_calc_dist_2_fences_hole(void);
 void test_fnc_calc_dist_2_fences_hole2(void);
 void test_fnc_calc_dist_2_fences_max_size(void);
+void test_fnc_calc_dist_random_pastures(void);
+void test_fnc_calc_dist_random_tracks(void);
+void test_fnc_calc_dist_exact_kernels(void);
+void test_fnc_calc_dist_lazy(void);
+
+/* Pasture helper functions. */
+int set_legacy_pasture_cache(pasture_legacy_t *legacy);
+
+void test_set_legacy_pasture(void);
+void test_pasture_cache_pin(void);
 
 void test_zone_calc(void);
 
+void test_fifo_stats(void);
+void test_latency_stats(void);
+
 void test_gnss_fix(void);
 void test_gnss_mode(void);
+void test_gnss_sched(void);
 void test_propagate_movement_out_event(void);
 
 void test_collar_status(void);
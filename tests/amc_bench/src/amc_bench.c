@@ -0,0 +1,380 @@
+/*
+ * Copyright (c) 2022 Nofence AS
+ */
+
+#include <ztest.h>
+#include <event_manager.h>
+#include "amc_cache.h"
+#include "amc_dist.h"
+#include "amc_zone.h"
+#include "amc_gnss.h"
+#include "amc_correction.h"
+#include "amc_const.h"
+#include "pasture_structure.h"
+#include "embedded.pb.h"
+
+#if CONFIG_ARCH_POSIX
+/* Simulated time does not advance while the CPU is busy on native_posix,
+ * so the host clock is used instead.
+ */
+#include <time.h>
+#endif
+
+/* Number of positions evaluated per benchmark case. */
+#define BENCH_POSITIONS 2000
+
+/* Number of passes over the positions, the fastest is reported. */
+#define BENCH_PASSES 5
+
+static uint8_t pasture_buf[PASTURE_MAX_SIZE] __aligned(4);
+static pasture_t *const pasture = (pasture_t *)pasture_buf;
+static int16_t pos_x[BENCH_POSITIONS];
+static int16_t pos_y[BENCH_POSITIONS];
+static int16_t dists[BENCH_POSITIONS];
+
+static uint32_t rand_state;
+
+/* Deterministic pseudo random number in [lo, hi], so that the output can be
+ * compared between commits.
+ */
+static int32_t bench_rand(int32_t lo, int32_t hi)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return lo + (int32_t)((rand_state >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+static uint64_t bench_now_ns(void)
+{
+#if CONFIG_ARCH_POSIX
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+#else
+	return k_cyc_to_ns_floor64(k_cycle_get_32());
+#endif
+}
+
+/** @brief Prints one result line. Lines starting with BENCH are
+ *         comma separated, with the columns given by bench_print_header, and
+ *         can be extracted from the console output and diffed between commits.
+ */
+static void bench_print(const char *name, const char *positions, uint8_t n_fences,
+			uint8_t n_points, bool inverted, uint64_t best_ns, uint32_t checksum)
+{
+	uint32_t ns_per_call = (uint32_t)(best_ns / BENCH_POSITIONS);
+	uint32_t calls_per_sec =
+		(best_ns == 0) ? UINT32_MAX : (uint32_t)((NSEC_PER_SEC * BENCH_POSITIONS) / best_ns);
+
+	printk("BENCH,%s,%s,%u,%u,%u,%u,%u,%u,%08x\n", name, positions, n_fences, n_points,
+	       inverted, BENCH_POSITIONS, ns_per_call, calls_per_sec, checksum);
+}
+
+static void bench_print_header(void)
+{
+	printk("BENCH,function,positions,fences,points,inverted,calls,ns_per_call,"
+	       "calls_per_sec,checksum\n");
+}
+
+/* Adds a star shaped, closed polygon around (cx, cy), with vertices on a
+ * square of the given half size, randomly pulled up to 30% towards the center.
+ */
+static void bench_add_fence(uint8_t index, uint8_t type, uint8_t n_points, int32_t cx,
+			    int32_t cy, int32_t half_size)
+{
+	fence_t fence = { .m = { .us_id = index,
+				 .n_points = n_points,
+				 .e_fence_type = type,
+				 .fence_no = index } };
+	fence_coordinate_t coordinates[FENCE_MAX_TOTAL_COORDINATES];
+	uint8_t n_corners = n_points - 1;
+	int32_t perimeter = 8 * half_size;
+
+	for (uint8_t i = 0; i < n_corners; i++) {
+		int32_t t = (perimeter * i) / n_corners;
+		int32_t side = t / (2 * half_size);
+		int32_t s = t % (2 * half_size) - half_size;
+		int32_t x, y;
+
+		switch (side) {
+		case 0:
+			x = s;
+			y = -half_size;
+			break;
+		case 1:
+			x = half_size;
+			y = s;
+			break;
+		case 2:
+			x = -s;
+			y = half_size;
+			break;
+		default:
+			x = -half_size;
+			y = -s;
+			break;
+		}
+
+		int32_t scale = 100 - bench_rand(0, 30);
+		coordinates[i].s_x_dm = cx + (x * scale) / 100;
+		coordinates[i].s_y_dm = cy + (y * scale) / 100;
+	}
+	coordinates[n_corners] = coordinates[0];
+
+	zassert_false(pasture_add_fence(pasture, sizeof(pasture_buf), index, &fence, coordinates),
+		      "");
+}
+
+/** @brief Builds a synthetic pasture and caches it. Without inverted fences
+ *         the fences are separate pastures on a grid, otherwise the first
+ *         fence is a large pasture with the others as holes inside it.
+ */
+static void bench_build_pasture(uint8_t n_fences, uint8_t n_points, bool inverted)
+{
+	zassert_false(pasture_init(pasture, sizeof(pasture_buf), n_fences), "");
+	rand_state = 1;
+	pasture->m.ul_fence_def_version = 1;
+	pasture->m.status = FenceStatus_FenceStatus_Normal;
+
+	for (uint8_t f = 0; f < n_fences; f++) {
+		if (!inverted) {
+			bench_add_fence(f, FenceDefinitionMessage_FenceType_Normal, n_points,
+					(f % 4) * 9000 - 13500, (f / 4) * 9000 - 9000, 4000);
+		} else if (f == 0) {
+			bench_add_fence(f, FenceDefinitionMessage_FenceType_Normal, n_points, 0,
+					0, 12000);
+		} else {
+			bench_add_fence(f, FenceDefinitionMessage_FenceType_Inverted, n_points,
+					((f - 1) % 3 - 1) * 6000, ((f - 1) / 3 - 1) * 6000, 1500);
+		}
+	}
+
+	zassert_false(set_pasture_cache(pasture_buf, pasture_size(pasture)), "");
+}
+
+/* Uniformly random positions over the area covered by the pastures. */
+static void bench_random_positions(void)
+{
+	for (int n = 0; n < BENCH_POSITIONS; n++) {
+		pos_x[n] = bench_rand(-18000, 18000);
+		pos_y[n] = bench_rand(-18000, 18000);
+	}
+}
+
+/* A walk with a few dm between fixes from the first fence corner, with an
+ * occasional jump as when GNSS reacquires a position.
+ */
+static void bench_track_positions(void)
+{
+	const fence_coordinate_t *corner = pasture_fence_coordinates(pasture, &pasture->fences[0]);
+	int32_t x = corner->s_x_dm / 2;
+	int32_t y = corner->s_y_dm / 2;
+
+	for (int n = 0; n < BENCH_POSITIONS; n++) {
+		int32_t step = (bench_rand(0, 99) == 0) ? 2000 : 5;
+		x = CLAMP(x + bench_rand(-step, step), -18000, 18000);
+		y = CLAMP(y + bench_rand(-step, step), -18000, 18000);
+		pos_x[n] = x;
+		pos_y[n] = y;
+	}
+}
+
+static void bench_dist_case(const char *positions, uint8_t n_fences, uint8_t n_points,
+			    bool inverted)
+{
+	uint64_t best_ns = UINT64_MAX;
+	uint32_t checksum = 0;
+
+	for (int p = 0; p < BENCH_PASSES; p++) {
+		uint8_t fence_index, vertex_index;
+		pasture_t *pasture = NULL;
+		uint8_t slot = pasture_cache_pin(&pasture);
+
+		checksum = 0;
+		uint64_t start = bench_now_ns();
+		for (int n = 0; n < BENCH_POSITIONS; n++) {
+			dists[n] = fnc_calc_dist(pasture, slot, pos_x[n], pos_y[n], &fence_index,
+						 &vertex_index);
+		}
+		best_ns = MIN(best_ns, bench_now_ns() - start);
+		pasture_cache_unpin(slot);
+
+		for (int n = 0; n < BENCH_POSITIONS; n++) {
+			checksum = checksum * 31 + (uint16_t)dists[n];
+		}
+	}
+
+	bench_print("fnc_calc_dist", positions, n_fences, n_points, inverted, best_ns, checksum);
+}
+
+void test_bench_fnc_calc_dist(void)
+{
+	const uint8_t fence_counts[] = { 1, 2, 5, FENCE_MAX };
+	const uint8_t point_counts[] = { 3, 5, 10, 20, FENCE_MAX_TOTAL_COORDINATES };
+
+	bench_print_header();
+	for (int inverted = 0; inverted <= 1; inverted++) {
+		for (int f = 0; f < ARRAY_SIZE(fence_counts); f++) {
+			if (inverted && fence_counts[f] == 1) {
+				continue;
+			}
+			for (int p = 0; p < ARRAY_SIZE(point_counts); p++) {
+				bench_build_pasture(fence_counts[f], point_counts[p], inverted);
+
+				bench_random_positions();
+				bench_dist_case("random", fence_counts[f], point_counts[p],
+						inverted);
+
+				bench_track_positions();
+				bench_dist_case("track", fence_counts[f], point_counts[p],
+						inverted);
+			}
+		}
+	}
+}
+
+static gnss_t gnss_data = {
+	.latest = { .pvt_flags = 1, .msss = CONFIG_ZONE_MIN_TIME_SINCE_RESET + 1 },
+	.fix_ok = true,
+	.lastfix = { .pvt_flags = 1, .mode = GNSSMODE_CAUTION },
+	.has_lastfix = true
+};
+
+/* Distances sweeping back and forth between caution zone and the fence line,
+ * so that every zone transition above PSM zone is exercised.
+ */
+static void bench_sweep_dists(void)
+{
+	int16_t d = -100;
+	int16_t step = 1;
+
+	for (int n = 0; n < BENCH_POSITIONS; n++) {
+		dists[n] = d;
+		if (d == -100) {
+			step = 1;
+		} else if (d == 20) {
+			step = -1;
+		}
+		d += step;
+	}
+}
+
+void test_bench_zone_update(void)
+{
+	uint64_t best_ns = UINT64_MAX;
+	uint32_t checksum = 0;
+
+	bench_sweep_dists();
+	for (int p = 0; p < BENCH_PASSES; p++) {
+		amc_zone_t zone;
+
+		checksum = 0;
+		uint64_t start = bench_now_ns();
+		for (int n = 0; n < BENCH_POSITIONS; n++) {
+			zone_update(dists[n], &gnss_data, &zone);
+			checksum += zone;
+		}
+		best_ns = MIN(best_ns, bench_now_ns() - start);
+
+		/* Let the event manager process the zone change events. */
+		k_sleep(K_MSEC(10));
+	}
+
+	bench_print("zone_update", "sweep", 0, 0, false, best_ns, checksum);
+}
+
+void test_bench_gnss_update_dist_flags(void)
+{
+	uint64_t best_ns = UINT64_MAX;
+
+	zassert_equal(gnss_init(NULL), 0, "");
+	bench_sweep_dists();
+	for (int p = 0; p < BENCH_PASSES; p++) {
+		uint64_t start = bench_now_ns();
+		for (int n = 0; n < BENCH_POSITIONS; n++) {
+			gnss_update_dist_flags(n % 7 - 3, n % 5 - 2, DIST_INCR_SLOPE_LIM, n % 10,
+					       DIST_INCR_COUNT, n % 50, n % 200, dists[n], 20);
+		}
+		best_ns = MIN(best_ns, bench_now_ns() - start);
+	}
+
+	bench_print("gnss_update_dist_flags", "sweep", 0, 0, false, best_ns, 0);
+}
+
+void test_bench_process_correction(void)
+{
+	uint64_t best_ns = UINT64_MAX;
+
+	/* Without a warn fix or GNSS in max mode the correction is never
+	 * started, so no mocked collar state is needed.
+	 */
+	zassert_equal(gnss_init(NULL), 0, "");
+	bench_sweep_dists();
+	for (int p = 0; p < BENCH_PASSES; p++) {
+		uint64_t start = bench_now_ns();
+		for (int n = 0; n < BENCH_POSITIONS; n++) {
+			amc_zone_t zone = (dists[n] >= 0) ? WARN_ZONE : PREWARN_ZONE;
+
+			gnss_data.lastfix.updated_at = k_uptime_get_32();
+			process_correction(Mode_Fence, &gnss_data.lastfix,
+					   FenceStatus_FenceStatus_Normal, zone, dists[n], n % 5 - 2);
+		}
+		best_ns = MIN(best_ns, bench_now_ns() - start);
+	}
+	zassert_equal(get_correction_status(), 0, "");
+
+	bench_print("process_correction", "sweep", 0, 0, false, best_ns, 0);
+}
+
+/* All AMC library calls made for one fix by the AMC handler. */
+void test_bench_fix_pipeline(void)
+{
+	const uint8_t fence_counts[] = { 1, FENCE_MAX };
+
+	zassert_equal(gnss_init(NULL), 0, "");
+	for (int f = 0; f < ARRAY_SIZE(fence_counts); f++) {
+		uint64_t best_ns = UINT64_MAX;
+		uint32_t checksum = 0;
+
+		bench_build_pasture(fence_counts[f], FENCE_MAX_TOTAL_COORDINATES, false);
+		bench_track_positions();
+		for (int p = 0; p < BENCH_PASSES; p++) {
+			uint8_t fence_index, vertex_index;
+			amc_zone_t zone;
+
+			checksum = 0;
+			uint64_t start = bench_now_ns();
+			for (int n = 0; n < BENCH_POSITIONS; n++) {
+				pasture_t *pasture = NULL;
+				uint8_t slot = pasture_cache_pin(&pasture);
+				int16_t dist = fnc_calc_dist(pasture, slot, pos_x[n], pos_y[n],
+							     &fence_index, &vertex_index);
+				pasture_cache_unpin(slot);
+				zone_update(dist, &gnss_data, &zone);
+				gnss_update_dist_flags(0, 0, DIST_INCR_SLOPE_LIM, 0,
+						       DIST_INCR_COUNT, 0, 0, dist, 20);
+				process_correction(Mode_Fence, &gnss_data.lastfix,
+						   FenceStatus_FenceStatus_Normal, zone, dist, 0);
+				checksum = checksum * 31 + (uint16_t)dist;
+			}
+			best_ns = MIN(best_ns, bench_now_ns() - start);
+
+			k_sleep(K_MSEC(10));
+		}
+
+		bench_print("fix_pipeline", "track", fence_counts[f], FENCE_MAX_TOTAL_COORDINATES,
+			    false, best_ns, checksum);
+	}
+}
+
+void test_main(void)
+{
+	zassert_false(event_manager_init(), "Error when initializing event manager");
+
+	ztest_test_suite(amc_bench, ztest_unit_test(test_bench_fnc_calc_dist),
+			 ztest_unit_test(test_bench_zone_update),
+			 ztest_unit_test(test_bench_gnss_update_dist_flags),
+			 ztest_unit_test(test_bench_process_correction),
+			 ztest_unit_test(test_bench_fix_pipeline));
+	ztest_run_test_suite(amc_bench);
+}
@@ -0,0 +1,147 @@
+/*
+ * Copyright (c) 2022 Nofence AS
+ */
+
+#include <zephyr.h>
+#include <device.h>
+#include <string.h>
+#include "replay_gnss.h"
+
+#define DT_DRV_COMPAT nofence_replay_gnss
+
+/* GNSS device driven by the replay harness. Commands always succeed, the
+ * receiver state that the AMC depends on, the mode, is kept here and
+ * reported in the replayed solutions.
+ */
+
+static gnss_data_cb_t data_cb = NULL;
+static gnss_mode_t current_mode = GNSSMODE_NOMODE;
+static uint16_t current_rate_ms = 1000;
+
+int replay_gnss_publish(const gnss_t *data)
+{
+	if (data_cb == NULL) {
+		return -ENODEV;
+	}
+	return data_cb(data);
+}
+
+gnss_mode_t replay_gnss_get_mode(void)
+{
+	return current_mode;
+}
+
+void replay_gnss_set_rate(uint16_t rate_ms)
+{
+	current_rate_ms = rate_ms;
+}
+
+static int replay_gnss_set_data_cb(const struct device *dev, gnss_data_cb_t gnss_data_cb)
+{
+	ARG_UNUSED(dev);
+	data_cb = gnss_data_cb;
+	return 0;
+}
+
+static int replay_gnss_setup(const struct device *dev, bool dummy)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(dummy);
+	return 0;
+}
+
+static int replay_gnss_reset(const struct device *dev, uint16_t mask, uint8_t mode)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(mask);
+	ARG_UNUSED(mode);
+	return 0;
+}
+
+static int replay_gnss_version_get(const struct device *dev,
+				   struct ublox_mon_ver *pmia_m10_versions)
+{
+	ARG_UNUSED(dev);
+	memset(pmia_m10_versions, 0, sizeof(*pmia_m10_versions));
+	strncpy(pmia_m10_versions->swVersion, "REPLAY", MIA_M10_SW_VERSION_SIZE - 1);
+	strncpy(pmia_m10_versions->hwVersion, "REPLAY", MIA_M10_HW_VERSION_SIZE - 1);
+	return 0;
+}
+
+static int replay_gnss_upload_assist_data(const struct device *dev, uint8_t *data, uint32_t size)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(data);
+	ARG_UNUSED(size);
+	return 0;
+}
+
+static int replay_gnss_set_rate(const struct device *dev, uint16_t rate)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(rate);
+	return 0;
+}
+
+static int replay_gnss_get_rate(const struct device *dev, uint16_t *rate)
+{
+	ARG_UNUSED(dev);
+	*rate = current_rate_ms;
+	return 0;
+}
+
+static int replay_gnss_data_fetch(const struct device *dev, gnss_t *data)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(data);
+	return -ENODATA;
+}
+
+static int replay_gnss_set_backup_mode(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+	current_mode = GNSSMODE_INACTIVE;
+	return 0;
+}
+
+static int replay_gnss_wakeup(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+	return 0;
+}
+
+static int replay_gnss_resetn_pin(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+	return 0;
+}
+
+static int replay_gnss_set_power_mode(const struct device *dev, gnss_mode_t mode)
+{
+	ARG_UNUSED(dev);
+	current_mode = mode;
+	return 0;
+}
+
+static const struct gnss_driver_api replay_gnss_driver_funcs = {
+	.gnss_setup = replay_gnss_setup,
+	.gnss_reset = replay_gnss_reset,
+	.gnss_version_get = replay_gnss_version_get,
+	.gnss_upload_assist_data = replay_gnss_upload_assist_data,
+	.gnss_set_rate = replay_gnss_set_rate,
+	.gnss_get_rate = replay_gnss_get_rate,
+	.gnss_set_data_cb = replay_gnss_set_data_cb,
+	.gnss_data_fetch = replay_gnss_data_fetch,
+	.gnss_set_backup_mode = replay_gnss_set_backup_mode,
+	.gnss_resetn_pin = replay_gnss_resetn_pin,
+	.gnss_wakeup = replay_gnss_wakeup,
+	.gnss_set_power_mode = replay_gnss_set_power_mode
+};
+
+static int replay_gnss_init(const struct device *dev)
+{
+	return 0;
+}
+
+DEVICE_DT_INST_DEFINE(0, replay_gnss_init, NULL, NULL, NULL, POST_KERNEL, 90,
+		      &replay_gnss_driver_funcs);
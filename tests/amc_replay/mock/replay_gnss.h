@@ -0,0 +1,44 @@
+/*
+ * Copyright (c) 2022 Nofence AS
+ */
+
+#ifndef _REPLAY_GNSS_H_
+#define _REPLAY_GNSS_H_
+
+#include <zephyr.h>
+#include "gnss.h"
+
+/**
+ * @brief Publishes a replayed solution through the data callback of the
+ *        GNSS device, as the receiver driver does when an epoch is complete.
+ * 
+ * @param[in] data solution to publish.
+ * 
+ * @return 0 on success, -ENODEV if no callback is registered.
+ */
+int replay_gnss_publish(const gnss_t *data);
+
+/** @brief Gets the mode last requested through gnss_set_power_mode. */
+gnss_mode_t replay_gnss_get_mode(void);
+
+/**
+ * @brief Sets the rate reported by gnss_get_rate, which the GNSS controller
+ *        uses for its timeouts.
+ * 
+ * @param[in] rate_ms interval between the epochs of the replayed log.
+ */
+void replay_gnss_set_rate(uint16_t rate_ms);
+
+/**
+ * @brief Writes the pasture to replay against, implemented by the replay
+ *        harness and read by the AMC through stg_read_pasture_data.
+ * 
+ * @param[out] buf buffer for the packed pasture.
+ * @param[in] size size of buf.
+ * @param[out] len length of the pasture written to buf.
+ * 
+ * @return 0 on success, otherwise negative errno.
+ */
+int replay_pasture_get(uint8_t *buf, size_t size, size_t *len);
+
+#endif /* _REPLAY_GNSS_H_ */
@@ -0,0 +1,103 @@
+/*
+* Copyright (c) 2022 Nofence AS
+*/
+
+#include "stg_config.h"
+#include "embedded.pb.h"
+
+/* Configuration of a collar in fence mode, with a started fence. Writes are
+ * kept, so that the AMC reads back what it wrote during the replay.
+ */
+static uint32_t config[STG_PARAM_ID_CNT] = {
+	[STG_U8_PAIN_CNT_DEF_ESCAPED] = 3,
+	[STG_U8_COLLAR_MODE] = Mode_Fence,
+	[STG_U8_FENCE_STATUS] = FenceStatus_FenceStatus_Normal,
+	[STG_U8_COLLAR_STATUS] = CollarStatus_CollarStatus_Normal,
+	[STG_U8_TEACH_MODE_FINISHED] = 1,
+};
+
+int stg_config_u8_read(stg_config_param_id_t id, uint8_t *value)
+{
+	if (id >= STG_PARAM_ID_CNT) {
+		return -EINVAL;
+	}
+	*value = (uint8_t)config[id];
+	return 0;
+}
+
+int stg_config_u8_write(stg_config_param_id_t id, const uint8_t value)
+{
+	if (id >= STG_PARAM_ID_CNT) {
+		return -EINVAL;
+	}
+	config[id] = value;
+	return 0;
+}
+
+int stg_config_u16_read(stg_config_param_id_t id, uint16_t *value)
+{
+	if (id >= STG_PARAM_ID_CNT) {
+		return -EINVAL;
+	}
+	*value = (uint16_t)config[id];
+	return 0;
+}
+
+int stg_config_u16_write(stg_config_param_id_t id, const uint16_t value)
+{
+	if (id >= STG_PARAM_ID_CNT) {
+		return -EINVAL;
+	}
+	config[id] = value;
+	return 0;
+}
+
+int stg_config_u32_read(stg_config_param_id_t id, uint32_t *value)
+{
+	if (id >= STG_PARAM_ID_CNT) {
+		return -EINVAL;
+	}
+	*value = config[id];
+	return 0;
+}
+
+int stg_config_u32_write(stg_config_param_id_t id, const uint32_t value)
+{
+	if (id >= STG_PARAM_ID_CNT) {
+		return -EINVAL;
+	}
+	config[id] = value;
+	return 0;
+}
+
+int stg_config_str_read(stg_config_param_id_t id, char *str, uint8_t *len)
+{
+	ARG_UNUSED(id);
+	ARG_UNUSED(str);
+	*len = 0;
+	return 0;
+}
+
+int stg_config_str_write(stg_config_param_id_t id, const char *str, const uint8_t len)
+{
+	ARG_UNUSED(id);
+	ARG_UNUSED(str);
+	ARG_UNUSED(len);
+	return 0;
+}
+
+int stg_config_blob_read(stg_config_param_id_t id, uint8_t *arr, uint8_t *len)
+{
+	ARG_UNUSED(id);
+	ARG_UNUSED(arr);
+	*len = 0;
+	return 0;
+}
+
+int stg_config_blob_write(stg_config_param_id_t id, const uint8_t *arr, const uint8_t len)
+{
+	ARG_UNUSED(id);
+	ARG_UNUSED(arr);
+	ARG_UNUSED(len);
+	return 0;
+}
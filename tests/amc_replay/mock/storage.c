@@ -0,0 +1,16 @@
+#include <zephyr.h>
+#include "storage.h"
+#include "pasture_structure.h"
+#include "replay_gnss.h"
+
+static uint8_t pasture_buf[PASTURE_MAX_SIZE] __aligned(4);
+
+int stg_read_pasture_data(fcb_read_cb cb)
+{
+	size_t len = 0;
+	int err = replay_pasture_get(pasture_buf, sizeof(pasture_buf), &len);
+	if (err) {
+		return err;
+	}
+	return cb(pasture_buf, len);
+}
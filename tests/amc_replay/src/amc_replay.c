@@ -0,0 +1,578 @@
+/*
+ * Copyright (c) 2022 Nofence AS
+ */
+
+#include <ztest.h>
+#include <string.h>
+#include <sys/timeutil.h>
+#include <event_manager.h>
+#include "amc_handler.h"
+#include "amc_events.h"
+#include "amc_zone.h"
+#include "gnss_controller.h"
+#include "gnss_controller_events.h"
+#include "sound_event.h"
+#include "ep_event.h"
+#include "messaging_module_events.h"
+#include "pasture_structure.h"
+#include "ublox_protocol.h"
+#include "replay_gnss.h"
+
+#if CONFIG_ARCH_POSIX
+/* Simulated time only advances while the replay sleeps on native_posix,
+ * so the host clock is used to measure the throughput.
+ */
+#include <time.h>
+#endif
+
+/* Half the side of the square fence laid around the first fix. */
+#define REPLAY_SQUARE_HALF_DM 300
+
+/* Decimeters per 1e-5 degree of latitude, see gnss_calc_xy. */
+#define REPLAY_K_LAT 11132
+
+/* Time given to the AMC to settle after the last epoch. */
+#define REPLAY_DRAIN_MS 3000
+
+/* Milliseconds in a GPS week, where iTOW wraps. */
+#define REPLAY_MS_PER_WEEK 604800000UL
+
+#define REPLAY_FLAG_NAV_DOP (1 << 0)
+#define REPLAY_FLAG_NAV_PVT (1 << 1)
+#define REPLAY_FLAG_NAV_STATUS (1 << 2)
+#define REPLAY_FLAG_NAV_PL (1 << 3)
+
+#define REPLAY_FLAGS_EPOCH                                                                         \
+	(REPLAY_FLAG_NAV_DOP | REPLAY_FLAG_NAV_PVT | REPLAY_FLAG_NAV_STATUS | REPLAY_FLAG_NAV_PL)
+
+static uint8_t replay_track[] = {
+#include "replay_track.inc"
+};
+
+#ifdef REPLAY_PASTURE
+static const uint8_t replay_pasture[] __aligned(4) = {
+#include "replay_pasture.inc"
+};
+#endif
+
+/** @brief Decoder state, the same as in the MIA-M10 driver. */
+static struct {
+	/** Set while the log is scanned for its rate and first fix. */
+	bool scanning;
+
+	uint32_t flags;
+	uint32_t tow;
+	uint64_t unix_timestamp;
+	gnss_struct_t in_progress;
+	/** C/N0 statistics of the last NAV-SAT, merged into every epoch. */
+	uint8_t sat_cno[4];
+	gnss_t data;
+} decoder;
+
+/** @brief What the log contains, found when scanning it. */
+static struct {
+	uint32_t epochs;
+	uint32_t first_tow;
+	uint16_t rate_ms;
+	bool has_origin;
+	int32_t origin_lat;
+	int32_t origin_lon;
+} track;
+
+/** @brief Progress and decisions of the replay. */
+static struct {
+	uint32_t epochs;
+	uint32_t fixes;
+	int64_t start_ms;
+	uint32_t zone_changes;
+	uint32_t warn_zone_entries;
+	uint32_t warn_starts;
+	uint32_t warn_pauses;
+	uint32_t zaps;
+	uint32_t mode_requests;
+} replay;
+
+static enum sound_event_status_type buzzer_status = SND_STATUS_IDLE;
+
+extern struct k_sem ep_trigger_ready;
+
+static uint64_t replay_host_ns(void)
+{
+#if CONFIG_ARCH_POSIX
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+#else
+	return k_cyc_to_ns_floor64(k_cycle_get_32());
+#endif
+}
+
+/** @brief Prints one result line. Lines starting with REPLAY are comma
+ *         separated, with the columns given by replay_print_header.
+ */
+static void replay_print(const char *kind, int32_t value)
+{
+	printk("REPLAY,%d,%s,%d\n", (int32_t)k_uptime_get(), kind, value);
+}
+
+static void replay_print_header(void)
+{
+	printk("REPLAY,uptime_ms,kind,value\n");
+}
+
+/** @brief Milliseconds from the first epoch of the log, iTOW wraps weekly. */
+static uint32_t replay_tow_offset(uint32_t tow)
+{
+	return (tow + REPLAY_MS_PER_WEEK - track.first_tow) % REPLAY_MS_PER_WEEK;
+}
+
+/** @brief Cosine for the latitude of the origin, good to 1e-5 up to 80
+ *         degrees, which is plenty for the k_lon of the square fence.
+ */
+static double replay_cos(double x)
+{
+	double x2 = x * x;
+	double term = 1.0;
+	double sum = 1.0;
+
+	for (int i = 1; i < 10; i++) {
+		term *= -x2 / ((2 * i - 1) * (2 * i));
+		sum += term;
+	}
+	return sum;
+}
+
+int replay_pasture_get(uint8_t *buf, size_t size, size_t *len)
+{
+#ifdef REPLAY_PASTURE
+	if (sizeof(replay_pasture) > size ||
+	    !pasture_layout_valid(replay_pasture, sizeof(replay_pasture))) {
+		return -EINVAL;
+	}
+	memcpy(buf, replay_pasture, sizeof(replay_pasture));
+	*len = sizeof(replay_pasture);
+	return 0;
+#else
+	if (!track.has_origin) {
+		return -ENODATA;
+	}
+
+	pasture_t *pasture = (pasture_t *)buf;
+	fence_coordinate_t points[] = {
+		{ .s_x_dm = -REPLAY_SQUARE_HALF_DM, .s_y_dm = -REPLAY_SQUARE_HALF_DM },
+		{ .s_x_dm = REPLAY_SQUARE_HALF_DM, .s_y_dm = -REPLAY_SQUARE_HALF_DM },
+		{ .s_x_dm = REPLAY_SQUARE_HALF_DM, .s_y_dm = REPLAY_SQUARE_HALF_DM },
+		{ .s_x_dm = -REPLAY_SQUARE_HALF_DM, .s_y_dm = REPLAY_SQUARE_HALF_DM }
+	};
+	fence_t fence = { .m = { .e_fence_type = FenceDefinitionMessage_FenceType_Normal,
+				 .n_points = ARRAY_SIZE(points) } };
+
+	int err = pasture_init(pasture, size, 1);
+	if (err) {
+		return err;
+	}
+	err = pasture_add_fence(pasture, size, 0, &fence, points);
+	if (err) {
+		return err;
+	}
+
+	double lat_rad = (track.origin_lat / 1e7) * 3.14159265358979 / 180.0;
+
+	pasture->m.ul_fence_def_version = 1;
+	pasture->m.l_origin_lat = track.origin_lat;
+	pasture->m.l_origin_lon = track.origin_lon;
+	pasture->m.us_k_lat = REPLAY_K_LAT;
+	pasture->m.us_k_lon = (uint16_t)(REPLAY_K_LAT * replay_cos(lat_rad) + 0.5);
+	pasture->m.status = FenceStatus_FenceStatus_Normal;
+
+	*len = pasture_size(pasture);
+	return 0;
+#endif
+}
+
+/** @brief Publishes a complete epoch at its time in the log, as
+ *         mia_m10_sync_complete does when the receiver outputs it.
+ */
+static void replay_publish_epoch(void)
+{
+	memcpy(&decoder.data.latest, &decoder.in_progress, sizeof(gnss_struct_t));
+	memcpy(decoder.data.latest.cno, decoder.sat_cno, sizeof(decoder.data.latest.cno));
+
+	if (decoder.scanning) {
+		if (track.epochs == 0) {
+			track.first_tow = decoder.tow;
+		} else if (track.epochs == 1) {
+			track.rate_ms = (uint16_t)MIN(replay_tow_offset(decoder.tow), UINT16_MAX);
+		}
+		if (!track.has_origin && (decoder.in_progress.pvt_flags & 1)) {
+			track.has_origin = true;
+			track.origin_lat = decoder.in_progress.lat;
+			track.origin_lon = decoder.in_progress.lon;
+		}
+		track.epochs++;
+		return;
+	}
+
+	/* Sleep until the epoch is due, the kernel time then matches the log. */
+	int64_t due_ms = replay.start_ms + replay_tow_offset(decoder.tow);
+	int64_t now_ms = k_uptime_get();
+	if (due_ms > now_ms) {
+		k_sleep(K_MSEC(due_ms - now_ms));
+	}
+
+	decoder.data.latest.updated_at = k_uptime_get_32();
+	decoder.data.latest.pvt_cycles = k_cycle_get_32();
+	decoder.data.fix_ok = (decoder.data.latest.pvt_flags & 1) != 0;
+
+	if (decoder.data.fix_ok) {
+		gnss_last_fix_struct_t *lastfix = &decoder.data.lastfix;
+		gnss_struct_t *latest = &decoder.data.latest;
+
+		lastfix->h_acc_dm = latest->h_acc_dm;
+		lastfix->lat = latest->lat;
+		lastfix->lon = latest->lon;
+		lastfix->unix_timestamp = decoder.unix_timestamp;
+		lastfix->head_veh = latest->head_veh;
+		lastfix->pvt_flags = latest->pvt_flags;
+		lastfix->head_acc = latest->head_acc;
+		lastfix->h_dop = latest->h_dop;
+		lastfix->num_sv = latest->num_sv;
+		lastfix->height = latest->height;
+		lastfix->msss = latest->msss;
+		lastfix->updated_at = latest->updated_at;
+		lastfix->pvt_cycles = latest->pvt_cycles;
+		lastfix->mode = latest->mode;
+		memcpy(&lastfix->pl, &latest->pl, sizeof(lastfix->pl));
+		decoder.data.has_lastfix = true;
+		replay.fixes++;
+	}
+
+	replay.epochs++;
+	zassert_false(replay_gnss_publish(&decoder.data), "Replay GNSS has no data callback");
+}
+
+/** @brief Registers a piece of the epoch, see mia_m10_sync_complete. */
+static void replay_sync_complete(uint32_t flag)
+{
+	decoder.flags |= flag;
+	if (decoder.flags == REPLAY_FLAGS_EPOCH) {
+		replay_publish_epoch();
+		/* Ignore any further pieces with the same time of week. */
+		decoder.flags |= BIT(31);
+	}
+}
+
+static void replay_sync_tow(uint32_t tow)
+{
+	if (tow != decoder.tow) {
+		memset(&decoder.in_progress, 0, sizeof(decoder.in_progress));
+		decoder.flags = 0;
+		decoder.tow = tow;
+	}
+}
+
+/* The handlers convert the messages exactly as the MIA-M10 driver does. */
+
+static int replay_nav_pvt_handler(void *context, void *payload, uint32_t size)
+{
+	struct ublox_nav_pvt *nav_pvt = payload;
+
+	if (size < sizeof(*nav_pvt)) {
+		return -EINVAL;
+	}
+	replay_sync_tow(nav_pvt->iTOW);
+
+	decoder.in_progress.mode = replay_gnss_get_mode();
+	decoder.in_progress.pvt_flags = nav_pvt->flags;
+	decoder.in_progress.pvt_valid = nav_pvt->valid;
+	decoder.in_progress.lon = nav_pvt->lon;
+	decoder.in_progress.lat = nav_pvt->lat;
+	decoder.in_progress.num_sv = nav_pvt->numSV;
+	decoder.in_progress.speed = (uint16_t)nav_pvt->gSpeed;
+	decoder.in_progress.head_veh = (int16_t)(nav_pvt->headVeh / 1000);
+	decoder.in_progress.head_acc = (int16_t)(nav_pvt->headAcc / 1000);
+	decoder.in_progress.height = (int16_t)MIN(INT16_MAX, MAX(INT16_MIN, nav_pvt->height / 100));
+	decoder.in_progress.h_acc_dm = (uint16_t)MIN(UINT16_MAX, nav_pvt->hAcc / 100);
+	decoder.in_progress.v_acc_dm = (uint16_t)MIN(UINT16_MAX, nav_pvt->vAcc / 100);
+
+	if (((nav_pvt->valid & 0x7) == 0x7) && (nav_pvt->flags & 1)) {
+		struct tm now = { 0 };
+
+		now.tm_year = nav_pvt->year - 1900;
+		now.tm_mon = nav_pvt->month - 1;
+		now.tm_mday = nav_pvt->day;
+		now.tm_hour = nav_pvt->hour;
+		now.tm_min = nav_pvt->min;
+		now.tm_sec = nav_pvt->sec;
+		decoder.unix_timestamp = timeutil_timegm64(&now);
+	}
+
+	replay_sync_complete(REPLAY_FLAG_NAV_PVT);
+	return 0;
+}
+
+static int replay_nav_dop_handler(void *context, void *payload, uint32_t size)
+{
+	struct ublox_nav_dop *nav_dop = payload;
+
+	if (size < sizeof(*nav_dop)) {
+		return -EINVAL;
+	}
+	replay_sync_tow(nav_dop->iTOW);
+
+	decoder.in_progress.h_dop = nav_dop->hDOP;
+
+	replay_sync_complete(REPLAY_FLAG_NAV_DOP);
+	return 0;
+}
+
+static int replay_nav_status_handler(void *context, void *payload, uint32_t size)
+{
+	struct ublox_nav_status *nav_status = payload;
+
+	if (size < sizeof(*nav_status)) {
+		return -EINVAL;
+	}
+	replay_sync_tow(nav_status->iTOW);
+
+	decoder.in_progress.msss = nav_status->msss;
+	decoder.in_progress.ttff = nav_status->ttff;
+
+	replay_sync_complete(REPLAY_FLAG_NAV_STATUS);
+	return 0;
+}
+
+static int replay_nav_pl_handler(void *context, void *payload, uint32_t size)
+{
+	struct ublox_nav_pl *nav_pl = payload;
+
+	if (size < sizeof(*nav_pl)) {
+		return -EINVAL;
+	}
+	replay_sync_tow(nav_pl->iTow);
+
+	decoder.in_progress.pl.tmirCoeff = nav_pl->tmirCoeff;
+	decoder.in_progress.pl.tmirExp = nav_pl->tmirExp;
+	decoder.in_progress.pl.plPosValid = nav_pl->plPosValid;
+	decoder.in_progress.pl.plPosFrame = nav_pl->plPosFrame;
+	decoder.in_progress.pl.plPos1 = nav_pl->plPos1;
+	decoder.in_progress.pl.plPos2 = nav_pl->plPos2;
+	decoder.in_progress.pl.plPos3 = nav_pl->plPos3;
+
+	replay_sync_complete(REPLAY_FLAG_NAV_PL);
+	return 0;
+}
+
+static int replay_nav_sat_handler(void *context, void *payload, uint32_t size)
+{
+	struct ublox_nav_sat *nav_sat = payload;
+	uint8_t n_sats = MIN(nav_sat->numSv, MAX_SVID);
+	uint8_t cnt = 0;
+	uint16_t cno_sum = 0;
+
+	if (size < offsetof(struct ublox_nav_sat, satinfo)) {
+		return -EINVAL;
+	}
+	n_sats = MIN(n_sats, (size - offsetof(struct ublox_nav_sat, satinfo)) /
+				     sizeof(satpar_struct_t));
+	memset(decoder.sat_cno, 0, sizeof(decoder.sat_cno));
+
+	/* Same statistics as the driver. NAV-SAT is not part of the epoch. */
+	for (uint8_t x = 0; x < n_sats; x++) {
+		uint8_t cno = nav_sat->satinfo[x].cno;
+
+		if (nav_sat->satinfo[x].svid == 27) {
+			decoder.sat_cno[0] = cno;
+		}
+		if (cno > 0) {
+			if (cnt == 0 || cno < decoder.sat_cno[1]) {
+				decoder.sat_cno[1] = cno;
+			}
+			decoder.sat_cno[2] = MAX(decoder.sat_cno[2], cno);
+			cnt++;
+			cno_sum += cno;
+		}
+	}
+	if (cnt > 0) {
+		decoder.sat_cno[3] = cno_sum / cnt;
+	}
+	return 0;
+}
+
+/** @brief Runs the UBX log through the parser of the GNSS driver. */
+static void replay_parse_track(bool scanning)
+{
+	memset(&decoder, 0, sizeof(decoder));
+	decoder.scanning = scanning;
+	decoder.tow = UINT32_MAX;
+
+	uint32_t pos = 0;
+	while (pos < sizeof(replay_track)) {
+		uint32_t parsed = ublox_parse(&replay_track[pos], sizeof(replay_track) - pos);
+		if (parsed == 0) {
+			break;
+		}
+		pos += parsed;
+	}
+}
+
+/** @brief Sets the buzzer status the AMC waits for, as the sound
+ *         controller does while playing the warning.
+ */
+static void replay_buzzer_set(enum sound_event_status_type status)
+{
+	if (status == buzzer_status) {
+		return;
+	}
+	buzzer_status = status;
+
+	struct sound_status_event *ev = new_sound_status_event();
+	ev->status = status;
+	EVENT_SUBMIT(ev);
+}
+
+static bool replay_event_handler(const struct event_header *eh)
+{
+	if (is_zone_change(eh)) {
+		struct zone_change *ev = cast_zone_change(eh);
+		replay.zone_changes++;
+		if (ev->zone == WARN_ZONE) {
+			replay.warn_zone_entries++;
+		}
+		replay_print("zone", ev->zone);
+		return false;
+	}
+	if (is_sound_event(eh)) {
+		struct sound_event *ev = cast_sound_event(eh);
+		if (ev->type == SND_WARN) {
+			replay_buzzer_set(SND_STATUS_PLAYING_WARN);
+		} else if (ev->type == SND_OFF) {
+			replay_buzzer_set(SND_STATUS_IDLE);
+		}
+		replay_print("sound", ev->type);
+		return false;
+	}
+	if (is_sound_set_warn_freq_event(eh)) {
+		struct sound_set_warn_freq_event *ev = cast_sound_set_warn_freq_event(eh);
+		if (buzzer_status != SND_STATUS_IDLE) {
+			replay_buzzer_set(ev->freq >= WARN_FREQ_MAX ? SND_STATUS_PLAYING_MAX :
+								      SND_STATUS_PLAYING_WARN);
+		}
+		replay_print("warn_freq", ev->freq);
+		return false;
+	}
+	if (is_warn_correction_start_event(eh)) {
+		struct warn_correction_start_event *ev = cast_warn_correction_start_event(eh);
+		replay.warn_starts++;
+		replay_print("warn_start", ev->fence_dist);
+		return false;
+	}
+	if (is_warn_correction_pause_event(eh)) {
+		struct warn_correction_pause_event *ev = cast_warn_correction_pause_event(eh);
+		replay.warn_pauses++;
+		/* The electric pulse module is ready for the pulse right away. */
+		if (ev->reason == Reason_WARNPAUSEREASON_ZAP) {
+			k_sem_give(&ep_trigger_ready);
+		}
+		replay_print("warn_pause", ev->reason);
+		return false;
+	}
+	if (is_warn_correction_end_event(eh)) {
+		struct warn_correction_end_event *ev = cast_warn_correction_end_event(eh);
+		replay_print("warn_end", ev->fence_dist);
+		return false;
+	}
+	if (is_ep_status_event(eh)) {
+		struct ep_status_event *ev = cast_ep_status_event(eh);
+		replay_print("pulse", ev->is_first_pulse);
+		return false;
+	}
+	if (is_amc_zapped_now_event(eh)) {
+		struct amc_zapped_now_event *ev = cast_amc_zapped_now_event(eh);
+		replay.zaps++;
+		replay_print("zap", ev->fence_dist);
+		return false;
+	}
+	if (is_gnss_set_mode_event(eh)) {
+		struct gnss_set_mode_event *ev = cast_gnss_set_mode_event(eh);
+		replay.mode_requests++;
+		replay_print("gnss_mode", ev->mode);
+		return false;
+	}
+	return false;
+}
+
+EVENT_LISTENER(amc_replay, replay_event_handler);
+EVENT_SUBSCRIBE(amc_replay, zone_change);
+EVENT_SUBSCRIBE(amc_replay, sound_event);
+EVENT_SUBSCRIBE(amc_replay, sound_set_warn_freq_event);
+EVENT_SUBSCRIBE(amc_replay, warn_correction_start_event);
+EVENT_SUBSCRIBE(amc_replay, warn_correction_pause_event);
+EVENT_SUBSCRIBE(amc_replay, warn_correction_end_event);
+EVENT_SUBSCRIBE(amc_replay, ep_status_event);
+EVENT_SUBSCRIBE(amc_replay, amc_zapped_now_event);
+EVENT_SUBSCRIBE(amc_replay, gnss_set_mode_event);
+
+static void test_replay_track(void)
+{
+	replay_parse_track(true);
+	zassert_true(track.epochs > 0, "No complete epoch in the replayed log");
+
+	if (track.rate_ms > 0) {
+		replay_gnss_set_rate(track.rate_ms);
+	}
+
+	zassert_false(amc_module_init(), "Error when initializing AMC");
+	zassert_false(gnss_controller_init(), "Error when initializing GNSS controller");
+
+	replay_print_header();
+	replay_print("track_epochs", track.epochs);
+	replay_print("track_rate_ms", track.rate_ms);
+
+	memset(&replay, 0, sizeof(replay));
+	replay.start_ms = k_uptime_get();
+	uint64_t host_start_ns = replay_host_ns();
+
+	replay_parse_track(false);
+	k_sleep(K_MSEC(REPLAY_DRAIN_MS));
+
+	uint64_t host_ns = MAX(replay_host_ns() - host_start_ns, 1);
+	int64_t virtual_ms = k_uptime_get() - replay.start_ms;
+
+	replay_print("epochs", replay.epochs);
+	replay_print("fixes", replay.fixes);
+	replay_print("zone_changes", replay.zone_changes);
+	replay_print("warn_starts", replay.warn_starts);
+	replay_print("warn_pauses", replay.warn_pauses);
+	replay_print("zaps", replay.zaps);
+	replay_print("gnss_mode_requests", replay.mode_requests);
+	replay_print("virtual_ms", (int32_t)virtual_ms);
+	replay_print("host_us", (int32_t)(host_ns / NSEC_PER_USEC));
+	replay_print("epochs_per_sec", (int32_t)((uint64_t)replay.epochs * NSEC_PER_SEC / host_ns));
+	replay_print("speedup", (int32_t)((uint64_t)virtual_ms * NSEC_PER_MSEC / host_ns));
+
+	zassert_equal(replay.epochs, track.epochs, "Replayed %d of %d epochs", replay.epochs,
+		      track.epochs);
+
+#ifdef REPLAY_SYNTHETIC_TRACK
+	/* The synthetic track walks out through the fence and back twice. */
+	zassert_true(replay.warn_zone_entries > 0, "Never entered the warn zone");
+	zassert_true(replay.warn_starts > 0, "Never started a warning");
+#endif
+}
+
+void test_main(void)
+{
+	zassert_false(event_manager_init(), "Error when initializing event manager");
+
+	ublox_protocol_init();
+	ublox_register_handler(UBX_NAV, UBX_NAV_PVT, replay_nav_pvt_handler, NULL);
+	ublox_register_handler(UBX_NAV, UBX_NAV_DOP, replay_nav_dop_handler, NULL);
+	ublox_register_handler(UBX_NAV, UBX_NAV_STATUS, replay_nav_status_handler, NULL);
+	ublox_register_handler(UBX_NAV, UBX_NAV_PL, replay_nav_pl_handler, NULL);
+	ublox_register_handler(UBX_NAV, UBX_NAV_SAT, replay_nav_sat_handler, NULL);
+
+	ztest_test_suite(amc_replay, ztest_unit_test(test_replay_track));
+	ztest_run_test_suite(amc_replay);
+}
@@ -0,0 +1,101 @@
+#!/usr/bin/env python3
+#
+# Copyright (c) 2022 Nofence AS
+#
+
+"""Writes a synthetic UBX log for the AMC replay harness.
+
+The animal stands at the origin, walks east out through the square fence
+the harness lays around the first fix, stands outside and walks back, twice.
+Every epoch holds NAV-PVT, NAV-DOP, NAV-STATUS, NAV-SAT and NAV-PL, with the
+accuracy of a good fix.
+"""
+
+import argparse
+import math
+import struct
+
+ORIGIN_LAT = 599133000  # 1e-7 degrees
+ORIGIN_LON = 107523000
+RATE_MS = 250
+START_TOW_MS = 302400000
+START_MSSS_MS = 60000
+
+# Same scale as the square fence of the harness, dm per 1e-5 degree.
+K_LAT = 11132
+K_LON = round(K_LAT * math.cos(math.radians(ORIGIN_LAT / 1e7)))
+
+# (duration s, speed east m/s)
+PHASES = [(30, 0.0), (72, 0.5), (10, 0.0), (72, -0.5), (20, 0.0)] * 2
+
+
+def ubx(msg_class, msg_id, payload):
+    body = struct.pack('<BBH', msg_class, msg_id, len(payload)) + payload
+    ck_a = ck_b = 0
+    for b in body:
+        ck_a = (ck_a + b) & 0xFF
+        ck_b = (ck_b + ck_a) & 0xFF
+    return b'\xb5\x62' + body + bytes([ck_a, ck_b])
+
+
+def nav_pvt(tow, t_s, lat, lon, speed_mm_s, heading):
+    sec = 12 * 3600 + int(t_s)
+    return ubx(0x01, 0x07, struct.pack(
+        '<IHBBBBBBIiBBBBiiiiIIiiiiiIIHH4siHH',
+        tow, 2022, 6, 1, sec // 3600, (sec // 60) % 60, sec % 60, 0x07,
+        20, 0, 3, 0x01, 0xE0, 12, lon, lat, 150000, 110000, 1500, 2500,
+        0, speed_mm_s, 0, abs(speed_mm_s), heading, 300, 2000000, 150, 0,
+        bytes(4), heading, 0, 0))
+
+
+def nav_dop(tow):
+    return ubx(0x01, 0x04, struct.pack('<IHHHHHHH', tow, 180, 150, 100, 120, 90, 70, 60))
+
+
+def nav_status(tow):
+    return ubx(0x01, 0x03, struct.pack('<IBBBBII', tow, 3, 0x0D, 0, 0, 25000,
+                                       START_MSSS_MS + tow - START_TOW_MS))
+
+
+def nav_sat(tow):
+    sats = [(0, 3, 38), (0, 8, 41), (0, 14, 35), (0, 22, 33), (0, 27, 40)]
+    payload = struct.pack('<IBB2s', tow, 1, len(sats), bytes(2))
+    for gnss_id, sv_id, cno in sats:
+        payload += struct.pack('<BBBbhhI', gnss_id, sv_id, cno, 45, 180, 0, 0x1F)
+    return ubx(0x01, 0x35, payload)
+
+
+def nav_pl(tow):
+    return ubx(0x01, 0x62, struct.pack('<BBbBBBBB4sIIIIIIIHHI4s', 1, 1, -1, 1, 1, 0, 0, 0,
+                                       bytes(4), tow, 3000, 3000, 5000, 0, 0, 0, 0, 0, 0,
+                                       bytes(4)))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__)
+    parser.add_argument('output', help='UBX log to write')
+    args = parser.parse_args()
+
+    log = bytearray()
+    x_m = 0.0
+    t_ms = 0
+    for duration_s, speed in PHASES:
+        for _ in range(duration_s * 1000 // RATE_MS):
+            tow = START_TOW_MS + t_ms
+            lat = ORIGIN_LAT
+            lon = ORIGIN_LON + round(x_m * 10 * 100000 / K_LON)
+            heading = 9000000 if speed >= 0 else 27000000
+            log += nav_pvt(tow, t_ms / 1000, lat, lon, round(speed * 1000), heading)
+            log += nav_dop(tow)
+            log += nav_status(tow)
+            log += nav_sat(tow)
+            log += nav_pl(tow)
+            x_m += speed * RATE_MS / 1000
+            t_ms += RATE_MS
+
+    with open(args.output, 'wb') as f:
+        f.write(log)
+
+
+if __name__ == '__main__':
+    main()
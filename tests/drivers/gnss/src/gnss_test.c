@@ -300,7 +300,7 @@ static void test_setup(void)
 
 	/* Enable NAV-SAT output on UART, no handler */
 	uint8_t cmd_cfg_setval_nav_sat[] = { 0xB5, 0x62, 0x06, 0x8A, 0x09, 0x00, 0x00, 0x03, 0x00,
-					     0x00, 0x16, 0x00, 0x91, 0x20, 0x01, 0x64, 0xa3 };
+					     0x00, 0x16, 0x00, 0x91, 0x20, 0x04, 0x67, 0xa6 };
 	uint8_t resp_cfg_setval_nav_sat[] = { 0xB5, 0x62, 0x05, 0x01, 0x02,
 					      0x00, 0x06, 0x8A, 0x98, 0xC1 };
 	gnss_add_expected_cmd_rsp(cmd_cfg_setval_nav_sat, sizeof(cmd_cfg_setval_nav_sat),
@@ -408,7 +408,7 @@ static void test_setup_2(void)
 
 	/* Enable NAV-SAT output on UART, no handler */
 	uint8_t cmd_cfg_setval_nav_sat[] = { 0xB5, 0x62, 0x06, 0x8A, 0x09, 0x00, 0x00, 0x03, 0x00,
-					     0x00, 0x16, 0x00, 0x91, 0x20, 0x01, 0x64, 0xa3 };
+					     0x00, 0x16, 0x00, 0x91, 0x20, 0x04, 0x67, 0xa6 };
 	uint8_t resp_cfg_setval_nav_sat[] = { 0xB5, 0x62, 0x05, 0x01, 0x02,
 					      0x00, 0x06, 0x8A, 0x98, 0xC1 };
 	gnss_add_expected_cmd_rsp(cmd_cfg_setval_nav_sat, sizeof(cmd_cfg_setval_nav_sat),
@@ -522,7 +522,7 @@ static void test_setup_3(void)
 
 	/* Enable NAV-SAT output on UART, no handler */
 	uint8_t cmd_cfg_setval_nav_sat[] = { 0xB5, 0x62, 0x06, 0x8A, 0x09, 0x00, 0x00, 0x03, 0x00,
-					     0x00, 0x16, 0x00, 0x91, 0x20, 0x01, 0x64, 0xa3 };
+					     0x00, 0x16, 0x00, 0x91, 0x20, 0x04, 0x67, 0xa6 };
 	uint8_t resp_cfg_setval_nav_sat[] = { 0xB5, 0x62, 0x05, 0x01, 0x02,
 					      0x00, 0x06, 0x8A, 0x98, 0xC1 };
 	gnss_add_expected_cmd_rsp(cmd_cfg_setval_nav_sat, sizeof(cmd_cfg_setval_nav_sat),
@@ -637,6 +637,8 @@ static void test_receive_gnss_solution(void)
 	zassert_equal(gnss_cb_data.lastfix.lat, 633743868, "Wrong latitude");
 	zassert_equal(gnss_cb_data.lastfix.lon, 103412316, "Wrong latitude");
 	zassert_equal(gnss_cb_data.lastfix.mode, GNSSMODE_NOMODE, "Wrong mode");
+	/* NAV-SAT is not part of the epoch, and arrives after it was published */
+	zassert_equal(gnss_cb_data.latest.cno[3], 0, "NAV-SAT merged before it was received");
 
 	zassert_equal(gnss_data_fetch(gnss_dev, &gnss_fetch_data), 0, "Fetching GNSS data failed");
 
@@ -722,6 +724,12 @@ static void test_ignore_nmea(void)
 	/* Expect data now */
 	zassert_equal(k_sem_take(&gnss_data_sem, K_MSEC(100)), 0, "No data received");
 
+	/* C/N0 statistics of the NAV-SAT received after the previous solution */
+	zassert_equal(gnss_cb_data.latest.cno[0], 0, "Wrong CNO of SV 27");
+	zassert_equal(gnss_cb_data.latest.cno[1], 18, "Wrong min CNO");
+	zassert_equal(gnss_cb_data.latest.cno[2], 18, "Wrong max CNO");
+	zassert_equal(gnss_cb_data.latest.cno[3], 22, "Wrong average CNO");
+
 	/* New data */
 	uint8_t nav_pvt_04[] = { 0xB5, 0x62, 0x01, 0x07, 0x5C, 0x00, 0x10, 0x05, 0x29, 0x08,
 				 0xE6, 0x07, 0x02, 0x15, 0x0E, 0x01, 0x1C, 0x37, 0x1F, 0x00,
@@ -870,6 +878,54 @@ static void test_ignore_garbage(void)
 	zassert_equal(k_sem_take(&gnss_data_sem, K_MSEC(100)), 0, "No data received");
 }
 
+/**
+ * @brief Testing GNSS receiving messages split into single bytes, with an 
+ *        unreasonably large message header in between. 
+ */
+static void test_receive_split_messages(void)
+{
+	/* Make sure no data was received unexpectedly */
+	zassert_equal(k_sem_take(&gnss_data_sem, K_NO_WAIT), -EBUSY, "Unexpected data");
+
+	uint8_t nav_pvt_06[] = { 0xB5, 0x62, 0x01, 0x07, 0x5C, 0x00, 0xE0, 0x0C, 0x29, 0x08,
+				 0xE6, 0x07, 0x02, 0x15, 0x0E, 0x01, 0x1D, 0x37, 0x1F, 0x00,
+				 0x00, 0x00, 0x3A, 0x40, 0xFA, 0xFF, 0x03, 0x01, 0xFA, 0x0E,
+				 0x66, 0xF2, 0x29, 0x06, 0xF1, 0x29, 0xC6, 0x25, 0xF1, 0x0E,
+				 0x03, 0x00, 0x73, 0x72, 0x02, 0x00, 0xDE, 0x0A, 0x00, 0x00,
+				 0x49, 0x15, 0x00, 0x00, 0xF6, 0xFF, 0xFF, 0xFF, 0x01, 0x00,
+				 0x00, 0x00, 0x04, 0x00, 0x00, 0x00, 0x0A, 0x00, 0x00, 0x00,
+				 0x00, 0x00, 0x00, 0x00, 0x72, 0x01, 0x00, 0x00, 0xE4, 0xE1,
+				 0xE0, 0x00, 0xAD, 0x00, 0x00, 0x00, 0xD2, 0x7A, 0x5B, 0x21,
+				 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xD0, 0x6F };
+	uint8_t nav_status_06[] = { 0xB5, 0x62, 0x01, 0x03, 0x10, 0x00, 0xE0, 0x0C, 0x29, 0x08,
+				    0x03, 0xDD, 0x00, 0x0C, 0xE3, 0x77, 0x00, 0x00, 0x97, 0xD5,
+				    0x1C, 0x00, 0xFF, 0x42 };
+	uint8_t nav_dop_06[] = { 0xB5, 0x62, 0x01, 0x04, 0x12, 0x00, 0xE0, 0x0C, 0x29, 0x08,
+				 0xC7, 0x00, 0xAD, 0x00, 0x62, 0x00, 0x97, 0x00, 0x54, 0x00,
+				 0x48, 0x00, 0x2C, 0x00, 0x69, 0x60 };
+	uint8_t nav_pl_06[] = { 0xB5, 0x62, 0x01, 0x62, 0x34, 0x00, 0x01, 0x05, 0x00, 0x01,
+				0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xE0, 0x0C,
+				0x29, 0x08, 0xE6, 0x2F, 0x00, 0x00, 0xAD, 0x1E, 0x00, 0x00,
+				0x30, 0x57, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+				0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+				0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x23, 0x58 };
+	uint8_t garbage[] = { 0xB5, 0xB5, 0x62, 0x01, 0x07, 0xFF, 0xFF };
+
+	uint8_t *msgs[] = { nav_pvt_06, nav_status_06, garbage, nav_dop_06, nav_pl_06 };
+	uint32_t sizes[] = { sizeof(nav_pvt_06), sizeof(nav_status_06), sizeof(garbage),
+			     sizeof(nav_dop_06), sizeof(nav_pl_06) };
+
+	for (uint32_t i = 0; i < ARRAY_SIZE(msgs); i++) {
+		for (uint32_t j = 0; j < sizes[i]; j++) {
+			mock_uart_send(uart_dev, &msgs[i][j], 1);
+		}
+	}
+
+	/* Expect data now */
+	zassert_equal(k_sem_take(&gnss_data_sem, K_MSEC(100)), 0, "No data received");
+	zassert_equal(gnss_cb_data.latest.msss, 0x1CD597, "Wrong data received");
+}
+
 /**
  * @brief Testing GNSS setting and getting of used measure rate
  */
@@ -1088,6 +1144,55 @@ static void test_upload_assistance_data(void)
 		      "GNSS simulator did not indicate completion");
 }
 
+static void test_nav_db(void)
+{
+	gnss_clear_expected();
+
+	/* Expect MGA-DBD poll, answered with the navigation database */
+	uint8_t cmd_mga_dbd_poll[] = { 0xb5, 0x62, 0x13, 0x80, 0x00, 0x00, 0x93, 0xcc };
+	uint8_t rsp_mga_dbd[] = { 0xb5, 0x62, 0x13, 0x80, 0x10, 0x00, 0x00, 0x00, 0x00, 0x00,
+				  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x02,
+				  0x03, 0x04, 0xad, 0x30, 0xb5, 0x62, 0x13, 0x80, 0x10, 0x00,
+				  0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+				  0x00, 0x00, 0x05, 0x06, 0x07, 0x08, 0xbd, 0x58 };
+	gnss_add_expected_cmd_rsp(cmd_mga_dbd_poll, sizeof(cmd_mga_dbd_poll), rsp_mga_dbd,
+				  sizeof(rsp_mga_dbd));
+
+	uint8_t nav_db[64];
+	uint32_t nav_db_size = 0;
+	zassert_equal(gnss_get_nav_db(gnss_dev, nav_db, sizeof(nav_db), &nav_db_size), 0,
+		      "GNSS navigation database read failed");
+	zassert_equal(k_sem_take(&gnss_sem, K_MSEC(1000)), 0,
+		      "GNSS simulator did not indicate completion");
+	zassert_equal(nav_db_size, sizeof(rsp_mga_dbd), "");
+	zassert_mem_equal(nav_db, rsp_mga_dbd, sizeof(rsp_mga_dbd), "");
+
+	/* Too small buffer */
+	gnss_clear_expected();
+	gnss_add_expected_cmd_rsp(cmd_mga_dbd_poll, sizeof(cmd_mga_dbd_poll), rsp_mga_dbd,
+				  sizeof(rsp_mga_dbd));
+	zassert_equal(gnss_get_nav_db(gnss_dev, nav_db, 32, &nav_db_size), -ENOBUFS, "");
+	zassert_equal(k_sem_take(&gnss_sem, K_MSEC(1000)), 0,
+		      "GNSS simulator did not indicate completion");
+
+	/* Expect the first message back, acknowledged by the receiver */
+	gnss_clear_expected();
+	uint8_t rsp_mga_ack[] = { 0xb5, 0x62, 0x13, 0x60, 0x08, 0x00, 0x01, 0x00,
+				  0x00, 0x80, 0x00, 0x00, 0x00, 0x00, 0xfc, 0xdc };
+	gnss_add_expected_cmd_rsp(rsp_mga_dbd, 24, rsp_mga_ack, sizeof(rsp_mga_ack));
+
+	struct gnss_assist_stats stats;
+	zassert_equal(gnss_restore_nav_db(gnss_dev, NULL, rsp_mga_dbd, 24, &stats), 0,
+		      "GNSS navigation database restore failed");
+	zassert_equal(k_sem_take(&gnss_sem, K_MSEC(1000)), 0,
+		      "GNSS simulator did not indicate completion");
+	zassert_equal(stats.accepted, 1, "");
+	zassert_equal(stats.rejected, 0, "");
+
+	/* Only UBX-MGA messages are restored */
+	zassert_equal(gnss_restore_nav_db(gnss_dev, NULL, rsp_mga_dbd, 20, &stats), -EINVAL, "");
+}
+
 static int extint_callback_count;
 
 /**
@@ -1249,12 +1354,14 @@ void test_main(void)
 			 ztest_unit_test(test_receive_gnss_solution),
 			 ztest_unit_test(test_ignore_nmea),
 			 ztest_unit_test(test_ignore_garbage),
+			 ztest_unit_test(test_receive_split_messages),
 			 ztest_unit_test(test_set_get_rate),
 			 ztest_unit_test(test_ignore_wrong_checksum), 
 			 ztest_unit_test(test_reset),
 			 ztest_unit_test(test_no_ack), 
 			 ztest_unit_test(test_no_resp),
 			 ztest_unit_test(test_upload_assistance_data),
+			 ztest_unit_test(test_nav_db),
 			 ztest_unit_test(test_resetn_pin),
 			 ztest_unit_test(test_wakeup_by_extint_pin),
 			 ztest_unit_test(test_set_power_mode_psm),
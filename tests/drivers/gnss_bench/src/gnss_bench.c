@@ -0,0 +1,411 @@
+/*
+ * Copyright (c) 2022 Nofence AS
+ */
+
+#include <ztest.h>
+#include <zephyr.h>
+#include <device.h>
+#include <string.h>
+#include "gnss.h"
+#include "gnss_hub.h"
+#include "ublox_protocol.h"
+
+#if CONFIG_ARCH_POSIX
+/* Simulated time does not advance while the CPU is busy on native_posix,
+ * so the host clock is used instead.
+ */
+#include <time.h>
+#endif
+
+const struct device *gnss_dev = DEVICE_DT_GET(DT_ALIAS(gnss));
+
+/* Epochs of the log that are followed until published. */
+#define BENCH_MAX_EPOCHS 8192
+
+#define BENCH_FLAG_NAV_DOP (1 << 0)
+#define BENCH_FLAG_NAV_PVT (1 << 1)
+#define BENCH_FLAG_NAV_STATUS (1 << 2)
+#define BENCH_FLAG_NAV_PL (1 << 3)
+
+#define BENCH_FLAGS_EPOCH                                                                          \
+	(BENCH_FLAG_NAV_DOP | BENCH_FLAG_NAV_PVT | BENCH_FLAG_NAV_STATUS | BENCH_FLAG_NAV_PL)
+
+/* Header, payload and checksum of a UBX message. */
+#define BENCH_UBX_OVERHEAD 8
+
+/** @brief How the log is injected into the GNSS hub. */
+struct bench_case {
+	/** Bytes per gnss_hub_send, as from one UART interrupt or DMA buffer. */
+	uint16_t fragment;
+	/** Bytes injected before the parser thread gets to run. */
+	uint16_t burst;
+	/** Bytes in a million that are corrupted. */
+	uint32_t noise_ppm;
+};
+
+static const struct bench_case bench_cases[] = {
+	/* The parser runs for every fragment. */
+	{ .fragment = 1, .burst = 1, .noise_ppm = 0 },
+	{ .fragment = 8, .burst = 8, .noise_ppm = 0 },
+	{ .fragment = 64, .burst = 64, .noise_ppm = 0 },
+	{ .fragment = 256, .burst = 256, .noise_ppm = 0 },
+	/* The parser falls behind, until data is dropped by the hub. */
+	{ .fragment = 64, .burst = 512, .noise_ppm = 0 },
+	{ .fragment = 64, .burst = 1024, .noise_ppm = 0 },
+	{ .fragment = 64, .burst = 4096, .noise_ppm = 0 },
+	/* Corrupted bytes, the parser resynchronizes on the next message. */
+	{ .fragment = 64, .burst = 64, .noise_ppm = 10 },
+	{ .fragment = 64, .burst = 64, .noise_ppm = 100 },
+	{ .fragment = 64, .burst = 64, .noise_ppm = 1000 },
+	{ .fragment = 64, .burst = 64, .noise_ppm = 10000 },
+};
+
+static const uint8_t bench_log[] = {
+#include "gnss_bench_log.inc"
+};
+
+/* Log as injected, with the noise of the current case. */
+static uint8_t bench_stream[sizeof(bench_log)];
+
+/** @brief Epochs of the log, found the same way as by the MIA-M10 driver. */
+static struct {
+	uint32_t count;
+	/** Offset just after the message completing the epoch. */
+	uint32_t end[BENCH_MAX_EPOCHS];
+	/** NAV-STATUS msss, identifying the epoch when it is published. */
+	uint32_t msss[BENCH_MAX_EPOCHS];
+} epochs;
+
+/** @brief Results of the current case. */
+static struct {
+	uint32_t published;
+	uint32_t next_epoch;
+	uint32_t latency_count;
+	uint64_t latency_sum_ns;
+	uint64_t latency_max_ns;
+	uint64_t injected_ns[BENCH_MAX_EPOCHS];
+} run;
+
+static uint32_t rand_state;
+
+/* Simulated receiver, answering the commands sent by gnss_setup. */
+K_KERNEL_STACK_DEFINE(bench_rcv_stack, 2048);
+static struct k_thread bench_rcv_thread;
+static struct k_sem bench_rcv_sem;
+
+/* Deterministic pseudo random number in [lo, hi], so that the output can be
+ * compared between commits.
+ */
+static int32_t bench_rand(int32_t lo, int32_t hi)
+{
+	rand_state = rand_state * 1103515245 + 12345;
+	return lo + (int32_t)((rand_state >> 8) % (uint32_t)(hi - lo + 1));
+}
+
+static uint64_t bench_now_ns(void)
+{
+#if CONFIG_ARCH_POSIX
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * NSEC_PER_SEC + ts.tv_nsec;
+#else
+	return k_cyc_to_ns_floor64(k_cycle_get_32());
+#endif
+}
+
+/** @brief Builds a UBX message.
+ *
+ * @return Size of the message.
+ */
+static uint32_t bench_ubx(uint8_t *buf, uint8_t msg_class, uint8_t msg_id, const void *payload,
+			  uint16_t length)
+{
+	uint8_t ck_a = 0;
+	uint8_t ck_b = 0;
+
+	buf[0] = UBLOX_SYNC_CHAR_1;
+	buf[1] = UBLOX_SYNC_CHAR_2;
+	buf[2] = msg_class;
+	buf[3] = msg_id;
+	buf[4] = length & 0xFF;
+	buf[5] = length >> 8;
+	memcpy(&buf[6], payload, length);
+
+	for (uint32_t i = 2; i < 6 + length; i++) {
+		ck_a += buf[i];
+		ck_b += ck_a;
+	}
+	buf[6 + length] = ck_a;
+	buf[7 + length] = ck_b;
+
+	return length + BENCH_UBX_OVERHEAD;
+}
+
+/** @brief Answers a command with an ACK, and CFG-VALGET with the configured
+ *         baudrate, which is the only value read by the setup.
+ */
+static void bench_rcv_answer(const uint8_t *cmd)
+{
+	uint8_t rsp[32];
+	uint8_t msg_class = cmd[2];
+	uint8_t msg_id = cmd[3];
+
+	if (msg_class == UBX_CFG && msg_id == UBX_CFG_VALGET) {
+		struct __packed {
+			struct ublox_cfg_val cfg;
+			uint32_t value;
+		} val;
+
+		memcpy(&val.cfg, &cmd[6], sizeof(val.cfg));
+		val.cfg.version = 1;
+		val.value = CONFIG_GNSS_MIA_M10_UART_BAUDRATE;
+		gnss_hub_send(GNSS_HUB_ID_DIAGNOSTICS, rsp,
+			      bench_ubx(rsp, UBX_CFG, UBX_CFG_VALGET, &val, sizeof(val)));
+	}
+
+	struct ublox_ack_ack ack = { .clsID = msg_class, .msgID = msg_id };
+	gnss_hub_send(GNSS_HUB_ID_DIAGNOSTICS, rsp,
+		      bench_ubx(rsp, UBX_ACK, UBX_ACK_ACK, &ack, sizeof(ack)));
+}
+
+static void bench_rcv_data_cb(void)
+{
+	k_sem_give(&bench_rcv_sem);
+}
+
+static void bench_rcv_fn(void)
+{
+	uint8_t cmd[CONFIG_GNSS_MIA_M10_CMD_MAX_SIZE];
+	uint32_t size = 0;
+
+	while (true) {
+		k_sem_take(&bench_rcv_sem, K_FOREVER);
+
+		/* Commands are sent whole, but may wrap around the TX buffer. */
+		uint8_t *data;
+		uint32_t cnt;
+		while (gnss_hub_rx_get_data(GNSS_HUB_ID_DIAGNOSTICS, &data, &cnt) == 0 && cnt > 0) {
+			uint32_t n = MIN(cnt, sizeof(cmd) - size);
+
+			memcpy(&cmd[size], data, n);
+			size += n;
+			gnss_hub_rx_consume(GNSS_HUB_ID_DIAGNOSTICS, cnt);
+		}
+
+		while (size >= BENCH_UBX_OVERHEAD) {
+			uint32_t msg_size = (cmd[4] | (cmd[5] << 8)) + BENCH_UBX_OVERHEAD;
+
+			if (cmd[0] != UBLOX_SYNC_CHAR_1 || msg_size > sizeof(cmd)) {
+				size = 0;
+			} else if (msg_size <= size) {
+				bench_rcv_answer(cmd);
+				memmove(cmd, &cmd[msg_size], size - msg_size);
+				size -= msg_size;
+			} else {
+				break;
+			}
+		}
+	}
+}
+
+/** @brief Finds where each epoch is completed in the log. The epoch is
+ *         published by the driver when NAV-PVT, NAV-DOP, NAV-STATUS and
+ *         NAV-PL with the same time of week have been received.
+ */
+static void bench_index_epochs(void)
+{
+	uint32_t flags = 0;
+	uint32_t tow = 0;
+	uint32_t msss = 0;
+	uint32_t i = 0;
+
+	memset(&epochs, 0, sizeof(epochs));
+	while (i + BENCH_UBX_OVERHEAD <= sizeof(bench_log)) {
+		if (bench_log[i] != UBLOX_SYNC_CHAR_1 || bench_log[i + 1] != UBLOX_SYNC_CHAR_2) {
+			i++;
+			continue;
+		}
+		uint16_t length = bench_log[i + 4] | (bench_log[i + 5] << 8);
+		uint32_t end = i + length + BENCH_UBX_OVERHEAD;
+		const uint8_t *payload = &bench_log[i + 6];
+		uint32_t flag = 0;
+		uint32_t msg_tow = 0;
+
+		if (end > sizeof(bench_log)) {
+			break;
+		}
+		if (bench_log[i + 2] == UBX_NAV) {
+			switch (bench_log[i + 3]) {
+			case UBX_NAV_PVT:
+				msg_tow = ((const struct ublox_nav_pvt *)payload)->iTOW;
+				flag = BENCH_FLAG_NAV_PVT;
+				break;
+			case UBX_NAV_DOP:
+				msg_tow = ((const struct ublox_nav_dop *)payload)->iTOW;
+				flag = BENCH_FLAG_NAV_DOP;
+				break;
+			case UBX_NAV_STATUS:
+				msg_tow = ((const struct ublox_nav_status *)payload)->iTOW;
+				msss = ((const struct ublox_nav_status *)payload)->msss;
+				flag = BENCH_FLAG_NAV_STATUS;
+				break;
+			case UBX_NAV_PL:
+				msg_tow = ((const struct ublox_nav_pl *)payload)->iTow;
+				flag = BENCH_FLAG_NAV_PL;
+				break;
+			default:
+				break;
+			}
+		}
+
+		if (flag != 0) {
+			if (msg_tow != tow) {
+				flags = 0;
+				tow = msg_tow;
+			}
+			flags |= flag;
+			if (flags == BENCH_FLAGS_EPOCH && epochs.count < BENCH_MAX_EPOCHS) {
+				epochs.end[epochs.count] = end;
+				epochs.msss[epochs.count] = msss;
+				epochs.count++;
+			}
+		}
+		i = end;
+	}
+}
+
+/* Measures the latency from injecting the byte completing an epoch to the
+ * data callback of the driver.
+ */
+static int bench_data_cb(const gnss_t *data)
+{
+	uint64_t now = bench_now_ns();
+
+	run.published++;
+	while (run.next_epoch < epochs.count &&
+	       epochs.msss[run.next_epoch] < data->latest.msss) {
+		run.next_epoch++;
+	}
+	if (run.next_epoch < epochs.count && epochs.msss[run.next_epoch] == data->latest.msss) {
+		uint64_t ns = now - run.injected_ns[run.next_epoch];
+
+		run.latency_count++;
+		run.latency_sum_ns += ns;
+		run.latency_max_ns = MAX(run.latency_max_ns, ns);
+		run.next_epoch++;
+	}
+
+	return 0;
+}
+
+/** @brief Prints one result line. Lines starting with BENCH are
+ *         comma separated, with the columns given by bench_print_header, and
+ *         can be extracted from the console output and diffed between commits.
+ */
+static void bench_print(const struct bench_case *c, uint32_t dropped,
+			const struct ublox_parse_stats *stats, uint64_t host_ns)
+{
+	uint32_t bytes_per_sec = (uint32_t)((uint64_t)sizeof(bench_log) * NSEC_PER_SEC / host_ns);
+	uint32_t latency_avg_ns =
+		(run.latency_count == 0) ? 0 : (uint32_t)(run.latency_sum_ns / run.latency_count);
+
+	printk("BENCH,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u,%u\n", c->fragment, c->burst,
+	       c->noise_ppm, (uint32_t)sizeof(bench_log), dropped, stats->messages,
+	       stats->checksum_errors, stats->oversized, stats->skipped, epochs.count,
+	       run.published,
+	       (uint32_t)(host_ns / NSEC_PER_USEC), bytes_per_sec, latency_avg_ns,
+	       (uint32_t)run.latency_max_ns);
+}
+
+static void bench_print_header(void)
+{
+	printk("BENCH,fragment,burst,noise_ppm,bytes,dropped,messages,checksum_errors,"
+	       "oversized,skipped,epochs,published,host_us,bytes_per_sec,latency_avg_ns,"
+	       "latency_max_ns\n");
+}
+
+/** @brief Injects the whole log, with noise, as described by the case. */
+static void bench_run(const struct bench_case *c)
+{
+	memcpy(bench_stream, bench_log, sizeof(bench_log));
+	rand_state = 1;
+	if (c->noise_ppm > 0) {
+		for (uint32_t i = 0; i < sizeof(bench_stream); i++) {
+			if (bench_rand(0, 999999) < c->noise_ppm) {
+				bench_stream[i] ^= bench_rand(1, 255);
+			}
+		}
+	}
+
+	memset(&run, 0, sizeof(run));
+	ublox_parse_stream_reset();
+	ublox_reset_parse_stats();
+
+	uint32_t offset = 0;
+	uint32_t epoch = 0;
+	uint64_t start = bench_now_ns();
+
+	while (offset < sizeof(bench_stream)) {
+		uint32_t burst_end = MIN(offset + c->burst, sizeof(bench_stream));
+
+		/* The parser thread is cooperative, and runs when unlocked. */
+		k_sched_lock();
+		while (offset < burst_end) {
+			uint32_t cnt = MIN(c->fragment, burst_end - offset);
+
+			gnss_hub_send(GNSS_HUB_ID_DIAGNOSTICS, &bench_stream[offset], cnt);
+			offset += cnt;
+
+			uint64_t now = bench_now_ns();
+			while (epoch < epochs.count && epochs.end[epoch] <= offset) {
+				run.injected_ns[epoch++] = now;
+			}
+		}
+		k_sched_unlock();
+	}
+	uint64_t host_ns = MAX(bench_now_ns() - start, 1);
+
+	struct ublox_parse_stats stats;
+	ublox_get_parse_stats(&stats);
+	uint32_t dropped = sizeof(bench_stream) - stats.bytes;
+
+	bench_print(c, dropped, &stats, host_ns);
+
+	/* Without noise, all data must be published while the hub keeps up. */
+	if (c->noise_ppm == 0 && c->burst <= CONFIG_GNSS_COMM_BUFFER_SIZE / 2) {
+		zassert_equal(dropped, 0, "Dropped %d bytes", dropped);
+		zassert_equal(stats.checksum_errors, 0, "Checksum errors in the log");
+		zassert_equal(run.published, epochs.count, "Published %d of %d epochs",
+			      run.published, epochs.count);
+	}
+}
+
+static void test_bench_parse(void)
+{
+	zassert_equal(gnss_setup(gnss_dev, false), 0, "GNSS setup failed");
+	zassert_equal(gnss_set_data_cb(gnss_dev, bench_data_cb), 0, "");
+
+	bench_index_epochs();
+	zassert_true(epochs.count > 0, "No complete epoch in the log");
+
+	bench_print_header();
+	for (int i = 0; i < ARRAY_SIZE(bench_cases); i++) {
+		bench_run(&bench_cases[i]);
+	}
+}
+
+void test_main(void)
+{
+	k_sem_init(&bench_rcv_sem, 0, 1);
+	k_thread_create(&bench_rcv_thread, bench_rcv_stack, K_KERNEL_STACK_SIZEOF(bench_rcv_stack),
+			(k_thread_entry_t)bench_rcv_fn, NULL, NULL, NULL, K_PRIO_COOP(2), 0,
+			K_NO_WAIT);
+
+	/* The benchmark takes the place of the receiver. */
+	zassert_equal(gnss_hub_set_diagnostics_callback(bench_rcv_data_cb), 0, "");
+	zassert_equal(gnss_hub_configure(GNSS_HUB_MODE_SIMULATOR), 0, "");
+
+	ztest_test_suite(gnss_bench, ztest_unit_test(test_bench_parse));
+	ztest_run_test_suite(gnss_bench);
+}
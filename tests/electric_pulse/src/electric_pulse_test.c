@@ -95,6 +95,7 @@ void test_electric_pulse_release_without_warning(void)
 	/* Submit an electric pulse event with no prior max warning */
 	struct ep_status_event *ep_event = new_ep_status_event();
 	ep_event->ep_status = EP_RELEASE;
+	ep_event->fix_cycles = 0;
 	EVENT_SUBMIT(ep_event);
 
 	int err = k_sem_take(&ep_event_sem, K_SECONDS(5));
@@ -118,6 +119,7 @@ void test_electric_pulse_release_early(void)
 	/* Submit an electric pulse event before safety timer expires */
 	struct ep_status_event *ep_event = new_ep_status_event();
 	ep_event->ep_status = EP_RELEASE;
+	ep_event->fix_cycles = 0;
 	EVENT_SUBMIT(ep_event);
 
 	int err = k_sem_take(&ep_event_sem, K_SECONDS(5));
@@ -146,6 +148,7 @@ void test_electric_pulse_release_ready(void)
 	ztest_returns_value(pwm_pin_set_usec, 0);
 	struct ep_status_event *ready_ep_event = new_ep_status_event();
 	ready_ep_event->ep_status = EP_RELEASE;
+	ready_ep_event->fix_cycles = 0;
 	EVENT_SUBMIT(ready_ep_event);
 
 	/* If no error is received, the semaphore is not given, 
@@ -171,6 +174,7 @@ void test_electric_pulse_release_snd_wrn(void)
 	/* Submit an electric pulse event */
 	struct ep_status_event *ready_ep_event = new_ep_status_event();
 	ready_ep_event->ep_status = EP_RELEASE;
+	ready_ep_event->fix_cycles = 0;
 	EVENT_SUBMIT(ready_ep_event);
 
 	int err = k_sem_take(&ep_event_sem, K_SECONDS(5));
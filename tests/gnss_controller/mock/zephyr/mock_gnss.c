@@ -12,9 +12,9 @@ static int mock_gnss_set_data_cb(const struct device *dev, gnss_data_cb_t gnss_d
 	return ztest_get_return_value();
 }
 
-void simulate_new_gnss_data(const gnss_t gnss_data)
+int simulate_new_gnss_data(const gnss_t gnss_data)
 {
-	data_cb(&gnss_data);
+	return data_cb(&gnss_data);
 }
 
 static int mock_gnss_setup(const struct device *dev, bool dummy)
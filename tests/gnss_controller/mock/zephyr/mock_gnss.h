@@ -6,6 +6,6 @@
 
 //static int gnss_set_data_cb(const struct device *, gnss_data_cb_t);
 
-void simulate_new_gnss_data(const gnss_t);
+int simulate_new_gnss_data(const gnss_t);
 
 //static int gnss_set_lastfix_cb(const struct device *, gnss_lastfix_cb_t);
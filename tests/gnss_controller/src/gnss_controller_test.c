@@ -157,6 +157,29 @@ void test_publish_event_with_gnss_data_callback(void)
 	zassert_equal(err, 0, "Expected gnss data event was not published!");
 }
 
+void test_gnss_snapshots_released(void)
+{
+	gnss_t *snapshots[GNSS_SNAPSHOT_COUNT];
+
+	/* The snapshot of the published data is released after the last subscriber. */
+	k_sleep(K_MSEC(10));
+	for (int i = 0; i < GNSS_SNAPSHOT_COUNT; i++) {
+		snapshots[i] = gnss_snapshot_alloc();
+		zassert_not_null(snapshots[i], "GNSS snapshot %d not released", i);
+	}
+	zassert_is_null(gnss_snapshot_alloc(), "Allocated more GNSS snapshots than the pool");
+
+	/* Published data is dropped while all snapshots are in use. */
+	zassert_equal(simulate_new_gnss_data(dummy_gnss_data), -ENOMEM, "");
+
+	for (int i = 0; i < GNSS_SNAPSHOT_COUNT; i++) {
+		gnss_snapshot_unref(snapshots[i]);
+	}
+	snapshots[0] = gnss_snapshot_alloc();
+	zassert_not_null(snapshots[0], "GNSS snapshots not returned to the pool");
+	gnss_snapshot_unref(snapshots[0]);
+}
+
 void setup_mock_reset(uint16_t *dummy_rate, uint16_t mask)
 {
 	ztest_returns_value(mock_gnss_wakeup, 0);
@@ -183,6 +206,7 @@ void test_gnss_timeout_and_resets(void)
 	/* set controller to expect max data rate */
 	struct gnss_set_mode_event *ev = new_gnss_set_mode_event();
 	ev->mode = GNSSMODE_MAX;
+	ev->rate_ms = 0;
 	EVENT_SUBMIT(ev);
 	k_sem_take(&gnss_set_mode_sem, K_FOREVER);
 	k_sleep(K_MSEC(DEFAULT_MIN_RATE_MS + 10));
@@ -276,6 +300,7 @@ void test_gnss_retries(void)
 	ztest_returns_value(mock_gnss_set_power_mode, -1);
 	struct gnss_set_mode_event *ev = new_gnss_set_mode_event();
 	ev->mode = GNSSMODE_CAUTION;
+	ev->rate_ms = 0;
 	EVENT_SUBMIT(ev);
 	k_sem_take(&gnss_set_mode_sem, K_FOREVER);
 	k_sleep(K_SECONDS(0.25));
@@ -295,6 +320,7 @@ void test_gnss_retries(void)
 	ztest_returns_value(mock_gnss_get_rate, 0);
 	ev = new_gnss_set_mode_event();
 	ev->mode = GNSSMODE_CAUTION;
+	ev->rate_ms = 0;
 	EVENT_SUBMIT(ev);
 	k_sem_take(&gnss_set_mode_sem, K_FOREVER);
 	k_sleep(K_SECONDS(0.25));
@@ -316,6 +342,7 @@ void test_semisteady_gnss_data_stream(void)
 	ztest_returns_value(mock_gnss_get_rate, 0);
 	struct gnss_set_mode_event *ev = new_gnss_set_mode_event();
 	ev->mode = GNSSMODE_MAX;
+	ev->rate_ms = 0;
 	EVENT_SUBMIT(ev);
 	k_sem_take(&gnss_set_mode_sem, K_FOREVER);
 	k_sleep(K_SECONDS(0.25));
@@ -354,6 +381,7 @@ static void test_gnss_set_backup_mode_on_inactive_event(void)
 	ztest_returns_value(mock_gnss_set_backup_mode, 0);
 	struct gnss_set_mode_event *ev = new_gnss_set_mode_event();
 	ev->mode = GNSSMODE_INACTIVE;
+	ev->rate_ms = 0;
 	EVENT_SUBMIT(ev);
 	k_sem_take(&gnss_set_mode_sem, K_FOREVER);
 	k_sleep(K_SECONDS(0.25));
@@ -364,15 +392,15 @@ static bool event_handler(const struct event_header *eh)
 	int ret;
 	if (is_gnss_data(eh)) {
 		struct gnss_data *ev = cast_gnss_data(eh);
-		gnss_t new_data = ev->gnss_data;
+		const gnss_t *new_data = ev->gnss_data;
 		if (!ev->timed_out) {
 			data_count++;
 			k_sem_give(&gnss_data_out);
-			ret = memcmp(&new_data, &dummy_gnss_data, sizeof(gnss_t));
+			ret = memcmp(new_data, &dummy_gnss_data, sizeof(gnss_t));
 			zassert_equal(ret, 0, "Published GNSS data mis-match");
 		} else {
 			timeout_count++;
-			uint8_t *raw_gnss = (uint8_t *)&new_data;
+			const uint8_t *raw_gnss = (const uint8_t *)new_data;
 			for (int i = 0; i < sizeof(gnss_t); i++) {
 				zassert_equal(raw_gnss[i], 0, "Non-zero byte during GNSS timeout!");
 			}
@@ -401,6 +429,7 @@ void test_main(void)
 			 ztest_unit_test(test_init_fails2),
 			 ztest_unit_test(test_init_fails3),
 			 ztest_unit_test(test_publish_event_with_gnss_data_callback),
+			 ztest_unit_test(test_gnss_snapshots_released),
 			 ztest_unit_test(test_gnss_timeout_and_resets),
 			 ztest_unit_test(test_semisteady_gnss_data_stream),
 			 ztest_unit_test(test_gnss_retries),
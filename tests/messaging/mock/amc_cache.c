@@ -2,7 +2,7 @@
 #include "amc_cache.h"
 #include <ztest.h>
 
-bool fnc_valid_fence(void)
+bool fnc_valid_fence(const pasture_t *pasture)
 {
 	return ztest_get_return_value();
 }
@@ -3,7 +3,9 @@
 #ifndef X3_AMC_CACHE_MOCK_H
 #define X3_AMC_CACHE_MOCK_H
 
-bool fnc_valid_fence(void);
+#include "pasture_structure.h"
+
+bool fnc_valid_fence(const pasture_t *pasture);
 bool fnc_valid_def(void);
 
 #endif //X3_AMC_CACHE_MOCK_H
@@ -32,6 +32,10 @@ int stg_write_log_data(uint8_t *data, size_t len)
 	return ztest_get_return_value();
 }
 
+void stg_request_log_flush(void)
+{
+}
+
 int stg_write_ano_data(uint8_t *data, size_t len)
 {
 	return ztest_get_return_value();
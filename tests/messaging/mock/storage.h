@@ -37,6 +37,7 @@ int stg_read_log_data(fcb_read_cb cb, uint16_t num_entries);
 int stg_read_ano_data(fcb_read_cb cb, uint16_t num_entries);
 int stg_read_pasture_data(fcb_read_cb cb);
 int stg_write_log_data(uint8_t *data, size_t len);
+void stg_request_log_flush(void);
 int stg_write_ano_data(uint8_t *data, size_t len);
 int stg_write_pasture_data(uint8_t *data, size_t len);
 uint32_t get_num_entries(flash_partition_t partition);
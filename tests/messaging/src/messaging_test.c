@@ -113,6 +113,8 @@ void test_init(void)
 
 	/* Cache variables for messaging module. */
 	struct gnss_data *ev_gnss = new_gnss_data();
+	ev_gnss->gnss_data = &gnss_snapshot_no_fix;
+	ev_gnss->timed_out = false;
 	EVENT_SUBMIT(ev_gnss);
 
 	struct update_collar_mode *ev_cmode = new_update_collar_mode();
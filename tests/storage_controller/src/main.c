@@ -38,14 +38,27 @@ void test_main(void)
 			 ztest_unit_test(test_init));
 	ztest_run_test_suite(storage_init);
 
+#if CONFIG_STORAGE_LOG_COALESCE
+	/* Test log partition with staged records, which are read back
+	 * without padding and several for every entry.
+	 */
+	ztest_test_suite(storage_log_coalesce_test, ztest_unit_test(test_log_coalesce),
+			 ztest_unit_test(test_log_coalesce_read_staged),
+			 ztest_unit_test(test_log_coalesce_full),
+			 ztest_unit_test(test_log_coalesce_age),
+			 ztest_unit_test(test_log_coalesce_abort));
+	ztest_run_test_suite(storage_log_coalesce_test);
+#else
 	/* Test log partition. */
 	ztest_test_suite(storage_log_test, ztest_unit_test(test_log),
-			 ztest_unit_test(test_log_padding),
+			 ztest_unit_test(test_log_padding), ztest_unit_test(test_log_unaligned),
 			 ztest_unit_test(test_reboot_persistent_log),
 			 ztest_unit_test(test_log_extended), ztest_unit_test(test_no_log_available),
 			 ztest_unit_test(test_log_after_reboot), ztest_unit_test(test_double_clear),
-			 ztest_unit_test(test_rotate_handling));
+			 ztest_unit_test(test_rotate_handling),
+			 ztest_unit_test(test_partition_stats));
 	ztest_run_test_suite(storage_log_test);
+#endif
 
 	/* Test ano partition. */
 	ztest_test_suite(storage_ano_test, ztest_unit_test(test_ano_write_20_days),
@@ -66,6 +79,14 @@ void test_main(void)
 	ztest_test_suite(storage_sys_diag_test, ztest_unit_test(test_sys_diag_log),
 			 ztest_unit_test(test_reboot_persistent_system_diag));
 	ztest_run_test_suite(storage_sys_diag_test);
+
+	/* Test GNSS partition. */
+	ztest_test_suite(storage_gnss_test, ztest_unit_test(test_gnss_write_read),
+			 ztest_unit_test(test_gnss_read_too_large),
+			 ztest_unit_test(test_gnss_replace),
+			 ztest_unit_test(test_reboot_persistent_gnss),
+			 ztest_unit_test(test_no_gnss_available));
+	ztest_run_test_suite(storage_gnss_test);
 }
 
 static bool event_handler(const struct event_header *eh)
@@ -26,6 +26,13 @@ void test_log_after_reboot(void);
 void test_double_clear(void);
 void test_rotate_handling(void);
 void test_log_padding(void);
+void test_log_unaligned(void);
+void test_partition_stats(void);
+void test_log_coalesce(void);
+void test_log_coalesce_read_staged(void);
+void test_log_coalesce_full(void);
+void test_log_coalesce_age(void);
+void test_log_coalesce_abort(void);
 
 /* Ano tests. */
 void test_ano_write_20_days(void);
@@ -38,4 +45,11 @@ void test_reboot_persistent_ano(void);
 void test_sys_diag_log(void);
 void test_reboot_persistent_system_diag(void);
 
+/* GNSS tests. */
+void test_gnss_write_read(void);
+void test_gnss_read_too_large(void);
+void test_gnss_replace(void);
+void test_reboot_persistent_gnss(void);
+void test_no_gnss_available(void);
+
 #endif /* _STORAGE_HELPER_H_ */
\ No newline at end of file
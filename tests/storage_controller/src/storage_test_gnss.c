@@ -0,0 +1,89 @@
+/*
+ * Copyright (c) 2022 Nofence AS
+ */
+
+#include <ztest.h>
+#include "storage.h"
+#include "storage_helper.h"
+
+#include "pm_config.h"
+#include <stdlib.h>
+
+/* Spans several entries, and ends with padding. */
+#define GNSS_DATA_SIZE (3 * STG_GNSS_ENTRY_SIZE + 5)
+
+static uint8_t gnss_data[GNSS_DATA_SIZE];
+static size_t gnss_data_len;
+
+/* Room for the padding of the last entry. */
+static uint8_t gnss_read_buf[GNSS_DATA_SIZE + 4];
+
+static void read_and_verify_gnss(void)
+{
+	size_t len;
+
+	zassert_equal(stg_read_gnss_data(gnss_read_buf, sizeof(gnss_read_buf), &len), 0,
+		      "Read GNSS error.");
+	zassert_true(len >= gnss_data_len && len < gnss_data_len + 4, "");
+	zassert_mem_equal(gnss_read_buf, gnss_data, gnss_data_len, "");
+}
+
+static void fill_gnss_data(uint8_t seed, size_t len)
+{
+	for (size_t i = 0; i < len; i++) {
+		gnss_data[i] = (uint8_t)(seed + i);
+	}
+	gnss_data_len = len;
+}
+
+void test_gnss_write_read(void)
+{
+	fill_gnss_data(0, GNSS_DATA_SIZE);
+	zassert_equal(stg_write_gnss_data(gnss_data, gnss_data_len), 0, "Write GNSS error.");
+	read_and_verify_gnss();
+}
+
+void test_gnss_read_too_large(void)
+{
+	fill_gnss_data(7, GNSS_DATA_SIZE);
+	zassert_equal(stg_write_gnss_data(gnss_data, gnss_data_len), 0, "Write GNSS error.");
+
+	size_t len;
+
+	zassert_equal(stg_read_gnss_data(gnss_read_buf, STG_GNSS_ENTRY_SIZE, &len), -ENOMEM, "");
+}
+
+void test_gnss_replace(void)
+{
+	/* Only the latest state is read back. */
+	for (int i = 0; i < 10; i++) {
+		fill_gnss_data(i, GNSS_DATA_SIZE - i * 100);
+		zassert_equal(stg_write_gnss_data(gnss_data, gnss_data_len), 0,
+			      "Write GNSS error.");
+	}
+	read_and_verify_gnss();
+	zassert_equal(get_num_entries(STG_PARTITION_GNSS),
+		      DIV_ROUND_UP(gnss_data_len, STG_GNSS_ENTRY_SIZE), "");
+}
+
+void test_reboot_persistent_gnss(void)
+{
+	fill_gnss_data(42, 100);
+	zassert_equal(stg_write_gnss_data(gnss_data, gnss_data_len), 0, "Write GNSS error.");
+
+	/* Clear ANO partition so that we do not call date_time. */
+	zassert_false(stg_clear_partition(STG_PARTITION_ANO), "");
+
+	int err = stg_fcb_reset_and_init();
+	zassert_equal(err, 0, "Error simulating reboot and FCB resets.");
+	read_and_verify_gnss();
+}
+
+void test_no_gnss_available(void)
+{
+	zassert_false(stg_clear_partition(STG_PARTITION_GNSS), "");
+	size_t len;
+
+	zassert_equal(stg_read_gnss_data(gnss_read_buf, sizeof(gnss_read_buf), &len), -ENODATA,
+		      "");
+}
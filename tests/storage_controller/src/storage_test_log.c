@@ -78,6 +78,32 @@ void test_log_padding(void)
 	zassert_false(stg_clear_partition(STG_PARTITION_LOG), "");
 }
 
+/* Longer than a write chunk, and not a multiple of 4. */
+static uint32_t unaligned_buf[40];
+#define UNALIGNED_LEN 150
+
+int read_callback_unaligned_log(uint8_t *data, size_t len)
+{
+	zassert_equal(len, ROUND_UP(UNALIGNED_LEN, 4), "");
+	zassert_mem_equal(data, (uint8_t *)unaligned_buf + 1, UNALIGNED_LEN, "");
+	return 0;
+}
+
+/** @brief Checks data that is not word aligned is written unchanged. */
+void test_log_unaligned(void)
+{
+	uint8_t *data = (uint8_t *)unaligned_buf + 1;
+
+	for (int i = 0; i < UNALIGNED_LEN; i++) {
+		data[i] = (uint8_t)(i * 7);
+	}
+
+	zassert_false(stg_clear_partition(STG_PARTITION_LOG), "");
+	zassert_false(stg_write_log_data(data, UNALIGNED_LEN), "");
+	zassert_false(stg_read_log_data(read_callback_unaligned_log, 0), "");
+	zassert_false(stg_clear_partition(STG_PARTITION_LOG), "");
+}
+
 void test_log_extended(void)
 {
 	for (int i = 0; i < expected_log_entries; i++) {
@@ -194,4 +220,191 @@ void test_log_after_reboot(void)
 	 * partition. Should return -ENODATA. 
 	 */
 	zassert_equal(stg_read_log_data(read_callback_multiple_log, 0), -ENODATA, "");
-}
\ No newline at end of file
+}
+/** @brief Checks the partition stats follow writes, rotation, reboots and
+ *         clears, and match the entries read back.
+ */
+void test_partition_stats(void)
+{
+	stg_partition_stats_t stats;
+	size_t entry_size = ROUND_UP(dummy_log_len, 4);
+
+	zassert_equal(stg_clear_partition(STG_PARTITION_LOG), 0, "");
+	zassert_equal(stg_get_partition_stats(STG_PARTITION_LOG, &stats), 0, "");
+	zassert_equal(stats.entries, 0, "");
+	zassert_equal(stats.bytes, 0, "");
+
+	for (int i = 0; i < 10; i++) {
+		zassert_equal(stg_write_log_data((uint8_t *)&dummy_log, dummy_log_len), 0,
+			      "Write log error.");
+	}
+	zassert_equal(stg_get_partition_stats(STG_PARTITION_LOG, &stats), 0, "");
+	zassert_equal(stats.entries, 10, "");
+	zassert_equal(stats.bytes, 10 * entry_size, "");
+
+	/* Recovered when mounted. */
+	zassert_equal(stg_fcb_reset_and_init(), 0, "Error simulating reboot and FCB resets.");
+	zassert_equal(stg_get_partition_stats(STG_PARTITION_LOG, &stats), 0, "");
+	zassert_equal(stats.entries, 10, "");
+	zassert_equal(stats.bytes, 10 * entry_size, "");
+
+	/* Write past the size of the partition, so that it rotates. */
+	uint32_t num_entries = (PM_LOG_PARTITION_SIZE / sizeof(log_rec_t)) + 1;
+	for (int i = 0; i < num_entries; i++) {
+		zassert_equal(stg_write_log_data((uint8_t *)&dummy_log, dummy_log_len), 0,
+			      "Write log error.");
+	}
+	zassert_equal(stg_get_partition_stats(STG_PARTITION_LOG, &stats), 0, "");
+	zassert_equal(stats.bytes, stats.entries * entry_size, "");
+	zassert_true(stats.newest_sector_id != stats.oldest_sector_id, "");
+
+	num_multiple_log_reads = 0;
+	zassert_equal(stg_read_log_data(read_callback_multiple_log, 0), 0, "");
+	zassert_equal(num_multiple_log_reads, stats.entries, "");
+
+	zassert_equal(stg_clear_partition(STG_PARTITION_LOG), 0, "");
+	zassert_equal(get_num_entries(STG_PARTITION_LOG), 0, "");
+}
+
+#if CONFIG_STORAGE_LOG_COALESCE
+/* Several fit in the staging buffer. */
+static uint8_t coalesce_record[61];
+static uint8_t coalesce_large[CONFIG_STORAGE_LOG_COALESCE_SIZE];
+static uint32_t coalesce_num_read;
+static bool coalesce_large_read;
+
+int read_callback_coalesce(uint8_t *data, size_t len)
+{
+	if (len == sizeof(coalesce_large)) {
+		zassert_mem_equal(data, coalesce_large, sizeof(coalesce_large), "");
+		coalesce_large_read = true;
+		return 0;
+	}
+
+	/* Staged records are read back without padding. */
+	zassert_equal(len, sizeof(coalesce_record), "");
+	zassert_mem_equal(data, coalesce_record, sizeof(coalesce_record), "");
+	zassert_false(coalesce_large_read, "Records read out of order.");
+	coalesce_num_read++;
+	return 0;
+}
+
+static void write_coalesce_records(uint32_t num_records)
+{
+	for (int i = 0; i < sizeof(coalesce_record); i++) {
+		coalesce_record[i] = (uint8_t)i;
+	}
+	for (int i = 0; i < num_records; i++) {
+		zassert_equal(stg_write_log_data(coalesce_record, sizeof(coalesce_record)), 0,
+			      "Write log error.");
+	}
+	coalesce_num_read = 0;
+	coalesce_large_read = false;
+}
+
+/** @brief Checks staged records are written as one entry, and read back one
+ *         record at a time.
+ */
+void test_log_coalesce(void)
+{
+	zassert_equal(stg_clear_partition(STG_PARTITION_LOG), 0, "");
+
+	write_coalesce_records(3);
+	zassert_equal(get_num_entries(STG_PARTITION_LOG), 0, "");
+
+	zassert_equal(stg_flush_log_data(), 0, "");
+	zassert_equal(get_num_entries(STG_PARTITION_LOG), 1, "");
+
+	zassert_equal(stg_read_log_data(read_callback_coalesce, 0), 0, "");
+	zassert_equal(coalesce_num_read, 3, "");
+}
+
+/** @brief Checks staged records are read without flushing them first. */
+void test_log_coalesce_read_staged(void)
+{
+	zassert_equal(stg_clear_partition(STG_PARTITION_LOG), 0, "");
+
+	write_coalesce_records(1);
+	zassert_equal(stg_read_log_data(read_callback_coalesce, 0), 0, "");
+	zassert_equal(coalesce_num_read, 1, "");
+}
+
+/** @brief Checks records are written when the buffer is full, and read back
+ *         in order together with a record too large to be staged.
+ */
+void test_log_coalesce_full(void)
+{
+	uint32_t num_records = 3 * CONFIG_STORAGE_LOG_COALESCE_SIZE / sizeof(coalesce_record);
+
+	zassert_equal(stg_clear_partition(STG_PARTITION_LOG), 0, "");
+
+	write_coalesce_records(num_records);
+	zassert_true(get_num_entries(STG_PARTITION_LOG) >= 3, "");
+
+	memset(coalesce_large, 0xA5, sizeof(coalesce_large));
+	zassert_equal(stg_write_log_data(coalesce_large, sizeof(coalesce_large)), 0,
+		      "Write log error.");
+
+	zassert_equal(stg_read_log_data(read_callback_coalesce, 0), 0, "");
+	zassert_equal(coalesce_num_read, num_records, "");
+	zassert_true(coalesce_large_read, "");
+}
+
+/** @brief Checks staged records are written once the oldest is old enough. */
+void test_log_coalesce_age(void)
+{
+	zassert_equal(stg_clear_partition(STG_PARTITION_LOG), 0, "");
+
+	write_coalesce_records(1);
+	zassert_equal(get_num_entries(STG_PARTITION_LOG), 0, "");
+
+	k_sleep(K_SECONDS(CONFIG_STORAGE_LOG_COALESCE_MAX_AGE_SEC + 1));
+	zassert_equal(get_num_entries(STG_PARTITION_LOG), 1, "");
+}
+
+static uint32_t coalesce_next_seq;
+static uint32_t coalesce_abort_after;
+
+int read_callback_coalesce_abort(uint8_t *data, size_t len)
+{
+	if (coalesce_abort_after == 0) {
+		return -EBUSY;
+	}
+	coalesce_abort_after--;
+
+	/* Every record is read once, in order. */
+	zassert_equal(len, sizeof(coalesce_record), "");
+	zassert_equal(data[0], (uint8_t)coalesce_next_seq, "Record read again or skipped.");
+	coalesce_next_seq++;
+	return 0;
+}
+
+/** @brief Checks a read aborted in the middle of an entry resumes after the
+ *         last record read, also when the read was aborted in a later entry.
+ */
+void test_log_coalesce_abort(void)
+{
+	uint32_t num_records = 3 * CONFIG_STORAGE_LOG_COALESCE_SIZE / sizeof(coalesce_record);
+
+	zassert_equal(stg_clear_partition(STG_PARTITION_LOG), 0, "");
+
+	for (int i = 0; i < num_records; i++) {
+		coalesce_record[0] = (uint8_t)i;
+		zassert_equal(stg_write_log_data(coalesce_record, sizeof(coalesce_record)), 0,
+			      "Write log error.");
+	}
+	coalesce_next_seq = 0;
+
+	/* In the first entry, then in a later one. */
+	coalesce_abort_after = 2;
+	zassert_equal(stg_read_log_data(read_callback_coalesce_abort, 0), -EBUSY, "");
+	zassert_equal(coalesce_next_seq, 2, "");
+
+	coalesce_abort_after = CONFIG_STORAGE_LOG_COALESCE_SIZE / sizeof(coalesce_record) + 1;
+	zassert_equal(stg_read_log_data(read_callback_coalesce_abort, 0), -EBUSY, "");
+
+	coalesce_abort_after = num_records;
+	zassert_equal(stg_read_log_data(read_callback_coalesce_abort, 0), 0, "");
+	zassert_equal(coalesce_next_seq, num_records, "");
+}
+#endif
@@ -15,39 +15,36 @@
 
 #include "storage.h"
 
-pasture_t pasture;
+static uint8_t pasture_buf[PASTURE_MAX_SIZE] __aligned(4);
+static pasture_t *const pasture = (pasture_t *)pasture_buf;
 
 void init_dummy_pasture(void)
 {
-	pasture.m.ul_total_fences = 2;
-
-	pasture.fences[0].m.fence_no = 0;
-	pasture.fences[0].m.n_points = 2;
-	pasture.fences[0].coordinates[0].s_x_dm = 1;
-	pasture.fences[0].coordinates[0].s_y_dm = 2;
-	pasture.fences[0].coordinates[1].s_x_dm = 3;
-	pasture.fences[0].coordinates[1].s_y_dm = 4;
-
-	pasture.fences[1].m.fence_no = 1;
-	pasture.fences[1].m.n_points = 3;
-	pasture.fences[1].coordinates[0].s_x_dm = 1;
-	pasture.fences[1].coordinates[0].s_y_dm = 2;
-	pasture.fences[1].coordinates[1].s_x_dm = 3;
-	pasture.fences[1].coordinates[1].s_y_dm = 4;
-	pasture.fences[1].coordinates[2].s_x_dm = 5;
-	pasture.fences[1].coordinates[2].s_y_dm = 6;
+	fence_coordinate_t points[] = {
+		{ .s_x_dm = 1, .s_y_dm = 2 },
+		{ .s_x_dm = 3, .s_y_dm = 4 },
+		{ .s_x_dm = 5, .s_y_dm = 6 },
+	};
+
+	zassert_false(pasture_init(pasture, sizeof(pasture_buf), 2), "");
+
+	fence_t fence0 = { .m = { .fence_no = 0, .n_points = 2 } };
+	zassert_false(pasture_add_fence(pasture, sizeof(pasture_buf), 0, &fence0, points), "");
+
+	fence_t fence1 = { .m = { .fence_no = 1, .n_points = 3 } };
+	zassert_false(pasture_add_fence(pasture, sizeof(pasture_buf), 1, &fence1, points), "");
 }
 
 int read_callback_pasture(uint8_t *data, size_t len)
 {
-	zassert_equal(len, sizeof(pasture_t), "");
-	zassert_mem_equal((pasture_t *)data, &pasture, len, "");
+	zassert_equal(len, pasture_size(pasture), "");
+	zassert_mem_equal((pasture_t *)data, pasture, len, "");
 	return 0;
 }
 
 void test_pasture(void)
 {
-	zassert_equal(stg_write_pasture_data((uint8_t *)&pasture, sizeof(pasture)), 0,
+	zassert_equal(stg_write_pasture_data(pasture_buf, pasture_size(pasture)), 0,
 		      "Write pasture error.");
 	zassert_equal(stg_read_pasture_data(read_callback_pasture), 0, "Read pasture error.");
 }
@@ -55,7 +52,7 @@ void test_pasture(void)
 void test_pasture_extended_write_read(void)
 {
 	for (int i = 0; i < 5; i++) {
-		zassert_equal(stg_write_pasture_data((uint8_t *)&pasture, sizeof(pasture)), 0,
+		zassert_equal(stg_write_pasture_data(pasture_buf, pasture_size(pasture)), 0,
 			      "Write pasture error.");
 	}
 	zassert_equal(stg_read_pasture_data(read_callback_pasture), 0, "Read pasture error.");
@@ -63,7 +60,7 @@ void test_pasture_extended_write_read(void)
 
 void test_reboot_persistent_pasture(void)
 {
-	zassert_equal(stg_write_pasture_data((uint8_t *)&pasture, sizeof(pasture)), 0,
+	zassert_equal(stg_write_pasture_data(pasture_buf, pasture_size(pasture)), 0,
 		      "Write pasture error.");
 
 	/* Clear ANO partition so that we do not call date_time. */
@@ -83,7 +80,7 @@ void test_reboot_persistent_pasture(void)
  */
 void test_request_pasture_multiple(void)
 {
-	zassert_equal(stg_write_pasture_data((uint8_t *)&pasture, sizeof(pasture)), 0,
+	zassert_equal(stg_write_pasture_data(pasture_buf, pasture_size(pasture)), 0,
 		      "Write pasture error.");
 
 	zassert_equal(stg_read_pasture_data(read_callback_pasture), 0, "Read pasture error.");
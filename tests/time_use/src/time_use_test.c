@@ -222,6 +222,23 @@ static void test_animal_behave()
 	zassert_equal(histogram.animal_behave.usRunningDist, 100, "");
 }
 
+static void submit_gnss_data(int16_t height, uint16_t speed)
+{
+	gnss_t *gnss = gnss_snapshot_alloc();
+	zassert_not_null(gnss, "No free GNSS snapshot");
+	memset(gnss, 0, sizeof(gnss_t));
+	gnss->fix_ok = true;
+	gnss->latest.mode = GNSSMODE_CAUTION;
+	gnss->latest.pvt_flags = 0;
+	gnss->latest.height = height;
+	gnss->latest.speed = speed;
+
+	struct gnss_data *ev = new_gnss_data();
+	ev->gnss_data = gnss;
+	ev->timed_out = false;
+	EVENT_SUBMIT(ev);
+}
+
 static void test_gnss_baro()
 {
 	collar_histogram histogram;
@@ -237,22 +254,9 @@ static void test_gnss_baro()
 	zassert_equal(histogram.qc_baro_gps_max_mean_min.usGpsSpeedMax, 0, "");
 	zassert_equal(histogram.qc_baro_gps_max_mean_min.usGpsSpeedMean, 0, "");
 
-	struct gnss_data *ev = new_gnss_data();
-
-	ev->gnss_data.fix_ok = true;
-	ev->gnss_data.latest.mode = GNSSMODE_CAUTION;
-	ev->gnss_data.latest.pvt_flags = 0;
-	ev->gnss_data.latest.height = 100;
-	ev->gnss_data.latest.speed = 200;
-	EVENT_SUBMIT(ev);
+	submit_gnss_data(100, 200);
 	k_yield();
-	ev = new_gnss_data();
-	ev->gnss_data.fix_ok = true;
-	ev->gnss_data.latest.mode = GNSSMODE_CAUTION;
-	ev->gnss_data.latest.pvt_flags = 0;
-	ev->gnss_data.latest.height = 200;
-	ev->gnss_data.latest.speed = 400;
-	EVENT_SUBMIT(ev);
+	submit_gnss_data(200, 400);
 	k_sleep(K_SECONDS(10));
 	reset_stats_bufs_now(&histogram);
 	zassert_equal(histogram.qc_baro_gps_max_mean_min.usGpsHeightMin, 100, "");
@@ -263,21 +267,9 @@ static void test_gnss_baro()
 	zassert_equal(histogram.qc_baro_gps_max_mean_min.usGpsSpeedMean, 300, "");
 
 	/* test that a new collection does not use old variables */
-	ev = new_gnss_data();
-	ev->gnss_data.fix_ok = true;
-	ev->gnss_data.latest.mode = GNSSMODE_CAUTION;
-	ev->gnss_data.latest.pvt_flags = 0;
-	ev->gnss_data.latest.height = 120;
-	ev->gnss_data.latest.speed = 220;
-	EVENT_SUBMIT(ev);
+	submit_gnss_data(120, 220);
 	k_yield();
-	ev = new_gnss_data();
-	ev->gnss_data.fix_ok = true;
-	ev->gnss_data.latest.mode = GNSSMODE_CAUTION;
-	ev->gnss_data.latest.pvt_flags = 0;
-	ev->gnss_data.latest.height = 190;
-	ev->gnss_data.latest.speed = 390;
-	EVENT_SUBMIT(ev);
+	submit_gnss_data(190, 390);
 	k_sleep(K_SECONDS(10));
 	reset_stats_bufs_now(&histogram);
 	zassert_equal(histogram.qc_baro_gps_max_mean_min.usGpsHeightMin, 120, "");
@@ -294,18 +286,28 @@ static void test_gnss_mode_switches()
 	reset_stats_bufs_now(&histogram);
 	struct gnss_set_mode_event *ev = new_gnss_set_mode_event();
 	ev->mode = GNSSMODE_INACTIVE;
+	ev->rate_ms = 0;
 	EVENT_SUBMIT(ev);
 	k_yield();
 	ev = new_gnss_set_mode_event();
 	ev->mode = GNSSMODE_PSM;
+	ev->rate_ms = 0;
 	EVENT_SUBMIT(ev);
 	k_yield();
 	ev = new_gnss_set_mode_event();
 	ev->mode = GNSSMODE_CAUTION;
+	ev->rate_ms = 0;
+	EVENT_SUBMIT(ev);
+	k_yield();
+	ev = new_gnss_set_mode_event();
+	ev->mode = GNSSMODE_MAX;
+	ev->rate_ms = 0;
 	EVENT_SUBMIT(ev);
 	k_yield();
+	/* A rate change in the same mode is not a switch. */
 	ev = new_gnss_set_mode_event();
 	ev->mode = GNSSMODE_MAX;
+	ev->rate_ms = 500;
 	EVENT_SUBMIT(ev);
 	k_yield();
 	k_sleep(K_SECONDS(10));